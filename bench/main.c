@@ -0,0 +1,1031 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+#include "pjson.h"
+#include "stats_parser.h"
+#include "specialized_stats_parser.h"
+
+#ifndef PJSON_BENCH_DATA_DIR
+#define PJSON_BENCH_DATA_DIR "test/data"
+#endif
+
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
+#define DEFAULT_ITERATION_COUNT (20)
+
+typedef struct {
+  const char *name;
+  uint8_t *data;
+  size_t length;
+} bench_input;
+
+typedef bool (*bench_fn)(const bench_input *input, size_t chunk_size);
+
+/** Small messages stored back to back in a single buffer. */
+typedef struct {
+  uint8_t *data;
+  size_t *offsets; // offsets[i] and offsets[i + 1] delimit message i
+  size_t count;
+} bench_messages;
+
+typedef bool (*bench_messages_fn)(const bench_messages *messages);
+
+#define MESSAGE_COUNT (10000)
+
+/* Helpers */
+
+static bool load_file(bench_input *input, const char *name, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return false;
+
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  input->name = name;
+  input->data = (uint8_t *)malloc(length > 0 ? (size_t)length : 1u);
+  input->length = input->data ? fread(input->data, 1, (size_t)length, file) : 0;
+  fclose(file);
+  return input->data && input->length == (size_t)length;
+}
+
+/**
+ * Synthesize a ~1 MB array of objects whose string values are dominated by CJK characters and emoji
+ * (there is no such sample among the test data files).
+ */
+static bool make_utf8_input(bench_input *input, const char *name) {
+  static const char *const words[] = {
+    "\xe4\xbd\xa0\xe5\xa5\xbd", "\xe4\xb8\x96\xe7\x95\x8c", "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e",
+    "\xed\x95\x9c\xea\xb5\xad\xec\x96\xb4", "\xf0\x9f\x98\x80", "\xf0\x9f\x8e\x89", "JSON", " ",
+  };
+  const size_t capacity = 1024 * 1024, max_record_length = 1024;
+
+  input->name = name;
+  input->data = (uint8_t *)malloc(capacity);
+  if (!input->data) return false;
+
+  char *p = (char *)input->data, *const end = p + capacity - max_record_length;
+  unsigned seed = 1;
+  *p++ = '[';
+  for (size_t id = 0; p < end; id++) {
+    p += sprintf(p, "%s\n  {\"id\": %zu, \"title\": \"", id ? "," : "", id);
+    for (int i = 0; i < 8; i++) {
+      seed = seed * 1103515245 + 12345;
+      p += sprintf(p, "%s", words[(seed >> 16) % pjson_countof(words)]);
+    }
+    p += sprintf(p, "\", \"text\": \"");
+    for (int i = 0; i < 40; i++) {
+      seed = seed * 1103515245 + 12345;
+      p += sprintf(p, "%s", words[(seed >> 16) % pjson_countof(words)]);
+    }
+    p += sprintf(p, "\"}");
+  }
+  p += sprintf(p, "\n]\n");
+
+  input->length = p - (char *)input->data;
+  return true;
+}
+
+/**
+ * Synthesize `MESSAGE_COUNT` small (~100-500 bytes) messages like the ones of an RPC or event stream.
+ */
+static bool make_messages(bench_messages *messages) {
+  const size_t max_message_length = 512;
+
+  messages->count = MESSAGE_COUNT;
+  messages->data = (uint8_t *)malloc(MESSAGE_COUNT * max_message_length);
+  messages->offsets = (size_t *)malloc((MESSAGE_COUNT + 1) * sizeof(size_t));
+  if (!messages->data || !messages->offsets) return false;
+
+  char *p = (char *)messages->data;
+  unsigned seed = 1;
+  for (size_t id = 0; id < MESSAGE_COUNT; id++) {
+    messages->offsets[id] = p - (char *)messages->data;
+    p += sprintf(p, "{\"id\": %zu, \"type\": \"event\", \"user\": {\"name\": \"user%zu\", \"verified\": %s}, \"values\": [",
+      id, id % 1000, id % 3 ? "true" : "false");
+    seed = seed * 1103515245 + 12345;
+    for (unsigned i = 0, n = 1 + (seed >> 16) % 32; i < n; i++) {
+      seed = seed * 1103515245 + 12345;
+      p += sprintf(p, "%s%u.%02u", i ? ", " : "", (seed >> 16) % 1000, (seed >> 8) % 100);
+    }
+    p += sprintf(p, "], \"note\": null}");
+  }
+  messages->offsets[MESSAGE_COUNT] = p - (char *)messages->data;
+  return true;
+}
+
+static pjson_parsing_status feed_in_chunks(pjson_tokenizer *tokenizer, const bench_input *input, size_t chunk_size) {
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  for (size_t offset = 0; offset < input->length; offset += chunk_size) {
+    size_t length = input->length - offset;
+    if (length > chunk_size) length = chunk_size;
+    status = pjson_feed(tokenizer, input->data + offset, length);
+    if (status != PJSON_STATUS_DATA_NEEDED) break;
+  }
+  return status;
+}
+
+static void run(const char *name, bench_fn fn, const bench_input *input, size_t chunk_size, int iterations) {
+  uint64_t best_ns = UINT64_MAX;
+#ifdef HAS_CYCLE_COUNTER
+  uint64_t best_cycles = UINT64_MAX;
+#endif
+
+  for (int i = 0; i < iterations; i++) {
+#ifdef HAS_CYCLE_COUNTER
+    uint64_t start_cycles = read_cycle_counter();
+#endif
+    uint64_t start_ns = now_ns();
+
+    if (!fn(input, chunk_size)) {
+      printf("%-12s %-20s FAILED\n", name, input->name);
+      return;
+    }
+
+    uint64_t elapsed_ns = now_ns() - start_ns;
+#ifdef HAS_CYCLE_COUNTER
+    uint64_t elapsed_cycles = read_cycle_counter() - start_cycles;
+    if (elapsed_cycles < best_cycles) best_cycles = elapsed_cycles;
+#endif
+    if (elapsed_ns < best_ns) best_ns = elapsed_ns;
+  }
+
+  double mb_per_s = (double)input->length / (1024.0 * 1024.0) / ((double)best_ns / 1e9);
+  printf("%-12s %-20s %9.1f MB/s %8.3f ns/B", name, input->name, mb_per_s, (double)best_ns / (double)input->length);
+#ifdef HAS_CYCLE_COUNTER
+  printf(" %8.3f cycles/B", (double)best_cycles / (double)input->length);
+#endif
+  puts("");
+}
+
+static void run_messages(const char *name, bench_messages_fn fn, const bench_messages *messages, int iterations) {
+  uint64_t best_ns = UINT64_MAX;
+
+  for (int i = 0; i < iterations; i++) {
+    uint64_t start_ns = now_ns();
+
+    if (!fn(messages)) {
+      printf("%-12s %-20s FAILED\n", name, "messages");
+      return;
+    }
+
+    uint64_t elapsed_ns = now_ns() - start_ns;
+    if (elapsed_ns < best_ns) best_ns = elapsed_ns;
+  }
+
+  size_t length = messages->offsets[messages->count];
+  printf("%-12s %-20s %9.1f MB/s %8.1f ns/message\n", name, "messages",
+    (double)length / (1024.0 * 1024.0) / ((double)best_ns / 1e9), (double)best_ns / (double)messages->count);
+}
+
+/* Benchmarks */
+
+static bool bench_tokenize(const bench_input *input, size_t chunk_size) {
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, NULL);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  return pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED;
+}
+
+typedef struct {
+  pjson_token_sink base;
+  size_t token_counts[PJSON_TOKEN_EOS + 1];
+} counting_sink;
+
+static pjson_parsing_status counting_sink_eat(pjson_token_sink *sink, const pjson_token *tokens, size_t count) {
+  counting_sink *counter = (counting_sink *)sink;
+  for (size_t i = 0; i < count; i++) {
+    counter->token_counts[tokens[i].type]++;
+  }
+  return tokens[count - 1].type != PJSON_TOKEN_EOS ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_COMPLETED;
+}
+
+static bool bench_tokenize_batch(const bench_input *input, size_t chunk_size) {
+  static pjson_token tokens[256];
+  counting_sink sink = { { &counting_sink_eat, tokens, pjson_countof(tokens) }, { 0 } };
+
+  pjson_tokenizer tokenizer;
+  pjson_init_batch(&tokenizer, &sink.base);
+  for (size_t offset = 0; offset < input->length; offset += chunk_size) {
+    size_t length = input->length - offset;
+    if (length > chunk_size) length = chunk_size;
+    if (pjson_feed_batch(&tokenizer, input->data + offset, length) != PJSON_STATUS_DATA_NEEDED) break;
+  }
+  return pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED && sink.token_counts[PJSON_TOKEN_EOS] == 1;
+}
+
+static bool bench_tokenize_scatter(const bench_input *input, size_t chunk_size) {
+  // The chunks are parts of the input buffer, which stays valid, so strings straddling them need not be copied.
+  pjson_tokenizer_options options = { .scatter_strings = true };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, NULL, &options);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  return pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED;
+}
+
+static bool bench_parse(const bench_input *input, size_t chunk_size) {
+  static stats_parser parser;
+  stats_parser_init(&parser, false);
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  return pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED;
+}
+
+static bool bench_parse_specialized(const bench_input *input, size_t chunk_size) {
+  static specialized_stats_parser parser;
+  specialized_stats stats;
+  memset(&stats, 0, sizeof(stats));
+  specialized_stats_parser_init(&parser, false);
+  parser.user_data = &stats;
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  return pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED;
+}
+
+/** Parser which only looks at the first levels of the input and skips deeper arrays and objects. */
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  size_t max_depth; // deepest level (counting the top-level context as 1) whose arrays and objects are parsed
+  size_t value_count;
+} skimming_parser;
+
+static pjson_parsing_status skimming_parser_on_value(skimming_parser *parser, pjson_parser_context *context, const pjson_token *token) {
+  (void)context;
+  switch (token->type) {
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      // parser->base.depth already includes the context of the array or object.
+      if (parser->base.depth > parser->max_depth) return PJSON_STATUS_SKIP;
+      parser->base.context->on_value = (pjson_parser_context_callback)&skimming_parser_on_value;
+      return PJSON_STATUS_SUCCESS;
+
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      parser->value_count++;
+      return PJSON_STATUS_SUCCESS;
+  }
+}
+
+static void skimming_parser_init(skimming_parser *parser, size_t max_depth, bool validate_skipped_values) {
+  pjson_parser_options options = { .validate_skipped_values = validate_skipped_values };
+  pjson_parser_init_ex(&parser->base, false, &options);
+  parser->base.context->on_value = (pjson_parser_context_callback)&skimming_parser_on_value;
+  parser->max_depth = max_depth;
+  parser->value_count = 0;
+}
+
+static bool bench_skim(const bench_input *input, size_t chunk_size, bool validate_skipped_values) {
+  // The inputs are arrays of objects: only their primitive properties are looked at.
+  static skimming_parser parser;
+  skimming_parser_init(&parser, 3, validate_skipped_values);
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  bool ok = pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED && parser.value_count > 0;
+  pjson_parser_free(&parser.base);
+  return ok;
+}
+
+static bool bench_skip(const bench_input *input, size_t chunk_size) {
+  return bench_skim(input, chunk_size, false);
+}
+
+static bool bench_skip_validating(const bench_input *input, size_t chunk_size) {
+  return bench_skim(input, chunk_size, true);
+}
+
+/** Parser which looks up every property name in the list of the names used by the 1 MB inputs. */
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  const pjson_name_table *table; // the names are compared one by one if NULL
+  size_t found_count;
+} naming_parser;
+
+static const char *const input_property_names[] = {
+  "_id", "index", "guid", "isActive", "balance", "picture", "age", "eyeColor", "name", "gender", "company", "email",
+  "phone", "address", "about", "registered", "latitude", "longitude", "tags", "friends", "greeting", "favoriteFruit", "id",
+};
+
+static pjson_parsing_status naming_parser_on_name(naming_parser *parser, pjson_parser_context *context, const pjson_token *token) {
+  (void)context;
+  if (parser->table) {
+    parser->found_count += pjson_name_table_find(parser->table, token) < parser->table->name_count;
+    return PJSON_STATUS_SUCCESS;
+  }
+
+  for (size_t i = 0; i < pjson_countof(input_property_names); i++) {
+    if (strlen(input_property_names[i]) == token->unescaped_length
+      && !memcmp(input_property_names[i], token->unescaped, token->unescaped_length)) {
+      parser->found_count++;
+      break;
+    }
+  }
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status naming_parser_on_value(naming_parser *parser, pjson_parser_context *context, const pjson_token *token) {
+  (void)context;
+  if (token->type == PJSON_TOKEN_OPEN_BRACKET || token->type == PJSON_TOKEN_OPEN_BRACE) {
+    parser->base.context->on_value = (pjson_parser_context_callback)&naming_parser_on_value;
+    parser->base.context->on_object_property_name = (pjson_parser_context_callback)&naming_parser_on_name;
+  }
+  return PJSON_STATUS_SUCCESS;
+}
+
+static bool bench_names(const bench_input *input, size_t chunk_size, const pjson_name_table *table) {
+  static naming_parser parser;
+  pjson_parser_init_ex(&parser.base, false, NULL);
+  parser.base.context->on_value = (pjson_parser_context_callback)&naming_parser_on_value;
+  parser.table = table;
+  parser.found_count = 0;
+
+  // Comparing the names one by one needs them unescaped, the table unescapes only the names with escape sequences.
+  pjson_tokenizer_options options = { .unescape_strings = !table };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  bool ok = pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED;
+  pjson_parser_free(&parser.base);
+  return ok;
+}
+
+static bool bench_names_compare(const bench_input *input, size_t chunk_size) {
+  return bench_names(input, chunk_size, NULL);
+}
+
+static bool bench_names_table(const bench_input *input, size_t chunk_size) {
+  static pjson_name_table table;
+  static bool is_table_built = false;
+  if (!is_table_built) {
+    if (pjson_name_table_init(&table, input_property_names, pjson_countof(input_property_names), NULL) != PJSON_STATUS_SUCCESS) return false;
+    is_table_built = true;
+  }
+  return bench_names(input, chunk_size, &table);
+}
+
+/** Struct for the records of the 1 MB inputs. */
+typedef struct {
+  int32_t id;
+  pjson_string name;
+} bench_friend;
+
+typedef struct {
+  pjson_string id, guid, balance, picture, eye_color, name, gender, company, email, phone, address, about, registered;
+  pjson_string greeting, favorite_fruit;
+  int32_t index, age;
+  bool is_active;
+  double latitude, longitude;
+  pjson_array tags, friends;
+} bench_record;
+
+static const pjson_field_descriptor bench_friend_fields[] = {
+  PJSON_FIELD("id", bench_friend, id, PJSON_FIELD_INT32),
+  PJSON_FIELD("name", bench_friend, name, PJSON_FIELD_STRING),
+};
+static const pjson_struct_descriptor bench_friend_descriptor = PJSON_STRUCT_DESCRIPTOR(bench_friend, bench_friend_fields);
+
+static const pjson_field_descriptor bench_record_fields[] = {
+  PJSON_FIELD("_id", bench_record, id, PJSON_FIELD_STRING),
+  PJSON_FIELD("index", bench_record, index, PJSON_FIELD_INT32),
+  PJSON_FIELD("guid", bench_record, guid, PJSON_FIELD_STRING),
+  PJSON_FIELD("isActive", bench_record, is_active, PJSON_FIELD_BOOL),
+  PJSON_FIELD("balance", bench_record, balance, PJSON_FIELD_STRING),
+  PJSON_FIELD("picture", bench_record, picture, PJSON_FIELD_STRING),
+  PJSON_FIELD("age", bench_record, age, PJSON_FIELD_INT32),
+  PJSON_FIELD("eyeColor", bench_record, eye_color, PJSON_FIELD_STRING),
+  PJSON_FIELD("name", bench_record, name, PJSON_FIELD_STRING),
+  PJSON_FIELD("gender", bench_record, gender, PJSON_FIELD_STRING),
+  PJSON_FIELD("company", bench_record, company, PJSON_FIELD_STRING),
+  PJSON_FIELD("email", bench_record, email, PJSON_FIELD_STRING),
+  PJSON_FIELD("phone", bench_record, phone, PJSON_FIELD_STRING),
+  PJSON_FIELD("address", bench_record, address, PJSON_FIELD_STRING),
+  PJSON_FIELD("about", bench_record, about, PJSON_FIELD_STRING),
+  PJSON_FIELD("registered", bench_record, registered, PJSON_FIELD_STRING),
+  PJSON_FIELD("latitude", bench_record, latitude, PJSON_FIELD_DOUBLE),
+  PJSON_FIELD("longitude", bench_record, longitude, PJSON_FIELD_DOUBLE),
+  PJSON_ARRAY_FIELD("tags", bench_record, tags, PJSON_FIELD_STRING),
+  PJSON_OBJECT_ARRAY_FIELD("friends", bench_record, friends, bench_friend_descriptor),
+  PJSON_FIELD("greeting", bench_record, greeting, PJSON_FIELD_STRING),
+  PJSON_FIELD("favoriteFruit", bench_record, favorite_fruit, PJSON_FIELD_STRING),
+};
+static const pjson_struct_descriptor bench_record_descriptor = PJSON_STRUCT_DESCRIPTOR(bench_record, bench_record_fields);
+
+static bool bench_bind(const bench_input *input, size_t chunk_size) {
+  // The arena keeps its blocks from one iteration to the next, like a server reusing it for every request.
+  static pjson_arena arena;
+  static bool is_arena_initialized = false;
+  if (!is_arena_initialized) {
+    pjson_arena_init(&arena, NULL, 0, NULL);
+    is_arena_initialized = true;
+  }
+  pjson_arena_reset(&arena);
+
+  pjson_array records;
+  pjson_binding binding;
+  if (pjson_binding_init(&binding, &bench_record_descriptor, true, &records, &arena, NULL) != PJSON_STATUS_SUCCESS) return false;
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &binding.parser.base);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  bool ok = pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED && records.count > 0;
+  pjson_binding_free(&binding);
+  return ok;
+}
+
+/**
+ * Hand-written parser filling the same structs as `bench_bind`, in the style of test/datastruct_parser.h: the names are
+ * compared one by one, and every member type has its own callback. Baseline for the binding.
+ */
+typedef struct {
+  pjson_parser_context base; // base struct MUST be the first member!
+  void *object; // record or friend being filled
+  void *member; // member of the current property
+  pjson_array *array; // array being filled
+} hand_context;
+
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  pjson_arena *arena;
+  pjson_array *records;
+} hand_parser;
+
+static void *hand_push_item(hand_parser *parser, pjson_array *array, size_t item_size) {
+  if (array->count == array->capacity) {
+    size_t new_capacity = array->capacity ? array->capacity * 2 : 4;
+    void *items = pjson_arena_reallocate(parser->arena, array->items, array->capacity * item_size, new_capacity * item_size, sizeof(double));
+    if (!items) return NULL;
+    array->items = items;
+    array->capacity = new_capacity;
+  }
+
+  void *item = (uint8_t *)array->items + array->count++ * item_size;
+  memset(item, 0, item_size);
+  return item;
+}
+
+static pjson_parsing_status hand_copy_string(hand_parser *parser, pjson_string *dest, const pjson_token *token) {
+  if (token->type != PJSON_TOKEN_STRING) return PJSON_STATUS_USER_ERROR;
+  char *data = (char *)pjson_arena_allocate(parser->arena, token->unescaped_length + 1, 1);
+  if (!data) return PJSON_STATUS_OUT_OF_MEMORY;
+  memcpy(data, token->unescaped, token->unescaped_length); // the tokenizer is expected to unescape strings
+  data[token->unescaped_length] = 0;
+  dest->data = data;
+  dest->length = token->unescaped_length;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_string(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  return hand_copy_string(parser, (pjson_string *)context->member, token);
+}
+
+static pjson_parsing_status hand_on_int32(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  (void)parser;
+  if (token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_NUMBER || !pjson_parse_int32((int32_t *)context->member, token->start, token->length)) return PJSON_STATUS_USER_ERROR;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_double(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  (void)parser;
+  if (token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_NUMBER || !pjson_parse_double((double *)context->member, token->start, token->length)) return PJSON_STATUS_USER_ERROR;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_bool(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  (void)parser;
+  if (token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_TRUE && token->type != PJSON_TOKEN_FALSE) return PJSON_STATUS_USER_ERROR;
+  *(bool *)context->member = token->type == PJSON_TOKEN_TRUE;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_unknown(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  (void)parser;
+  (void)context;
+  return token->type == PJSON_TOKEN_CLOSE_BRACE ? PJSON_STATUS_SUCCESS : PJSON_STATUS_SKIP;
+}
+
+static pjson_parsing_status hand_on_tag(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_CLOSE_BRACKET) return PJSON_STATUS_SUCCESS;
+  pjson_string *tag = (pjson_string *)hand_push_item(parser, context->array, sizeof(pjson_string));
+  return tag ? hand_copy_string(parser, tag, token) : PJSON_STATUS_OUT_OF_MEMORY;
+}
+
+static pjson_parsing_status hand_on_tags(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_CLOSE_BRACKET || token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_OPEN_BRACKET) return PJSON_STATUS_USER_ERROR;
+  hand_context *child_context = (hand_context *)parser->base.context;
+  child_context->base.on_value = (pjson_parser_context_callback)&hand_on_tag;
+  child_context->array = (pjson_array *)context->member;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static bool hand_name_equals(const pjson_token *token, const char *name, size_t length) {
+  return token->unescaped_length == length && !memcmp(token->unescaped, name, length);
+}
+
+#define HAND_MEMBER(name, struct_type, struct_member, callback) \
+  if (hand_name_equals(token, (name), sizeof(name) - 1)) { \
+    context->member = &((struct_type *)context->object)->struct_member; \
+    context->base.on_value = (pjson_parser_context_callback)&(callback); \
+    return PJSON_STATUS_SUCCESS; \
+  }
+
+static pjson_parsing_status hand_on_friend_name(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  (void)parser;
+  HAND_MEMBER("id", bench_friend, id, hand_on_int32)
+  HAND_MEMBER("name", bench_friend, name, hand_on_string)
+  context->base.on_value = (pjson_parser_context_callback)&hand_on_unknown;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_friend(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_CLOSE_BRACKET || token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_OPEN_BRACE) return PJSON_STATUS_USER_ERROR;
+  hand_context *child_context = (hand_context *)parser->base.context;
+  if (!(child_context->object = hand_push_item(parser, context->array, sizeof(bench_friend)))) return PJSON_STATUS_OUT_OF_MEMORY;
+  child_context->base.on_object_property_name = (pjson_parser_context_callback)&hand_on_friend_name;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_friends(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_CLOSE_BRACKET || token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_OPEN_BRACKET) return PJSON_STATUS_USER_ERROR;
+  hand_context *child_context = (hand_context *)parser->base.context;
+  child_context->base.on_value = (pjson_parser_context_callback)&hand_on_friend;
+  child_context->array = (pjson_array *)context->member;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_record_name(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  (void)parser;
+  HAND_MEMBER("_id", bench_record, id, hand_on_string)
+  HAND_MEMBER("index", bench_record, index, hand_on_int32)
+  HAND_MEMBER("guid", bench_record, guid, hand_on_string)
+  HAND_MEMBER("isActive", bench_record, is_active, hand_on_bool)
+  HAND_MEMBER("balance", bench_record, balance, hand_on_string)
+  HAND_MEMBER("picture", bench_record, picture, hand_on_string)
+  HAND_MEMBER("age", bench_record, age, hand_on_int32)
+  HAND_MEMBER("eyeColor", bench_record, eye_color, hand_on_string)
+  HAND_MEMBER("name", bench_record, name, hand_on_string)
+  HAND_MEMBER("gender", bench_record, gender, hand_on_string)
+  HAND_MEMBER("company", bench_record, company, hand_on_string)
+  HAND_MEMBER("email", bench_record, email, hand_on_string)
+  HAND_MEMBER("phone", bench_record, phone, hand_on_string)
+  HAND_MEMBER("address", bench_record, address, hand_on_string)
+  HAND_MEMBER("about", bench_record, about, hand_on_string)
+  HAND_MEMBER("registered", bench_record, registered, hand_on_string)
+  HAND_MEMBER("latitude", bench_record, latitude, hand_on_double)
+  HAND_MEMBER("longitude", bench_record, longitude, hand_on_double)
+  HAND_MEMBER("tags", bench_record, tags, hand_on_tags)
+  HAND_MEMBER("friends", bench_record, friends, hand_on_friends)
+  HAND_MEMBER("greeting", bench_record, greeting, hand_on_string)
+  HAND_MEMBER("favoriteFruit", bench_record, favorite_fruit, hand_on_string)
+  context->base.on_value = (pjson_parser_context_callback)&hand_on_unknown;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_record(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_CLOSE_BRACKET || token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_OPEN_BRACE) return PJSON_STATUS_USER_ERROR;
+  hand_context *child_context = (hand_context *)parser->base.context;
+  if (!(child_context->object = hand_push_item(parser, context->array, sizeof(bench_record)))) return PJSON_STATUS_OUT_OF_MEMORY;
+  child_context->base.on_object_property_name = (pjson_parser_context_callback)&hand_on_record_name;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status hand_on_records(hand_parser *parser, hand_context *context, const pjson_token *token) {
+  (void)context;
+  if (token->type == PJSON_TOKEN_CLOSE_BRACKET) return PJSON_STATUS_SUCCESS;
+  if (token->type != PJSON_TOKEN_OPEN_BRACKET) return PJSON_STATUS_USER_ERROR;
+  hand_context *child_context = (hand_context *)parser->base.context;
+  child_context->base.on_value = (pjson_parser_context_callback)&hand_on_record;
+  child_context->array = parser->records;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static bool bench_bind_by_hand(const bench_input *input, size_t chunk_size) {
+  static pjson_arena arena;
+  static bool is_arena_initialized = false;
+  if (!is_arena_initialized) {
+    pjson_arena_init(&arena, NULL, 0, NULL);
+    is_arena_initialized = true;
+  }
+  pjson_arena_reset(&arena);
+
+  pjson_array records = { NULL, 0, 0 };
+  hand_parser parser = { .arena = &arena, .records = &records };
+  pjson_parser_options parser_options = { .context_size = sizeof(hand_context) };
+  pjson_parser_init_ex(&parser.base, false, &parser_options);
+  parser.base.context->on_value = (pjson_parser_context_callback)&hand_on_records;
+
+  pjson_tokenizer_options options = { .unescape_strings = true };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  bool ok = pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED && records.count > 0;
+  pjson_parser_free(&parser.base);
+  return ok;
+}
+
+/** Counts the allocations of the DOM benchmarks, and tracks the peak of the memory in use. */
+typedef struct {
+  size_t allocation_count;
+  size_t live_size;
+  size_t peak_size;
+} memory_stats;
+
+static memory_stats dom_memory;
+
+static void *tracked_malloc(size_t size) {
+  // The size is stored in front of the block, as the naive tree doesn't know the sizes when freeing.
+  size_t *p = (size_t *)malloc(sizeof(max_align_t) + size);
+  if (!p) return NULL;
+  *p = size;
+  dom_memory.allocation_count++;
+  dom_memory.live_size += size;
+  if (dom_memory.live_size > dom_memory.peak_size) dom_memory.peak_size = dom_memory.live_size;
+  return (uint8_t *)p + sizeof(max_align_t);
+}
+
+static void tracked_free(void *ptr) {
+  if (!ptr) return;
+  size_t *p = (size_t *)((uint8_t *)ptr - sizeof(max_align_t));
+  dom_memory.live_size -= *p;
+  free(p);
+}
+
+static void *tracked_allocate(void *user_data, size_t size) {
+  (void)user_data;
+  return tracked_malloc(size);
+}
+
+static void *tracked_reallocate(void *user_data, void *ptr, size_t old_size, size_t new_size) {
+  (void)user_data;
+  void *new_ptr = tracked_malloc(new_size);
+  if (new_ptr && ptr) memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+  if (new_ptr) tracked_free(ptr);
+  return new_ptr;
+}
+
+static void tracked_deallocate(void *user_data, void *ptr, size_t size) {
+  (void)user_data;
+  (void)size;
+  tracked_free(ptr);
+}
+
+static const pjson_allocator tracked_allocator = { &tracked_allocate, &tracked_reallocate, &tracked_deallocate, NULL };
+
+static bool bench_dom(const bench_input *input, size_t chunk_size) {
+  pjson_dom_options options = { .allocator = &tracked_allocator };
+  pjson_dom dom;
+  pjson_dom_init(&dom, &options);
+  pjson_tokenizer_options tokenizer_options = { .allocator = &tracked_allocator };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &dom.parser.base, &tokenizer_options);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  bool ok = pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED && dom.root.count > 0;
+  pjson_dom_free(&dom);
+  return ok;
+}
+
+/** The usual hand-written tree: a node per value, and separate allocations for every name and string. */
+typedef struct naive_node {
+  pjson_dom_type type;
+  char *name;
+  char *text;
+  size_t length;
+  struct naive_node *first_child, *last_child, *next;
+} naive_node;
+
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  naive_node *root;
+  char *name; // name of the next property
+} naive_dom_parser;
+
+typedef struct {
+  pjson_parser_context base; // base struct MUST be the first member!
+  naive_node *node;
+} naive_dom_context;
+
+static char *naive_copy(const uint8_t *data, size_t length) {
+  char *copy = (char *)tracked_malloc(length + 1);
+  if (!copy) return NULL;
+  memcpy(copy, data, length);
+  copy[length] = 0;
+  return copy;
+}
+
+static void naive_free(naive_node *node) {
+  while (node) {
+    naive_node *next = node->next;
+    naive_free(node->first_child);
+    tracked_free(node->name);
+    tracked_free(node->text);
+    tracked_free(node);
+    node = next;
+  }
+}
+
+static pjson_parsing_status naive_dom_on_name(naive_dom_parser *parser, naive_dom_context *context, const pjson_token *token) {
+  (void)context;
+  parser->name = naive_copy(token->unescaped, token->unescaped_length);
+  return parser->name ? PJSON_STATUS_SUCCESS : PJSON_STATUS_OUT_OF_MEMORY;
+}
+
+static pjson_parsing_status naive_dom_on_value(naive_dom_parser *parser, naive_dom_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_CLOSE_BRACKET || token->type == PJSON_TOKEN_CLOSE_BRACE) return PJSON_STATUS_SUCCESS;
+
+  naive_node *node = (naive_node *)tracked_malloc(sizeof(naive_node));
+  if (!node) return PJSON_STATUS_OUT_OF_MEMORY;
+  memset(node, 0, sizeof(*node));
+  node->name = parser->name;
+  parser->name = NULL;
+  if (context->node) {
+    if (context->node->last_child) context->node->last_child->next = node;
+    else context->node->first_child = node;
+    context->node->last_child = node;
+  }
+  else parser->root = node;
+
+  naive_dom_context *child_context;
+  switch (token->type) {
+    case PJSON_TOKEN_NUMBER:
+      node->type = PJSON_DOM_NUMBER;
+      node->length = token->length;
+      return (node->text = naive_copy(token->start, token->length)) ? PJSON_STATUS_SUCCESS : PJSON_STATUS_OUT_OF_MEMORY;
+
+    case PJSON_TOKEN_STRING:
+      node->type = PJSON_DOM_STRING;
+      node->length = token->unescaped_length;
+      return (node->text = naive_copy(token->unescaped, token->unescaped_length)) ? PJSON_STATUS_SUCCESS : PJSON_STATUS_OUT_OF_MEMORY;
+
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      node->type = token->type == PJSON_TOKEN_OPEN_BRACKET ? PJSON_DOM_ARRAY : PJSON_DOM_OBJECT;
+      child_context = (naive_dom_context *)parser->base.context;
+      child_context->node = node;
+      child_context->base.on_value = (pjson_parser_context_callback)&naive_dom_on_value;
+      child_context->base.on_object_property_name = (pjson_parser_context_callback)&naive_dom_on_name;
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      node->type = token->type == PJSON_TOKEN_NULL ? PJSON_DOM_NULL : token->type == PJSON_TOKEN_FALSE ? PJSON_DOM_FALSE : PJSON_DOM_TRUE;
+      return PJSON_STATUS_SUCCESS;
+  }
+}
+
+static bool bench_dom_naive(const bench_input *input, size_t chunk_size) {
+  naive_dom_parser parser;
+  pjson_parser_options parser_options = { .context_size = sizeof(naive_dom_context), .allocator = &tracked_allocator };
+  pjson_parser_init_ex(&parser.base, false, &parser_options);
+  parser.base.context->on_value = (pjson_parser_context_callback)&naive_dom_on_value;
+  ((naive_dom_context *)parser.base.context)->node = NULL;
+  parser.root = NULL;
+  parser.name = NULL;
+
+  pjson_tokenizer_options options = { .unescape_strings = true, .allocator = &tracked_allocator };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  bool ok = pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED && parser.root;
+  naive_free(parser.root);
+  tracked_free(parser.name);
+  pjson_parser_free(&parser.base);
+  return ok;
+}
+
+static volatile double field_sum; // keeps the field reads from being optimized away
+
+/** Reads two fields of every record on demand, leaving the rest of the input untokenized. */
+static bool bench_doc(const bench_input *input, size_t chunk_size) {
+  (void)chunk_size; // the whole input is navigated at once
+
+  pjson_doc doc;
+  pjson_value root, record, value;
+  pjson_doc_open(&doc, input->data, input->length, NULL, &root);
+  double sum = 0.0, num;
+  while (pjson_arr_next(&root, &record)) {
+    if (pjson_obj_find_field(&record, "age", 3, &value) && pjson_value_get_double(&value, &num)) sum += num;
+    if (pjson_obj_find_field(&record, "latitude", 8, &value) && pjson_value_get_double(&value, &num)) sum += num;
+  }
+  field_sum = sum;
+  return pjson_doc_close(&doc) == PJSON_STATUS_COMPLETED;
+}
+
+/** Reads the same fields from a DOM. */
+static bool bench_dom_fields(const bench_input *input, size_t chunk_size) {
+  static pjson_dom dom;
+  static bool is_dom_initialized = false;
+  if (!is_dom_initialized) {
+    pjson_dom_init(&dom, NULL);
+    is_dom_initialized = true;
+  }
+  pjson_dom_rewind(&dom);
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &dom.parser.base);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  if (pjson_close(&tokenizer) != PJSON_STATUS_COMPLETED) return false;
+
+  double sum = 0.0, num;
+  for (size_t i = 0; i < dom.root.count; i++) {
+    const pjson_dom_value *record = pjson_dom_array_get(&dom.root, i), *value;
+    if ((value = pjson_dom_object_get(record, "age", 3)) && value->type == PJSON_DOM_NUMBER
+      && pjson_parse_double(&num, (const uint8_t *)value->data.text, value->count)) sum += num;
+    if ((value = pjson_dom_object_get(record, "latitude", 8)) && value->type == PJSON_DOM_NUMBER
+      && pjson_parse_double(&num, (const uint8_t *)value->data.text, value->count)) sum += num;
+  }
+  field_sum = sum;
+  return true;
+}
+
+static void report_memory(const char *name, bench_fn fn, const bench_input *input, size_t chunk_size) {
+  memset(&dom_memory, 0, sizeof(dom_memory));
+  if (!fn(input, chunk_size)) {
+    printf("%-12s %-20s FAILED\n", name, input->name);
+    return;
+  }
+  printf("%-12s %-20s %9zu allocations %9.1f KiB peak\n", name, input->name,
+    dom_memory.allocation_count, (double)dom_memory.peak_size / 1024.0);
+}
+
+static bool bench_tape(const bench_input *input, size_t chunk_size) {
+  pjson_tape tape;
+  pjson_tokenizer tokenizer;
+  pjson_init_tape(&tokenizer, &tape, NULL, 0);
+  feed_in_chunks(&tokenizer, input, chunk_size);
+  bool ok = pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED && tape.entry_count > 0;
+  pjson_tape_free(&tape);
+  return ok;
+}
+
+static bool bench_index(const bench_input *input, size_t chunk_size) {
+  static stats_parser parser;
+  stats_parser_init(&parser, false);
+  (void)chunk_size; // the whole input is indexed at once
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  pjson_index(&tokenizer, input->data, input->length);
+  return pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED;
+}
+
+static bool bench_messages_init(const bench_messages *messages) {
+  static stats_parser parser;
+  bool ok = true;
+
+  // Set up everything from scratch for each message.
+  for (size_t i = 0; i < messages->count; i++) {
+    stats_parser_init(&parser, false);
+    pjson_tokenizer tokenizer;
+    pjson_init(&tokenizer, &parser.base.base);
+    pjson_feed(&tokenizer, messages->data + messages->offsets[i], messages->offsets[i + 1] - messages->offsets[i]);
+    ok &= pjson_close(&tokenizer) == PJSON_STATUS_COMPLETED;
+  }
+  return ok;
+}
+
+static bool bench_messages_reuse(const bench_messages *messages) {
+  static stats_parser parser;
+  stats_parser_init(&parser, false);
+  bool ok = true;
+
+  // Set up once, then only rewind the parser and reset the tokenizer for each message.
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  for (size_t i = 0; i < messages->count; i++) {
+    pjson_parser_rewind(&parser.base, false);
+    ok &= pjson_parse_buffer(&tokenizer, messages->data + messages->offsets[i], messages->offsets[i + 1] - messages->offsets[i]) == PJSON_STATUS_COMPLETED;
+  }
+  pjson_close(&tokenizer);
+  return ok;
+}
+
+static bool bench_messages_skip(const bench_messages *messages) {
+  // Only the primitive properties of the messages are looked at, "user" and "values" are skipped.
+  static skimming_parser parser;
+  skimming_parser_init(&parser, 2, false);
+  bool ok = true;
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  for (size_t i = 0; i < messages->count; i++) {
+    pjson_parser_rewind(&parser.base, false);
+    ok &= pjson_parse_buffer(&tokenizer, messages->data + messages->offsets[i], messages->offsets[i + 1] - messages->offsets[i]) == PJSON_STATUS_COMPLETED;
+  }
+  pjson_close(&tokenizer);
+  pjson_parser_free(&parser.base);
+  return ok && parser.value_count == 3 * messages->count;
+}
+
+static pjson_parsing_status count_match(pjson_path_filter *filter, size_t path_index, const pjson_token *token) {
+  (void)path_index, (void)token;
+  (*(size_t *)filter->user_data)++;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static bool bench_messages_paths(const bench_messages *messages) {
+  // Only two values of each message are wanted, everything else is skipped.
+  static const char *const paths[] = { "/id", "$.user.name" };
+  static pjson_path_filter filter;
+  size_t match_count = 0;
+  if (pjson_path_filter_init(&filter, false, paths, pjson_countof(paths), &count_match, NULL) != PJSON_STATUS_SUCCESS) return false;
+  filter.user_data = &match_count;
+  bool ok = true;
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &filter.parser.base);
+  for (size_t i = 0; i < messages->count; i++) {
+    pjson_path_filter_rewind(&filter, false);
+    ok &= pjson_parse_buffer(&tokenizer, messages->data + messages->offsets[i], messages->offsets[i + 1] - messages->offsets[i]) == PJSON_STATUS_COMPLETED;
+  }
+  pjson_close(&tokenizer);
+  pjson_path_filter_free(&filter);
+  return ok && match_count == 2 * messages->count;
+}
+
+/* Entry point */
+
+int main(int argc, char *argv[]) {
+  size_t chunk_size = DEFAULT_CHUNK_SIZE;
+  int iterations = DEFAULT_ITERATION_COUNT;
+
+  if (argc > 1) chunk_size = (size_t)strtoul(argv[1], NULL, 10);
+  if (argc > 2) iterations = atoi(argv[2]);
+  if (chunk_size == 0 || iterations <= 0) {
+    puts("Usage: pjson_bench [chunk_size] [iteration_count]");
+    return EXIT_FAILURE;
+  }
+
+  bench_input inputs[3];
+  if (!load_file(&inputs[0], "formatted_1mb.json", PJSON_BENCH_DATA_DIR "/formatted_1mb.json")
+    || !load_file(&inputs[1], "minified_1mb.json", PJSON_BENCH_DATA_DIR "/minified_1mb.json")
+    || !make_utf8_input(&inputs[2], "utf8_1mb.json")) {
+    puts("Failed to load benchmark input.");
+    return EXIT_FAILURE;
+  }
+
+  bench_messages messages;
+  if (!make_messages(&messages)) {
+    puts("Failed to create benchmark messages.");
+    return EXIT_FAILURE;
+  }
+
+  printf("Chunk size: %zu bytes, best of %d iterations\n\n", chunk_size, iterations);
+
+  for (size_t i = 0; i < pjson_countof(inputs); i++) {
+    run("tokenize", &bench_tokenize, &inputs[i], chunk_size, iterations);
+    run("batch", &bench_tokenize_batch, &inputs[i], chunk_size, iterations);
+    run("scatter", &bench_tokenize_scatter, &inputs[i], chunk_size, iterations);
+    run("parse", &bench_parse, &inputs[i], chunk_size, iterations);
+    run("parse/spec", &bench_parse_specialized, &inputs[i], chunk_size, iterations);
+    run("skip", &bench_skip, &inputs[i], chunk_size, iterations);
+    run("skip/valid", &bench_skip_validating, &inputs[i], chunk_size, iterations);
+    run("names/cmp", &bench_names_compare, &inputs[i], chunk_size, iterations);
+    run("names/table", &bench_names_table, &inputs[i], chunk_size, iterations);
+    run("bind", &bench_bind, &inputs[i], chunk_size, iterations);
+    run("bind/hand", &bench_bind_by_hand, &inputs[i], chunk_size, iterations);
+    run("dom", &bench_dom, &inputs[i], chunk_size, iterations);
+    run("dom/naive", &bench_dom_naive, &inputs[i], chunk_size, iterations);
+    run("dom/fields", &bench_dom_fields, &inputs[i], chunk_size, iterations);
+    run("doc/fields", &bench_doc, &inputs[i], chunk_size, iterations);
+    run("tape", &bench_tape, &inputs[i], chunk_size, iterations);
+    run("index", &bench_index, &inputs[i], chunk_size, iterations);
+  }
+
+  puts("");
+  for (size_t i = 0; i < pjson_countof(inputs); i++) {
+    report_memory("dom", &bench_dom, &inputs[i], chunk_size);
+    report_memory("dom/naive", &bench_dom_naive, &inputs[i], chunk_size);
+  }
+
+  printf("\n%zu messages of %.0f bytes on average\n\n", messages.count, (double)messages.offsets[messages.count] / (double)messages.count);
+  run_messages("init/close", &bench_messages_init, &messages, iterations);
+  run_messages("reuse", &bench_messages_reuse, &messages, iterations);
+  run_messages("reuse/skip", &bench_messages_skip, &messages, iterations);
+  run_messages("reuse/paths", &bench_messages_paths, &messages, iterations);
+
+  for (size_t i = 0; i < pjson_countof(inputs); i++) {
+    free(inputs[i].data);
+  }
+  free(messages.data);
+  free(messages.offsets);
+
+  return EXIT_SUCCESS;
+}
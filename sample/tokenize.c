@@ -43,10 +43,8 @@ static pjson_parsing_status on_subsequent_token(pjson_parser_base *parser, const
   printf("/* type: %s | start_index: %zu | length: %zu | value: %s",
     token_type_name(token->type), token->start_index, token->length, buf);
 
-  if (token->unescaped_length != token->length - (token->type == PJSON_TOKEN_STRING ? 2 : 0)) {
-    if (!pjson_parse_string((uint8_t *)buf, token->length, token->start, token->length, true)) {
-      return PJSON_STATUS_USER_ERROR;
-    }
+  if (token->unescaped && token->unescaped != token->start + 1) {
+    memcpy(buf, token->unescaped, token->unescaped_length);
     buf[token->unescaped_length] = 0;
 
     printf(" | unescaped_length: %zu | unescaped value: %s", token->unescaped_length, buf);
@@ -82,7 +80,8 @@ int tokenize() {
 
   pjson_parsing_status status;
   pjson_tokenizer tokenizer;
-  pjson_init(&tokenizer, &parser);
+  pjson_tokenizer_options options = { .unescape_strings = true };
+  pjson_init_ex(&tokenizer, &parser, &options);
 
   char buf[128];
   int num_read;
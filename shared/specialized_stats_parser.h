@@ -0,0 +1,98 @@
+#ifndef __SPECIALIZED_STATS_PARSER_H__
+#define __SPECIALIZED_STATS_PARSER_H__
+
+#include "pjson.h"
+#include "pjson_parser_template.h"
+
+// Same statistics as `stats_parser` (see stats_parser.h), computed by a parser generated by `PJSON_DEFINE_PARSER`.
+
+#ifndef SPECIALIZED_STATS_PARSER_MAX_DEPTH
+#define SPECIALIZED_STATS_PARSER_MAX_DEPTH (99)
+#endif // SPECIALIZED_STATS_PARSER_MAX_DEPTH
+
+typedef struct {
+  size_t counter;
+} specialized_stats_parser_context;
+
+typedef struct {
+  pjson_token_type toplevel_datatype;
+  size_t max_depth;
+  size_t max_array_item_count;
+  size_t max_object_property_count;
+  size_t datatype_counts[PJSON_TOKEN_EOS - PJSON_TOKEN_NULL];
+  size_t key_count;
+} specialized_stats;
+
+typedef struct specialized_stats_parser specialized_stats_parser;
+
+static inline pjson_parsing_status specialized_stats_parser_on_value(specialized_stats_parser *parser,
+  specialized_stats_parser_context *context, const pjson_token *token);
+
+static inline pjson_parsing_status specialized_stats_parser_on_object_property_name(specialized_stats_parser *parser,
+  specialized_stats_parser_context *context, const pjson_token *token);
+
+PJSON_DEFINE_PARSER(specialized_stats_parser, specialized_stats_parser_context, SPECIALIZED_STATS_PARSER_MAX_DEPTH,
+  specialized_stats_parser_on_value, specialized_stats_parser_on_object_property_name)
+
+static inline pjson_parsing_status specialized_stats_parser_on_value(specialized_stats_parser *parser,
+  specialized_stats_parser_context *context, const pjson_token *token) {
+
+  specialized_stats *stats = (specialized_stats *)parser->user_data;
+  specialized_stats_parser_context *child_context;
+
+  if (context == &parser->contexts[0]) {
+    stats->toplevel_datatype = token->type;
+  }
+  else if (token->type != PJSON_TOKEN_CLOSE_BRACKET && token->type != PJSON_TOKEN_CLOSE_BRACE) {
+    // Count items or properties in the current array or object.
+    context->counter++;
+  }
+
+  switch (token->type) {
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      // Calculate maximum depth. (No initialization is needed, contexts are zeroed when pushed.)
+      if (stats->max_depth < parser->depth) {
+        stats->max_depth = parser->depth;
+      }
+      break;
+
+    case PJSON_TOKEN_CLOSE_BRACKET:
+      // Calculate maximum number of items in arrays.
+      child_context = specialized_stats_parser_current_context(parser);
+      if (stats->max_array_item_count < child_context->counter) {
+        stats->max_array_item_count = child_context->counter;
+      }
+      stats->datatype_counts[token->type - PJSON_TOKEN_NULL]++;
+      break;
+
+    case PJSON_TOKEN_CLOSE_BRACE:
+      // Calculate maximum number of properties in objects.
+      child_context = specialized_stats_parser_current_context(parser);
+      if (stats->max_object_property_count < child_context->counter) {
+        stats->max_object_property_count = child_context->counter;
+      }
+      stats->datatype_counts[token->type - PJSON_TOKEN_NULL]++;
+      break;
+
+    default:
+      stats->datatype_counts[token->type - PJSON_TOKEN_NULL]++;
+      break;
+  }
+
+  return PJSON_STATUS_SUCCESS;
+}
+
+static inline pjson_parsing_status specialized_stats_parser_on_object_property_name(specialized_stats_parser *parser,
+  specialized_stats_parser_context *context, const pjson_token *token) {
+
+  (void)context;
+  (void)token;
+
+  // Count property keys.
+  ((specialized_stats *)parser->user_data)->key_count++;
+
+  return PJSON_STATUS_SUCCESS;
+}
+
+#endif // __SPECIALIZED_STATS_PARSER_H__
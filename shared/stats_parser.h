@@ -15,11 +15,9 @@ typedef struct {
 typedef struct {
   pjson_parser base; // base struct MUST be the first member!
 
-  // For simplicity's sake, we use a fixed-size buffer for storing the context stack.
-  // In real life, when maximum depth of the parsed JSON is not known beforehand,
-  // you may want to use a dynamically allocated data structure for this purpose.
+  // The built-in context stack of the parser stores the contexts in this array. As the nesting depth is limited to
+  // the size of the array, the parser never needs to allocate more storage, so no `pjson_parser_free` call is needed.
   stats_parser_context context_stack[STATS_PARSER_MAX_DEPTH];
-  size_t context_stack_current_index;
 
   pjson_token_type toplevel_datatype;
   size_t max_depth;
@@ -29,27 +27,6 @@ typedef struct {
   size_t key_count;
 } stats_parser;
 
-/* Parser context stack implementation */
-
-static pjson_parsing_status stats_parser_push_context(stats_parser *parser) {
-  size_t next_index = parser->context_stack_current_index + 1u;
-  if (next_index >= pjson_countof(parser->context_stack)) {
-    return PJSON_STATUS_MAX_DEPTH_EXCEEDED;
-  }
-  parser->context_stack_current_index = next_index;
-  return PJSON_STATUS_SUCCESS;
-}
-
-static stats_parser_context *stats_parser_peek_context(stats_parser *parser, bool previous) {
-  assert(parser->context_stack_current_index - (size_t)previous < pjson_countof(parser->context_stack));
-  return &parser->context_stack[parser->context_stack_current_index - (size_t)previous];
-}
-
-static void stats_parser_pop_context(stats_parser *parser) {
-  assert(0 < parser->context_stack_current_index && parser->context_stack_current_index < pjson_countof(parser->context_stack));
-  parser->context_stack_current_index--;
-}
-
 /* Parser callbacks */
 
 static pjson_parsing_status stats_parser_on_value_core(stats_parser *parser, stats_parser_context *context, const pjson_token *token);
@@ -98,8 +75,8 @@ static pjson_parsing_status stats_parser_on_value_core(stats_parser *parser, sta
     case PJSON_TOKEN_OPEN_BRACKET:
     case PJSON_TOKEN_OPEN_BRACE:
       // When an array or object is beginning (or ending), the new context is already (or still) on the stack,
-      // however the `context` parameter points to the original context. You can obtain the new context from the stack.
-      child_context = stats_parser_peek_context(parser, false);
+      // however the `context` parameter points to the original context. The new context is the current one.
+      child_context = (stats_parser_context *)parser->base.context;
       // Don't forget to initialize your additional state in the context struct!
       // pjson only initializes the parts which it's aware of.
       child_context->counter = 0;
@@ -107,14 +84,15 @@ static pjson_parsing_status stats_parser_on_value_core(stats_parser *parser, sta
       child_context->base.on_object_property_name = (pjson_parser_context_callback)&stats_parser_on_object_property_name;
 
       // Calculate maximum depth.
-      if (parser->max_depth < parser->context_stack_current_index) {
-        parser->max_depth = parser->context_stack_current_index;
+      // (The depth of the stack includes the top-level context.)
+      if (parser->max_depth < parser->base.depth - 1) {
+        parser->max_depth = parser->base.depth - 1;
       }
       break;
 
     case PJSON_TOKEN_CLOSE_BRACKET:
       // Calculate maximum number of items in arrays.
-      child_context = stats_parser_peek_context(parser, false);
+      child_context = (stats_parser_context *)parser->base.context;
       if (parser->max_array_item_count < child_context->counter) {
         parser->max_array_item_count = child_context->counter;
       }
@@ -122,7 +100,7 @@ static pjson_parsing_status stats_parser_on_value_core(stats_parser *parser, sta
 
     case PJSON_TOKEN_CLOSE_BRACE:
       // Calculate maximum number of properties in objects.
-      child_context = stats_parser_peek_context(parser, false);
+      child_context = (stats_parser_context *)parser->base.context;
       if (parser->max_array_item_count < child_context->counter) {
         parser->max_object_property_count = child_context->counter;
       }
@@ -142,22 +120,25 @@ static void stats_parser_init(stats_parser *parser, bool is_lazy) {
   // Don't forget to initialize your additional state in the parser struct!
   // `pjson_parser_init` only initializes the part which it's aware of.
   memset(((uint8_t *)parser) + sizeof(parser->base), 0, sizeof(*parser) - sizeof(parser->base));
-  parser->context_stack_current_index = (size_t)-1;
-
-  pjson_parser_init(&parser->base, is_lazy,
-    // The pointer casts below are safe only because `stats_parser` is defined with its first member being the
-    // `pjson_parser` "base" structure. The callbacks are called with the pointer to the base struct, so in the
-    // case of a different memory layout, you're better off using a compatible callback signature here and restoring
-    // the pointer to your actual context and parser structs in the callbacks.
-    (pjson_parser_push_context)&stats_parser_push_context,
-    (pjson_parser_peek_context)&stats_parser_peek_context,
-    (pjson_parser_pop_context)&stats_parser_pop_context);
-
-  // `pjson_parser_init` pushes the top-level context onto the stack but unless we set a callback to observe the tokens,
+
+  pjson_parser_options options = {
+    // The parser zeroes contexts of this size, so our additional state starts out zeroed as well.
+    .context_size = sizeof(stats_parser_context),
+    .initial_contexts = parser->context_stack,
+    .initial_capacity = pjson_countof(parser->context_stack),
+    // Nesting levels exclude the top-level context.
+    .max_depth = pjson_countof(parser->context_stack) - 1,
+  };
+  pjson_parser_init_ex(&parser->base, is_lazy, &options);
+
+  // `pjson_parser_init_ex` pushes the top-level context onto the stack but unless we set a callback to observe the tokens,
   // the parser will just consume them and validate the syntax of the JSON. We need to set an `on_value`
   // (or `on_object_property_name`) callback to hook into the parsing process if we want do anything useful.
-  stats_parser_peek_context(parser, false)->base.on_value =
-    // The same considerations apply for casting this function pointer as above.
+  parser->base.context->on_value =
+    // The cast below is safe only because `stats_parser` is defined with its first member being the `pjson_parser`
+    // "base" structure. The callbacks are called with the pointer to the base struct, so in the case of a different
+    // memory layout, you're better off using a compatible callback signature here and restoring the pointer to your
+    // actual context and parser structs in the callbacks.
     (pjson_parser_context_callback)&stats_parser_on_value_at_toplevel;
 }
 
@@ -168,11 +149,10 @@ static void stats_parser_init(stats_parser *parser, bool is_lazy) {
 
 static void stats_parser_reset(stats_parser *parser, bool is_lazy) {
   memset(((uint8_t *)parser) + sizeof(parser->base), 0, sizeof(*parser) - sizeof(parser->base));
-  parser->context_stack_current_index = (size_t)-1;
 
   pjson_parser_reset(&parser->base, is_lazy);
 
-  stats_parser_peek_context(parser, false)->base.on_value =
+  parser->base.context->on_value =
     (pjson_parser_context_callback)&stats_parser_on_value_at_toplevel;
 }
 
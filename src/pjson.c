@@ -37,7 +37,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <assert.h>
-#include <ctype.h>
 #include <memory.h>
 #include <errno.h>
 #include <stdlib.h>
@@ -49,21 +48,177 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "pjson.h"
 
+#ifndef PJSON_NO_SIMD
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PJSON_X86
+#endif
+#endif
+
+// All x86 kernels are compiled regardless of the target architecture flags, the ones to use are selected at run time
+// (see pjson_set_kernel_level). SSE2 instructions can be used without a run-time check where SSE2 is part of the baseline.
+#if defined(PJSON_X86)
+#include <immintrin.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PJSON_X86_SSE2_BASELINE
+#endif
+#if defined(_MSC_VER)
+#define PJSON_TARGET(features)
+#else
+#define PJSON_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER) \
+  || (defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define PJSON_LITTLE_ENDIAN
+#endif
+
 #ifndef max
 #define max(a,b) (((a) > (b)) ? (a) : (b))
 #endif
 
 #define UTF8_INVALID_CODEPOINT_REPLACEMENT (0xFFFD)
 
+#define CHAR_CLASS_DIGIT (0x01)
+#define CHAR_CLASS_HEX_DIGIT (0x02)
+#define CHAR_CLASS_WHITESPACE (0x04)
+#define CHAR_CLASS_STRUCTURAL (0x08)
+#define CHAR_CLASS_STRING_SPECIAL (0x10) // bytes which can't appear unescaped in strings or start an escape sequence
+
+#define N_ (0)
+#define D_ (CHAR_CLASS_DIGIT | CHAR_CLASS_HEX_DIGIT)
+#define H_ (CHAR_CLASS_HEX_DIGIT)
+#define S_ (CHAR_CLASS_WHITESPACE)
+#define P_ (CHAR_CLASS_STRUCTURAL)
+#define C_ (CHAR_CLASS_STRING_SPECIAL)
+#define W_ (CHAR_CLASS_WHITESPACE | CHAR_CLASS_STRING_SPECIAL)
+
+/**
+ * Character classes of bytes as a combination of `CHAR_CLASS_*` flags.
+ * (Unlike the functions of <ctype.h>, this doesn't depend on the current locale and compiles to a single load.)
+ */
+static const uint8_t CHAR_CLASS_LOOKUP[256] = {
+  /*       0   1   2   3   4   5   6   7   8   9   A   B   C   D   E   F */
+  /* 0 */ C_, C_, C_, C_, C_, C_, C_, C_, C_, W_, W_, C_, C_, W_, C_, C_,
+  /* 1 */ C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_,
+  /* 2 */ S_, N_, C_, N_, N_, N_, N_, N_, N_, N_, N_, N_, P_, N_, N_, N_,
+  /* 3 */ D_, D_, D_, D_, D_, D_, D_, D_, D_, D_, P_, N_, N_, N_, N_, N_,
+  /* 4 */ N_, H_, H_, H_, H_, H_, H_, N_, N_, N_, N_, N_, N_, N_, N_, N_,
+  /* 5 */ N_, N_, N_, N_, N_, N_, N_, N_, N_, N_, N_, P_, C_, P_, N_, N_,
+  /* 6 */ N_, H_, H_, H_, H_, H_, H_, N_, N_, N_, N_, N_, N_, N_, N_, N_,
+  /* 7 */ N_, N_, N_, N_, N_, N_, N_, N_, N_, N_, N_, P_, N_, P_, N_, N_,
+  // bytes 0x80-0xFF belong to no class
+};
+
+#undef N_
+#undef D_
+#undef H_
+#undef S_
+#undef P_
+#undef C_
+#undef W_
+
+static inline bool is_digit(uint8_t ch);
+static inline bool is_hex_digit(uint8_t ch);
+static inline bool is_whitespace(uint8_t ch);
+static inline bool is_streamed_string(const pjson_token *token);
+static inline pjson_token_type punctuator_token_type(uint8_t ch);
+static inline unsigned bit_scan_forward64(uint64_t x);
 static inline uint8_t hex_digit_value(uint8_t ch);
 static inline int16_t utf8_cont_payload(uint8_t ch);
+static inline bool utf8_is_valid_sequence(const uint8_t *seq, size_t length);
+static inline const uint8_t *utf8_trim_incomplete_sequence(const uint8_t *p, const uint8_t *end);
 static inline size_t utf8_byte_size(int32_t cp);
 static inline bool utf16_is_high_surrogate(uint16_t ch);
 static inline bool utf16_is_low_surrogate(uint16_t ch);
 static inline int32_t utf16_to_code_point(uint16_t high_surrogate, uint16_t low_surrogate);
+static const uint8_t *unescape_string_part(uint8_t **dest, const uint8_t *src, const uint8_t *src_end, bool is_last);
+
+typedef struct structural_index structural_index;
+
+/**
+ * Bitmaps which classify the bytes of a 64-byte block of input (bit `i` describes byte `i`).
+ */
+typedef struct {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t punctuator;
+  uint64_t whitespace;
+  uint64_t control; // including whitespace other than space
+} block_masks;
+
+/**
+ * Implementations of the scanning routines which can benefit from instruction set extensions.
+ */
+struct pjson_kernels {
+  pjson_kernel_level level;
+  /** Return a pointer to the first non-whitespace byte in the range `[p, end)` or `end` if there is no such byte. */
+  const uint8_t *(*skip_whitespace)(const uint8_t *p, const uint8_t *end);
+  /** Return a pointer to the first byte in the range `[p, end)` which can't be consumed as a plain ASCII string character. */
+  const uint8_t *(*scan_string_ascii_run)(const uint8_t *p, const uint8_t *end);
+  /** Return a pointer to the first byte in the range `[p, end)` which terminates a span of unescaped string content. */
+  const uint8_t *(*scan_string_span)(const uint8_t *p, const uint8_t *end);
+  /** Return a pointer to the first quotation mark, bracket or brace in the range `[p, end)` (see STATE_SKIPPING_VALUE). */
+  const uint8_t *(*scan_skipped_value)(const uint8_t *p, const uint8_t *end);
+  /** Check whether the range `[p, end)` is valid UTF8 (i.e. it consists of complete, valid sequences only). */
+  bool (*utf8_validate)(const uint8_t *p, const uint8_t *end);
+  /** Index the blocks of the current window of `si` (see structural_index_fill). */
+  void (*index_blocks)(structural_index *si);
+};
+
+static const pjson_kernels *get_kernels(void);
+static inline const uint8_t *skip_whitespace(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end);
+static inline const uint8_t *scan_string_ascii_run(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end);
+static inline const uint8_t *scan_string_span(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end);
+static inline const uint8_t *scan_skipped_value(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end);
+
+/* Allocator */
+
+static void *pjson_default_allocate(void *user_data, size_t size) {
+  (void)user_data;
+  return pjson_malloc(size);
+}
+
+static void *pjson_default_reallocate(void *user_data, void *ptr, size_t old_size, size_t new_size) {
+  (void)user_data, (void)old_size;
+  return pjson_realloc(ptr, new_size);
+}
+
+static void pjson_default_deallocate(void *user_data, void *ptr, size_t size) {
+  (void)user_data, (void)size;
+  pjson_free(ptr);
+}
+
+static const pjson_allocator pjson_default_allocator = {
+  .allocate = &pjson_default_allocate,
+  .reallocate = &pjson_default_reallocate,
+  .deallocate = &pjson_default_deallocate,
+};
+
+static inline void *pjson_allocate(const pjson_allocator *allocator, size_t size) {
+  return allocator->allocate(allocator->user_data, size);
+}
+
+static inline void *pjson_reallocate(const pjson_allocator *allocator, void *ptr, size_t old_size, size_t new_size) {
+  return allocator->reallocate(allocator->user_data, ptr, old_size, new_size);
+}
+
+static inline void pjson_deallocate(const pjson_allocator *allocator, void *ptr, size_t size) {
+  if (ptr) allocator->deallocate(allocator->user_data, ptr, size);
+}
 
 /* Tokenizer */
 
+#if !defined(PJSON_COMPACT_TOKENIZER)
+#define FIXED_SIZE_BUF_CAPACITY (PJSON_INTERNAL_BUFFER_FIXED_SIZE)
+#else
+#define FIXED_SIZE_BUF_CAPACITY (0)
+#endif
+
 // The negative range of state values is reserved for storing final states
 // (i.e. EOS and the error states defined by pjson_parsing_status).
 // Note for maintainers: state values must not be changed as parsing logic relies on them (see comments below).
@@ -79,12 +234,12 @@ static inline int32_t utf16_to_code_point(uint16_t high_surrogate, uint16_t low_
 #define STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_4_OF_4 (7) // value must be equal to STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_3_OF_4 + 1
 #define STATE_IN_STRING_MAYBE_LOW_SURROGATE_ESCAPE (8)
 #define STATE_IN_STRING_EXPECT_ESCAPE_MAYBE_LOW_SURROGATE (9)
-#define STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2 (10) // value is used for indexing into FEED_UTF8_SEQUENCE_BYTE_LOOKUP
-#define STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3 (11) // value is used for indexing into FEED_UTF8_SEQUENCE_BYTE_LOOKUP
-#define STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_3 (12) // value is used for indexing into FEED_UTF8_SEQUENCE_BYTE_LOOKUP and must be equal to STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3 + 1
-#define STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4 (13) // value is used for indexing into FEED_UTF8_SEQUENCE_BYTE_LOOKUP
-#define STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_4 (14) // value is used for indexing into FEED_UTF8_SEQUENCE_BYTE_LOOKUP and must be equal to STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4 + 1
-#define STATE_IN_STRING_EXPECT_UTF8_BYTE_4_OF_4 (15) // value is used for indexing into FEED_UTF8_SEQUENCE_BYTE_LOOKUP and must be equal to STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_4 + 1
+#define STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2 (10)
+#define STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3 (11) // value is used for computing the position in utf8_sequence_buf
+#define STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_3 (12) // value must be equal to STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3 + 1
+#define STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4 (13) // value is used for computing the position in utf8_sequence_buf
+#define STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_4 (14) // value is used for computing the position in utf8_sequence_buf and must be equal to STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4 + 1
+#define STATE_IN_STRING_EXPECT_UTF8_BYTE_4_OF_4 (15) // value must be equal to STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_4 + 1
 #define STATE_IN_NUMBER_EXPECT_INTEGER_PART (16)
 #define STATE_IN_NUMBER_EXPECT_FRACTIONAL_PART (17)
 #define STATE_IN_NUMBER_EXPECT_EXPONENT (18)
@@ -93,31 +248,16 @@ static inline int32_t utf16_to_code_point(uint16_t high_surrogate, uint16_t low_
 #define STATE_IN_NUMBER_FRACTIONAL_PART (21)
 #define STATE_IN_NUMBER_EXPONENT_DIGITS (22)
 #define STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT (23)
+// The states of skipping an array or object (see PJSON_STATUS_SKIP) must have the highest values.
+#define STATE_SKIPPING_VALUE (24)
+#define STATE_SKIPPING_VALUE_IN_STRING (25)
+#define STATE_SKIPPING_VALUE_IN_STRING_EXPECT_ESCAPE (26)
 
 // Note for maintainers: lookup indices must be in sync with pjson_token_type values
 // (i.e. the index of a keyword must be equal to `keyword_token_type - PJSON_TOKEN_NULL`)!
 
 static const char *KEYWORD_LOOKUP[] = { "null", "false", "true" };
 
-typedef bool (*feed_string_utf8_sequence_byte)(pjson_tokenizer *tokenizer, uint8_t ch);
-
-static bool pjson_feed_string_utf8_intermediate_byte(pjson_tokenizer *tokenizer, uint8_t ch);
-static bool pjson_feed_string_utf8_byte_2_of_2(pjson_tokenizer *tokenizer, uint8_t ch);
-static bool pjson_feed_string_utf8_byte_3_of_3(pjson_tokenizer *tokenizer, uint8_t ch);
-static bool pjson_feed_string_utf8_byte_4_of_4(pjson_tokenizer *tokenizer, uint8_t ch);
-
-// Note for maintainers: lookup indices must be in sync with STATE_* values
-// (i.e. the index of a function must be equal to `tokenizer->state - pjson_feed_string_utf8_sequence_byte_2_of_2`)!
-
-static const feed_string_utf8_sequence_byte FEED_UTF8_SEQUENCE_BYTE_LOOKUP[] = {
-  &pjson_feed_string_utf8_byte_2_of_2,
-  &pjson_feed_string_utf8_intermediate_byte,
-  &pjson_feed_string_utf8_byte_3_of_3,
-  &pjson_feed_string_utf8_intermediate_byte,
-  &pjson_feed_string_utf8_intermediate_byte,
-  &pjson_feed_string_utf8_byte_4_of_4,
-};
-
 static pjson_parsing_status pjson_null_parser_eat_subsequent(pjson_parser_base *parser, const pjson_token *token) {
   (void)parser;
   return token->type != PJSON_TOKEN_EOS ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_COMPLETED;
@@ -132,6 +272,13 @@ static pjson_parsing_status pjson_null_parser_eat_first(pjson_parser_base *parse
   return PJSON_STATUS_DATA_NEEDED;
 }
 
+/**
+ * Converts a size to `pjson_tokenizer_length`, saturating it if the type is narrower than `size_t` (see PJSON_COMPACT_TOKENIZER).
+ */
+static inline pjson_tokenizer_length pjson_clamp_length(size_t value) {
+  return value < PJSON_TOKENIZER_LENGTH_MAX ? (pjson_tokenizer_length)value : PJSON_TOKENIZER_LENGTH_MAX;
+}
+
 void pjson_init(pjson_tokenizer *tokenizer, pjson_parser_base *parser) {
   assert(tokenizer);
 
@@ -145,8 +292,49 @@ void pjson_init(pjson_tokenizer *tokenizer, pjson_parser_base *parser) {
   }
   tokenizer->parser = (pjson_parser_base *)parser;
 
-  tokenizer->buf = tokenizer->fixed_size_buf;
-  tokenizer->buf_capacity = pjson_countof(tokenizer->fixed_size_buf);
+  tokenizer->buf = pjson_fixed_size_buf(tokenizer);
+  tokenizer->buf_capacity = FIXED_SIZE_BUF_CAPACITY;
+  tokenizer->allocator = &pjson_default_allocator;
+
+  tokenizer->max_token_length = tokenizer->max_buffer_size = tokenizer->max_depth = PJSON_TOKENIZER_LENGTH_MAX;
+  tokenizer->buffer_high_water = PJSON_TOKENIZER_LENGTH_MAX;
+
+  tokenizer->kernels = get_kernels();
+}
+
+void pjson_init_ex(pjson_tokenizer *tokenizer, pjson_parser_base *parser, const pjson_tokenizer_options *options) {
+  pjson_init(tokenizer, parser);
+
+  if (options) {
+    tokenizer->unescape_strings = options->unescape_strings;
+    tokenizer->scatter_strings = options->scatter_strings && !options->unescape_strings;
+    tokenizer->string_chunk_handler = options->string_chunk_handler;
+    assert(!tokenizer->string_chunk_handler || tokenizer->string_chunk_handler->on_chunk);
+    if (options->max_token_length) tokenizer->max_token_length = pjson_clamp_length(options->max_token_length);
+    if (options->max_buffer_size) tokenizer->max_buffer_size = pjson_clamp_length(options->max_buffer_size);
+    if (options->max_depth) tokenizer->max_depth = pjson_clamp_length(options->max_depth);
+    if (options->buffer_high_water) tokenizer->buffer_high_water = pjson_clamp_length(options->buffer_high_water);
+    tokenizer->buffer_pool = options->buffer_pool;
+    if (options->allocator) {
+      assert(options->allocator->allocate && options->allocator->reallocate && options->allocator->deallocate);
+      tokenizer->allocator = options->allocator;
+    }
+  }
+}
+
+size_t pjson_tokenizer_size(void) {
+  return sizeof(pjson_tokenizer);
+}
+
+void pjson_init_batch(pjson_tokenizer *tokenizer, pjson_token_sink *sink) {
+  pjson_init_batch_ex(tokenizer, sink, NULL);
+}
+
+void pjson_init_batch_ex(pjson_tokenizer *tokenizer, pjson_token_sink *sink, const pjson_tokenizer_options *options) {
+  assert(sink && sink->eat && sink->tokens && sink->capacity > 0);
+
+  pjson_init_ex(tokenizer, NULL, options);
+  tokenizer->sink = sink;
 }
 
 static pjson_parsing_status pjson_report_error(pjson_tokenizer *tokenizer, pjson_parsing_status status, pjson_token_type type, size_t start_index) {
@@ -163,6 +351,148 @@ static inline void pjson_start_token(pjson_tokenizer *tokenizer, pjson_token_typ
   tokenizer->token_start = start;
 }
 
+/**
+ * Returns how large a buffer of the tokenizer may grow given that the others take up `other_capacity` bytes.
+ */
+static inline size_t pjson_buffer_size_limit(const pjson_tokenizer *tokenizer, size_t other_capacity) {
+  return tokenizer->max_buffer_size > other_capacity ? tokenizer->max_buffer_size - other_capacity : 0;
+}
+
+/**
+ * Returns the number of bytes allocated for the internal buffer (its fixed-size part doesn't count).
+ */
+static inline size_t pjson_internal_buffer_size(const pjson_tokenizer *tokenizer) {
+  return tokenizer->buf != pjson_fixed_size_buf(tokenizer) ? tokenizer->buf_capacity : 0;
+}
+
+/**
+ * Returns the number of bytes taken up by the list of segments (see `scatter_strings`), which counts against
+ * `max_buffer_size` as well.
+ */
+static inline size_t pjson_segments_size(const pjson_tokenizer *tokenizer) {
+  return tokenizer->segment_capacity * sizeof(pjson_segment);
+}
+
+/**
+ * Checks whether a token of `length` bytes is within the limits, including that the internal buffer may grow to hold it
+ * if `is_buffered` (this must be checked before buffering so that the allocator is never called past the limit).
+ */
+static inline pjson_parsing_status pjson_check_token_limits(const pjson_tokenizer *tokenizer, size_t length, bool is_buffered) {
+  if (length > tokenizer->max_token_length) return PJSON_STATUS_LIMIT_EXCEEDED;
+
+  if (is_buffered && length > tokenizer->buf_capacity
+    && length > pjson_buffer_size_limit(tokenizer, tokenizer->unescape_buf_capacity + pjson_segments_size(tokenizer))) {
+    return PJSON_STATUS_LIMIT_EXCEEDED;
+  }
+
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+/**
+ * Keeps track of the nesting depth of arrays and objects. (The tokenizer doesn't check the grammar, so it counts
+ * brackets and braces regardless of whether they match.)
+ */
+static inline pjson_parsing_status pjson_track_depth(pjson_tokenizer *tokenizer, pjson_token_type type) {
+  if (type == PJSON_TOKEN_OPEN_BRACKET || type == PJSON_TOKEN_OPEN_BRACE) {
+    if (++tokenizer->depth > tokenizer->max_depth) return PJSON_STATUS_MAX_DEPTH_EXCEEDED;
+  }
+  else if ((type == PJSON_TOKEN_CLOSE_BRACKET || type == PJSON_TOKEN_CLOSE_BRACE) && tokenizer->depth) {
+    tokenizer->depth--;
+  }
+
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+static void *pjson_buffer_pool_borrow(pjson_buffer_pool *pool) {
+  void *slab = pool->free_list;
+  if (!slab) return pjson_malloc(pool->slab_size);
+
+  memcpy(&pool->free_list, slab, sizeof(void *));
+  pool->free_count--;
+  return slab;
+}
+
+static void pjson_buffer_pool_return(pjson_buffer_pool *pool, void *slab) {
+  if (pool->free_count >= pool->max_free_count) {
+    pjson_free(slab);
+    return;
+  }
+
+  memcpy(slab, &pool->free_list, sizeof(void *));
+  pool->free_list = slab;
+  pool->free_count++;
+}
+
+void pjson_buffer_pool_init(pjson_buffer_pool *pool, size_t slab_size, size_t max_free_count) {
+  assert(pool && slab_size >= sizeof(void *));
+
+  pool->slab_size = slab_size;
+  pool->max_free_count = max_free_count;
+  pool->free_count = 0;
+  pool->free_list = NULL;
+}
+
+void pjson_buffer_pool_free(pjson_buffer_pool *pool) {
+  assert(pool);
+
+  while (pool->free_list) {
+    void *slab = pool->free_list;
+    memcpy(&pool->free_list, slab, sizeof(void *));
+    pjson_free(slab);
+  }
+  pool->free_count = 0;
+}
+
+/**
+ * Reverts the internal buffer to its fixed-size part, freeing or returning to the pool the heap-allocated one.
+ */
+static void pjson_release_internal_buffer(pjson_tokenizer *tokenizer) {
+  assert(tokenizer->buf != pjson_fixed_size_buf(tokenizer) && !tokenizer->buf_length);
+
+  if (tokenizer->is_buf_pooled) pjson_buffer_pool_return(tokenizer->buffer_pool, tokenizer->buf);
+  else pjson_deallocate(tokenizer->allocator, tokenizer->buf, tokenizer->buf_capacity);
+
+  tokenizer->buf = pjson_fixed_size_buf(tokenizer);
+  tokenizer->buf_capacity = FIXED_SIZE_BUF_CAPACITY;
+  tokenizer->is_buf_pooled = false;
+}
+
+/**
+ * Called when the internal buffer has been emptied after completing a token.
+ */
+static inline void pjson_trim_internal_buffer(pjson_tokenizer *tokenizer) {
+  if (tokenizer->buf != pjson_fixed_size_buf(tokenizer)
+    && (tokenizer->buffer_pool || tokenizer->buf_capacity > tokenizer->buffer_high_water)) {
+    pjson_release_internal_buffer(tokenizer);
+  }
+}
+
+/**
+ * Called when the unescaping buffer is no longer referenced by a token nor holds a pending escape sequence.
+ */
+static inline void pjson_trim_unescape_buf(pjson_tokenizer *tokenizer) {
+  if (tokenizer->unescape_buf
+    && (tokenizer->buffer_pool || tokenizer->unescape_buf_capacity > tokenizer->buffer_high_water)) {
+    assert(!tokenizer->string_chunk_pending_length);
+    pjson_deallocate(tokenizer->allocator, tokenizer->unescape_buf, tokenizer->unescape_buf_capacity);
+    tokenizer->unescape_buf = NULL;
+    tokenizer->unescape_buf_capacity = 0;
+  }
+}
+
+/**
+ * Called when the segment list has been emptied after completing (or starting to stream) a token.
+ */
+static inline void pjson_trim_segments(pjson_tokenizer *tokenizer) {
+  if (tokenizer->segments
+    && (tokenizer->buffer_pool || pjson_segments_size(tokenizer) > tokenizer->buffer_high_water)) {
+    assert(!tokenizer->segment_count);
+    pjson_deallocate(tokenizer->allocator, tokenizer->segments, pjson_segments_size(tokenizer));
+    tokenizer->segments = NULL;
+    tokenizer->segment_capacity = 0;
+  }
+}
+
 static const uint8_t *pjson_push_data_into_internal_buffer(pjson_tokenizer *tokenizer, const uint8_t *start, const uint8_t *end) {
   size_t count = end - start, new_length = tokenizer->buf_length + count;
   if (new_length < tokenizer->buf_length) return NULL; // handle unsigned overflow
@@ -170,28 +500,46 @@ static const uint8_t *pjson_push_data_into_internal_buffer(pjson_tokenizer *toke
   if (new_length > tokenizer->buf_capacity) {
     uint8_t *buf;
     size_t new_capacity = max(new_length, tokenizer->buf_capacity + (tokenizer->buf_capacity >> 1));
-    for (;;) {
-      if (tokenizer->buf == tokenizer->fixed_size_buf) {
-        buf = pjson_malloc(new_capacity);
-        if (buf) {
-          memcpy(buf, tokenizer->fixed_size_buf, tokenizer->buf_length);
-          break;
+    size_t limit = pjson_buffer_size_limit(tokenizer, tokenizer->unescape_buf_capacity + pjson_segments_size(tokenizer));
+    assert(new_length <= limit); // checked by pjson_check_token_limits
+    if (new_capacity > limit) new_capacity = limit;
+
+    pjson_buffer_pool *pool = tokenizer->buffer_pool;
+    if (pool && tokenizer->buf == pjson_fixed_size_buf(tokenizer) && new_length <= pool->slab_size && pool->slab_size <= limit) {
+      buf = pjson_buffer_pool_borrow(pool);
+      if (!buf) return NULL;
+      if (tokenizer->buf_length) memcpy(buf, tokenizer->buf, tokenizer->buf_length);
+      tokenizer->is_buf_pooled = true;
+      new_capacity = pool->slab_size;
+    }
+    else {
+      for (;;) {
+        if (tokenizer->buf == pjson_fixed_size_buf(tokenizer) || tokenizer->is_buf_pooled) {
+          buf = pjson_allocate(tokenizer->allocator, new_capacity);
+          if (buf) {
+            if (tokenizer->buf_length) memcpy(buf, tokenizer->buf, tokenizer->buf_length);
+            if (tokenizer->is_buf_pooled) {
+              pjson_buffer_pool_return(pool, tokenizer->buf);
+              tokenizer->is_buf_pooled = false;
+            }
+            break;
+          }
+        }
+        else {
+          buf = pjson_reallocate(tokenizer->allocator, tokenizer->buf, tokenizer->buf_capacity, new_capacity);
+          if (buf) break;
         }
-      }
-      else {
-        buf = pjson_realloc(tokenizer->buf, new_capacity);
-        if (buf) break;
-      }
 
-      if (new_capacity > new_length) new_capacity = new_length; // retry allocation with new_length
-      else return NULL;
+        if (new_capacity > new_length) new_capacity = new_length; // retry allocation with new_length
+        else return NULL;
+      }
     }
     tokenizer->buf = buf;
-    tokenizer->buf_capacity = new_capacity;
+    tokenizer->buf_capacity = (pjson_tokenizer_length)new_capacity;
   }
 
   memcpy(tokenizer->buf + tokenizer->buf_length, start, count);
-  tokenizer->buf_length = new_length;
+  tokenizer->buf_length = (pjson_tokenizer_length)new_length;
   return tokenizer->buf + new_length;
 }
 
@@ -206,48 +554,341 @@ static inline const uint8_t *pjson_ensure_token_data(pjson_tokenizer *tokenizer,
   return end;
 }
 
+static pjson_parsing_status pjson_push_segment(pjson_tokenizer *tokenizer, const uint8_t *start, const uint8_t *end) {
+  if (tokenizer->segment_count == tokenizer->segment_capacity) {
+    size_t new_capacity = max((size_t)4, tokenizer->segment_capacity + (tokenizer->segment_capacity >> 1));
+    if (new_capacity > (size_t)-1 / sizeof(pjson_segment) || new_capacity > PJSON_TOKENIZER_LENGTH_MAX) return PJSON_STATUS_OUT_OF_MEMORY;
+
+    size_t limit = pjson_buffer_size_limit(tokenizer, pjson_internal_buffer_size(tokenizer) + tokenizer->unescape_buf_capacity)
+      / sizeof(pjson_segment);
+    if (new_capacity > limit) new_capacity = limit;
+    if (new_capacity <= tokenizer->segment_capacity) return PJSON_STATUS_LIMIT_EXCEEDED;
+
+    pjson_segment *segments = pjson_reallocate(tokenizer->allocator, tokenizer->segments,
+      pjson_segments_size(tokenizer), new_capacity * sizeof(pjson_segment));
+    if (!segments) return PJSON_STATUS_OUT_OF_MEMORY;
+    tokenizer->segments = segments;
+    tokenizer->segment_capacity = (pjson_tokenizer_length)new_capacity;
+  }
+
+  pjson_segment *segment = &tokenizer->segments[tokenizer->segment_count++];
+  segment->start = start;
+  segment->length = end - start;
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+static pjson_parsing_status pjson_flush_tokens(pjson_tokenizer *tokenizer) {
+  pjson_token_sink *sink = tokenizer->sink;
+  size_t count = tokenizer->sink_token_count;
+  if (!count) return PJSON_STATUS_DATA_NEEDED;
+
+  tokenizer->sink_token_count = 0;
+  return sink->eat(sink, sink->tokens, count);
+}
+
+/**
+ * Returns where to construct the next token: `local` or, in batch mode, the next free slot of the sink's array
+ * (so that the token doesn't need to be copied there).
+ */
+static inline pjson_token *pjson_next_token(pjson_tokenizer *tokenizer, pjson_token *local) {
+  pjson_token_sink *sink = tokenizer->sink;
+  if (!sink) return local;
+
+  assert(tokenizer->sink_token_count < sink->capacity);
+  return &sink->tokens[tokenizer->sink_token_count];
+}
+
+/**
+ * Passes `token` (obtained from pjson_next_token) to the parser or, in batch mode, appends it to the current batch.
+ * @param must_flush Specifies whether the token becomes invalid after returning (so the batch must be delivered now).
+ */
+static inline pjson_parsing_status pjson_eat_token(pjson_tokenizer *tokenizer, const pjson_token *token, bool must_flush) {
+  pjson_token_sink *sink = tokenizer->sink;
+  if (!sink) {
+    pjson_parser_base *parser = tokenizer->parser;
+    return parser->eat(parser, token);
+  }
+
+  return ++tokenizer->sink_token_count == sink->capacity || must_flush
+    ? pjson_flush_tokens(tokenizer)
+    : PJSON_STATUS_DATA_NEEDED;
+}
+
+static pjson_parsing_status pjson_reserve_unescape_buf(pjson_tokenizer *tokenizer, size_t size) {
+  if (size > tokenizer->unescape_buf_capacity) {
+    size_t limit = pjson_buffer_size_limit(tokenizer, pjson_internal_buffer_size(tokenizer) + pjson_segments_size(tokenizer));
+    if (size > limit) return PJSON_STATUS_LIMIT_EXCEEDED;
+
+    size_t new_capacity = max(size, tokenizer->unescape_buf_capacity + (tokenizer->unescape_buf_capacity >> 1));
+    if (new_capacity > limit) new_capacity = limit;
+    uint8_t *buf = pjson_reallocate(tokenizer->allocator, tokenizer->unescape_buf, tokenizer->unescape_buf_capacity, new_capacity);
+    if (!buf) return PJSON_STATUS_OUT_OF_MEMORY;
+    tokenizer->unescape_buf = buf;
+    tokenizer->unescape_buf_capacity = (pjson_tokenizer_length)new_capacity;
+  }
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+static pjson_parsing_status pjson_unescape_string(pjson_tokenizer *tokenizer, pjson_token *token) {
+  pjson_parsing_status status = pjson_reserve_unescape_buf(tokenizer, token->unescaped_length);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+
+  bool success = pjson_parse_string(tokenizer->unescape_buf, token->unescaped_length, token->start, token->length, true);
+  assert(success); // the token has been validated already
+  (void)success;
+  token->unescaped = tokenizer->unescape_buf;
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+/**
+ * Passes the string payload `[start, end)` to the string chunk handler, unescaping it if requested. (An escape sequence
+ * which may continue in the next chunk is kept at the start of the scratch buffer until then, unless `is_last`.)
+ */
+static pjson_parsing_status pjson_stream_string_part(pjson_tokenizer *tokenizer, const uint8_t *start, const uint8_t *end, bool is_last) {
+  pjson_string_chunk_handler *handler = tokenizer->string_chunk_handler;
+  if (!tokenizer->unescape_strings) {
+    return start < end ? handler->on_chunk(handler, tokenizer->token_start_index, start, end - start) : PJSON_STATUS_DATA_NEEDED;
+  }
+
+  size_t pending_length = tokenizer->string_chunk_pending_length, length = pending_length + (end - start);
+  if (length < pending_length) return PJSON_STATUS_OUT_OF_MEMORY; // handle unsigned overflow
+  pjson_parsing_status status = pjson_reserve_unescape_buf(tokenizer, length);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+  if (start < end) memcpy(tokenizer->unescape_buf + pending_length, start, end - start);
+
+  // Unescaping never makes the string longer, so it can be done in place.
+  uint8_t *dest = tokenizer->unescape_buf;
+  const uint8_t *rest = unescape_string_part(&dest, tokenizer->unescape_buf, tokenizer->unescape_buf + length, is_last);
+  status = dest > tokenizer->unescape_buf
+    ? handler->on_chunk(handler, tokenizer->token_start_index, tokenizer->unescape_buf, dest - tokenizer->unescape_buf)
+    : PJSON_STATUS_DATA_NEEDED;
+
+  pending_length = tokenizer->unescape_buf + length - rest;
+  if (pending_length) memmove(tokenizer->unescape_buf, rest, pending_length);
+  tokenizer->string_chunk_pending_length = (pjson_tokenizer_length)pending_length;
+  return status;
+}
+
+/**
+ * Passes the part of an incomplete string received so far to the string chunk handler (see `pjson_string_chunk_handler`).
+ */
+static pjson_parsing_status pjson_stream_string(pjson_tokenizer *tokenizer, const uint8_t *data, const uint8_t *end) {
+  pjson_parsing_status status;
+
+  if (!tokenizer->is_streaming_string) {
+    tokenizer->is_streaming_string = true;
+
+    // Tokens preceding the string must be delivered first.
+    if (tokenizer->sink && (status = pjson_flush_tokens(tokenizer)) != PJSON_STATUS_DATA_NEEDED) return status;
+
+    // Pass on what has been received before this chunk, skipping the opening quote.
+    if (tokenizer->segment_count) {
+      for (size_t i = 0; i < tokenizer->segment_count; i++) {
+        const pjson_segment *segment = &tokenizer->segments[i];
+        status = pjson_stream_string_part(tokenizer, segment->start + (i == 0), segment->start + segment->length, false);
+        if (status != PJSON_STATUS_DATA_NEEDED) return status;
+      }
+      tokenizer->segment_count = 0;
+      pjson_trim_segments(tokenizer);
+    }
+    else if (tokenizer->token_start == tokenizer->buf) {
+      status = pjson_stream_string_part(tokenizer, tokenizer->buf + 1, tokenizer->buf + tokenizer->buf_length, false);
+      tokenizer->buf_length = 0;
+      pjson_trim_internal_buffer(tokenizer);
+      if (status != PJSON_STATUS_DATA_NEEDED) return status;
+    }
+    else {
+      data = tokenizer->token_start + 1;
+    }
+    tokenizer->token_start = NULL;
+  }
+
+  return pjson_stream_string_part(tokenizer, data, end, false);
+}
+
+static pjson_parsing_status pjson_finish_streamed_string(pjson_tokenizer *tokenizer, const uint8_t *data, const uint8_t *end) {
+  assert(tokenizer->token_type == PJSON_TOKEN_STRING && data < end);
+  pjson_parsing_status status = pjson_stream_string_part(tokenizer, data, end - 1, true); // skip the closing quote
+  tokenizer->is_streaming_string = false;
+  assert(tokenizer->string_chunk_pending_length == 0);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+
+  pjson_token local, *token = pjson_next_token(tokenizer, &local);
+  token->type = tokenizer->token_type;
+  token->start_index = tokenizer->token_start_index;
+  token->start = NULL;
+  token->length = tokenizer->index + 1 - tokenizer->token_start_index;
+  token->unescaped_length = tokenizer->unescaped_length;
+  token->unescaped = NULL;
+  token->segments = NULL;
+  token->segment_count = 0;
+  if ((status = pjson_check_token_limits(tokenizer, token->length, false)) != PJSON_STATUS_DATA_NEEDED) return status;
+
+  pjson_string_chunk_handler *handler = tokenizer->string_chunk_handler;
+  if (handler->on_end && (status = handler->on_end(handler, token)) != PJSON_STATUS_DATA_NEEDED) return status;
+
+  pjson_trim_unescape_buf(tokenizer);
+  return pjson_eat_token(tokenizer, token, false);
+}
+
+/**
+ * Completes a string token whose previous parts were recorded as segments by pjson_feed (see `scatter_strings`).
+ */
+static pjson_parsing_status pjson_finish_segmented_token(pjson_tokenizer *tokenizer, const uint8_t *data, const uint8_t *end) {
+  assert(tokenizer->token_type == PJSON_TOKEN_STRING && data < end);
+  pjson_parsing_status status = pjson_push_segment(tokenizer, data, end);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+
+  pjson_token local, *token = pjson_next_token(tokenizer, &local);
+  token->type = tokenizer->token_type;
+  token->start_index = tokenizer->token_start_index;
+  token->start = tokenizer->segments[0].start;
+  token->length = 0;
+  for (size_t i = 0; i < tokenizer->segment_count; i++) {
+    token->length += tokenizer->segments[i].length;
+  }
+  token->unescaped_length = tokenizer->unescaped_length;
+  token->unescaped = NULL;
+  token->segments = tokenizer->segments;
+  token->segment_count = tokenizer->segment_count;
+
+  status = pjson_check_token_limits(tokenizer, token->length, false);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+
+  status = pjson_eat_token(tokenizer, token, true); // the segment list is reused by the next token
+  tokenizer->segment_count = 0;
+  pjson_trim_segments(tokenizer);
+  return status;
+}
+
 static pjson_parsing_status pjson_finish_token(pjson_tokenizer *tokenizer, const uint8_t *data, const uint8_t *end) {
+  if (tokenizer->is_streaming_string) {
+    return pjson_finish_streamed_string(tokenizer, data, end);
+  }
+
+  if (tokenizer->segment_count) {
+    return pjson_finish_segmented_token(tokenizer, data, end);
+  }
+
+  bool is_buffered = tokenizer->token_start == tokenizer->buf;
+  pjson_parsing_status status = pjson_check_token_limits(tokenizer,
+    is_buffered ? tokenizer->buf_length + (size_t)(end - data) : (size_t)(end - tokenizer->token_start), is_buffered);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+
   end = pjson_ensure_token_data(tokenizer, data, end);
   if (!end) {
     return PJSON_STATUS_OUT_OF_MEMORY;
   }
 
-  pjson_token token;
-  token.type = tokenizer->token_type;
-  token.start_index = tokenizer->token_start_index;
-  token.start = tokenizer->token_start;
-  token.length = end - token.start;
-  token.unescaped_length = tokenizer->unescaped_length;
-  assert(token.unescaped_length <= token.length);
-
-  pjson_parser_base *parser = tokenizer->parser;
-  pjson_parsing_status status = parser->eat(parser, &token);
+  pjson_token local, *token = pjson_next_token(tokenizer, &local);
+  token->type = tokenizer->token_type;
+  token->start_index = tokenizer->token_start_index;
+  token->start = tokenizer->token_start;
+  token->length = end - token->start;
+  token->unescaped_length = tokenizer->unescaped_length;
+  token->unescaped = NULL;
+  token->segments = NULL;
+  token->segment_count = 0;
+  assert(token->unescaped_length <= token->length);
+
+  bool must_flush = is_buffered, is_unescaped = false;
+
+  if (tokenizer->unescape_strings && token->type == PJSON_TOKEN_STRING) {
+    if (token->unescaped_length == token->length - 2) {
+      token->unescaped = token->start + 1; // no escape sequences, the string can be referenced in place
+    }
+    else {
+      if ((status = pjson_unescape_string(tokenizer, token)) != PJSON_STATUS_DATA_NEEDED) return status;
+      must_flush = is_unescaped = true; // the scratch buffer is reused by the next string
+    }
+  }
+
+  status = pjson_eat_token(tokenizer, token, must_flush);
   tokenizer->buf_length = 0;
+  if (is_buffered) pjson_trim_internal_buffer(tokenizer);
+  if (is_unescaped) pjson_trim_unescape_buf(tokenizer);
   return status;
 }
 
 static pjson_parsing_status pjson_emit_punctuator(pjson_tokenizer *tokenizer, pjson_token_type type, const uint8_t *p) {
-  pjson_token token;
+  pjson_parsing_status status = pjson_track_depth(tokenizer, type);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+
+  pjson_token local, *token = pjson_next_token(tokenizer, &local);
   // All JSON punctuators are 1 byte long, so incomplete token handling can be skipped.
-  token.type = type;
-  token.start_index = tokenizer->index;
-  token.start = p;
-  token.length = token.unescaped_length = 1;
+  token->type = type;
+  token->start_index = tokenizer->index;
+  token->start = p;
+  token->length = token->unescaped_length = 1;
+  token->unescaped = NULL;
+  token->segments = NULL;
+  token->segment_count = 0;
+
+  return pjson_eat_token(tokenizer, token, false);
+}
 
-  pjson_parser_base *parser = tokenizer->parser;
-  return parser->eat(parser, &token);
+/**
+ * Check whether the parser may make the tokenizer skip the content of the array or object whose opening token
+ * has just been emitted (see PJSON_STATUS_SKIP). In batch mode, tokens reach the parser too late for that.
+ */
+static inline bool pjson_can_skip(const pjson_tokenizer *tokenizer) {
+  return !tokenizer->sink
+    && (tokenizer->token_type == PJSON_TOKEN_OPEN_BRACKET || tokenizer->token_type == PJSON_TOKEN_OPEN_BRACE);
 }
 
 static pjson_parsing_status pjson_emit_eos(pjson_tokenizer *tokenizer) {
-  pjson_token token;
-  token.type = PJSON_TOKEN_EOS;
-  token.start_index = tokenizer->index;
-  token.start = NULL;
-  token.length = token.unescaped_length = 0;
+  pjson_token local, *token = pjson_next_token(tokenizer, &local);
+  token->type = PJSON_TOKEN_EOS;
+  token->start_index = tokenizer->index;
+  token->start = NULL;
+  token->length = token->unescaped_length = 0;
+  token->unescaped = NULL;
+  token->segments = NULL;
+  token->segment_count = 0;
+
+  return pjson_eat_token(tokenizer, token, true);
+}
 
-  pjson_parser_base *parser = tokenizer->parser;
-  return parser->eat(parser, &token);
+// Note for maintainers: pjson_feed is written in terms of the following macros so that the same code can be compiled
+// to either a portable switch-based state machine or, when PJSON_USE_COMPUTED_GOTO is defined and the compiler
+// supports labels as values (GCC, Clang), a direct-threaded one. In the latter case each state handler jumps straight
+// to the handler of the next state, sparing the bounds check and the shared indirect branch of the switch.
+// * HANDLE_STATE(s) starts the handler of state `s`.
+// * NEXT_BYTE(s) moves to the next input byte and continues in state `s` (which must be one of the STATE_* names).
+// * NEXT_BYTE_IN_CURRENT_STATE() moves to the next input byte and continues in the state stored in `state`.
+// The current state and index are kept in locals and written back to the tokenizer (see SAVE_STATE) only
+// before invoking callbacks and returning.
+
+#if defined(PJSON_USE_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define PJSON_COMPUTED_GOTO
+#endif
+
+#if defined(PJSON_COMPUTED_GOTO)
+#define HANDLE_STATE(s) Handle_##s:
+#define STATE_HANDLER_ADDRESS(s) [s] = &&Handle_##s
+#define NEXT_BYTE(s) { \
+  state = (s); \
+  if (p++, ++index, p >= data_end) goto BufferConsumed; \
+  ch = *p; \
+  goto Handle_##s; \
 }
+#define NEXT_BYTE_IN_CURRENT_STATE() { \
+  if (p++, ++index, p >= data_end) goto BufferConsumed; \
+  ch = *p; \
+  goto *STATE_HANDLER_LOOKUP[state]; \
+}
+#else
+#define HANDLE_STATE(s) case s:
+#define NEXT_BYTE(s) { state = (s); continue; }
+#define NEXT_BYTE_IN_CURRENT_STATE() continue
+#endif
+
+#define SAVE_STATE() (tokenizer->state = (pjson_tokenizer_state)state, tokenizer->index = index)
+
+#if defined(PJSON_COMPUTED_GOTO)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // labels as values are a GNU extension
+#endif
 
 pjson_parsing_status pjson_feed(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length) {
   assert(tokenizer);
@@ -259,19 +900,71 @@ pjson_parsing_status pjson_feed(pjson_tokenizer *tokenizer, const uint8_t *data,
   const uint8_t *p, *const data_end = data + length;
   assert((uintptr_t)data <= (uintptr_t)data_end); // check for unsigned overflow
 
-  for (p = data; p < data_end; p++, tokenizer->index++) {
-    uint8_t ch = *p, ch2;
-    switch (tokenizer->state) {
-      case STATE_BETWEEN_TOKENS: {
+  const uint8_t *utf8_slow_path_end = data;
+  const pjson_kernels *const kernels = tokenizer->kernels;
+
+  int state = tokenizer->state;
+  size_t index = tokenizer->index;
+  uint8_t ch, ch2;
+
+  if (state < 0) return state;
+
+#if defined(PJSON_COMPUTED_GOTO)
+  static const void *const STATE_HANDLER_LOOKUP[] = {
+    STATE_HANDLER_ADDRESS(STATE_BETWEEN_TOKENS),
+    STATE_HANDLER_ADDRESS(STATE_IN_KEYWORD),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_ESCAPE),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_1_OF_4),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_2_OF_4),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_3_OF_4),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_4_OF_4),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_MAYBE_LOW_SURROGATE_ESCAPE),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_ESCAPE_MAYBE_LOW_SURROGATE),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_3),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_4),
+    STATE_HANDLER_ADDRESS(STATE_IN_STRING_EXPECT_UTF8_BYTE_4_OF_4),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_EXPECT_INTEGER_PART),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_EXPECT_FRACTIONAL_PART),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_EXPECT_EXPONENT),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_EXPECT_EXPONENT_DIGITS),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_INTEGER_PART),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_FRACTIONAL_PART),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_EXPONENT_DIGITS),
+    STATE_HANDLER_ADDRESS(STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT),
+    STATE_HANDLER_ADDRESS(STATE_SKIPPING_VALUE),
+    STATE_HANDLER_ADDRESS(STATE_SKIPPING_VALUE_IN_STRING),
+    STATE_HANDLER_ADDRESS(STATE_SKIPPING_VALUE_IN_STRING_EXPECT_ESCAPE),
+  };
+
+  p = data;
+  if (p >= data_end) goto BufferConsumed;
+  ch = *p;
+  assert((size_t)state < pjson_countof(STATE_HANDLER_LOOKUP));
+  goto *STATE_HANDLER_LOOKUP[state];
+
+  {
+    {
+#else
+  for (p = data; p < data_end; p++, index++) {
+    ch = *p;
+    switch (state) {
+#endif
+      HANDLE_STATE(STATE_BETWEEN_TOKENS) {
         switch (ch) {
           case '\x20': case '\t': case '\r': case '\n':
-            continue;
+            // Indentation usually comes in runs, so jump over the whole run at once.
+            tmp = skip_whitespace(kernels, p + 1, data_end) - (p + 1);
+            p += tmp, index += tmp;
+            NEXT_BYTE(STATE_BETWEEN_TOKENS);
 
           case '"':
-            pjson_start_token(tokenizer, PJSON_TOKEN_STRING, tokenizer->index, p);
+            pjson_start_token(tokenizer, PJSON_TOKEN_STRING, index, p);
             tokenizer->unescaped_length = 0;
-            tokenizer->state = STATE_IN_STRING;
-            continue;
+            NEXT_BYTE(STATE_IN_STRING);
 
           case ':':
             tokenizer->token_type = PJSON_TOKEN_COLON;
@@ -298,34 +991,28 @@ pjson_parsing_status pjson_feed(pjson_tokenizer *tokenizer, const uint8_t *data,
             goto EmitPunctuator;
 
           case '-':
-            pjson_start_token(tokenizer, PJSON_TOKEN_NUMBER, tokenizer->index, p);
-            tokenizer->state = STATE_IN_NUMBER_EXPECT_INTEGER_PART;
-            continue;
+            pjson_start_token(tokenizer, PJSON_TOKEN_NUMBER, index, p);
+            NEXT_BYTE(STATE_IN_NUMBER_EXPECT_INTEGER_PART);
 
           case '0':
-            pjson_start_token(tokenizer, PJSON_TOKEN_NUMBER, tokenizer->index, p);
-            tokenizer->state = STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT;
-            continue;
+            pjson_start_token(tokenizer, PJSON_TOKEN_NUMBER, index, p);
+            NEXT_BYTE(STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT);
 
           case '1': case '2': case '3': case '4': case '5': case '6': case '7':  case '8':  case '9':
-            pjson_start_token(tokenizer, PJSON_TOKEN_NUMBER, tokenizer->index, p);
-            tokenizer->state = STATE_IN_NUMBER_INTEGER_PART;
-            continue;
+            pjson_start_token(tokenizer, PJSON_TOKEN_NUMBER, index, p);
+            NEXT_BYTE(STATE_IN_NUMBER_INTEGER_PART);
 
           case 'f':
-            pjson_start_token(tokenizer, PJSON_TOKEN_FALSE, tokenizer->index, p);
-            tokenizer->state = STATE_IN_KEYWORD;
-            continue;
+            pjson_start_token(tokenizer, PJSON_TOKEN_FALSE, index, p);
+            NEXT_BYTE(STATE_IN_KEYWORD);
 
           case 't':
-            pjson_start_token(tokenizer, PJSON_TOKEN_TRUE, tokenizer->index, p);
-            tokenizer->state = STATE_IN_KEYWORD;
-            continue;
+            pjson_start_token(tokenizer, PJSON_TOKEN_TRUE, index, p);
+            NEXT_BYTE(STATE_IN_KEYWORD);
 
           case 'n':
-            pjson_start_token(tokenizer, PJSON_TOKEN_NULL, tokenizer->index, p);
-            tokenizer->state = STATE_IN_KEYWORD;
-            continue;
+            pjson_start_token(tokenizer, PJSON_TOKEN_NULL, index, p);
+            NEXT_BYTE(STATE_IN_KEYWORD);
         }
 
         goto UnexpectedCharacter;
@@ -333,352 +1020,389 @@ pjson_parsing_status pjson_feed(pjson_tokenizer *tokenizer, const uint8_t *data,
 
       /* Keywords */
 
-      case STATE_IN_KEYWORD: {
+      HANDLE_STATE(STATE_IN_KEYWORD) {
         tmp = tokenizer->token_type - PJSON_TOKEN_NULL;
         assert(tmp < (pjson_countof(KEYWORD_LOOKUP)));
         const uint8_t *const keyword = (uint8_t *)KEYWORD_LOOKUP[tmp];
 
-        tmp = tokenizer->index - tokenizer->token_start_index;
+        tmp = index - tokenizer->token_start_index;
         assert(tmp <= (tokenizer->token_type == PJSON_TOKEN_FALSE ? 5 : 4));
 
         ch2 = keyword[tmp];
-        if (ch == ch2) continue;
-        else if (ch2 == 0) {
-          switch (ch) {
-            case '\x20': case '\t': case '\r': case '\n': goto FinishKeywordOrNumberAndHandleWhitespace;
-            case ':': tmp = PJSON_TOKEN_COLON; goto FinishKeywordOrNumberAndHandlePunctuator;
-            case ',': tmp = PJSON_TOKEN_COMMA; goto FinishKeywordOrNumberAndHandlePunctuator;
-            case '[': tmp = PJSON_TOKEN_OPEN_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-            case ']': tmp = PJSON_TOKEN_CLOSE_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-            case '{': tmp = PJSON_TOKEN_OPEN_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
-            case '}': tmp = PJSON_TOKEN_CLOSE_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
-          }
-        }
+        if (ch == ch2) NEXT_BYTE(STATE_IN_KEYWORD);
+
+        if (ch2 == 0) goto FinishKeywordOrNumber;
 
         goto InvalidToken;
       }
 
       /* String */
 
-      case STATE_IN_STRING: {
+      HANDLE_STATE(STATE_IN_STRING) {
       ExpectStringCharacter:
         if ((ch & 0x80) == 0) {
           if (ch == '"') {
+            SAVE_STATE();
             status = pjson_finish_token(tokenizer, data, p + 1);
             if (status != PJSON_STATUS_DATA_NEEDED) {
               if (status == PJSON_STATUS_COMPLETED) {
-                p++, tokenizer->index++;
+                p++, index++;
                 goto Completed;
               }
               else goto UnexpectedTokenOrOtherError;
             }
-            tokenizer->state = STATE_BETWEEN_TOKENS;
+            NEXT_BYTE(STATE_BETWEEN_TOKENS);
           }
           else if (ch == '\\') {
-            tokenizer->state = STATE_IN_STRING_EXPECT_ESCAPE;
+            NEXT_BYTE(STATE_IN_STRING_EXPECT_ESCAPE);
           }
           else if (ch >= 0x20) {
-            tokenizer->unescaped_length++;
+            // Plain ASCII characters usually come in runs, so consume the whole run at once.
+            tmp = scan_string_ascii_run(kernels, p + 1, data_end) - p;
+            tokenizer->unescaped_length += (pjson_tokenizer_length)tmp;
+            p += tmp - 1, index += tmp - 1;
+            NEXT_BYTE(STATE_IN_STRING);
           }
           else goto InvalidToken;
         }
         else {
-          if ((ch & 0xE0) == 0xC0) {
-            tokenizer->state = STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2;
-          }
-          else if ((ch & 0xF0) == 0xE0) {
-            tokenizer->state = STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3;
-          }
-          else if ((ch & 0xF8) == 0xF0) {
-            tokenizer->state = STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4;
+          if (p >= utf8_slow_path_end) {
+            // Non-ASCII characters usually come in runs as well, so validate the whole span of string content
+            // up to the next quotation mark, backslash or control character at once. A trailing sequence
+            // which is continued in the next chunk is left to the per-byte states.
+            const uint8_t *span_end = kernels->scan_string_span(p + 1, data_end);
+            if (span_end == data_end) span_end = utf8_trim_incomplete_sequence(p, span_end);
+
+            if (span_end > p && kernels->utf8_validate(p, span_end)) {
+              tmp = span_end - p;
+              tokenizer->unescaped_length += (pjson_tokenizer_length)tmp;
+              p += tmp - 1, index += tmp - 1;
+              NEXT_BYTE(STATE_IN_STRING);
+            }
+
+            // The span is invalid, so fall back to the per-byte states, which pinpoint the position of the error.
+            // (Remembering the end of the span prevents validating the same span over and over again.)
+            utf8_slow_path_end = span_end;
           }
-          else goto Utf8Error;
 
           tokenizer->string_state.utf8_sequence_buf[0] = ch;
+
+          if ((ch & 0xE0) == 0xC0) NEXT_BYTE(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2);
+          if ((ch & 0xF0) == 0xE0) NEXT_BYTE(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3);
+          if ((ch & 0xF8) == 0xF0) NEXT_BYTE(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4);
+          goto Utf8Error;
         }
-        continue;
       }
 
-      case STATE_IN_STRING_EXPECT_ESCAPE: {
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_ESCAPE) {
       ExpectStringEscapeCharacter:
         switch (ch) {
           case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
             tokenizer->unescaped_length++;
-            tokenizer->state = STATE_IN_STRING;
-            continue;
+            NEXT_BYTE(STATE_IN_STRING);
           case 'u':
-            tokenizer->state = STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_1_OF_4;
-            continue;
+            // string_state may still hold the bytes of a preceding UTF8 sequence (see utf8_sequence_buf).
+            tokenizer->string_state.utf16_surrogate_pair[0] = tokenizer->string_state.utf16_surrogate_pair[1] = 0;
+            NEXT_BYTE(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_1_OF_4);
         }
 
         goto InvalidToken;
       }
 
-      case STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_1_OF_4:
-      case STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_2_OF_4:
-      case STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_3_OF_4: {
-        if (isxdigit(ch)) {
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_1_OF_4)
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_2_OF_4)
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_3_OF_4) {
+        if (is_hex_digit(ch)) {
           tokenizer->string_state.utf16_surrogate_pair[0] = tokenizer->string_state.utf16_surrogate_pair[0] << 4 | hex_digit_value(ch);
-          tokenizer->state++;
-          continue;
+          state++;
+          NEXT_BYTE_IN_CURRENT_STATE();
         }
 
         goto InvalidToken;
       }
 
-      case STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_4_OF_4: {
-        if (isxdigit(ch)) {
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_4_OF_4) {
+        if (is_hex_digit(ch)) {
           tmp = tokenizer->string_state.utf16_surrogate_pair[0] << 4 | hex_digit_value(ch);
           if (utf16_is_high_surrogate((uint16_t)tmp)) {
             if (tokenizer->string_state.utf16_surrogate_pair[1] != 0) { // two consecutive high surrogates (invalid encoding but JSON allows it; will be replaced with U+FFFD)
-              tokenizer->unescaped_length += utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT);
+              tokenizer->unescaped_length += (pjson_tokenizer_length)utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT);
             }
 
             tokenizer->string_state.utf16_surrogate_pair[0] = 0;
             tokenizer->string_state.utf16_surrogate_pair[1] = (uint16_t)tmp;
-            tokenizer->state = STATE_IN_STRING_MAYBE_LOW_SURROGATE_ESCAPE;
-            continue;
+            NEXT_BYTE(STATE_IN_STRING_MAYBE_LOW_SURROGATE_ESCAPE);
           }
           else if (tokenizer->string_state.utf16_surrogate_pair[1] != 0) {
             if (utf16_is_low_surrogate((uint16_t)tmp)) { // low surrogate following a high surrogate
-              tokenizer->unescaped_length += utf8_byte_size(utf16_to_code_point(tokenizer->string_state.utf16_surrogate_pair[1], (uint16_t)tmp));
+              tokenizer->unescaped_length += (pjson_tokenizer_length)utf8_byte_size(utf16_to_code_point(tokenizer->string_state.utf16_surrogate_pair[1], (uint16_t)tmp));
             }
             else { // lone high surrogate
-              tokenizer->unescaped_length += utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT);
-              tokenizer->unescaped_length += utf8_byte_size((int32_t)tmp);
+              tokenizer->unescaped_length += (pjson_tokenizer_length)utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT);
+              tokenizer->unescaped_length += (pjson_tokenizer_length)utf8_byte_size((int32_t)tmp);
             }
           }
           else {
-            tokenizer->unescaped_length += utf8_byte_size(!utf16_is_low_surrogate((uint16_t)tmp)
+            tokenizer->unescaped_length += (pjson_tokenizer_length)utf8_byte_size(!utf16_is_low_surrogate((uint16_t)tmp)
               ? (int32_t)tmp
               : UTF8_INVALID_CODEPOINT_REPLACEMENT); // lone low surrogate
           }
 
           tokenizer->string_state.utf16_surrogate_pair[0] = tokenizer->string_state.utf16_surrogate_pair[1] = 0;
-          tokenizer->state = STATE_IN_STRING;
-          continue;
+          NEXT_BYTE(STATE_IN_STRING);
         }
 
         goto InvalidToken;
       }
 
-      case STATE_IN_STRING_MAYBE_LOW_SURROGATE_ESCAPE: {
-        if (ch == '\\') {
-          tokenizer->state = STATE_IN_STRING_EXPECT_ESCAPE_MAYBE_LOW_SURROGATE;
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_STRING_MAYBE_LOW_SURROGATE_ESCAPE) {
+        if (ch == '\\') NEXT_BYTE(STATE_IN_STRING_EXPECT_ESCAPE_MAYBE_LOW_SURROGATE);
 
-        tokenizer->unescaped_length += utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT); // lone high surrogate
+        tokenizer->unescaped_length += (pjson_tokenizer_length)utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT); // lone high surrogate
         tokenizer->string_state.utf16_surrogate_pair[0] = tokenizer->string_state.utf16_surrogate_pair[1] = 0;
-        tokenizer->state = STATE_IN_STRING;
+        state = STATE_IN_STRING;
         goto ExpectStringCharacter;
       }
 
-      case STATE_IN_STRING_EXPECT_ESCAPE_MAYBE_LOW_SURROGATE: {
-        if (ch == 'u') {
-          tokenizer->state = STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_1_OF_4;
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_ESCAPE_MAYBE_LOW_SURROGATE) {
+        if (ch == 'u') NEXT_BYTE(STATE_IN_STRING_EXPECT_UTF16_ESCAPE_DIGIT_1_OF_4);
 
-        tokenizer->unescaped_length += utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT); // lone high surrogate
+        tokenizer->unescaped_length += (pjson_tokenizer_length)utf8_byte_size(UTF8_INVALID_CODEPOINT_REPLACEMENT); // lone high surrogate
         tokenizer->string_state.utf16_surrogate_pair[0] = tokenizer->string_state.utf16_surrogate_pair[1] = 0;
-        tokenizer->state = STATE_IN_STRING_EXPECT_ESCAPE;
+        state = STATE_IN_STRING_EXPECT_ESCAPE;
         goto ExpectStringEscapeCharacter;
       }
 
-      case STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2:
-      case STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3:
-      case STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_3:
-      case STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4:
-      case STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_4:
-      case STATE_IN_STRING_EXPECT_UTF8_BYTE_4_OF_4: {
-        tmp = tokenizer->state - STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2;
-        assert(0 < pjson_countof(FEED_UTF8_SEQUENCE_BYTE_LOOKUP));
-        if (!FEED_UTF8_SEQUENCE_BYTE_LOOKUP[tmp](tokenizer, ch)) goto Utf8Error;
-        continue;
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3)
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_4)
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_4) {
+        tmp = ((state - STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3) & 1) + 1;
+        tokenizer->string_state.utf8_sequence_buf[tmp] = ch;
+        state++;
+        NEXT_BYTE_IN_CURRENT_STATE();
       }
 
-      /* Number */
-
-      case STATE_IN_NUMBER_EXPECT_INTEGER_PART: {
-        if (ch == '0') {
-          tokenizer->state = STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT;
-          continue;
-        }
-
-        if (isdigit(ch)) {
-          tokenizer->state = STATE_IN_NUMBER_INTEGER_PART;
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_2) {
+        tmp = 2;
+        goto FinishUtf8Sequence;
+      }
 
-        goto InvalidToken;
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF8_BYTE_3_OF_3) {
+        tmp = 3;
+        goto FinishUtf8Sequence;
       }
 
-      case STATE_IN_NUMBER_INTEGER_PART: {
-        if (isdigit(ch)) {
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_STRING_EXPECT_UTF8_BYTE_4_OF_4) {
+        tmp = 4;
 
-      MaybeDecimalSeparatorOrExponent:
-        switch (ch) {
-          case '.':
-            tokenizer->state = STATE_IN_NUMBER_EXPECT_FRACTIONAL_PART;
-            continue;
-
-          case 'e': case 'E':
-            tokenizer->state = STATE_IN_NUMBER_EXPECT_EXPONENT;
-            continue;
-
-          case '\x20': case '\t': case '\r': case '\n': goto FinishKeywordOrNumberAndHandleWhitespace;
-          case ':': tmp = PJSON_TOKEN_COLON; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case ',': tmp = PJSON_TOKEN_COMMA; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '[': tmp = PJSON_TOKEN_OPEN_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case ']': tmp = PJSON_TOKEN_CLOSE_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '{': tmp = PJSON_TOKEN_OPEN_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '}': tmp = PJSON_TOKEN_CLOSE_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
+      FinishUtf8Sequence:
+        tokenizer->string_state.utf8_sequence_buf[tmp - 1] = ch;
+        if (!utf8_is_valid_sequence(tokenizer->string_state.utf8_sequence_buf, tmp)) {
+          index -= tmp - 1; // report the error at the lead byte of the sequence
+          goto Utf8Error;
         }
 
-        goto InvalidToken;
+        tokenizer->unescaped_length += (pjson_tokenizer_length)tmp;
+        NEXT_BYTE(STATE_IN_STRING);
       }
 
-      case STATE_IN_NUMBER_EXPECT_FRACTIONAL_PART: {
-        if (isdigit(ch)) {
-          tokenizer->state = STATE_IN_NUMBER_FRACTIONAL_PART;
-          continue;
-        }
+      /* Number */
+
+      HANDLE_STATE(STATE_IN_NUMBER_EXPECT_INTEGER_PART) {
+        if (ch == '0') NEXT_BYTE(STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT);
+
+        if (is_digit(ch)) NEXT_BYTE(STATE_IN_NUMBER_INTEGER_PART);
 
         goto InvalidToken;
       }
 
-      case STATE_IN_NUMBER_FRACTIONAL_PART: {
-        if (isdigit(ch)) {
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_NUMBER_INTEGER_PART) {
+        if (is_digit(ch)) NEXT_BYTE(STATE_IN_NUMBER_INTEGER_PART);
 
+      MaybeDecimalSeparatorOrExponent:
         switch (ch) {
-          case 'e': case 'E':
-            tokenizer->state = STATE_IN_NUMBER_EXPECT_EXPONENT;
-            continue;
-
-          case '\x20': case '\t': case '\r': case '\n': goto FinishKeywordOrNumberAndHandleWhitespace;
-          case ':': tmp = PJSON_TOKEN_COLON; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case ',': tmp = PJSON_TOKEN_COMMA; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '[': tmp = PJSON_TOKEN_OPEN_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case ']': tmp = PJSON_TOKEN_CLOSE_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '{': tmp = PJSON_TOKEN_OPEN_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '}': tmp = PJSON_TOKEN_CLOSE_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
+          case '.': NEXT_BYTE(STATE_IN_NUMBER_EXPECT_FRACTIONAL_PART);
+          case 'e': case 'E': NEXT_BYTE(STATE_IN_NUMBER_EXPECT_EXPONENT);
         }
 
+        goto FinishKeywordOrNumber;
+      }
+
+      HANDLE_STATE(STATE_IN_NUMBER_EXPECT_FRACTIONAL_PART) {
+        if (is_digit(ch)) NEXT_BYTE(STATE_IN_NUMBER_FRACTIONAL_PART);
+
         goto InvalidToken;
       }
 
-      case STATE_IN_NUMBER_EXPECT_EXPONENT: {
-        if (ch == '+' || ch == '-') {
-          tokenizer->state = STATE_IN_NUMBER_EXPECT_EXPONENT_DIGITS;
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_NUMBER_FRACTIONAL_PART) {
+        if (is_digit(ch)) NEXT_BYTE(STATE_IN_NUMBER_FRACTIONAL_PART);
 
-        if (isdigit(ch)) {
-          tokenizer->state = STATE_IN_NUMBER_EXPONENT_DIGITS;
-          continue;
+        switch (ch) {
+          case 'e': case 'E': NEXT_BYTE(STATE_IN_NUMBER_EXPECT_EXPONENT);
         }
 
+        goto FinishKeywordOrNumber;
+      }
+
+      HANDLE_STATE(STATE_IN_NUMBER_EXPECT_EXPONENT) {
+        if (ch == '+' || ch == '-') NEXT_BYTE(STATE_IN_NUMBER_EXPECT_EXPONENT_DIGITS);
+
+        if (is_digit(ch)) NEXT_BYTE(STATE_IN_NUMBER_EXPONENT_DIGITS);
+
         goto InvalidToken;
       }
 
-      case STATE_IN_NUMBER_EXPECT_EXPONENT_DIGITS: {
-        if (isdigit(ch)) {
-          tokenizer->state = STATE_IN_NUMBER_EXPONENT_DIGITS;
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_NUMBER_EXPECT_EXPONENT_DIGITS) {
+        if (is_digit(ch)) NEXT_BYTE(STATE_IN_NUMBER_EXPONENT_DIGITS);
 
         goto InvalidToken;
       }
 
-      case STATE_IN_NUMBER_EXPONENT_DIGITS: {
-        if (isdigit(ch)) {
-          tokenizer->state = STATE_IN_NUMBER_EXPONENT_DIGITS;
-          continue;
-        }
+      HANDLE_STATE(STATE_IN_NUMBER_EXPONENT_DIGITS) {
+        if (is_digit(ch)) NEXT_BYTE(STATE_IN_NUMBER_EXPONENT_DIGITS);
+
+        goto FinishKeywordOrNumber;
+      }
+
+      HANDLE_STATE(STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT) goto MaybeDecimalSeparatorOrExponent;
+
+      /* Skipped array or object */
+
+      // Only strings and the nesting of arrays and objects matter (see PJSON_STATUS_SKIP), so the content is consumed
+      // in leaps from one quotation mark, bracket or brace to the next, and strings from one quotation mark or
+      // backslash to the next. The matching closing bracket or brace is emitted as usual.
 
+      HANDLE_STATE(STATE_SKIPPING_VALUE) {
         switch (ch) {
-          case '\x20': case '\t': case '\r': case '\n': goto FinishKeywordOrNumberAndHandleWhitespace;
-          case ':': tmp = PJSON_TOKEN_COLON; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case ',': tmp = PJSON_TOKEN_COMMA; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '[': tmp = PJSON_TOKEN_OPEN_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case ']': tmp = PJSON_TOKEN_CLOSE_BRACKET; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '{': tmp = PJSON_TOKEN_OPEN_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
-          case '}': tmp = PJSON_TOKEN_CLOSE_BRACE; goto FinishKeywordOrNumberAndHandlePunctuator;
+          case '"':
+            NEXT_BYTE(STATE_SKIPPING_VALUE_IN_STRING);
+
+          case '[': case '{':
+            tokenizer->skip_depth++;
+            break;
+
+          case ']': case '}':
+            if (--tokenizer->skip_depth == 0) {
+              tokenizer->token_type = punctuator_token_type(ch);
+              goto EmitPunctuator;
+            }
+            break;
         }
 
-        goto InvalidToken;
+      SkipValueContent:
+        tmp = scan_skipped_value(kernels, p + 1, data_end) - (p + 1);
+        p += tmp, index += tmp;
+        NEXT_BYTE(STATE_SKIPPING_VALUE);
+      }
+
+      HANDLE_STATE(STATE_SKIPPING_VALUE_IN_STRING) {
+        if (ch == '"') NEXT_BYTE(STATE_SKIPPING_VALUE);
+
+        if (ch == '\\') NEXT_BYTE(STATE_SKIPPING_VALUE_IN_STRING_EXPECT_ESCAPE);
+
+        tmp = scan_string_span(kernels, p + 1, data_end) - (p + 1);
+        p += tmp, index += tmp;
+        NEXT_BYTE(STATE_SKIPPING_VALUE_IN_STRING);
       }
 
-      case STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT: goto MaybeDecimalSeparatorOrExponent;
+      HANDLE_STATE(STATE_SKIPPING_VALUE_IN_STRING_EXPECT_ESCAPE) NEXT_BYTE(STATE_SKIPPING_VALUE_IN_STRING);
 
+#if !defined(PJSON_COMPUTED_GOTO)
       default:
-        assert(tokenizer->state < 0);
-        return tokenizer->state;
+        assert(false); // final states are handled before entering the loop
+        return state;
+#endif
     }
 
     /* Common logic */
 
-  FinishKeywordOrNumberAndHandleWhitespace:
+  FinishKeywordOrNumber:
     {
-      tokenizer->unescaped_length = tokenizer->index - tokenizer->token_start_index;
+      // Keywords and numbers are terminated by whitespace or a punctuator.
+      tmp = CHAR_CLASS_LOOKUP[ch];
+      if (tmp & CHAR_CLASS_STRUCTURAL) goto FinishKeywordOrNumberAndHandlePunctuator;
+      if (!(tmp & CHAR_CLASS_WHITESPACE)) goto InvalidToken;
+
+      tokenizer->unescaped_length = (pjson_tokenizer_length)(index - tokenizer->token_start_index);
+      SAVE_STATE();
       status = pjson_finish_token(tokenizer, data, p);
       if (status != PJSON_STATUS_DATA_NEEDED) {
         if (status == PJSON_STATUS_COMPLETED) goto Completed;
         else goto UnexpectedTokenOrOtherError;
       }
 
-      tokenizer->state = STATE_BETWEEN_TOKENS;
-      continue;
+      NEXT_BYTE(STATE_BETWEEN_TOKENS);
     }
 
   FinishKeywordOrNumberAndHandlePunctuator:
     {
-      tokenizer->unescaped_length = tokenizer->index - tokenizer->token_start_index;
+      tokenizer->unescaped_length = (pjson_tokenizer_length)(index - tokenizer->token_start_index);
+      SAVE_STATE();
       status = pjson_finish_token(tokenizer, data, p);
       if (status != PJSON_STATUS_DATA_NEEDED) {
         if (status == PJSON_STATUS_COMPLETED) goto Completed;
         else goto UnexpectedTokenOrOtherError;
       }
-      tokenizer->token_type = (pjson_token_type)tmp;
+      tokenizer->token_type = punctuator_token_type(ch);
 
     EmitPunctuator:
+      SAVE_STATE();
       status = pjson_emit_punctuator(tokenizer, tokenizer->token_type, p);
       if (status != PJSON_STATUS_DATA_NEEDED) {
         if (status == PJSON_STATUS_COMPLETED) {
-          p++, tokenizer->index++;
+          p++, index++;
           goto Completed;
         }
-        tokenizer->token_start_index = tokenizer->index;
+        if (status == PJSON_STATUS_SKIP && pjson_can_skip(tokenizer)) {
+          tokenizer->skip_depth = 1;
+          goto SkipValueContent;
+        }
+        tokenizer->token_start_index = index;
         goto UnexpectedTokenOrOtherError;
       }
 
-      tokenizer->state = STATE_BETWEEN_TOKENS;
-      continue;
+      NEXT_BYTE(STATE_BETWEEN_TOKENS);
     }
 
   Completed:
     {
       tokenizer->token_type = PJSON_TOKEN_NONE;
-      tokenizer->token_start_index = tokenizer->index;
+      tokenizer->token_start_index = index;
       tokenizer->token_start = p; // save the pointer to the start of the potential next JSON value for user
       tokenizer->state = STATE_BETWEEN_TOKENS;
+      tokenizer->index = index;
       return PJSON_STATUS_COMPLETED;
     }
   }
 
   /* Buffer consumed */
 
-  if (tokenizer->state != STATE_BETWEEN_TOKENS) {
-    if (tokenizer->state < 0) {
-      return tokenizer->state;
+#if defined(PJSON_COMPUTED_GOTO)
+BufferConsumed:
+#endif
+  SAVE_STATE();
+
+  if (state != STATE_BETWEEN_TOKENS && state < STATE_SKIPPING_VALUE) {
+    size_t token_length = index - tokenizer->token_start_index;
+    if (token_length > tokenizer->max_token_length) goto LimitExceeded;
+
+    if (tokenizer->string_chunk_handler && tokenizer->token_type == PJSON_TOKEN_STRING
+      && (tokenizer->is_streaming_string || token_length > tokenizer->string_chunk_handler->threshold)) {
+      // String is oversized. Pass on what is received so far instead of saving it.
+      status = pjson_stream_string(tokenizer, data, data_end);
+      if (status != PJSON_STATUS_DATA_NEEDED) goto UnexpectedTokenOrOtherError;
+      return PJSON_STATUS_DATA_NEEDED;
+    }
+
+    if (tokenizer->scatter_strings && tokenizer->token_type == PJSON_TOKEN_STRING) {
+      // String is incomplete. Record the part received so far (the caller guarantees that the chunk stays valid).
+      status = pjson_push_segment(tokenizer, tokenizer->segment_count ? data : tokenizer->token_start, data_end);
+      if (status != PJSON_STATUS_DATA_NEEDED) goto UnexpectedTokenOrOtherError;
+      return PJSON_STATUS_DATA_NEEDED;
     }
 
     // Token may be incomplete. Save what is received so far into the internal buffer.
+    if (pjson_check_token_limits(tokenizer, token_length, true) != PJSON_STATUS_DATA_NEEDED) goto LimitExceeded;
     p = pjson_ensure_token_data(tokenizer, data, data_end);
     if (p == data_end) {
       if (!pjson_push_data_into_internal_buffer(tokenizer, tokenizer->token_start, data_end)) goto OutOfMemory;
@@ -690,7 +1414,7 @@ pjson_parsing_status pjson_feed(pjson_tokenizer *tokenizer, const uint8_t *data,
   }
   else {
     tokenizer->token_type = PJSON_TOKEN_NONE;
-    tokenizer->token_start_index = tokenizer->index;
+    tokenizer->token_start_index = index;
     tokenizer->token_start = NULL;
   }
 
@@ -699,29 +1423,48 @@ pjson_parsing_status pjson_feed(pjson_tokenizer *tokenizer, const uint8_t *data,
   /* Error cases */
 
 Utf8Error:
-  status = pjson_report_error(tokenizer, PJSON_STATUS_UTF8_ERROR, PJSON_TOKEN_ERROR, tokenizer->index);
-  return tokenizer->state = status; // save the status code for cases when pjson_feed is called again
+  tokenizer->index = index;
+  status = pjson_report_error(tokenizer, PJSON_STATUS_UTF8_ERROR, PJSON_TOKEN_ERROR, index);
+  return tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed is called again
 
 UnexpectedCharacter:
-  status = pjson_report_error(tokenizer, PJSON_STATUS_SYNTAX_ERROR, PJSON_TOKEN_ERROR, tokenizer->index);
-  return tokenizer->state = status; // save the status code for cases when pjson_feed is called again
+  tokenizer->index = index;
+  status = pjson_report_error(tokenizer, PJSON_STATUS_SYNTAX_ERROR, PJSON_TOKEN_ERROR, index);
+  return tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed is called again
 
 InvalidToken:
+  tokenizer->index = index;
   status = pjson_report_error(tokenizer, PJSON_STATUS_SYNTAX_ERROR, PJSON_TOKEN_ERROR, tokenizer->token_start_index);
-  return tokenizer->state = status; // save the status code for cases when pjson_feed is called again
+  return tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed is called again
 
 OutOfMemory:
   status = PJSON_STATUS_OUT_OF_MEMORY;
   goto UnexpectedTokenOrOtherError;
 
+LimitExceeded:
+  status = PJSON_STATUS_LIMIT_EXCEEDED;
+  goto UnexpectedTokenOrOtherError;
+
 UnexpectedTokenOrOtherError:
+  tokenizer->index = index;
   status = pjson_report_error(tokenizer, status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status, tokenizer->token_type, tokenizer->token_start_index);
-  return tokenizer->state = status; // save the status code for cases when pjson_feed is called again
+  return tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed is called again
 }
 
-pjson_parsing_status pjson_close(pjson_tokenizer *tokenizer) {
-  assert(tokenizer);
+#if defined(PJSON_COMPUTED_GOTO)
+#pragma GCC diagnostic pop
+#endif
 
+#undef SAVE_STATE
+#undef NEXT_BYTE_IN_CURRENT_STATE
+#undef NEXT_BYTE
+#undef STATE_HANDLER_ADDRESS
+#undef HANDLE_STATE
+
+/**
+ * Completes tokenization like `pjson_close` does, except for releasing the memory owned by the tokenizer.
+ */
+static pjson_parsing_status pjson_complete(pjson_tokenizer *tokenizer) {
   pjson_parsing_status status;
   size_t index;
 
@@ -739,6 +1482,7 @@ pjson_parsing_status pjson_close(pjson_tokenizer *tokenizer) {
 
       if (keyword[index] != 0) goto InvalidToken;
 
+      tokenizer->unescaped_length = (pjson_tokenizer_length)index;
       status = pjson_finish_token(tokenizer, NULL, NULL);
       if (status != PJSON_STATUS_DATA_NEEDED && status != PJSON_STATUS_COMPLETED) goto UnexpectedTokenOrOtherError;
       goto EmitEOS;
@@ -780,30 +1524,40 @@ pjson_parsing_status pjson_close(pjson_tokenizer *tokenizer) {
     case STATE_IN_NUMBER_FRACTIONAL_PART:
     case STATE_IN_NUMBER_EXPONENT_DIGITS:
     case STATE_IN_NUMBER_MAYBE_DECIMAL_SEPARATOR_OR_EXPONENT:
+      tokenizer->unescaped_length = (pjson_tokenizer_length)(tokenizer->index - tokenizer->token_start_index);
       status = pjson_finish_token(tokenizer, NULL, NULL);
       if (status != PJSON_STATUS_DATA_NEEDED && status != PJSON_STATUS_COMPLETED) goto UnexpectedTokenOrOtherError;
       goto EmitEOS;
 
+    case STATE_SKIPPING_VALUE:
+    case STATE_SKIPPING_VALUE_IN_STRING:
+    case STATE_SKIPPING_VALUE_IN_STRING_EXPECT_ESCAPE:
+      // The array or object being skipped is not closed.
+      tokenizer->token_type = PJSON_TOKEN_EOS;
+      tokenizer->token_start_index = tokenizer->index;
+      status = PJSON_STATUS_SYNTAX_ERROR;
+      goto UnexpectedTokenOrOtherError;
+
     default:
       assert(tokenizer->state < 0);
       status = tokenizer->state;
-      goto CleanUp;
+      return status;
   }
 
 Utf8Error:
   status = pjson_report_error(tokenizer, PJSON_STATUS_UTF8_ERROR, PJSON_TOKEN_ERROR, tokenizer->index);
-  tokenizer->state = status; // save the status code for cases when pjson_feed is called again
-  goto CleanUp;
+  tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed is called again
+  return status;
 
 InvalidToken:
   status = pjson_report_error(tokenizer, PJSON_STATUS_SYNTAX_ERROR, PJSON_TOKEN_ERROR, tokenizer->token_start_index);
-  tokenizer->state = status; // save the status code for cases when pjson_feed is called again
-  goto CleanUp;
+  tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed is called again
+  return status;
 
 UnexpectedTokenOrOtherError:
   status = pjson_report_error(tokenizer, status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status, tokenizer->token_type, tokenizer->token_start_index);
-  tokenizer->state = status; // save the status code for cases when pjson_feed/pjson_close is called again
-  goto CleanUp;
+  tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed/pjson_close is called again
+  return status;
 
 EmitEOS:
   tokenizer->token_type = PJSON_TOKEN_EOS;
@@ -814,83 +1568,512 @@ EmitEOS:
   tokenizer->token_start = NULL;
   tokenizer->state = STATE_EOS;
 
-CleanUp:
+  return status;
+}
+
+static void pjson_release_buffers(pjson_tokenizer *tokenizer) {
   if (tokenizer->buf) {
-    if (tokenizer->buf != tokenizer->fixed_size_buf) {
-      pjson_free(tokenizer->buf);
+    if (tokenizer->buf != pjson_fixed_size_buf(tokenizer)) {
+      tokenizer->buf_length = 0;
+      pjson_release_internal_buffer(tokenizer);
     }
     tokenizer->buf = NULL;
     tokenizer->buf_length = 0;
     tokenizer->buf_capacity = 0;
   }
 
+  if (tokenizer->unescape_buf) {
+    pjson_deallocate(tokenizer->allocator, tokenizer->unescape_buf, tokenizer->unescape_buf_capacity);
+    tokenizer->unescape_buf = NULL;
+    tokenizer->unescape_buf_capacity = 0;
+  }
+
+  if (tokenizer->segments) {
+    pjson_deallocate(tokenizer->allocator, tokenizer->segments, tokenizer->segment_capacity * sizeof(pjson_segment));
+    tokenizer->segments = NULL;
+    tokenizer->segment_count = 0;
+    tokenizer->segment_capacity = 0;
+  }
+
+  tokenizer->is_streaming_string = false;
+  tokenizer->string_chunk_pending_length = 0;
+}
+
+pjson_parsing_status pjson_close(pjson_tokenizer *tokenizer) {
+  assert(tokenizer);
+
+  pjson_parsing_status status = pjson_complete(tokenizer);
+  pjson_release_buffers(tokenizer);
   return status;
 }
 
-// UTF8 sequence validation is based on: https://www.json.org/JSON_checker/utf8_decode.c
+void pjson_reset(pjson_tokenizer *tokenizer) {
+  assert(tokenizer);
 
-static bool pjson_feed_string_utf8_intermediate_byte(pjson_tokenizer *tokenizer, uint8_t ch) {
-  uint8_t *p = tokenizer->string_state.utf8_sequence_buf + ((tokenizer->state - STATE_IN_STRING_EXPECT_UTF8_BYTE_2_OF_3) & 1) + 1;
-  *p = ch;
-  tokenizer->state++;
-  return true;
+  tokenizer->index = 0;
+  tokenizer->token_start_index = (size_t)-1;
+  tokenizer->token_start = NULL;
+  tokenizer->token_type = PJSON_TOKEN_NONE;
+  tokenizer->state = STATE_BETWEEN_TOKENS;
+  memset(&tokenizer->string_state, 0, sizeof(tokenizer->string_state));
+  tokenizer->unescaped_length = 0;
+  tokenizer->sink_token_count = 0;
+  tokenizer->segment_count = 0;
+  tokenizer->is_streaming_string = false;
+  tokenizer->string_chunk_pending_length = 0;
+  tokenizer->depth = 0;
+  tokenizer->skip_depth = 0;
+
+  tokenizer->buf_length = 0;
+  if (!tokenizer->buf) { // released by pjson_close
+    tokenizer->buf = pjson_fixed_size_buf(tokenizer);
+    tokenizer->buf_capacity = FIXED_SIZE_BUF_CAPACITY;
+  }
+  else {
+    pjson_trim_internal_buffer(tokenizer);
+  }
+  pjson_trim_unescape_buf(tokenizer);
+  pjson_trim_segments(tokenizer);
 }
 
-static bool pjson_feed_string_utf8_byte_2_of_2(pjson_tokenizer *tokenizer, uint8_t ch) {
-  uint8_t *p = tokenizer->string_state.utf8_sequence_buf;
-  const uint8_t ch0 = *p;
-  const int16_t ch1 = utf8_cont_payload(ch);
+pjson_parsing_status pjson_parse_buffer(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length) {
+  assert(tokenizer);
 
-  if (ch1 >= 0) {
-    const uint32_t r = ((ch0 & 0x1F) << 6) | (uint8_t)ch1;
-    if (r >= 0x80) {
-      tokenizer->unescaped_length += 2;
-      tokenizer->state = STATE_IN_STRING;
-      return true;
-    }
+  pjson_reset(tokenizer);
+
+  pjson_parsing_status status = !tokenizer->sink
+    ? pjson_index(tokenizer, data, length)
+    : pjson_feed_batch(tokenizer, data, length);
+  if (status != PJSON_STATUS_DATA_NEEDED) return status;
+
+  return pjson_complete(tokenizer);
+}
+
+pjson_parsing_status pjson_feed_batch(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length) {
+  assert(tokenizer && tokenizer->sink);
+
+  pjson_parsing_status status = pjson_feed(tokenizer, data, length);
+  if (!tokenizer->sink_token_count) return status;
+
+  // Pending tokens may point into `data`, so they must be delivered before returning.
+  const pjson_token *last_token = &tokenizer->sink->tokens[tokenizer->sink_token_count - 1];
+  pjson_token_type type = last_token->type;
+  size_t start_index = last_token->start_index;
+
+  pjson_parsing_status sink_status = pjson_flush_tokens(tokenizer);
+  if (sink_status == PJSON_STATUS_DATA_NEEDED) return status;
+  if (sink_status == PJSON_STATUS_COMPLETED) return sink_status;
+
+  // The sink rejected tokens which precede the point where pjson_feed stopped, so its status takes precedence.
+  status = pjson_report_error(tokenizer, sink_status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : sink_status, type, start_index);
+  return tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed_batch is called again
+}
+
+/* Structural index */
+
+// pjson_index works in two stages. Stage 1 classifies the input in 64-byte blocks using the selected kernel and turns
+// the resulting bitmaps into a single bitmap per block which marks the punctuators, the unescaped quotation marks and
+// the first bytes of keywords and numbers, that is, where tokens start or end. Backslashes and control characters
+// within strings (and control characters other than whitespace outside of them) are marked as well so that stage 2
+// can tell whether a string can be emitted as is. Stage 2 then visits the marked bytes in order and emits the tokens,
+// handing over anything unusual to pjson_feed. To keep memory usage bounded and the bitmaps in cache, stage 1 indexes
+// a window of blocks at a time, right before stage 2 needs them.
+
+#define STRUCTURAL_INDEX_WINDOW_BLOCKS (64)
+
+struct structural_index {
+  const uint8_t *data;
+  size_t length;
+  const pjson_kernels *kernels;
+  size_t next_block_offset;
+  uint64_t prev_in_string; // all bits set if the previous block ended inside a string
+  uint64_t prev_escaped; // 1 if the previous block ended with an odd-length run of backslashes
+  uint64_t prev_scalar; // 1 if the previous block ended inside a keyword or number
+  size_t window_offset;
+  size_t block_count;
+  uint64_t bitmaps[STRUCTURAL_INDEX_WINDOW_BLOCKS];
+};
+
+/**
+ * The position of stage 2 in the index. Kept apart from structural_index so that it can live in registers.
+ */
+typedef struct {
+  size_t block; // the block of the window being visited
+  uint64_t bits; // the bits of the bitmap of the block being visited which haven't been visited yet
+} structural_index_cursor;
+
+/**
+ * Return a mask which has a bit set for every byte preceded by an odd-length run of backslashes (i.e. escaped).
+ */
+static inline uint64_t structural_index_escaped_bytes(structural_index *si, uint64_t backslash) {
+  const uint64_t even_bits = 0x5555555555555555u, odd_bits = ~even_bits;
+  // Runs starting at an even position end at an odd one if they are of odd length and vice versa. The end of a run
+  // can be located by adding its start to it. A run continued from the previous block is considered to start
+  // at an odd position if the backslashes before it leave the first one unpaired.
+  const uint64_t starts = backslash & ~(backslash << 1);
+  const uint64_t even_start_mask = even_bits ^ si->prev_escaped;
+  const uint64_t even_starts = starts & even_start_mask, odd_starts = starts & ~even_start_mask;
+  const uint64_t even_run_ends = (backslash + even_starts) & ~backslash;
+  uint64_t odd_run_ends = backslash + odd_starts;
+  const uint64_t carry = odd_run_ends < backslash;
+  odd_run_ends = (odd_run_ends | si->prev_escaped) & ~backslash;
+  si->prev_escaped = carry;
+  return (even_run_ends & odd_bits) | (odd_run_ends & even_bits);
+}
+
+/**
+ * Return a mask which has bit `i` set if the number of set bits in the range `[0, i]` of `x` is odd.
+ */
+static inline uint64_t prefix_xor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+/**
+ * Return a pointer to the next block of input to index or `NULL` if the current window or the input is exhausted.
+ */
+static inline const uint8_t *structural_index_next_block(structural_index *si, uint8_t *padded_block) {
+  if (si->block_count >= STRUCTURAL_INDEX_WINDOW_BLOCKS || si->next_block_offset >= si->length) return NULL;
+
+  const uint8_t *block = si->data + si->next_block_offset;
+  const size_t block_length = si->length - si->next_block_offset;
+  if (block_length < 64) {
+    // Pad the last block with whitespace, which isn't marked.
+    memset(padded_block, '\x20', 64);
+    memcpy(padded_block, block, block_length);
+    block = padded_block;
   }
+  return block;
+}
 
-  tokenizer->index--;
-  return false;
+/**
+ * Append the bitmap of the next block of input to the window given the classification of its bytes.
+ */
+static inline void structural_index_add_block(structural_index *si, const block_masks *masks) {
+  // Backslashes are rare outside of a few kinds of strings, so most blocks don't need the escapes to be located.
+  const uint64_t quote = masks->backslash | si->prev_escaped
+    ? masks->quote & ~structural_index_escaped_bytes(si, masks->backslash)
+    : masks->quote;
+  const uint64_t in_string = prefix_xor(quote) ^ si->prev_in_string; // includes opening, excludes closing quotes
+  si->prev_in_string = 0 - (in_string >> 63);
+  const uint64_t scalar = ~(masks->quote | masks->punctuator | masks->whitespace | masks->control | in_string);
+  const uint64_t scalar_start = scalar & ~(scalar << 1 | si->prev_scalar);
+  si->prev_scalar = scalar >> 63;
+
+  si->bitmaps[si->block_count++] = (masks->punctuator & ~in_string) | quote | scalar_start
+    | ((masks->backslash | masks->control) & in_string) | (masks->control & ~masks->whitespace);
+  si->next_block_offset += 64;
 }
 
-static bool pjson_feed_string_utf8_byte_3_of_3(pjson_tokenizer *tokenizer, uint8_t ch) {
-  uint8_t *p = tokenizer->string_state.utf8_sequence_buf;
-  const uint8_t ch0 = *p;
-  const int16_t ch1 = utf8_cont_payload(*(++p));
-  const int16_t ch2 = utf8_cont_payload(ch);
+static void structural_index_fill(structural_index *si) {
+  si->window_offset = si->next_block_offset;
+  si->block_count = 0;
+  si->kernels->index_blocks(si);
+}
 
-  if ((ch1 | ch2) >= 0) {
-    const uint32_t r = ((ch0 & 0x0F) << 12) | ((uint8_t)ch1 << 6) | (uint8_t)ch2;
-    if (r >= 0x800 && (r < 0xD800 || r > 0xDFFF)) {
-      tokenizer->unescaped_length += 3;
-      tokenizer->state = STATE_IN_STRING;
-      return true;
+/**
+ * Return the offset of the next marked byte or `(size_t)-1` if the end of input is reached.
+ */
+static inline size_t structural_index_next(structural_index *si, structural_index_cursor *cursor) {
+  while (!cursor->bits) {
+    if (++cursor->block >= si->block_count) {
+      if (si->next_block_offset >= si->length) return (size_t)-1;
+      structural_index_fill(si);
+      cursor->block = 0;
     }
+    cursor->bits = si->bitmaps[cursor->block];
   }
 
-  tokenizer->index -= 2;
-  return false;
+  const size_t offset = si->window_offset + cursor->block * 64 + bit_scan_forward64(cursor->bits);
+  cursor->bits &= cursor->bits - 1;
+  return offset;
 }
 
-static bool pjson_feed_string_utf8_byte_4_of_4(pjson_tokenizer *tokenizer, uint8_t ch) {
-  uint8_t *p = tokenizer->string_state.utf8_sequence_buf;
-  const uint8_t ch0 = *p;
-  const int16_t ch1 = utf8_cont_payload(*(++p));
-  const int16_t ch2 = utf8_cont_payload(*(++p));
-  const int16_t ch3 = utf8_cont_payload(ch);
+/**
+ * Return a pointer to the delimiter following the number which starts at `p` or `NULL` if there is no valid number
+ * followed by whitespace or a punctuator in the range `[p, end)`.
+ */
+static const uint8_t *index_scan_number(const uint8_t *p, const uint8_t *end) {
+  if (*p == '-' && ++p == end) return NULL;
 
-  if ((ch1 | ch2 | ch3) >= 0) {
-    const uint32_t r = ((ch0 & 0x07) << 18) | ((uint8_t)ch1 << 12) | ((uint8_t)ch2 << 6) | (uint8_t)ch3;
-    if (r >= 0x10000 && r <= 0x10FFFF) {
-      tokenizer->unescaped_length += 4;
-      tokenizer->state = STATE_IN_STRING;
-      return true;
+  if (*p == '0') p++;
+  else if (is_digit(*p)) {
+    do p++; while (p < end && is_digit(*p));
+  }
+  else return NULL;
+
+  if (p < end && *p == '.') {
+    if (++p == end || !is_digit(*p)) return NULL;
+    do p++; while (p < end && is_digit(*p));
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    if (++p < end && (*p == '+' || *p == '-')) p++;
+    if (p == end || !is_digit(*p)) return NULL;
+    do p++; while (p < end && is_digit(*p));
+  }
+
+  return p < end && (CHAR_CLASS_LOOKUP[*p] & (CHAR_CLASS_WHITESPACE | CHAR_CLASS_STRUCTURAL)) ? p : NULL;
+}
+
+/**
+ * Return a pointer to the delimiter following the keyword of type `type` which starts at `p` or `NULL` if there is
+ * no such keyword followed by whitespace or a punctuator in the range `[p, end)`.
+ */
+static const uint8_t *index_scan_keyword(const uint8_t *p, const uint8_t *end, pjson_token_type type) {
+  const char *const keyword = KEYWORD_LOOKUP[type - PJSON_TOKEN_NULL];
+  const size_t keyword_length = type == PJSON_TOKEN_FALSE ? 5 : 4;
+
+  if ((size_t)(end - p) <= keyword_length || memcmp(p, keyword, keyword_length)) return NULL;
+
+  p += keyword_length;
+  return CHAR_CLASS_LOOKUP[*p] & (CHAR_CLASS_WHITESPACE | CHAR_CLASS_STRUCTURAL) ? p : NULL;
+}
+
+pjson_parsing_status pjson_index(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length) {
+  assert(tokenizer);
+  assert(data || length == 0);
+
+  pjson_parsing_status status;
+  pjson_token token;
+  size_t offset, index;
+
+  const uint8_t *p, *q, *const data_end = data + length;
+  assert((uintptr_t)data <= (uintptr_t)data_end); // check for unsigned overflow
+
+  pjson_parser_base *const parser = tokenizer->parser;
+  const pjson_kernels *const kernels = tokenizer->kernels;
+  const size_t base_index = tokenizer->index;
+
+  if (tokenizer->sink) return pjson_feed_batch(tokenizer, data, length);
+
+  // Tokens continued from a previous call and invalid UTF-8 (which needs to be reported at the exact position)
+  // are left to pjson_feed.
+  if (tokenizer->state != STATE_BETWEEN_TOKENS || !kernels->utf8_validate(data, data_end)) {
+    return pjson_feed(tokenizer, data, length);
+  }
+
+  structural_index si;
+  si.data = data;
+  si.length = length;
+  si.kernels = kernels;
+  si.next_block_offset = 0;
+  si.prev_in_string = si.prev_escaped = si.prev_scalar = 0;
+  si.window_offset = si.block_count = 0;
+
+  structural_index_cursor cursor = { 0, 0 };
+
+  // The tokens emitted here lie within `data`, so none of them has segments.
+  token.segments = NULL;
+  token.segment_count = 0;
+
+  // Tokens are passed to the parser directly as the members of the tokenizer which pjson_feed maintains for
+  // the current token are only observable when returning.
+  while ((offset = structural_index_next(&si, &cursor)) != (size_t)-1) {
+    p = data + offset;
+    index = base_index + offset;
+    switch (*p) {
+      case '"':
+      EmitString:
+        // The string is closed by the next marked quotation mark. Anything marked in between is a backslash or
+        // a control character, so the string needs unescaping or is invalid: let pjson_feed process it.
+        offset = structural_index_next(&si, &cursor);
+        if (offset == (size_t)-1) goto Fallback;
+
+        q = data + offset;
+        if (*q != '"') {
+          while (*q != '"') {
+            offset = structural_index_next(&si, &cursor);
+            if (offset == (size_t)-1) goto Fallback;
+            q = data + offset;
+          }
+
+          tokenizer->index = index;
+          status = pjson_feed(tokenizer, p, q + 1 - p);
+          if (status != PJSON_STATUS_DATA_NEEDED) return status;
+          continue;
+        }
+
+        token.type = PJSON_TOKEN_STRING;
+        token.start_index = index;
+        token.start = p;
+        token.length = q + 1 - p;
+        if (token.length > tokenizer->max_token_length) goto LimitExceeded;
+        token.unescaped_length = token.length - 2;
+        token.unescaped = tokenizer->unescape_strings ? p + 1 : NULL;
+        index += q + 1 - p, p = q + 1;
+        status = parser->eat(parser, &token);
+        if (status != PJSON_STATUS_DATA_NEEDED) {
+          tokenizer->token_type = token.type;
+          tokenizer->token_start_index = token.start_index;
+          if (status == PJSON_STATUS_COMPLETED) goto Completed;
+          else goto UnexpectedTokenOrOtherError;
+        }
+        goto MaybeEmitSeparator;
+
+      case ':':
+        token.type = PJSON_TOKEN_COLON;
+        goto EmitPunctuator;
+
+      case ',':
+        token.type = PJSON_TOKEN_COMMA;
+        goto EmitPunctuator;
+
+      case '[':
+        token.type = PJSON_TOKEN_OPEN_BRACKET;
+        goto EmitPunctuator;
+
+      case ']':
+        token.type = PJSON_TOKEN_CLOSE_BRACKET;
+        goto EmitPunctuator;
+
+      case '{':
+        token.type = PJSON_TOKEN_OPEN_BRACE;
+        goto EmitPunctuator;
+
+      case '}':
+        token.type = PJSON_TOKEN_CLOSE_BRACE;
+
+      EmitPunctuator:
+        token.start_index = index;
+        token.start = p;
+        token.length = token.unescaped_length = 1;
+        token.unescaped = NULL;
+        status = pjson_track_depth(tokenizer, token.type);
+        if (status == PJSON_STATUS_DATA_NEEDED) status = parser->eat(parser, &token);
+        if (status != PJSON_STATUS_DATA_NEEDED) {
+          tokenizer->token_type = token.type;
+          tokenizer->token_start_index = token.start_index;
+          if (status == PJSON_STATUS_COMPLETED) {
+            p++, index++;
+            goto Completed;
+          }
+          else if (status == PJSON_STATUS_SKIP && pjson_can_skip(tokenizer)) goto SkipValueContent;
+          else goto UnexpectedTokenOrOtherError;
+        }
+
+        // Unless the input is formatted, property names follow right after most punctuators, and closing brackets
+        // and braces are followed by separators, so these are emitted without going back to the switch as well.
+        p++, index++;
+        if (p < data_end && *p == '"') {
+          structural_index_next(&si, &cursor);
+          goto EmitString;
+        }
+        if (token.type == PJSON_TOKEN_CLOSE_BRACKET || token.type == PJSON_TOKEN_CLOSE_BRACE) goto MaybeEmitSeparator;
+        continue;
+
+      case '-': case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':  case '8':  case '9':
+        token.type = PJSON_TOKEN_NUMBER;
+        q = index_scan_number(p, data_end);
+        break;
+
+      case 'f':
+        token.type = PJSON_TOKEN_FALSE;
+        q = index_scan_keyword(p, data_end, token.type);
+        break;
+
+      case 't':
+        token.type = PJSON_TOKEN_TRUE;
+        q = index_scan_keyword(p, data_end, token.type);
+        break;
+
+      case 'n':
+        token.type = PJSON_TOKEN_NULL;
+        q = index_scan_keyword(p, data_end, token.type);
+        break;
+
+      default:
+        q = NULL;
+        break;
+    }
+
+    // Keywords and numbers which are invalid or may be continued in a subsequent call are left to pjson_feed.
+    if (!q) goto Fallback;
+
+    token.start_index = index;
+    token.start = p;
+    token.length = token.unescaped_length = q - p;
+    if (token.length > tokenizer->max_token_length) goto LimitExceeded;
+    token.unescaped = NULL;
+    index += q - p, p = q;
+    status = parser->eat(parser, &token);
+    if (status != PJSON_STATUS_DATA_NEEDED) {
+      tokenizer->token_type = token.type;
+      tokenizer->token_start_index = token.start_index;
+      if (status == PJSON_STATUS_COMPLETED) goto Completed;
+      else goto UnexpectedTokenOrOtherError;
+    }
+
+  MaybeEmitSeparator:
+    // Unless the input is formatted, values and property names are followed right away by a comma or a colon.
+    // Emitting these here, rather than through the switch above, spares every other token its hard to predict
+    // jump. The bytes checked are marked, so they are the next mark to visit.
+    if (p < data_end && (*p == ',' || *p == ':')) {
+      structural_index_next(&si, &cursor);
+      token.type = *p == ',' ? PJSON_TOKEN_COMMA : PJSON_TOKEN_COLON;
+      goto EmitPunctuator;
     }
   }
 
-  tokenizer->index -= 3;
-  return false;
+  tokenizer->index = base_index + length;
+  tokenizer->token_type = PJSON_TOKEN_NONE;
+  tokenizer->token_start_index = tokenizer->index;
+  tokenizer->token_start = NULL;
+  return PJSON_STATUS_DATA_NEEDED;
+
+SkipValueContent:
+  {
+    // Brackets and braces are marked outside of strings only, so it's enough to count them to find the matching
+    // closing one. Quotation marks are only tracked for handing over an unterminated string to pjson_feed.
+    size_t skip_depth = 1;
+    const uint8_t *string_start = NULL;
+    do {
+      if ((offset = structural_index_next(&si, &cursor)) == (size_t)-1) {
+        p = string_start ? string_start : data_end;
+        index = base_index + (p - data);
+        tokenizer->state = STATE_SKIPPING_VALUE;
+        tokenizer->skip_depth = (pjson_tokenizer_length)skip_depth;
+        goto Fallback;
+      }
+
+      p = data + offset;
+      switch (*p) {
+        case '"': string_start = string_start ? NULL : p; break;
+        case '[': case '{': skip_depth++; break;
+        case ']': case '}': skip_depth--; break;
+      }
+    } while (skip_depth);
+
+    index = base_index + offset;
+    token.type = punctuator_token_type(*p);
+    goto EmitPunctuator;
+  }
+
+Fallback:
+  tokenizer->index = index;
+  return pjson_feed(tokenizer, p, data_end - p);
+
+Completed:
+  tokenizer->token_type = PJSON_TOKEN_NONE;
+  tokenizer->token_start_index = index;
+  tokenizer->token_start = p; // save the pointer to the start of the potential next JSON value for user
+  tokenizer->index = index;
+  return PJSON_STATUS_COMPLETED;
+
+LimitExceeded:
+  status = PJSON_STATUS_LIMIT_EXCEEDED;
+  tokenizer->token_type = token.type;
+  tokenizer->token_start_index = token.start_index;
+
+UnexpectedTokenOrOtherError:
+  tokenizer->index = index;
+  status = pjson_report_error(tokenizer, status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status, tokenizer->token_type, tokenizer->token_start_index);
+  return tokenizer->state = (pjson_tokenizer_state)status; // save the status code for cases when pjson_feed is called again
 }
 
 /* Parser */
@@ -903,8 +2086,122 @@ static pjson_parsing_status pjson_eat_object_property_name(pjson_parser *parser,
 static pjson_parsing_status pjson_eat_object_property_name_and_value_separator(pjson_parser *parser, const pjson_token *token);
 static pjson_parsing_status pjson_eat_object_property_value(pjson_parser *parser, const pjson_token *token);
 static pjson_parsing_status pjson_eat_object_property_separator_or_end(pjson_parser *parser, const pjson_token *token);
+static pjson_parsing_status pjson_eat_skipped_array_end(pjson_parser *parser, const pjson_token *token);
+static pjson_parsing_status pjson_eat_skipped_object_end(pjson_parser *parser, const pjson_token *token);
 static pjson_parsing_status pjson_eat_eos(pjson_parser *parser, const pjson_token *token);
 
+// The built-in context stack stores the contexts in the caller-provided initial array first, then in a list of blocks
+// of growing size. A context is placed in the next block if it doesn't fit into the rest of the current one, so every
+// block is filled before moving on. Blocks are kept when the stack shrinks, so a parser allocates only while the input
+// gets deeper than anything seen before. Contexts are linked to their parents, which makes popping trivial.
+
+struct pjson_parser_stack_block {
+  pjson_parser_stack_block *prev;
+  pjson_parser_stack_block *next;
+  size_t capacity; // number of contexts the block can hold
+};
+
+#define PARSER_STACK_BLOCK_HEADER_SIZE ((sizeof(pjson_parser_stack_block) + 15) & ~(size_t)15) // keep contexts aligned
+#define PARSER_STACK_BLOCK_MIN_CAPACITY (16)
+
+static inline uint8_t *pjson_parser_stack_block_data(pjson_parser_stack_block *block) {
+  return (uint8_t *)block + PARSER_STACK_BLOCK_HEADER_SIZE;
+}
+
+static pjson_parsing_status pjson_parser_stack_push(pjson_parser *parser) {
+  if (parser->depth > parser->max_depth) return PJSON_STATUS_MAX_DEPTH_EXCEEDED; // the top-level context doesn't count
+
+  const size_t context_size = parser->context_size;
+  uint8_t *next = parser->depth ? (uint8_t *)parser->context + context_size : parser->initial_contexts;
+
+  if ((size_t)(parser->stack_end - next) < context_size) {
+    pjson_parser_stack_block *block = parser->stack_block ? parser->stack_block->next : parser->stack_blocks;
+    if (!block) {
+      size_t capacity = parser->stack_block
+        ? parser->stack_block->capacity * 2
+        : max((size_t)PARSER_STACK_BLOCK_MIN_CAPACITY, parser->initial_capacity);
+      if (capacity > ((size_t)-1 - PARSER_STACK_BLOCK_HEADER_SIZE) / context_size) return PJSON_STATUS_OUT_OF_MEMORY;
+
+      block = pjson_allocate(parser->allocator, PARSER_STACK_BLOCK_HEADER_SIZE + capacity * context_size);
+      if (!block) return PJSON_STATUS_OUT_OF_MEMORY;
+      block->prev = parser->stack_block;
+      block->next = NULL;
+      block->capacity = capacity;
+      if (parser->stack_block) parser->stack_block->next = block;
+      else parser->stack_blocks = block;
+    }
+
+    parser->stack_block = block;
+    next = pjson_parser_stack_block_data(block);
+    parser->stack_end = next + block->capacity * context_size;
+  }
+
+  pjson_parser_context *context = (pjson_parser_context *)next;
+  memset(context, 0, context_size);
+  context->parent = parser->context;
+  parser->context = context;
+  parser->depth++;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static void pjson_parser_stack_pop(pjson_parser *parser) {
+  assert(parser->depth > 0);
+
+  pjson_parser_stack_block *block = parser->stack_block;
+  if (block && (uint8_t *)parser->context == pjson_parser_stack_block_data(block)) {
+    parser->stack_block = block = block->prev;
+    parser->stack_end = block
+      ? pjson_parser_stack_block_data(block) + block->capacity * parser->context_size
+      : parser->initial_contexts + parser->initial_capacity * parser->context_size;
+  }
+
+  parser->context = parser->context->parent;
+  parser->depth--;
+}
+
+static void pjson_parser_stack_clear(pjson_parser *parser) {
+  parser->context = NULL;
+  parser->depth = 0;
+  parser->stack_block = NULL;
+  parser->stack_end = parser->initial_contexts + parser->initial_capacity * parser->context_size;
+}
+
+// The following functions operate on either the built-in or the user-provided context stack. In the latter case,
+// the current context is looked up after each push and pop, so that accessing it costs no call in the common case.
+
+static inline pjson_parsing_status pjson_parser_push(pjson_parser *parser) {
+  if (!parser->push_context) return pjson_parser_stack_push(parser);
+
+  pjson_parsing_status status = parser->push_context(parser);
+  if (status != PJSON_STATUS_SUCCESS) return status;
+
+  pjson_parser_context *context = parser->peek_context(parser, false);
+  assert(context);
+  memset(context, 0, sizeof(*context));
+  parser->context = context;
+  parser->depth++;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static inline void pjson_parser_pop(pjson_parser *parser) {
+  if (!parser->push_context) {
+    pjson_parser_stack_pop(parser);
+    return;
+  }
+
+  parser->pop_context(parser);
+  parser->depth--;
+  parser->context = parser->depth ? parser->peek_context(parser, false) : NULL;
+}
+
+/**
+ * Returns the context enclosing the current one. (User-provided stacks may move contexts when pushing, so the parent
+ * pointer is only maintained for the built-in stack.)
+ */
+static inline pjson_parser_context *pjson_parser_parent_context(pjson_parser *parser) {
+  return !parser->push_context ? parser->context->parent : parser->peek_context(parser, true);
+}
+
 static inline pjson_parsing_status pjson_eat_value(pjson_parser *parser, const pjson_token *token,
   pjson_parser_eat primitive_value_next_eat,
   pjson_parser_eat complex_value_next_eat,
@@ -921,10 +2218,11 @@ static inline pjson_parsing_status pjson_eat_value(pjson_parser *parser, const p
     case PJSON_TOKEN_TRUE:
     case PJSON_TOKEN_NUMBER:
     case PJSON_TOKEN_STRING: {
-      context = (pjson_parser_context *)parser->peek_context(parser, false);
+      context = parser->context;
       assert(context);
       if (context->on_value
-        && (status = context->on_value(parser, context, token)) != PJSON_STATUS_SUCCESS) {
+        && (status = context->on_value(parser, context, token)) != PJSON_STATUS_SUCCESS
+        && status != PJSON_STATUS_SKIP) { // there is nothing to skip in a primitive value
         goto Error;
       }
 
@@ -947,213 +2245,3026 @@ static inline pjson_parsing_status pjson_eat_value(pjson_parser *parser, const p
       return PJSON_STATUS_SYNTAX_ERROR;
   }
 
-BeginComplexValue:
-  status = parser->push_context(parser);
-  if (status != PJSON_STATUS_SUCCESS) goto Error;
+BeginComplexValue:
+  status = pjson_parser_push(parser);
+  if (status != PJSON_STATUS_SUCCESS) goto Error;
+
+  context = pjson_parser_parent_context(parser);
+  assert(context);
+  context->next_eat = complex_value_next_eat;
+
+  if (context->on_value
+    && (status = context->on_value(parser, context, token)) != PJSON_STATUS_SUCCESS) {
+    if (status != PJSON_STATUS_SKIP) goto Error;
+
+    if (!parser->validate_skipped_values) {
+      // Let the tokenizer skip the content, the next token is the closing one.
+      parser->base.eat = token->type == PJSON_TOKEN_OPEN_BRACKET
+        ? (pjson_parser_eat)&pjson_eat_skipped_array_end
+        : (pjson_parser_eat)&pjson_eat_skipped_object_end;
+      return PJSON_STATUS_SKIP;
+    }
+
+    // Parse the content without calling back (nested contexts are pushed with no callbacks).
+    parser->context->on_value = parser->context->on_object_property_name = NULL;
+  }
+
+  parser->base.eat = parser_next_eat;
+  return PJSON_STATUS_DATA_NEEDED;
+
+Error:
+  return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status;
+}
+
+static inline pjson_parsing_status pjson_end_complex_value(pjson_parser *parser, const pjson_token *token) {
+  pjson_parser_context *context = pjson_parser_parent_context(parser);
+  assert(context);
+
+  pjson_parsing_status status;
+  if (context->on_value
+    && (status = context->on_value(parser, context, token)) != PJSON_STATUS_SUCCESS
+    && status != PJSON_STATUS_SKIP) { // there is nothing to skip at the end of an array or object
+    return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status;
+  }
+
+  pjson_parser_eat next_eat = context->next_eat;
+  context->next_eat = NULL;
+
+  pjson_parser_pop(parser);
+
+  if (next_eat) {
+    parser->base.eat = next_eat;
+    return PJSON_STATUS_DATA_NEEDED;
+  }
+  else {
+    parser->base.eat = (pjson_parser_eat)&pjson_eat_eos;
+    return PJSON_STATUS_COMPLETED;
+  }
+}
+
+static pjson_parsing_status pjson_eat_toplevel_value_greedy(pjson_parser *parser, const pjson_token *token) {
+  return pjson_eat_value(parser, token,
+    (pjson_parser_eat)&pjson_eat_eos,
+    (pjson_parser_eat)&pjson_eat_eos,
+    PJSON_STATUS_DATA_NEEDED,
+    PJSON_STATUS_NO_TOKENS_FOUND);
+}
+
+static pjson_parsing_status pjson_eat_toplevel_value_lazy(pjson_parser *parser, const pjson_token *token) {
+  return pjson_eat_value(parser, token,
+    (pjson_parser_eat)&pjson_eat_eos,
+    NULL, // used to indicate lazy parsing to `pjson_end_complex_value`
+    PJSON_STATUS_COMPLETED,
+    PJSON_STATUS_NO_TOKENS_FOUND);
+}
+
+static pjson_parsing_status pjson_eat_array_element_or_end(pjson_parser *parser, const pjson_token *token) {
+  return token->type != PJSON_TOKEN_CLOSE_BRACKET
+    ? pjson_eat_array_element(parser, token)
+    : pjson_end_complex_value(parser, token);
+}
+
+static pjson_parsing_status pjson_eat_array_element(pjson_parser *parser, const pjson_token *token) {
+  return pjson_eat_value(parser, token,
+    (pjson_parser_eat)&pjson_eat_array_element_separator_or_end,
+    (pjson_parser_eat)&pjson_eat_array_element_separator_or_end,
+    PJSON_STATUS_DATA_NEEDED,
+    PJSON_STATUS_SYNTAX_ERROR);
+}
+
+static pjson_parsing_status pjson_eat_array_element_separator_or_end(pjson_parser *parser, const pjson_token *token) {
+  switch (token->type) {
+    case PJSON_TOKEN_COMMA: {
+      parser->base.eat = (pjson_parser_eat)&pjson_eat_array_element;
+      return PJSON_STATUS_DATA_NEEDED;
+    }
+
+    case PJSON_TOKEN_CLOSE_BRACKET:
+      return pjson_end_complex_value(parser, token);
+
+    default:
+      return PJSON_STATUS_SYNTAX_ERROR;
+  }
+}
+
+static pjson_parsing_status pjson_eat_object_property_name_or_end(pjson_parser *parser, const pjson_token *token) {
+  return token->type != PJSON_TOKEN_CLOSE_BRACE
+    ? pjson_eat_object_property_name(parser, token)
+    : pjson_end_complex_value(parser, token);
+}
+
+static pjson_parsing_status pjson_eat_object_property_name(pjson_parser *parser, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_STRING) {
+    pjson_parser_context *current_context = parser->context;
+    assert(current_context);
+
+    pjson_parsing_status status;
+    if (current_context->on_object_property_name
+      && (status = current_context->on_object_property_name(parser, current_context, token)) != PJSON_STATUS_SUCCESS) {
+      return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status;
+    }
+
+    parser->base.eat = (pjson_parser_eat)&pjson_eat_object_property_name_and_value_separator;
+    return PJSON_STATUS_DATA_NEEDED;
+  }
+
+  return PJSON_STATUS_SYNTAX_ERROR;
+}
+
+static pjson_parsing_status pjson_eat_object_property_name_and_value_separator(pjson_parser *parser, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_COLON) {
+    parser->base.eat = (pjson_parser_eat)&pjson_eat_object_property_value;
+    return PJSON_STATUS_DATA_NEEDED;
+  }
+
+  return PJSON_STATUS_SYNTAX_ERROR;
+}
+
+static pjson_parsing_status pjson_eat_object_property_value(pjson_parser *parser, const pjson_token *token) {
+  return pjson_eat_value(parser, token,
+    (pjson_parser_eat)&pjson_eat_object_property_separator_or_end,
+    (pjson_parser_eat)&pjson_eat_object_property_separator_or_end,
+    PJSON_STATUS_DATA_NEEDED,
+    PJSON_STATUS_SYNTAX_ERROR);
+}
+
+static pjson_parsing_status pjson_eat_object_property_separator_or_end(pjson_parser *parser, const pjson_token *token) {
+  switch (token->type) {
+    case PJSON_TOKEN_COMMA: {
+      parser->base.eat = (pjson_parser_eat)&pjson_eat_object_property_name;
+      return PJSON_STATUS_DATA_NEEDED;
+    }
+
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return pjson_end_complex_value(parser, token);
+
+    default:
+      return PJSON_STATUS_SYNTAX_ERROR;
+  }
+}
+
+static pjson_parsing_status pjson_eat_skipped_array_end(pjson_parser *parser, const pjson_token *token) {
+  return token->type == PJSON_TOKEN_CLOSE_BRACKET
+    ? pjson_end_complex_value(parser, token)
+    : PJSON_STATUS_SYNTAX_ERROR;
+}
+
+static pjson_parsing_status pjson_eat_skipped_object_end(pjson_parser *parser, const pjson_token *token) {
+  return token->type == PJSON_TOKEN_CLOSE_BRACE
+    ? pjson_end_complex_value(parser, token)
+    : PJSON_STATUS_SYNTAX_ERROR;
+}
+
+static pjson_parsing_status pjson_eat_eos(pjson_parser *parser, const pjson_token *token) {
+  (void)parser;
+  return token->type == PJSON_TOKEN_EOS ? PJSON_STATUS_COMPLETED : PJSON_STATUS_SYNTAX_ERROR;
+}
+
+static pjson_parsing_status pjson_eat_out_of_memory(pjson_parser *parser, const pjson_token *token) {
+  (void)parser;
+  (void)token;
+  return PJSON_STATUS_OUT_OF_MEMORY;
+}
+
+void pjson_parser_init(pjson_parser *parser, bool is_lazy,
+  pjson_parser_push_context push_context,
+  pjson_parser_peek_context peek_context,
+  pjson_parser_pop_context pop_context
+) {
+  assert(parser);
+  assert(push_context);
+  assert(peek_context);
+  assert(pop_context);
+
+  memset(parser, 0, sizeof(*parser));
+
+  parser->push_context = push_context;
+  parser->peek_context = peek_context;
+  parser->pop_context = pop_context;
+
+  pjson_parser_reset(parser, is_lazy);
+}
+
+void pjson_parser_init_ex(pjson_parser *parser, bool is_lazy, const pjson_parser_options *options) {
+  assert(parser);
+
+  memset(parser, 0, sizeof(*parser));
+
+  parser->context_size = sizeof(pjson_parser_context);
+  parser->max_depth = (size_t)-1;
+  parser->allocator = &pjson_default_allocator;
+
+  if (options) {
+    assert(!options->context_size || options->context_size >= sizeof(pjson_parser_context));
+    assert(options->initial_contexts || options->initial_capacity == 0);
+    if (options->context_size) parser->context_size = options->context_size;
+    if (options->initial_contexts) {
+      parser->initial_contexts = (uint8_t *)options->initial_contexts;
+      parser->initial_capacity = options->initial_capacity;
+    }
+    if (options->max_depth) parser->max_depth = options->max_depth;
+    parser->validate_skipped_values = options->validate_skipped_values;
+    if (options->allocator) {
+      assert(options->allocator->allocate && options->allocator->reallocate && options->allocator->deallocate);
+      parser->allocator = options->allocator;
+    }
+  }
+
+  if (!parser->initial_contexts) {
+    // Larger contexts may not fit, in which case even the top-level one is allocated.
+    parser->initial_contexts = (uint8_t *)parser->inline_contexts;
+    parser->initial_capacity = sizeof(parser->inline_contexts) / parser->context_size;
+  }
+
+  pjson_parser_reset(parser, is_lazy);
+}
+
+void pjson_parser_free(pjson_parser *parser) {
+  assert(parser);
+
+  pjson_parser_stack_block *block = parser->stack_blocks;
+  while (block) {
+    pjson_parser_stack_block *next = block->next;
+    pjson_deallocate(parser->allocator, block, PARSER_STACK_BLOCK_HEADER_SIZE + block->capacity * parser->context_size);
+    block = next;
+  }
+  parser->stack_blocks = NULL;
+
+  if (!parser->push_context) pjson_parser_stack_clear(parser);
+}
+
+void pjson_parser_reset(pjson_parser *parser, bool is_lazy) {
+  assert(parser);
+
+  if (!parser->push_context) pjson_parser_stack_clear(parser);
+  else parser->depth = 0;
+
+  if (pjson_parser_push(parser) != PJSON_STATUS_SUCCESS) {
+    // Only possible if the built-in stack couldn't allocate storage for the top-level context.
+    parser->base.eat = (pjson_parser_eat)&pjson_eat_out_of_memory;
+    return;
+  }
+
+  parser->base.eat = (pjson_parser_eat)(!is_lazy
+    ? &pjson_eat_toplevel_value_greedy
+    : &pjson_eat_toplevel_value_lazy);
+}
+
+void pjson_parser_rewind(pjson_parser *parser, bool is_lazy) {
+  assert(parser && parser->depth > 0);
+
+  // Drop the contexts of the arrays and objects left open by the previous input (if any).
+  while (parser->depth > 1) {
+    pjson_parser_pop(parser);
+  }
+
+  pjson_parser_context *context = parser->context;
+  assert(context);
+  context->next_eat = NULL;
+
+  parser->base.eat = (pjson_parser_eat)(!is_lazy
+    ? &pjson_eat_toplevel_value_greedy
+    : &pjson_eat_toplevel_value_lazy);
+}
+
+/* Tape */
+
+// The tape checks the grammar (like pjson_parser does) so that it always describes a well-formed document.
+// While a container is open, the match_index of its entry links to the entry of the enclosing container, which makes
+// up the stack of open containers without extra storage.
+
+#define TAPE_STATE_EXPECT_VALUE (0)
+#define TAPE_STATE_EXPECT_VALUE_OR_END (1) // states accepting a value must have the lowest values
+#define TAPE_STATE_EXPECT_NAME (2)
+#define TAPE_STATE_EXPECT_NAME_OR_END (3)
+#define TAPE_STATE_EXPECT_COLON (4)
+#define TAPE_STATE_EXPECT_SEPARATOR_OR_END (5)
+#define TAPE_STATE_EXPECT_EOS (6)
+
+static pjson_tape_entry *pjson_tape_push_entry(pjson_tape *tape, const pjson_token *token) {
+  if (tape->entry_count == tape->entry_capacity) {
+    pjson_tape_entry *entries;
+    size_t new_capacity = max((size_t)64, tape->entry_capacity + (tape->entry_capacity >> 1));
+    if (new_capacity > (size_t)-1 / sizeof(*entries)) return NULL;
+
+    if (tape->entries == tape->initial_entries) {
+      entries = pjson_allocate(tape->allocator, new_capacity * sizeof(*entries));
+      if (!entries) return NULL;
+      if (tape->entry_count) memcpy(entries, tape->entries, tape->entry_count * sizeof(*entries));
+    }
+    else {
+      entries = pjson_reallocate(tape->allocator, tape->entries, tape->entry_capacity * sizeof(*entries), new_capacity * sizeof(*entries));
+      if (!entries) return NULL;
+    }
+    tape->entries = entries;
+    tape->entry_capacity = new_capacity;
+  }
+
+  pjson_tape_entry *entry = &tape->entries[tape->entry_count++];
+  entry->type = token->type;
+  entry->start_index = token->start_index;
+  entry->length = token->length;
+  entry->unescaped_length = token->unescaped_length;
+  entry->match_index = PJSON_TAPE_NO_INDEX;
+  entry->string_offset = is_streamed_string(token) ? PJSON_TAPE_STREAMED : PJSON_TAPE_NO_INDEX;
+
+  // Tokens straddling input chunks are assembled in the internal buffer of the tokenizer, which is reused afterwards,
+  // or referenced as segments of the chunks, which are not necessarily parts of a single input buffer.
+  if ((token->start && token->start == tape->tokenizer->buf) || token->segments) {
+    size_t new_length = tape->strings_length + token->length;
+    if (new_length < tape->strings_length) return NULL; // handle unsigned overflow
+
+    if (new_length > tape->strings_capacity) {
+      size_t new_capacity = max(new_length, tape->strings_capacity + (tape->strings_capacity >> 1));
+      uint8_t *strings = pjson_reallocate(tape->allocator, tape->strings, tape->strings_capacity, new_capacity);
+      if (!strings) return NULL;
+      tape->strings = strings;
+      tape->strings_capacity = new_capacity;
+    }
+
+    if (token->segments) {
+      uint8_t *dest = tape->strings + tape->strings_length;
+      for (size_t i = 0; i < token->segment_count; i++) {
+        memcpy(dest, token->segments[i].start, token->segments[i].length);
+        dest += token->segments[i].length;
+      }
+    }
+    else {
+      memcpy(tape->strings + tape->strings_length, token->start, token->length);
+    }
+    entry->string_offset = tape->strings_length;
+    tape->strings_length = new_length;
+  }
+
+  return entry;
+}
+
+static pjson_parsing_status pjson_tape_eat(pjson_parser_base *parser, const pjson_token *token) {
+  pjson_tape *tape = (pjson_tape *)parser;
+  pjson_tape_entry *entry;
+  size_t open_index = tape->open_index;
+
+  switch (token->type) {
+    case PJSON_TOKEN_NULL:
+    case PJSON_TOKEN_FALSE:
+    case PJSON_TOKEN_TRUE:
+    case PJSON_TOKEN_NUMBER:
+    case PJSON_TOKEN_STRING:
+      if (tape->state <= TAPE_STATE_EXPECT_VALUE_OR_END) {
+        tape->state = open_index != PJSON_TAPE_NO_INDEX ? TAPE_STATE_EXPECT_SEPARATOR_OR_END : TAPE_STATE_EXPECT_EOS;
+      }
+      else if ((tape->state == TAPE_STATE_EXPECT_NAME || tape->state == TAPE_STATE_EXPECT_NAME_OR_END)
+        && token->type == PJSON_TOKEN_STRING) {
+        tape->state = TAPE_STATE_EXPECT_COLON;
+      }
+      else return PJSON_STATUS_SYNTAX_ERROR;
+
+      return pjson_tape_push_entry(tape, token) ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_OUT_OF_MEMORY;
+
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      if (tape->state > TAPE_STATE_EXPECT_VALUE_OR_END) return PJSON_STATUS_SYNTAX_ERROR;
+
+      if (!(entry = pjson_tape_push_entry(tape, token))) return PJSON_STATUS_OUT_OF_MEMORY;
+      entry->match_index = open_index;
+      tape->open_index = tape->entry_count - 1;
+      tape->state = token->type == PJSON_TOKEN_OPEN_BRACKET ? TAPE_STATE_EXPECT_VALUE_OR_END : TAPE_STATE_EXPECT_NAME_OR_END;
+      return PJSON_STATUS_DATA_NEEDED;
+
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      if (tape->state != TAPE_STATE_EXPECT_SEPARATOR_OR_END
+        && tape->state != TAPE_STATE_EXPECT_VALUE_OR_END
+        && tape->state != TAPE_STATE_EXPECT_NAME_OR_END) {
+        return PJSON_STATUS_SYNTAX_ERROR;
+      }
+      assert(open_index != PJSON_TAPE_NO_INDEX);
+      if (tape->entries[open_index].type != token->type - (PJSON_TOKEN_CLOSE_BRACKET - PJSON_TOKEN_OPEN_BRACKET)) {
+        return PJSON_STATUS_SYNTAX_ERROR;
+      }
+
+      if (!(entry = pjson_tape_push_entry(tape, token))) return PJSON_STATUS_OUT_OF_MEMORY;
+      entry->match_index = open_index;
+      tape->open_index = tape->entries[open_index].match_index;
+      tape->entries[open_index].match_index = tape->entry_count - 1;
+      tape->state = tape->open_index != PJSON_TAPE_NO_INDEX ? TAPE_STATE_EXPECT_SEPARATOR_OR_END : TAPE_STATE_EXPECT_EOS;
+      return PJSON_STATUS_DATA_NEEDED;
+
+    case PJSON_TOKEN_COLON:
+      if (tape->state != TAPE_STATE_EXPECT_COLON) return PJSON_STATUS_SYNTAX_ERROR;
+
+      tape->state = TAPE_STATE_EXPECT_VALUE;
+      return PJSON_STATUS_DATA_NEEDED;
+
+    case PJSON_TOKEN_COMMA:
+      if (tape->state != TAPE_STATE_EXPECT_SEPARATOR_OR_END) return PJSON_STATUS_SYNTAX_ERROR;
+
+      assert(open_index != PJSON_TAPE_NO_INDEX);
+      tape->state = tape->entries[open_index].type == PJSON_TOKEN_OPEN_BRACKET ? TAPE_STATE_EXPECT_VALUE : TAPE_STATE_EXPECT_NAME;
+      return PJSON_STATUS_DATA_NEEDED;
+
+    case PJSON_TOKEN_EOS:
+      return tape->state == TAPE_STATE_EXPECT_EOS ? PJSON_STATUS_COMPLETED
+        : tape->entry_count == 0 ? PJSON_STATUS_NO_TOKENS_FOUND
+        : PJSON_STATUS_SYNTAX_ERROR;
+
+    default:
+      return PJSON_STATUS_SYNTAX_ERROR;
+  }
+}
+
+void pjson_init_tape(pjson_tokenizer *tokenizer, pjson_tape *tape, pjson_tape_entry *entries, size_t capacity) {
+  pjson_init_tape_ex(tokenizer, tape, entries, capacity, NULL);
+}
+
+void pjson_init_tape_ex(pjson_tokenizer *tokenizer, pjson_tape *tape, pjson_tape_entry *entries, size_t capacity,
+  const pjson_tokenizer_options *options) {
+  assert(tape);
+  assert(entries || capacity == 0);
+
+  memset(tape, 0, sizeof(*tape));
+
+  tape->base.eat = &pjson_tape_eat;
+  tape->entries = tape->initial_entries = entries;
+  tape->entry_capacity = capacity;
+  tape->tokenizer = tokenizer;
+  tape->open_index = PJSON_TAPE_NO_INDEX;
+  tape->state = TAPE_STATE_EXPECT_VALUE;
+
+  pjson_init_ex(tokenizer, &tape->base, options);
+  tape->allocator = tokenizer->allocator;
+}
+
+void pjson_tape_free(pjson_tape *tape) {
+  assert(tape);
+
+  if (tape->entries != tape->initial_entries) {
+    pjson_deallocate(tape->allocator, tape->entries, tape->entry_capacity * sizeof(*tape->entries));
+  }
+  tape->entries = tape->initial_entries = NULL;
+  tape->entry_count = tape->entry_capacity = 0;
+
+  pjson_deallocate(tape->allocator, tape->strings, tape->strings_capacity);
+  tape->strings = NULL;
+  tape->strings_length = tape->strings_capacity = 0;
+}
+
+const uint8_t *pjson_tape_entry_data(const pjson_tape *tape, const pjson_tape_entry *entry, const uint8_t *input) {
+  assert(tape);
+  assert(entry);
+
+  if (entry->string_offset == PJSON_TAPE_STREAMED) return NULL;
+  if (entry->string_offset != PJSON_TAPE_NO_INDEX) return tape->strings + entry->string_offset;
+
+  assert(input);
+  return input + entry->start_index;
+}
+
+/* Path filter */
+
+// Paths are compiled into a trie of steps. While parsing, every array and object context holds the set of trie nodes
+// matched by the container itself, so a single pass over the children of these nodes finds the nodes matched by a
+// member. Containers that no path leads into are skipped by the tokenizer.
+
+#define PATH_STEP_ROOT (0)
+#define PATH_STEP_NAME (1)
+#define PATH_STEP_INDEX (2)
+#define PATH_STEP_NAME_OR_INDEX (3) // JSON Pointer tokens consisting of digits
+#define PATH_STEP_WILDCARD (4)
+
+#define PATH_NO_INDEX ((size_t)-1)
+
+typedef struct pjson_path_filter_context {
+  pjson_parser_context base; // base struct MUST be the first member!
+  uint64_t nodes; // nodes matched by the array or object
+  uint64_t member_nodes; // nodes matched by the value of the current property (or the top-level value)
+  size_t index; // index of the next array element
+  bool is_array;
+} pjson_path_filter_context;
+
+/**
+ * Returns the child of `parent` for the given step, adding it if needed. The name of the step must have been written
+ * to the end of `filter->names` (at `*names_length`), and is kept only if the node is new. Returns 0 if the limit of
+ * the number of nodes is exceeded.
+ */
+static size_t pjson_path_filter_add_step(pjson_path_filter *filter, size_t parent, uint8_t kind, size_t index,
+  size_t name_length, size_t *names_length) {
+  const uint8_t *name = filter->names + *names_length;
+  size_t child, last_child = 0;
+
+  for (child = filter->nodes[parent].first_child; child; child = filter->nodes[child].next_sibling) {
+    const pjson_path_filter_node *node = &filter->nodes[child];
+    if (node->kind == kind && node->index == index && node->name_length == name_length
+      && !memcmp(filter->names + node->name_offset, name, name_length)) {
+      return child;
+    }
+    last_child = child;
+  }
+
+  if (filter->node_count == PJSON_PATH_FILTER_MAX_NODES) return 0;
+
+  child = filter->node_count++;
+  pjson_path_filter_node *node = &filter->nodes[child];
+  node->kind = kind;
+  node->first_child = node->next_sibling = 0;
+  node->index = index;
+  node->name_offset = *names_length;
+  node->name_length = name_length;
+  node->first_path = PATH_NO_INDEX;
+  *names_length += name_length;
+  filter->max_name_length = max(filter->max_name_length, name_length);
+
+  // Keep the siblings in the order of the paths.
+  if (last_child) filter->nodes[last_child].next_sibling = (uint8_t)child;
+  else filter->nodes[parent].first_child = (uint8_t)child;
+  filter->inner_nodes |= (uint64_t)1 << parent;
+  return child;
+}
+
+static bool pjson_path_filter_parse_index(const char **p, size_t *index) {
+  const char *s = *p;
+  if (!is_digit((uint8_t)*s)) return false;
+
+  size_t value = 0;
+  for (; is_digit((uint8_t)*s); s++) {
+    if (value > ((size_t)-1 - 9) / 10) return false;
+    value = value * 10 + (size_t)(*s - '0');
+  }
+  *p = s;
+  *index = value;
+  return true;
+}
+
+static pjson_parsing_status pjson_path_filter_compile(pjson_path_filter *filter, const char *path, size_t *names_length,
+  size_t *final_node) {
+  const char *p = path;
+  size_t node = 0;
+
+  if (*p == '$') {
+    // Simple JSONPath
+    for (p++; *p; ) {
+      uint8_t *name = filter->names + *names_length;
+      size_t name_length = 0, index = 0;
+      uint8_t kind = PATH_STEP_NAME;
+
+      if (*p == '.') {
+        p++;
+        if (*p == '*') {
+          kind = PATH_STEP_WILDCARD;
+          p++;
+        }
+        else {
+          while (*p && *p != '.' && *p != '[') name[name_length++] = (uint8_t)*p++;
+          if (!name_length) return PJSON_STATUS_SYNTAX_ERROR; // also rejects recursive descent (`..`)
+        }
+      }
+      else if (*p == '[') {
+        p++;
+        if (*p == '*') {
+          kind = PATH_STEP_WILDCARD;
+          p++;
+        }
+        else if (*p == '\'' || *p == '"') {
+          const char quote = *p++;
+          while (*p != quote) {
+            if (!*p) return PJSON_STATUS_SYNTAX_ERROR;
+            if (*p == '\\' && !*++p) return PJSON_STATUS_SYNTAX_ERROR;
+            name[name_length++] = (uint8_t)*p++;
+          }
+          p++;
+        }
+        else if (pjson_path_filter_parse_index(&p, &index)) {
+          kind = PATH_STEP_INDEX;
+        }
+        else return PJSON_STATUS_SYNTAX_ERROR;
+
+        if (*p++ != ']') return PJSON_STATUS_SYNTAX_ERROR;
+      }
+      else return PJSON_STATUS_SYNTAX_ERROR;
+
+      if (!(node = pjson_path_filter_add_step(filter, node, kind, index, name_length, names_length))) {
+        return PJSON_STATUS_LIMIT_EXCEEDED;
+      }
+    }
+  }
+  else {
+    // JSON Pointer (RFC 6901)
+    if (*p && *p != '/') return PJSON_STATUS_SYNTAX_ERROR;
+
+    while (*p == '/') {
+      uint8_t *name = filter->names + *names_length;
+      size_t name_length = 0, index = 0;
+      uint8_t kind = PATH_STEP_NAME;
+
+      const char *token = ++p;
+      while (*p && *p != '/') {
+        if (*p == '~') {
+          p++;
+          if (*p == '0') name[name_length++] = '~';
+          else if (*p == '1') name[name_length++] = '/';
+          else return PJSON_STATUS_SYNTAX_ERROR;
+          p++;
+        }
+        else name[name_length++] = (uint8_t)*p++;
+      }
+
+      // Array indices have no leading zeros.
+      const char *s = token;
+      if ((*token != '0' || p == token + 1) && pjson_path_filter_parse_index(&s, &index) && s == p) {
+        kind = PATH_STEP_NAME_OR_INDEX;
+      }
+      else index = 0;
+
+      if (!(node = pjson_path_filter_add_step(filter, node, kind, index, name_length, names_length))) {
+        return PJSON_STATUS_LIMIT_EXCEEDED;
+      }
+    }
+  }
+
+  *final_node = node;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static bool pjson_path_filter_name_equals(pjson_path_filter *filter, const pjson_token *token, const pjson_path_filter_node *node) {
+  const uint8_t *name = filter->names + node->name_offset;
+  if (token->unescaped_length != node->name_length) return false;
+
+  if (token->unescaped) return !memcmp(token->unescaped, name, node->name_length);
+
+  assert(!is_streamed_string(token)); // rejected by pjson_path_filter_on_name
+  if (!token->segments && token->length == node->name_length + 2) {
+    // No escape sequences
+    return !memcmp(token->start + 1, name, node->name_length);
+  }
+
+  // Every byte of the unescaped name takes at most 6 bytes in the token (`\uXXXX`).
+  assert(token->length <= 6 * node->name_length + 2);
+  const uint8_t *token_start = token->start;
+  if (token->segments) {
+    uint8_t *dest = filter->scratch;
+    for (size_t i = 0; i < token->segment_count; i++) {
+      memcpy(dest, token->segments[i].start, token->segments[i].length);
+      dest += token->segments[i].length;
+    }
+    token_start = filter->scratch;
+  }
+
+  uint8_t *unescaped = filter->scratch + 6 * filter->max_name_length + 2;
+  return pjson_parse_string(unescaped, node->name_length, token_start, token->length, true)
+    && !memcmp(unescaped, name, node->name_length);
+}
+
+/**
+ * Returns the set of nodes matched by a member of a container matching `nodes`: by the property named `name`,
+ * or by the array element `index` if `name` is `NULL`.
+ */
+static uint64_t pjson_path_filter_step(pjson_path_filter *filter, uint64_t nodes, const pjson_token *name, size_t index) {
+  uint64_t result = 0;
+
+  for (nodes &= filter->inner_nodes; nodes; nodes &= nodes - 1) {
+    size_t child = filter->nodes[bit_scan_forward64(nodes)].first_child;
+    for (; child; child = filter->nodes[child].next_sibling) {
+      const pjson_path_filter_node *node = &filter->nodes[child];
+      bool is_match;
+
+      switch (node->kind) {
+        case PATH_STEP_WILDCARD: is_match = true; break;
+        case PATH_STEP_INDEX: is_match = !name && node->index == index; break;
+        case PATH_STEP_NAME_OR_INDEX: is_match = !name ? node->index == index : pjson_path_filter_name_equals(filter, name, node); break;
+        default: is_match = name && pjson_path_filter_name_equals(filter, name, node); break;
+      }
+      if (is_match) result |= (uint64_t)1 << child;
+    }
+  }
+
+  return result;
+}
+
+static pjson_parsing_status pjson_path_filter_report(pjson_path_filter *filter, uint64_t nodes, const pjson_token *token) {
+  pjson_parsing_status result = PJSON_STATUS_SUCCESS;
+
+  for (nodes &= filter->final_nodes; nodes; nodes &= nodes - 1) {
+    size_t path = filter->nodes[bit_scan_forward64(nodes)].first_path;
+    for (; path != PATH_NO_INDEX; path = filter->next_paths[path]) {
+      pjson_parsing_status status = filter->on_match(filter, path, token);
+      if (status == PJSON_STATUS_SKIP) result = status;
+      else if (status != PJSON_STATUS_SUCCESS) return status;
+    }
+  }
+
+  return result;
+}
+
+static pjson_parsing_status pjson_path_filter_on_name(pjson_path_filter *filter, pjson_path_filter_context *context,
+  const pjson_token *token) {
+  // The bytes of streamed names are not available for comparing. (Longer names can't match a step anyway.)
+  if (is_streamed_string(token) && token->unescaped_length <= filter->max_name_length) return PJSON_STATUS_USER_ERROR;
+
+  context->member_nodes = pjson_path_filter_step(filter, context->nodes, token, 0);
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status pjson_path_filter_on_value(pjson_path_filter *filter, pjson_path_filter_context *context,
+  const pjson_token *token) {
+  pjson_path_filter_context *child_context = (pjson_path_filter_context *)filter->parser.context;
+  pjson_parsing_status status;
+  uint64_t nodes;
+
+  switch (token->type) {
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return pjson_path_filter_report(filter, child_context->nodes, token);
+
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      nodes = context->is_array ? pjson_path_filter_step(filter, context->nodes, NULL, context->index++) : context->member_nodes;
+      child_context->nodes = nodes;
+      child_context->is_array = token->type == PJSON_TOKEN_OPEN_BRACKET;
+
+      status = pjson_path_filter_report(filter, nodes, token);
+      if (status != PJSON_STATUS_SUCCESS) return status;
+      if (!(nodes & filter->inner_nodes)) return PJSON_STATUS_SKIP; // no path leads into the value
+
+      child_context->base.on_value = (pjson_parser_context_callback)&pjson_path_filter_on_value;
+      child_context->base.on_object_property_name = (pjson_parser_context_callback)&pjson_path_filter_on_name;
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      nodes = context->is_array ? pjson_path_filter_step(filter, context->nodes, NULL, context->index++) : context->member_nodes;
+      return pjson_path_filter_report(filter, nodes, token);
+  }
+}
+
+static void pjson_path_filter_setup_toplevel_context(pjson_path_filter *filter) {
+  pjson_path_filter_context *context = (pjson_path_filter_context *)filter->parser.context;
+  if (!context) return; // the parser is out of memory
+
+  context->base.on_value = (pjson_parser_context_callback)&pjson_path_filter_on_value;
+  context->nodes = 0;
+  context->member_nodes = 1; // the root
+  context->is_array = false;
+}
+
+pjson_parsing_status pjson_path_filter_init(pjson_path_filter *filter, bool is_lazy,
+  const char *const *paths, size_t path_count, pjson_path_filter_callback on_match, const pjson_path_filter_options *options) {
+  assert(filter);
+  assert(paths || path_count == 0);
+  assert(on_match);
+
+  memset(filter, 0, sizeof(*filter));
+  filter->on_match = on_match;
+  filter->path_count = path_count;
+  filter->allocator = options && options->allocator ? options->allocator : &pjson_default_allocator;
+
+  // Unescaped names are never longer than the paths they come from.
+  size_t names_capacity = 0, max_path_length = 0;
+  for (size_t i = 0; i < path_count; i++) {
+    assert(paths[i]);
+    size_t length = strlen(paths[i]);
+    names_capacity += length;
+    max_path_length = max(max_path_length, length);
+  }
+
+  size_t next_paths_size = path_count * sizeof(*filter->next_paths);
+  size_t scratch_size = 7 * max_path_length + 2; // the token of the longest name and its unescaped form
+  filter->buffer_size = next_paths_size + names_capacity + scratch_size;
+  uint8_t *buffer = pjson_allocate(filter->allocator, filter->buffer_size);
+  if (!buffer) return PJSON_STATUS_OUT_OF_MEMORY;
+  filter->next_paths = (size_t *)buffer;
+  filter->names = buffer + next_paths_size;
+
+  filter->nodes[0].kind = PATH_STEP_ROOT;
+  filter->nodes[0].first_path = PATH_NO_INDEX;
+  filter->node_count = 1;
+
+  size_t names_length = 0;
+  for (size_t i = 0; i < path_count; i++) {
+    size_t node;
+    pjson_parsing_status status = pjson_path_filter_compile(filter, paths[i], &names_length, &node);
+    if (status != PJSON_STATUS_SUCCESS) {
+      pjson_deallocate(filter->allocator, buffer, filter->buffer_size);
+      filter->next_paths = NULL;
+      filter->names = NULL;
+      return status;
+    }
+
+    // Append the path to the list of the node, keeping the order of the paths.
+    size_t *next = &filter->nodes[node].first_path;
+    while (*next != PATH_NO_INDEX) next = &filter->next_paths[*next];
+    *next = i;
+    filter->next_paths[i] = PATH_NO_INDEX;
+    filter->final_nodes |= (uint64_t)1 << node;
+  }
+  filter->scratch = filter->names + names_capacity;
+
+  pjson_parser_options parser_options = {
+    .context_size = sizeof(pjson_path_filter_context),
+    .allocator = filter->allocator,
+  };
+  if (options) {
+    parser_options.max_depth = options->max_depth;
+    parser_options.validate_skipped_values = options->validate_skipped_values;
+  }
+  pjson_parser_init_ex(&filter->parser, is_lazy, &parser_options);
+  pjson_path_filter_setup_toplevel_context(filter);
+
+  return PJSON_STATUS_SUCCESS;
+}
+
+void pjson_path_filter_rewind(pjson_path_filter *filter, bool is_lazy) {
+  assert(filter);
+
+  pjson_parser_rewind(&filter->parser, is_lazy);
+  pjson_path_filter_setup_toplevel_context(filter);
+}
+
+void pjson_path_filter_free(pjson_path_filter *filter) {
+  assert(filter);
+
+  pjson_deallocate(filter->allocator, filter->next_paths, filter->buffer_size);
+  filter->next_paths = NULL;
+  filter->names = filter->scratch = NULL;
+  filter->buffer_size = 0;
+
+  pjson_parser_free(&filter->parser);
+}
+
+/* Property name lookup */
+
+// The table is built with the "hash, displace and compress" scheme: names are hashed to buckets of a few names each,
+// then the buckets are placed into the slots one by one, largest first, by finding a displacement value for each bucket
+// which moves all of its names to free slots. A lookup hashes the name once and mixes the displacement of its bucket
+// into the hash to get the slot. With twice as many slots as names, displacements are found within a few tries.
+
+#define NAME_TABLE_SEED_COUNT (16)
+#define NAME_TABLE_NO_NAME ((size_t)-1)
+
+static inline uint64_t pjson_name_hash(uint64_t seed, const uint8_t *name, size_t length) {
+  uint64_t h = seed ^ ((uint64_t)length * 0x9E3779B97F4A7C15ull), word;
+
+  for (; length >= 8; name += 8, length -= 8) {
+    memcpy(&word, name, 8);
+    h = (h ^ word) * 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+  }
+  if (length) {
+    word = 0;
+    memcpy(&word, name, length);
+    h = (h ^ word) * 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+  }
+
+  return h * 0x94D049BB133111EBull;
+}
+
+static inline size_t pjson_name_table_slot(const pjson_name_table *table, uint64_t hash, uint16_t displacement) {
+  uint64_t x = hash ^ ((uint64_t)displacement * 0x9E3779B97F4A7C15ull);
+  x ^= x >> 32;
+  x *= 0xD6E8FEB86659FD93ull;
+  return (size_t)(x >> (64 - table->slot_bits));
+}
+
+/**
+ * Tries to place all names using the current seed. Returns `PJSON_STATUS_SUCCESS`, `PJSON_STATUS_SYNTAX_ERROR` if two
+ * names are the same or `PJSON_STATUS_LIMIT_EXCEEDED` if some bucket cannot be placed.
+ */
+static pjson_parsing_status pjson_name_table_place(pjson_name_table *table, uint64_t *hashes, size_t *next_names, size_t *buckets) {
+  const size_t bucket_count = (size_t)1 << table->bucket_bits;
+  const size_t slot_count = (size_t)1 << table->slot_bits;
+  size_t max_bucket_size = 0;
+
+  // Link the names of each bucket into a list (buckets[] holds the heads, and the sizes are counted separately).
+  for (size_t i = 0; i < bucket_count; i++) buckets[i] = NAME_TABLE_NO_NAME;
+  memset(table->displacements, 0, bucket_count * sizeof(*table->displacements));
+  memset(table->slots, 0, slot_count * sizeof(*table->slots));
+
+  for (size_t i = 0; i < table->name_count; i++) {
+    const uint8_t *name = (const uint8_t *)table->names[i];
+    hashes[i] = pjson_name_hash(table->seed, name, table->name_lengths[i]);
+    size_t bucket = (size_t)(hashes[i] >> (64 - table->bucket_bits));
+
+    size_t bucket_size = 1;
+    for (size_t other = buckets[bucket]; other != NAME_TABLE_NO_NAME; other = next_names[other], bucket_size++) {
+      if (hashes[other] != hashes[i]) continue;
+      if (table->name_lengths[other] == table->name_lengths[i] && !memcmp(table->names[other], name, table->name_lengths[i])) {
+        return PJSON_STATUS_SYNTAX_ERROR;
+      }
+      return PJSON_STATUS_LIMIT_EXCEEDED; // names with the same hash can't be told apart, try another seed
+    }
+    next_names[i] = buckets[bucket];
+    buckets[bucket] = i;
+    max_bucket_size = max(max_bucket_size, bucket_size);
+  }
+
+  for (size_t size = max_bucket_size; size > 0; size--) {
+    for (size_t bucket = 0; bucket < bucket_count; bucket++) {
+      size_t bucket_size = 0;
+      for (size_t i = buckets[bucket]; i != NAME_TABLE_NO_NAME; i = next_names[i]) bucket_size++;
+      if (bucket_size != size) continue;
+
+      uint32_t displacement = 0;
+      for (; displacement <= 0xFFFF; displacement++) {
+        // Claim the slots of the names one by one, and release them if a name doesn't fit.
+        size_t i = buckets[bucket], placed = buckets[bucket];
+        for (; i != NAME_TABLE_NO_NAME; i = next_names[i]) {
+          size_t slot = pjson_name_table_slot(table, hashes[i], (uint16_t)displacement);
+          if (table->slots[slot]) break;
+          table->slots[slot] = (uint16_t)(i + 1);
+        }
+        if (i == NAME_TABLE_NO_NAME) break;
+
+        for (; placed != i; placed = next_names[placed]) {
+          table->slots[pjson_name_table_slot(table, hashes[placed], (uint16_t)displacement)] = 0;
+        }
+      }
+      if (displacement > 0xFFFF) return PJSON_STATUS_LIMIT_EXCEEDED;
+
+      table->displacements[bucket] = (uint16_t)displacement;
+    }
+  }
+
+  return PJSON_STATUS_SUCCESS;
+}
+
+pjson_parsing_status pjson_name_table_init(pjson_name_table *table, const char *const *names, size_t name_count,
+  const pjson_name_table_options *options) {
+  assert(table);
+  assert(names || name_count == 0);
+
+  memset(table, 0, sizeof(*table));
+  if (name_count > PJSON_NAME_TABLE_MAX_NAMES) return PJSON_STATUS_LIMIT_EXCEEDED;
+
+  table->names = names;
+  table->name_count = name_count;
+  table->allocator = options && options->allocator ? options->allocator : &pjson_default_allocator;
+
+  // About 2 names per bucket and 2 slots per name
+  table->bucket_bits = 1;
+  while (((size_t)2 << table->bucket_bits) < name_count) table->bucket_bits++;
+  table->slot_bits = 1;
+  while (((size_t)1 << table->slot_bits) < name_count * 2) table->slot_bits++;
+
+  const size_t bucket_count = (size_t)1 << table->bucket_bits;
+  const size_t slot_count = (size_t)1 << table->slot_bits;
+  table->buffer_size = name_count * sizeof(*table->name_lengths)
+    + bucket_count * sizeof(*table->displacements) + slot_count * sizeof(*table->slots);
+  if (!(table->name_lengths = pjson_allocate(table->allocator, table->buffer_size))) return PJSON_STATUS_OUT_OF_MEMORY;
+  table->displacements = (uint16_t *)(table->name_lengths + name_count);
+  table->slots = table->displacements + bucket_count;
+
+  for (size_t i = 0; i < name_count; i++) {
+    assert(names[i]);
+    table->name_lengths[i] = strlen(names[i]);
+    table->max_name_length = max(table->max_name_length, table->name_lengths[i]);
+  }
+
+  // Temporary storage: the hashes and the lists of names by bucket
+  size_t temp_size = name_count * (sizeof(uint64_t) + sizeof(size_t)) + bucket_count * sizeof(size_t);
+  uint8_t *temp = pjson_allocate(table->allocator, temp_size);
+  if (!temp) {
+    pjson_name_table_free(table);
+    return PJSON_STATUS_OUT_OF_MEMORY;
+  }
+  uint64_t *hashes = (uint64_t *)temp;
+  size_t *next_names = (size_t *)(hashes + name_count);
+  size_t *buckets = next_names + name_count;
+
+  pjson_parsing_status status = PJSON_STATUS_LIMIT_EXCEEDED;
+  for (table->seed = 0; table->seed < NAME_TABLE_SEED_COUNT && status == PJSON_STATUS_LIMIT_EXCEEDED; table->seed++) {
+    status = pjson_name_table_place(table, hashes, next_names, buckets);
+    if (status == PJSON_STATUS_SUCCESS) break;
+  }
+
+  pjson_deallocate(table->allocator, temp, temp_size);
+  if (status != PJSON_STATUS_SUCCESS) pjson_name_table_free(table);
+  return status;
+}
+
+void pjson_name_table_free(pjson_name_table *table) {
+  assert(table);
+
+  pjson_deallocate(table->allocator, table->name_lengths, table->buffer_size);
+  table->name_lengths = NULL;
+  table->displacements = table->slots = NULL;
+  table->buffer_size = 0;
+}
+
+size_t pjson_name_table_find_string(const pjson_name_table *table, const uint8_t *name, size_t length) {
+  assert(table && table->slots);
+  assert(name || length == 0);
+
+  if (length > table->max_name_length) return PJSON_NAME_NOT_FOUND;
+
+  uint64_t hash = pjson_name_hash(table->seed, name, length);
+  uint16_t displacement = table->displacements[hash >> (64 - table->bucket_bits)];
+  size_t slot = table->slots[pjson_name_table_slot(table, hash, displacement)];
+  if (!slot) return PJSON_NAME_NOT_FOUND;
+
+  size_t index = slot - 1;
+  return table->name_lengths[index] == length && !memcmp(table->names[index], name, length) ? index : PJSON_NAME_NOT_FOUND;
+}
+
+size_t pjson_name_table_find(const pjson_name_table *table, const pjson_token *token) {
+  assert(table);
+  assert(token && token->type == PJSON_TOKEN_STRING);
+
+  if (token->unescaped) return pjson_name_table_find_string(table, token->unescaped, token->unescaped_length);
+  if (token->unescaped_length > table->max_name_length) return PJSON_NAME_NOT_FOUND;
+  if (is_streamed_string(token)) return PJSON_NAME_UNAVAILABLE;
+
+  if (!token->segments && token->unescaped_length == token->length - 2) {
+    // No escape sequences
+    return pjson_name_table_find_string(table, token->start + 1, token->unescaped_length);
+  }
+
+  // The token is gathered from its segments (if needed) and unescaped into the buffer.
+  uint8_t fixed_size_buf[256];
+  size_t buf_size = token->unescaped_length + (token->segments ? token->length : 0);
+  uint8_t *buf;
+  if (buf_size <= sizeof(fixed_size_buf)) {
+    buf = fixed_size_buf;
+  }
+  else if (!(buf = pjson_allocate(table->allocator, buf_size))) {
+    return PJSON_NAME_UNAVAILABLE;
+  }
+
+  const uint8_t *token_start = token->start;
+  if (token->segments) {
+    uint8_t *dest = buf + token->unescaped_length;
+    for (size_t i = 0; i < token->segment_count; i++) {
+      memcpy(dest, token->segments[i].start, token->segments[i].length);
+      dest += token->segments[i].length;
+    }
+    token_start = buf + token->unescaped_length;
+  }
+
+  size_t index = pjson_parse_string(buf, token->unescaped_length, token_start, token->length, true)
+    ? pjson_name_table_find_string(table, buf, token->unescaped_length)
+    : PJSON_NAME_NOT_FOUND;
+
+  if (buf != fixed_size_buf) pjson_deallocate(table->allocator, buf, buf_size);
+  return index;
+}
+
+/* Arena */
+
+struct pjson_arena_block {
+  pjson_arena_block *next;
+  size_t size; // number of bytes the block can hold
+};
+
+#define ARENA_BLOCK_HEADER_SIZE ((sizeof(pjson_arena_block) + PJSON_ARENA_ALIGNMENT - 1) & ~(size_t)(PJSON_ARENA_ALIGNMENT - 1))
+#define ARENA_MIN_BLOCK_SIZE (4096)
+#define ARENA_MAX_BLOCK_SIZE (256 * 1024) // caps the memory left unused at the end of the last block
+
+static inline uint8_t *pjson_arena_block_data(pjson_arena_block *block) {
+  return (uint8_t *)block + ARENA_BLOCK_HEADER_SIZE;
+}
+
+static inline uint8_t *pjson_arena_align(uint8_t *p, size_t alignment) {
+  return (uint8_t *)(((uintptr_t)p + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void pjson_arena_init(pjson_arena *arena, void *buffer, size_t size, const pjson_allocator *allocator) {
+  assert(arena);
+  assert(buffer || size == 0);
+
+  memset(arena, 0, sizeof(*arena));
+  arena->initial_buffer = (uint8_t *)buffer;
+  arena->initial_size = size;
+  arena->allocator = allocator ? allocator : &pjson_default_allocator;
+  pjson_arena_reset(arena);
+}
+
+void *pjson_arena_allocate(pjson_arena *arena, size_t size, size_t alignment) {
+  assert(arena);
+  assert(alignment && !(alignment & (alignment - 1)) && alignment <= PJSON_ARENA_ALIGNMENT);
+
+  uint8_t *p = pjson_arena_align(arena->cursor, alignment);
+  if (p && p <= arena->end && size <= (size_t)(arena->end - p)) {
+    arena->cursor = p + size;
+    return p;
+  }
+
+  // Move on to the next block, skipping the blocks kept from before the last reset which are too small.
+  pjson_arena_block *block = arena->block;
+  pjson_arena_block *next = block ? block->next : arena->blocks;
+  for (; next; block = next, next = next->next) {
+    if (size <= next->size) {
+      arena->block = next;
+      arena->cursor = pjson_arena_block_data(next) + size;
+      arena->end = pjson_arena_block_data(next) + next->size;
+      return pjson_arena_block_data(next);
+    }
+  }
+
+  // Blocks grow geometrically up to a limit, so there are few of them, and the last one isn't left mostly unused.
+  size_t block_size = max((size_t)ARENA_MIN_BLOCK_SIZE, block ? block->size * 2 : arena->initial_size);
+  if (block_size > ARENA_MAX_BLOCK_SIZE) block_size = max((size_t)ARENA_MAX_BLOCK_SIZE, arena->initial_size);
+  if (block_size < size) block_size = size;
+  if (block_size > (size_t)-1 - ARENA_BLOCK_HEADER_SIZE) return NULL;
+
+  if (!(next = pjson_allocate(arena->allocator, ARENA_BLOCK_HEADER_SIZE + block_size))) return NULL;
+  next->next = NULL;
+  next->size = block_size;
+  if (block) block->next = next;
+  else arena->blocks = next;
+
+  arena->block = next;
+  arena->cursor = pjson_arena_block_data(next) + size;
+  arena->end = pjson_arena_block_data(next) + block_size;
+  return pjson_arena_block_data(next);
+}
+
+void *pjson_arena_reallocate(pjson_arena *arena, void *ptr, size_t old_size, size_t new_size, size_t alignment) {
+  assert(arena);
+  assert(ptr || old_size == 0);
+
+  uint8_t *p = (uint8_t *)ptr;
+  if (p && p + old_size == arena->cursor && new_size <= (size_t)(arena->end - p)) {
+    // The most recent allocation can be resized in place.
+    arena->cursor = p + new_size;
+    return p;
+  }
+  if (new_size <= old_size) return ptr;
+
+  uint8_t *new_p = pjson_arena_allocate(arena, new_size, alignment);
+  if (new_p && old_size) memcpy(new_p, p, old_size);
+  return new_p;
+}
+
+void pjson_arena_reset(pjson_arena *arena) {
+  assert(arena);
+
+  arena->block = NULL;
+  arena->cursor = arena->initial_buffer;
+  arena->end = arena->initial_buffer + arena->initial_size;
+}
+
+void pjson_arena_free(pjson_arena *arena) {
+  assert(arena);
+
+  pjson_arena_block *block = arena->blocks;
+  while (block) {
+    pjson_arena_block *next = block->next;
+    pjson_deallocate(arena->allocator, block, ARENA_BLOCK_HEADER_SIZE + block->size);
+    block = next;
+  }
+  arena->blocks = NULL;
+
+  pjson_arena_reset(arena);
+}
+
+/** Copies the bytes `[offset, offset + length)` of a token consisting of segments to `dest`. */
+static void pjson_token_gather(uint8_t *dest, const pjson_token *token, size_t offset, size_t length) {
+  for (size_t i = 0; i < token->segment_count && length; i++) {
+    const pjson_segment *segment = &token->segments[i];
+    if (offset >= segment->length) {
+      offset -= segment->length;
+      continue;
+    }
+    size_t n = segment->length - offset < length ? segment->length - offset : length;
+    memcpy(dest, segment->start + offset, n);
+    dest += n;
+    length -= n;
+    offset = 0;
+  }
+}
+
+/**
+ * Copies the (unescaped) value of a string token to the arena, zero-terminated. Fails with `PJSON_STATUS_USER_ERROR` for
+ * strings streamed to a `pjson_string_chunk_handler`, the bytes of which are not available.
+ */
+static pjson_parsing_status pjson_arena_copy_string(pjson_arena *arena, pjson_string *dest, const pjson_token *token) {
+  if (is_streamed_string(token)) return PJSON_STATUS_USER_ERROR;
+
+  const size_t length = token->unescaped_length;
+  uint8_t *data = pjson_arena_allocate(arena, length + 1, 1);
+  if (!data) return PJSON_STATUS_OUT_OF_MEMORY;
+
+  if (token->unescaped) memcpy(data, token->unescaped, length);
+  else if (length == token->length - 2) {
+    // No escape sequences
+    if (token->segments) pjson_token_gather(data, token, 1, length);
+    else memcpy(data, token->start + 1, length);
+  }
+  else {
+    const uint8_t *token_start = token->start;
+    if (token->segments) {
+      // Rare enough to accept leaving the gathered token in the arena.
+      uint8_t *buf = pjson_arena_allocate(arena, token->length, 1);
+      if (!buf) return PJSON_STATUS_OUT_OF_MEMORY;
+      pjson_token_gather(buf, token, 0, token->length);
+      token_start = buf;
+    }
+    if (!pjson_parse_string(data, length, token_start, token->length, true)) return PJSON_STATUS_USER_ERROR;
+  }
+
+  data[length] = 0;
+  dest->data = (const char *)data;
+  dest->length = length;
+  return PJSON_STATUS_SUCCESS;
+}
+
+/* Struct binding */
+
+// Every array and object being filled has a context pointing to its storage. Property names are looked up in the name
+// table of the struct, and the value is converted according to the type of the field found (if any).
+
+typedef struct pjson_binding_context {
+  pjson_parser_context base; // base struct MUST be the first member!
+  const pjson_binding_struct *item_struct; // struct of the object, or of the items of the array (if they are objects)
+  uint8_t *object; // object being filled
+  const pjson_field_descriptor *field; // field of the current property, NULL if unknown
+  pjson_array *array; // array being filled
+  pjson_field_type item_type; // type of the items of the array
+  size_t item_size;
+} pjson_binding_context;
+
+static pjson_parsing_status pjson_binding_on_property_name(pjson_binding *binding, pjson_binding_context *context, const pjson_token *token);
+static pjson_parsing_status pjson_binding_on_property_value(pjson_binding *binding, pjson_binding_context *context, const pjson_token *token);
+static pjson_parsing_status pjson_binding_on_item(pjson_binding *binding, pjson_binding_context *context, const pjson_token *token);
+
+static const pjson_binding_struct *pjson_binding_find_struct(const pjson_binding *binding, const pjson_struct_descriptor *descriptor) {
+  for (size_t i = 0; i < binding->struct_count; i++) {
+    if (binding->structs[i].descriptor == descriptor) return &binding->structs[i];
+  }
+  return NULL;
+}
+
+/**
+ * Size of the block holding the names of the fields of a struct and the indices of their structs.
+ */
+static size_t pjson_binding_struct_buffer_size(const pjson_struct_descriptor *descriptor) {
+  return max((size_t)1, descriptor->field_count) * sizeof(const char *) + descriptor->field_count;
+}
+
+static size_t pjson_binding_type_size(pjson_field_type type, const pjson_binding_struct *item_struct) {
+  switch (type) {
+    case PJSON_FIELD_BOOL: return sizeof(bool);
+    case PJSON_FIELD_INT32: return sizeof(int32_t);
+    case PJSON_FIELD_UINT32: return sizeof(uint32_t);
+    case PJSON_FIELD_INT64: return sizeof(int64_t);
+    case PJSON_FIELD_UINT64: return sizeof(uint64_t);
+    case PJSON_FIELD_FLOAT: return sizeof(float);
+    case PJSON_FIELD_DOUBLE: return sizeof(double);
+    case PJSON_FIELD_STRING: return sizeof(pjson_string);
+    case PJSON_FIELD_OBJECT: return item_struct->descriptor->size;
+    default: return sizeof(pjson_array);
+  }
+}
+
+/**
+ * Stores a value in `dest`, which has the type `type`. For arrays, `item_type` is the type of the items. For objects and
+ * arrays of objects, `item_struct` is the struct of the object(s).
+ */
+static pjson_parsing_status pjson_binding_bind(pjson_binding *binding, pjson_field_type type, pjson_field_type item_type,
+  const pjson_binding_struct *item_struct, uint8_t *dest, const pjson_token *token) {
+  pjson_binding_context *child_context;
+  bool is_valid;
+
+  if (token->type == PJSON_TOKEN_NULL) return PJSON_STATUS_SUCCESS; // leave the member zeroed
+
+  switch (type) {
+    case PJSON_FIELD_BOOL:
+      if (token->type != PJSON_TOKEN_TRUE && token->type != PJSON_TOKEN_FALSE) return PJSON_STATUS_USER_ERROR;
+      *(bool *)dest = token->type == PJSON_TOKEN_TRUE;
+      return PJSON_STATUS_SUCCESS;
+
+    case PJSON_FIELD_INT32:
+      is_valid = token->type == PJSON_TOKEN_NUMBER && pjson_parse_int32((int32_t *)dest, token->start, token->length);
+      return is_valid ? PJSON_STATUS_SUCCESS : PJSON_STATUS_USER_ERROR;
+
+    case PJSON_FIELD_UINT32:
+      is_valid = token->type == PJSON_TOKEN_NUMBER && pjson_parse_uint32((uint32_t *)dest, token->start, token->length);
+      return is_valid ? PJSON_STATUS_SUCCESS : PJSON_STATUS_USER_ERROR;
+
+    case PJSON_FIELD_INT64:
+      is_valid = token->type == PJSON_TOKEN_NUMBER && pjson_parse_int64((int64_t *)dest, token->start, token->length);
+      return is_valid ? PJSON_STATUS_SUCCESS : PJSON_STATUS_USER_ERROR;
+
+    case PJSON_FIELD_UINT64:
+      is_valid = token->type == PJSON_TOKEN_NUMBER && pjson_parse_uint64((uint64_t *)dest, token->start, token->length);
+      return is_valid ? PJSON_STATUS_SUCCESS : PJSON_STATUS_USER_ERROR;
+
+    case PJSON_FIELD_FLOAT:
+      is_valid = token->type == PJSON_TOKEN_NUMBER && pjson_parse_float_ex((float *)dest, token->start, token->length, binding->allocator);
+      return is_valid ? PJSON_STATUS_SUCCESS : PJSON_STATUS_USER_ERROR;
+
+    case PJSON_FIELD_DOUBLE:
+      is_valid = token->type == PJSON_TOKEN_NUMBER && pjson_parse_double_ex((double *)dest, token->start, token->length, binding->allocator);
+      return is_valid ? PJSON_STATUS_SUCCESS : PJSON_STATUS_USER_ERROR;
+
+    case PJSON_FIELD_STRING:
+      if (token->type != PJSON_TOKEN_STRING || is_streamed_string(token)) return PJSON_STATUS_USER_ERROR;
+      return pjson_arena_copy_string(binding->arena, (pjson_string *)dest, token);
+
+    case PJSON_FIELD_OBJECT:
+      if (token->type != PJSON_TOKEN_OPEN_BRACE) return PJSON_STATUS_USER_ERROR;
+      memset(dest, 0, item_struct->descriptor->size);
+      child_context = (pjson_binding_context *)binding->parser.context;
+      child_context->base.on_value = (pjson_parser_context_callback)&pjson_binding_on_property_value;
+      child_context->base.on_object_property_name = (pjson_parser_context_callback)&pjson_binding_on_property_name;
+      child_context->item_struct = item_struct;
+      child_context->object = dest;
+      return PJSON_STATUS_SUCCESS;
+
+    case PJSON_FIELD_ARRAY:
+      if (token->type != PJSON_TOKEN_OPEN_BRACKET) return PJSON_STATUS_USER_ERROR;
+      memset(dest, 0, sizeof(pjson_array));
+      child_context = (pjson_binding_context *)binding->parser.context;
+      child_context->base.on_value = (pjson_parser_context_callback)&pjson_binding_on_item;
+      child_context->item_struct = item_struct;
+      child_context->array = (pjson_array *)dest;
+      child_context->item_type = item_type;
+      child_context->item_size = pjson_binding_type_size(item_type, item_struct);
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      assert(false);
+      return PJSON_STATUS_USER_ERROR;
+  }
+}
+
+static pjson_parsing_status pjson_binding_on_property_name(pjson_binding *binding, pjson_binding_context *context, const pjson_token *token) {
+  (void)binding;
+  size_t index = pjson_name_table_find(&context->item_struct->table, token);
+  if (index == PJSON_NAME_UNAVAILABLE) {
+    // The bytes of streamed names are not available for the lookup.
+    return is_streamed_string(token) ? PJSON_STATUS_USER_ERROR : PJSON_STATUS_OUT_OF_MEMORY;
+  }
+
+  context->field = index != PJSON_NAME_NOT_FOUND ? &context->item_struct->descriptor->fields[index] : NULL;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status pjson_binding_on_property_value(pjson_binding *binding, pjson_binding_context *context, const pjson_token *token) {
+  const pjson_field_descriptor *field = context->field;
+
+  switch (token->type) {
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return PJSON_STATUS_SUCCESS;
+
+    default: {
+      if (!field) return PJSON_STATUS_SKIP; // unknown property (a no-op for primitive values)
+
+      const pjson_binding_struct *item_struct = context->item_struct;
+      return pjson_binding_bind(binding, field->type, field->element_type,
+        field->object ? &binding->structs[item_struct->field_structs[field - item_struct->descriptor->fields]] : NULL,
+        context->object + field->offset, token);
+    }
+  }
+}
+
+static pjson_parsing_status pjson_binding_on_item(pjson_binding *binding, pjson_binding_context *context, const pjson_token *token) {
+  pjson_array *array = context->array;
+
+  switch (token->type) {
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      if (array->count == array->capacity) {
+        size_t new_capacity = max((size_t)4, array->capacity * 2);
+        if (new_capacity > (size_t)-1 / context->item_size) return PJSON_STATUS_OUT_OF_MEMORY;
+        void *items = pjson_arena_reallocate(binding->arena, array->items, array->capacity * context->item_size,
+          new_capacity * context->item_size, PJSON_ARENA_ALIGNMENT);
+        if (!items) return PJSON_STATUS_OUT_OF_MEMORY;
+        array->items = items;
+        array->capacity = new_capacity;
+      }
+
+      uint8_t *item = (uint8_t *)array->items + array->count++ * context->item_size;
+      memset(item, 0, context->item_size);
+      return pjson_binding_bind(binding, context->item_type, PJSON_FIELD_OBJECT, context->item_struct, item, token);
+  }
+}
+
+static pjson_parsing_status pjson_binding_on_toplevel_value(pjson_binding *binding, pjson_binding_context *context, const pjson_token *token) {
+  (void)context;
+
+  switch (token->type) {
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      return pjson_binding_bind(binding, binding->is_array ? PJSON_FIELD_ARRAY : PJSON_FIELD_OBJECT, PJSON_FIELD_OBJECT,
+        &binding->structs[0], (uint8_t *)binding->target, token);
+  }
+}
+
+static pjson_parsing_status pjson_binding_add_struct(pjson_binding *binding, const pjson_struct_descriptor *descriptor) {
+  assert(descriptor && (descriptor->fields || descriptor->field_count == 0));
+
+  if (pjson_binding_find_struct(binding, descriptor)) return PJSON_STATUS_SUCCESS;
+  if (binding->struct_count == PJSON_BINDING_MAX_STRUCTS) return PJSON_STATUS_LIMIT_EXCEEDED;
+
+  pjson_binding_struct *item_struct = &binding->structs[binding->struct_count];
+  const size_t buffer_size = pjson_binding_struct_buffer_size(descriptor);
+  item_struct->descriptor = descriptor;
+  if (!(item_struct->names = pjson_allocate(binding->allocator, buffer_size))) return PJSON_STATUS_OUT_OF_MEMORY;
+  item_struct->field_structs = (uint8_t *)(item_struct->names + max((size_t)1, descriptor->field_count));
+
+  for (size_t i = 0; i < descriptor->field_count; i++) {
+    const pjson_field_descriptor *field = &descriptor->fields[i];
+    assert(field->name);
+    assert(field->type <= PJSON_FIELD_ARRAY);
+    assert(field->type != PJSON_FIELD_ARRAY || field->element_type < PJSON_FIELD_ARRAY);
+    assert(!!field->object == (field->type == PJSON_FIELD_OBJECT
+      || (field->type == PJSON_FIELD_ARRAY && field->element_type == PJSON_FIELD_OBJECT)));
+    item_struct->names[i] = field->name;
+    item_struct->field_structs[i] = 0;
+  }
+
+  pjson_name_table_options table_options = { .allocator = binding->allocator };
+  pjson_parsing_status status = pjson_name_table_init(&item_struct->table, item_struct->names, descriptor->field_count, &table_options);
+  if (status != PJSON_STATUS_SUCCESS) {
+    pjson_deallocate(binding->allocator, (void *)item_struct->names, buffer_size);
+    item_struct->names = NULL;
+    item_struct->field_structs = NULL;
+    return status;
+  }
+  binding->struct_count++;
+
+  // The structs of the fields are resolved once here, so that binding their values needs no lookup.
+  for (size_t i = 0; i < descriptor->field_count; i++) {
+    const pjson_struct_descriptor *field_descriptor = descriptor->fields[i].object;
+    if (!field_descriptor) continue;
+    if ((status = pjson_binding_add_struct(binding, field_descriptor)) != PJSON_STATUS_SUCCESS) return status;
+    item_struct->field_structs[i] = (uint8_t)(pjson_binding_find_struct(binding, field_descriptor) - binding->structs);
+  }
+  return PJSON_STATUS_SUCCESS;
+}
+
+pjson_parsing_status pjson_binding_init(pjson_binding *binding, const pjson_struct_descriptor *descriptor,
+  bool is_array, void *target, pjson_arena *arena, const pjson_binding_options *options) {
+  assert(binding);
+  assert(descriptor);
+  assert(target);
+  assert(arena);
+
+  memset(binding, 0, sizeof(*binding));
+  binding->is_array = is_array;
+  binding->arena = arena;
+  binding->allocator = options && options->allocator ? options->allocator : &pjson_default_allocator;
+
+  pjson_parser_options parser_options = {
+    .context_size = sizeof(pjson_binding_context),
+    .max_depth = options ? options->max_depth : 0,
+    .allocator = binding->allocator,
+  };
+  pjson_parser_init_ex(&binding->parser, false, &parser_options);
+
+  pjson_parsing_status status = pjson_binding_add_struct(binding, descriptor);
+  if (status != PJSON_STATUS_SUCCESS) {
+    pjson_binding_free(binding);
+    return status;
+  }
+
+  pjson_binding_rewind(binding, target);
+  return PJSON_STATUS_SUCCESS;
+}
+
+void pjson_binding_rewind(pjson_binding *binding, void *target) {
+  assert(binding);
+  assert(target);
+
+  pjson_parser_rewind(&binding->parser, false);
+  binding->target = target;
+
+  pjson_parser_context *context = binding->parser.context;
+  if (context) context->on_value = (pjson_parser_context_callback)&pjson_binding_on_toplevel_value;
+}
+
+void pjson_binding_free(pjson_binding *binding) {
+  assert(binding);
+
+  for (size_t i = 0; i < binding->struct_count; i++) {
+    pjson_binding_struct *item_struct = &binding->structs[i];
+    pjson_name_table_free(&item_struct->table);
+    pjson_deallocate(binding->allocator, (void *)item_struct->names, pjson_binding_struct_buffer_size(item_struct->descriptor));
+    item_struct->names = NULL;
+    item_struct->field_structs = NULL;
+  }
+  binding->struct_count = 0;
+
+  pjson_parser_free(&binding->parser);
+}
+
+/* DOM */
+
+// The values are collected on a stack of members (the name being empty for array items and for the top-level value).
+// When an array or object ends, its children are on top of the stack: they are moved to the arena in one piece, and
+// popped. Thus, the stack is only as large as the children of the open arrays and objects, and the arena gets no
+// garbage from growing children arrays.
+
+typedef struct pjson_dom_context {
+  pjson_parser_context base; // base struct MUST be the first member!
+  size_t value_index; // index of the array or object in the stack
+  size_t first_index; // index of its first child in the stack
+} pjson_dom_context;
+
+static pjson_parsing_status pjson_dom_on_property_name(pjson_dom *dom, pjson_dom_context *context, const pjson_token *token);
+static pjson_parsing_status pjson_dom_on_property_value(pjson_dom *dom, pjson_dom_context *context, const pjson_token *token);
+static pjson_parsing_status pjson_dom_on_item(pjson_dom *dom, pjson_dom_context *context, const pjson_token *token);
+
+/** Pushes a member to the stack, and returns its index (`(size_t)-1` if out of memory). */
+static size_t pjson_dom_push(pjson_dom *dom) {
+  if (dom->stack_count == dom->stack_capacity) {
+    size_t new_capacity = max((size_t)64, dom->stack_capacity * 2);
+    if (new_capacity > (size_t)-1 / sizeof(pjson_dom_member)) return (size_t)-1;
+    pjson_dom_member *stack = pjson_reallocate(dom->allocator, dom->stack,
+      dom->stack_capacity * sizeof(pjson_dom_member), new_capacity * sizeof(pjson_dom_member));
+    if (!stack) return (size_t)-1;
+    dom->stack = stack;
+    dom->stack_capacity = new_capacity;
+  }
+
+  pjson_dom_member *member = &dom->stack[dom->stack_count];
+  member->name.data = "";
+  member->name.length = 0;
+  return dom->stack_count++;
+}
+
+/** Stores the value of a token in the member at `index` of the stack. */
+static pjson_parsing_status pjson_dom_set_value(pjson_dom *dom, size_t index, const pjson_token *token) {
+  pjson_dom_value *value = &dom->stack[index].value;
+  pjson_dom_context *child_context;
+  pjson_string text;
+  pjson_parsing_status status;
+
+  switch (token->type) {
+    case PJSON_TOKEN_NULL:
+    case PJSON_TOKEN_FALSE:
+    case PJSON_TOKEN_TRUE:
+      value->type = token->type == PJSON_TOKEN_NULL ? PJSON_DOM_NULL : token->type == PJSON_TOKEN_FALSE ? PJSON_DOM_FALSE : PJSON_DOM_TRUE;
+      value->count = 0;
+      value->data.text = NULL;
+      return PJSON_STATUS_SUCCESS;
+
+    case PJSON_TOKEN_NUMBER: {
+      uint8_t *data = pjson_arena_allocate(&dom->arena, token->length + 1, 1);
+      if (!data) return PJSON_STATUS_OUT_OF_MEMORY;
+      if (token->segments) pjson_token_gather(data, token, 0, token->length);
+      else memcpy(data, token->start, token->length);
+      data[token->length] = 0;
+
+      value->type = PJSON_DOM_NUMBER;
+      value->count = token->length;
+      value->data.text = (const char *)data;
+      return PJSON_STATUS_SUCCESS;
+    }
+
+    case PJSON_TOKEN_STRING:
+      if ((status = pjson_arena_copy_string(&dom->arena, &text, token)) != PJSON_STATUS_SUCCESS) return status;
+      value->type = PJSON_DOM_STRING;
+      value->count = text.length;
+      value->data.text = text.data;
+      return PJSON_STATUS_SUCCESS;
+
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      value->type = token->type == PJSON_TOKEN_OPEN_BRACKET ? PJSON_DOM_ARRAY : PJSON_DOM_OBJECT;
+      value->count = 0;
+      value->data.items = NULL;
+
+      child_context = (pjson_dom_context *)dom->parser.context;
+      child_context->value_index = index;
+      child_context->first_index = dom->stack_count;
+      if (token->type == PJSON_TOKEN_OPEN_BRACKET) {
+        child_context->base.on_value = (pjson_parser_context_callback)&pjson_dom_on_item;
+      }
+      else {
+        child_context->base.on_value = (pjson_parser_context_callback)&pjson_dom_on_property_value;
+        child_context->base.on_object_property_name = (pjson_parser_context_callback)&pjson_dom_on_property_name;
+      }
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      assert(false);
+      return PJSON_STATUS_USER_ERROR;
+  }
+}
+
+/** Moves the children of the array or object ending to the arena. */
+static pjson_parsing_status pjson_dom_end_value(pjson_dom *dom) {
+  const pjson_dom_context *child_context = (const pjson_dom_context *)dom->parser.context;
+  pjson_dom_value *value = &dom->stack[child_context->value_index].value;
+  const pjson_dom_member *children = &dom->stack[child_context->first_index];
+  const size_t count = dom->stack_count - child_context->first_index;
+
+  value->count = count;
+  if (count) {
+    if (value->type == PJSON_DOM_ARRAY) {
+      pjson_dom_value *items = pjson_arena_allocate(&dom->arena, count * sizeof(pjson_dom_value), PJSON_ARENA_ALIGNMENT);
+      if (!items) return PJSON_STATUS_OUT_OF_MEMORY;
+      for (size_t i = 0; i < count; i++) items[i] = children[i].value;
+      value->data.items = items;
+    }
+    else {
+      pjson_dom_member *members = pjson_arena_allocate(&dom->arena, count * sizeof(pjson_dom_member), PJSON_ARENA_ALIGNMENT);
+      if (!members) return PJSON_STATUS_OUT_OF_MEMORY;
+      memcpy(members, children, count * sizeof(pjson_dom_member));
+      value->data.members = members;
+    }
+  }
+
+  dom->stack_count = child_context->first_index;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status pjson_dom_on_property_name(pjson_dom *dom, pjson_dom_context *context, const pjson_token *token) {
+  (void)context;
+  size_t index = pjson_dom_push(dom);
+  if (index == (size_t)-1) return PJSON_STATUS_OUT_OF_MEMORY;
+  return pjson_arena_copy_string(&dom->arena, &dom->stack[index].name, token);
+}
+
+static pjson_parsing_status pjson_dom_on_property_value(pjson_dom *dom, pjson_dom_context *context, const pjson_token *token) {
+  (void)context;
+
+  switch (token->type) {
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return pjson_dom_end_value(dom);
+
+    default:
+      return pjson_dom_set_value(dom, dom->stack_count - 1, token); // the member pushed by the property name
+  }
+}
+
+static pjson_parsing_status pjson_dom_on_item(pjson_dom *dom, pjson_dom_context *context, const pjson_token *token) {
+  (void)context;
+
+  switch (token->type) {
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      return pjson_dom_end_value(dom);
+
+    default: {
+      size_t index = pjson_dom_push(dom);
+      if (index == (size_t)-1) return PJSON_STATUS_OUT_OF_MEMORY;
+      return pjson_dom_set_value(dom, index, token);
+    }
+  }
+}
+
+static pjson_parsing_status pjson_dom_on_toplevel_value(pjson_dom *dom, pjson_dom_context *context, const pjson_token *token) {
+  pjson_parsing_status status = pjson_dom_on_item(dom, context, token);
+  if (status != PJSON_STATUS_SUCCESS) return status;
+
+  // The top-level value is the bottom of the stack.
+  switch (token->type) {
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      dom->root = dom->stack[0].value;
+      dom->stack_count = 0;
+      return PJSON_STATUS_SUCCESS;
+  }
+}
+
+void pjson_dom_init(pjson_dom *dom, const pjson_dom_options *options) {
+  assert(dom);
+  assert(!options || options->buffer || options->buffer_size == 0);
+
+  memset(dom, 0, sizeof(*dom));
+  dom->allocator = options && options->allocator ? options->allocator : &pjson_default_allocator;
+  pjson_arena_init(&dom->arena, options ? options->buffer : NULL, options ? options->buffer_size : 0, dom->allocator);
+
+  pjson_parser_options parser_options = {
+    .context_size = sizeof(pjson_dom_context),
+    .max_depth = options ? options->max_depth : 0,
+    .allocator = dom->allocator,
+  };
+  pjson_parser_init_ex(&dom->parser, false, &parser_options);
+
+  pjson_dom_rewind(dom);
+}
+
+void pjson_dom_rewind(pjson_dom *dom) {
+  assert(dom);
+
+  pjson_parser_rewind(&dom->parser, false);
+  pjson_arena_reset(&dom->arena);
+  dom->stack_count = 0;
+  memset(&dom->root, 0, sizeof(dom->root));
+
+  pjson_parser_context *context = dom->parser.context;
+  if (context) context->on_value = (pjson_parser_context_callback)&pjson_dom_on_toplevel_value;
+}
+
+void pjson_dom_free(pjson_dom *dom) {
+  assert(dom);
+
+  pjson_deallocate(dom->allocator, dom->stack, dom->stack_capacity * sizeof(pjson_dom_member));
+  dom->stack = NULL;
+  dom->stack_count = dom->stack_capacity = 0;
+  memset(&dom->root, 0, sizeof(dom->root));
+
+  pjson_arena_free(&dom->arena);
+  pjson_parser_free(&dom->parser);
+}
+
+const pjson_dom_value *pjson_dom_array_get(const pjson_dom_value *array, size_t index) {
+  assert(array);
+
+  return array->type == PJSON_DOM_ARRAY && index < array->count ? &array->data.items[index] : NULL;
+}
+
+const pjson_dom_value *pjson_dom_object_get(const pjson_dom_value *object, const char *name, size_t length) {
+  assert(object);
+  assert(name || length == 0);
+
+  if (object->type != PJSON_DOM_OBJECT) return NULL;
+  for (size_t i = 0; i < object->count; i++) {
+    const pjson_dom_member *member = &object->data.members[i];
+    if (member->name.length == length && (!length || !memcmp(member->name.data, name, length))) return &member->value;
+  }
+  return NULL;
+}
+
+/* On-demand cursor */
+
+// Each token is pulled by a pjson_feed call on the rest of the input, which stops as soon as the token reaches the doc
+// (a completed lazy parse, see `pjson_tokenizer.token_start`). The doc checks the grammar of what it reads. The values
+// handed out are not read until they are accessed: a value which isn't gets read as a whole by the tokenizer in skipping
+// mode (see PJSON_STATUS_SKIP), as well as what is left of the arrays and objects left behind by the caller.
+
+static pjson_parsing_status pjson_doc_eat(pjson_doc *doc, const pjson_token *token) {
+  if (doc->is_token_read) return PJSON_STATUS_COMPLETED; // the end of stream following the last token
+
+  if (doc->is_skipping && (token->type == PJSON_TOKEN_OPEN_BRACKET || token->type == PJSON_TOKEN_OPEN_BRACE)) {
+    doc->is_skipped = true;
+    return PJSON_STATUS_SKIP; // the next token is the closing one
+  }
+
+  doc->token = *token;
+  // The last token may have been buffered by the tokenizer, but it is in the input anyway.
+  doc->token.start = token->type != PJSON_TOKEN_EOS ? doc->data + token->start_index : NULL;
+  doc->is_token_read = true;
+  return PJSON_STATUS_COMPLETED;
+}
+
+static inline bool pjson_doc_error(pjson_doc *doc, pjson_parsing_status status) {
+  doc->status = pjson_report_error(&doc->tokenizer, status, doc->token.type, doc->token.start_index);
+  doc->tokenizer.state = (pjson_tokenizer_state)status; // as if the tokenizer had stopped there
+  return false;
+}
+
+/** Reads the next token. If `skip` is set, arrays and objects are skipped (the token read is the closing one). */
+static bool pjson_doc_read(pjson_doc *doc, bool skip) {
+  if (doc->status != PJSON_STATUS_SUCCESS) return false;
+
+  doc->is_skipping = skip;
+  doc->is_skipped = doc->is_token_read = false;
+  pjson_parsing_status status = PJSON_STATUS_COMPLETED;
+  if (!doc->is_closed) {
+    const size_t index = doc->tokenizer.index;
+    status = pjson_feed(&doc->tokenizer, doc->data + index, doc->length - index);
+    if (status == PJSON_STATUS_DATA_NEEDED) {
+      doc->is_closed = true;
+      status = pjson_close(&doc->tokenizer); // emits the number or keyword ending the input (if any), and the end of stream
+    }
+    if (status != PJSON_STATUS_COMPLETED) {
+      doc->status = status;
+      return false;
+    }
+  }
+  if (!doc->is_token_read) {
+    doc->token.type = PJSON_TOKEN_EOS;
+    doc->token.start_index = doc->tokenizer.index;
+    doc->token.start = NULL;
+    doc->token.length = doc->token.unescaped_length = 0;
+    doc->is_token_read = true;
+  }
+
+  if (doc->is_skipped) return true;
+  switch (doc->token.type) {
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      doc->depth++;
+      return true;
+
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      if (!doc->depth) return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+      doc->depth--;
+      return true;
+
+    default:
+      return true;
+  }
+}
+
+/** Returns the byte beginning the next token (0 at the end of the input). */
+static uint8_t pjson_doc_peek(const pjson_doc *doc) {
+  const uint8_t *end = doc->data + doc->length;
+  const uint8_t *p = doc->is_closed ? end : skip_whitespace(doc->tokenizer.kernels, doc->data + doc->tokenizer.index, end);
+  return p < end ? *p : 0;
+}
+
+/** Hands out the value beginning with the next token. */
+static void pjson_doc_push_value(pjson_doc *doc, pjson_value *value) {
+  value->doc = doc;
+  value->index = doc->pending_value = ++doc->value_count;
+  value->depth = doc->depth;
+  memset(&value->token, 0, sizeof(value->token));
+}
+
+/** Skips the values handed out but not accessed, and what is left of the arrays and objects deeper than `depth`. */
+static bool pjson_doc_skip_to(pjson_doc *doc, size_t depth) {
+  if (doc->pending_value) {
+    doc->pending_value = 0;
+    if (!pjson_doc_read(doc, true)) return false;
+    if (!doc->is_skipped && (doc->token.type < PJSON_TOKEN_NULL || doc->token.type > PJSON_TOKEN_STRING)) {
+      return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+    }
+    doc->is_after_value = true;
+  }
+
+  while (doc->depth > depth) {
+    if (!pjson_doc_read(doc, true)) return false;
+    if (doc->token.type == PJSON_TOKEN_EOS) return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+    doc->is_after_value = true; // only matters once a closing token is read
+  }
+  return true;
+}
+
+/** Reads the first token of a value, unless it's been read already. */
+static bool pjson_value_start(pjson_value *value) {
+  assert(value && value->doc);
+
+  pjson_doc *doc = value->doc;
+  if (value->token.type != PJSON_TOKEN_NONE) return true;
+  if (doc->status != PJSON_STATUS_SUCCESS) return false;
+  if (doc->pending_value != value->index) return pjson_doc_error(doc, PJSON_STATUS_USER_ERROR);
+
+  doc->pending_value = 0;
+  if (!pjson_doc_read(doc, false)) return false;
+
+  switch (doc->token.type) {
+    case PJSON_TOKEN_NULL:
+    case PJSON_TOKEN_FALSE:
+    case PJSON_TOKEN_TRUE:
+    case PJSON_TOKEN_NUMBER:
+    case PJSON_TOKEN_STRING:
+      doc->is_after_value = true;
+      break;
+
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      doc->is_after_value = false;
+      break;
+
+    case PJSON_TOKEN_EOS:
+      return pjson_doc_error(doc, value->index == 1 ? PJSON_STATUS_NO_TOKENS_FOUND : PJSON_STATUS_SYNTAX_ERROR);
+
+    default:
+      return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+  }
+
+  value->token = doc->token;
+  return true;
+}
+
+/** Moves to the content of an array or object (skipping its values left behind), unless it has ended. */
+static bool pjson_value_enter(pjson_value *value, pjson_token_type type) {
+  if (!pjson_value_start(value)) return false;
+
+  pjson_doc *doc = value->doc;
+  if (value->token.type != type) return pjson_doc_error(doc, PJSON_STATUS_USER_ERROR);
+  return pjson_doc_skip_to(doc, value->depth + 1) && doc->depth > value->depth;
+}
+
+void pjson_doc_open(pjson_doc *doc, const uint8_t *data, size_t length, const pjson_tokenizer_options *options,
+  pjson_value *root) {
+  assert(doc);
+  assert(data || length == 0);
+  assert(root);
+
+  memset(doc, 0, sizeof(*doc));
+  doc->base.eat = (pjson_parser_eat)&pjson_doc_eat;
+  doc->data = data;
+  doc->length = length;
+
+  pjson_tokenizer_options tokenizer_options = { 0 };
+  if (options) tokenizer_options = *options;
+  tokenizer_options.unescape_strings = tokenizer_options.scatter_strings = false;
+  tokenizer_options.string_chunk_handler = NULL;
+  pjson_init_ex(&doc->tokenizer, &doc->base, &tokenizer_options);
+
+  pjson_doc_push_value(doc, root);
+}
+
+pjson_parsing_status pjson_doc_close(pjson_doc *doc) {
+  assert(doc);
+
+  if (pjson_doc_skip_to(doc, 0) && pjson_doc_read(doc, true) && doc->token.type != PJSON_TOKEN_EOS) {
+    pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+  }
+  if (!doc->is_closed) {
+    doc->is_closed = true;
+    pjson_close(&doc->tokenizer);
+  }
+  return doc->status != PJSON_STATUS_SUCCESS ? doc->status : PJSON_STATUS_COMPLETED;
+}
+
+bool pjson_arr_next(pjson_value *array, pjson_value *item) {
+  assert(item);
+
+  if (!pjson_value_enter(array, PJSON_TOKEN_OPEN_BRACKET)) return false;
+
+  pjson_doc *doc = array->doc;
+  if (doc->is_after_value || pjson_doc_peek(doc) == ']') {
+    if (!pjson_doc_read(doc, false)) return false;
+    if (doc->token.type == PJSON_TOKEN_CLOSE_BRACKET) {
+      doc->is_after_value = true;
+      return false;
+    }
+    if (doc->token.type != PJSON_TOKEN_COMMA || !doc->is_after_value) return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+  }
+
+  pjson_doc_push_value(doc, item);
+  return true;
+}
+
+bool pjson_obj_next_field(pjson_value *object, pjson_token *name, pjson_value *value) {
+  assert(value);
+
+  if (!pjson_value_enter(object, PJSON_TOKEN_OPEN_BRACE)) return false;
+
+  pjson_doc *doc = object->doc;
+  if (!pjson_doc_read(doc, false)) return false;
+  if (doc->token.type == PJSON_TOKEN_CLOSE_BRACE) {
+    doc->is_after_value = true;
+    return false;
+  }
+  if (doc->is_after_value) {
+    if (doc->token.type != PJSON_TOKEN_COMMA) return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+    if (!pjson_doc_read(doc, false)) return false;
+  }
+  if (doc->token.type != PJSON_TOKEN_STRING) return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+  if (name) *name = doc->token;
+
+  if (!pjson_doc_read(doc, false)) return false;
+  if (doc->token.type != PJSON_TOKEN_COLON) return pjson_doc_error(doc, PJSON_STATUS_SYNTAX_ERROR);
+
+  pjson_doc_push_value(doc, value);
+  return true;
+}
+
+static bool pjson_doc_name_equals(pjson_doc *doc, const pjson_token *token, const char *name, size_t length) {
+  if (token->unescaped_length != length) return false;
+  if (token->length - 2 == length) return !length || !memcmp(token->start + 1, name, length); // no escape sequences
+
+  uint8_t fixed_size_buf[256];
+  uint8_t *buf = fixed_size_buf;
+  if (length > sizeof(fixed_size_buf) && !(buf = pjson_allocate(doc->tokenizer.allocator, length))) {
+    return pjson_doc_error(doc, PJSON_STATUS_OUT_OF_MEMORY);
+  }
+
+  bool is_equal = pjson_parse_string(buf, length, token->start, token->length, true) && !memcmp(buf, name, length);
+
+  if (buf != fixed_size_buf) pjson_deallocate(doc->tokenizer.allocator, buf, length);
+  return is_equal;
+}
+
+bool pjson_obj_find_field(pjson_value *object, const char *name, size_t length, pjson_value *value) {
+  assert(name || length == 0);
+
+  pjson_token token;
+  while (pjson_obj_next_field(object, &token, value)) {
+    if (pjson_doc_name_equals(object->doc, &token, name, length)) return true;
+    if (object->doc->status != PJSON_STATUS_SUCCESS) return false;
+  }
+  return false;
+}
+
+pjson_token_type pjson_value_get_type(pjson_value *value) {
+  return pjson_value_start(value) ? value->token.type : PJSON_TOKEN_ERROR;
+}
+
+bool pjson_value_get_bool(pjson_value *value, bool *result) {
+  assert(result);
+
+  if (!pjson_value_start(value)) return false;
+  if (value->token.type != PJSON_TOKEN_TRUE && value->token.type != PJSON_TOKEN_FALSE) return false;
+  *result = value->token.type == PJSON_TOKEN_TRUE;
+  return true;
+}
+
+bool pjson_value_get_int64(pjson_value *value, int64_t *num) {
+  assert(num);
+
+  return pjson_value_start(value) && value->token.type == PJSON_TOKEN_NUMBER
+    && pjson_parse_int64(num, value->token.start, value->token.length);
+}
+
+bool pjson_value_get_double(pjson_value *value, double *num) {
+  assert(num);
+
+  return pjson_value_start(value) && value->token.type == PJSON_TOKEN_NUMBER
+    && pjson_parse_double_ex(num, value->token.start, value->token.length, value->doc->tokenizer.allocator);
+}
+
+bool pjson_value_get_string(pjson_value *value, uint8_t *dest, size_t dest_size, size_t *length) {
+  assert(dest || dest_size == 0);
+
+  if (!pjson_value_start(value) || value->token.type != PJSON_TOKEN_STRING) return false;
+  if (length) *length = value->token.unescaped_length;
+  if (value->token.unescaped_length > dest_size) return false;
+  return pjson_parse_string(dest, dest_size, value->token.start, value->token.length, true);
+}
+
+/* Helpers */
+
+static inline bool is_digit(uint8_t ch) {
+  return CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_DIGIT;
+}
+
+static inline bool is_hex_digit(uint8_t ch) {
+  return CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_HEX_DIGIT;
+}
+
+static inline bool is_whitespace(uint8_t ch) {
+  return CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_WHITESPACE;
+}
+
+/** Whether `token` is a string passed to a `pjson_string_chunk_handler`, so only its position and lengths are known. */
+static inline bool is_streamed_string(const pjson_token *token) {
+  return token->type == PJSON_TOKEN_STRING && !token->start && !token->segments;
+}
+
+static inline pjson_token_type punctuator_token_type(uint8_t ch) {
+  assert(CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_STRUCTURAL);
+  switch (ch) {
+    case ':': return PJSON_TOKEN_COLON;
+    case ',': return PJSON_TOKEN_COMMA;
+    case '[': return PJSON_TOKEN_OPEN_BRACKET;
+    case ']': return PJSON_TOKEN_CLOSE_BRACKET;
+    case '{': return PJSON_TOKEN_OPEN_BRACE;
+    default: return PJSON_TOKEN_CLOSE_BRACE;
+  }
+}
+
+static inline unsigned bit_scan_forward32(uint32_t x) {
+  assert(x != 0);
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, x);
+  return (unsigned)index;
+#else
+  return (unsigned)__builtin_ctz(x);
+#endif
+}
+
+static inline unsigned bit_scan_forward64(uint64_t x) {
+  assert(x != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return (unsigned)index;
+#elif defined(_MSC_VER)
+  return (uint32_t)x ? bit_scan_forward32((uint32_t)x) : 32 + bit_scan_forward32((uint32_t)(x >> 32));
+#else
+  return (unsigned)__builtin_ctzll(x);
+#endif
+}
+
+#if defined(PJSON_LITTLE_ENDIAN)
+#define PJSON_SWAR
+
+// SWAR (SIMD within a register) helpers for the portable kernels.
+
+#define SWAR_BROADCAST(ch) ((uint64_t)0x0101010101010101u * (uint8_t)(ch))
+#define SWAR_HIGH_BITS SWAR_BROADCAST(0x80)
+#define SWAR_LOW_BITS SWAR_BROADCAST(0x7F)
+
+/**
+ * Return a mask which has the high bit set in every zero byte of `x` and all other bits cleared.
+ * (Unlike the well-known `(x - 0x01..) & ~x & 0x80..` trick, this doesn't produce false positives.)
+ */
+static inline uint64_t swar_zero_bytes(uint64_t x) {
+  return ~(((x & SWAR_LOW_BITS) + SWAR_LOW_BITS) | x | SWAR_LOW_BITS);
+}
+
+static inline uint64_t swar_load(const uint8_t *p) {
+  uint64_t x;
+  memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+static inline unsigned swar_first_byte_index(uint64_t mask) {
+  assert(mask != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return (unsigned)index >> 3;
+#elif defined(_MSC_VER)
+  return (uint32_t)mask ? bit_scan_forward32((uint32_t)mask) >> 3 : 4 + (bit_scan_forward32((uint32_t)(mask >> 32)) >> 3);
+#else
+  return (unsigned)__builtin_ctzll(mask) >> 3;
+#endif
+}
+
+/**
+ * Return a mask which has the high bit set in every non-whitespace byte of `x` and all other bits cleared.
+ */
+static inline uint64_t swar_non_whitespace_bytes(uint64_t x) {
+  const uint64_t ws =
+    swar_zero_bytes(x ^ SWAR_BROADCAST('\x20')) | swar_zero_bytes(x ^ SWAR_BROADCAST('\t'))
+    | swar_zero_bytes(x ^ SWAR_BROADCAST('\r')) | swar_zero_bytes(x ^ SWAR_BROADCAST('\n'));
+  return ~ws & SWAR_HIGH_BITS;
+}
+
+/**
+ * Return a mask which has the high bit set in every byte of `x` which is a quotation mark, a backslash,
+ * a control character or (if `include_non_ascii` is true) a non-ASCII byte, and all other bits cleared.
+ */
+static inline uint64_t swar_string_special_bytes(uint64_t x, bool include_non_ascii) {
+  const uint64_t control_or_non_ascii = ~((x & SWAR_LOW_BITS) + SWAR_BROADCAST(0x80 - 0x20));
+  return (swar_zero_bytes(x ^ SWAR_BROADCAST('"')) | swar_zero_bytes(x ^ SWAR_BROADCAST('\\'))
+    | (include_non_ascii ? control_or_non_ascii | x : control_or_non_ascii & ~x)) & SWAR_HIGH_BITS;
+}
+
+/**
+ * Return a mask which has the high bit set in every byte of `x` which is a quotation mark, a bracket or a brace,
+ * and all other bits cleared.
+ */
+static inline uint64_t swar_skipped_value_special_bytes(uint64_t x) {
+  const uint64_t bracket = x | SWAR_BROADCAST(0x20); // maps '[' to '{' and ']' to '}'
+  return (swar_zero_bytes(x ^ SWAR_BROADCAST('"'))
+    | swar_zero_bytes(bracket ^ SWAR_BROADCAST('{')) | swar_zero_bytes(bracket ^ SWAR_BROADCAST('}'))) & SWAR_HIGH_BITS;
+}
+
+/**
+ * Gather the high bits of the bytes of `mask` into the low 8 bits of the result (i.e. the SWAR equivalent of movemask).
+ */
+static inline uint64_t swar_gather_high_bits(uint64_t mask) {
+  return ((mask & SWAR_HIGH_BITS) >> 7) * 0x0102040810204080u >> 56;
+}
+#endif
+
+// The scanning kernels below come in several flavors: a portable one (SWAR on little endian platforms) and, on x86,
+// ones for each supported instruction set extension. The tokenizer calls them through the kernel table selected by
+// pjson_init (see pjson_set_kernel_level), so each flavor must produce exactly the same result.
+
+/**
+ * Return a pointer to the first non-whitespace byte in the range `[p, end)` or `end` if there is no such byte.
+ */
+static const uint8_t *skip_whitespace_scalar(const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_SWAR)
+  for (; end - p >= 8; p += 8) {
+    const uint64_t mask = swar_non_whitespace_bytes(swar_load(p));
+    if (mask) return p + swar_first_byte_index(mask);
+  }
+#endif
+
+  while (p < end && is_whitespace(*p)) p++;
+  return p;
+}
+
+/**
+ * Return a pointer to the first byte in the range `[p, end)` which can't be consumed as a plain ASCII string character
+ * (i.e. a quotation mark, a backslash, a control character or a non-ASCII byte), or `end` if there is no such byte.
+ */
+static const uint8_t *scan_string_ascii_run_scalar(const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_SWAR)
+  for (; end - p >= 8; p += 8) {
+    const uint64_t mask = swar_string_special_bytes(swar_load(p), true);
+    if (mask) return p + swar_first_byte_index(mask);
+  }
+#endif
+
+  for (; p < end; p++) {
+    const uint8_t ch = *p;
+    if ((CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_STRING_SPECIAL) || ch >= 0x80) break;
+  }
+  return p;
+}
+
+/**
+ * Return a pointer to the first byte in the range `[p, end)` which terminates a span of unescaped string content
+ * (i.e. a quotation mark, a backslash or a control character), or `end` if there is no such byte.
+ */
+static const uint8_t *scan_string_span_scalar(const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_SWAR)
+  for (; end - p >= 8; p += 8) {
+    const uint64_t mask = swar_string_special_bytes(swar_load(p), false);
+    if (mask) return p + swar_first_byte_index(mask);
+  }
+#endif
+
+  for (; p < end; p++) {
+    const uint8_t ch = *p;
+    if (CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_STRING_SPECIAL) break;
+  }
+  return p;
+}
+
+static inline bool is_skipped_value_special(uint8_t ch) {
+  return ch == '"' || (ch | 0x20) == '{' || (ch | 0x20) == '}';
+}
+
+/**
+ * Return a pointer to the first byte in the range `[p, end)` which matters when skipping a value (i.e. a quotation
+ * mark, a bracket or a brace), or `end` if there is no such byte.
+ */
+static const uint8_t *scan_skipped_value_scalar(const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_SWAR)
+  for (; end - p >= 8; p += 8) {
+    const uint64_t mask = swar_skipped_value_special_bytes(swar_load(p));
+    if (mask) return p + swar_first_byte_index(mask);
+  }
+#endif
+
+  while (p < end && !is_skipped_value_special(*p)) p++;
+  return p;
+}
+
+/**
+ * Classify the 64 bytes starting at `p` (see block_masks).
+ */
+static inline void classify_block_scalar(const uint8_t *p, block_masks *masks) {
+  block_masks m = { 0 };
+#if defined(PJSON_SWAR)
+  for (unsigned i = 0; i < 64; i += 8) {
+    const uint64_t x = swar_load(p + i);
+    const uint64_t bracket = x | SWAR_BROADCAST(0x20); // maps '[' to '{' and ']' to '}'
+    const uint64_t ws =
+      swar_zero_bytes(x ^ SWAR_BROADCAST('\x20')) | swar_zero_bytes(x ^ SWAR_BROADCAST('\t'))
+      | swar_zero_bytes(x ^ SWAR_BROADCAST('\r')) | swar_zero_bytes(x ^ SWAR_BROADCAST('\n'));
+    const uint64_t control = ~((x & SWAR_LOW_BITS) + SWAR_BROADCAST(0x80 - 0x20)) & ~x;
+    m.quote |= swar_gather_high_bits(swar_zero_bytes(x ^ SWAR_BROADCAST('"'))) << i;
+    m.backslash |= swar_gather_high_bits(swar_zero_bytes(x ^ SWAR_BROADCAST('\\'))) << i;
+    m.punctuator |= swar_gather_high_bits(
+      swar_zero_bytes(x ^ SWAR_BROADCAST(':')) | swar_zero_bytes(x ^ SWAR_BROADCAST(','))
+      | swar_zero_bytes(bracket ^ SWAR_BROADCAST('{')) | swar_zero_bytes(bracket ^ SWAR_BROADCAST('}'))) << i;
+    m.whitespace |= swar_gather_high_bits(ws) << i;
+    m.control |= swar_gather_high_bits(control) << i;
+  }
+#else
+  for (unsigned i = 0; i < 64; i++) {
+    const uint8_t ch = p[i];
+    const uint64_t bit = (uint64_t)1 << i;
+    if (ch == '"') m.quote |= bit;
+    else if (ch == '\\') m.backslash |= bit;
+    else if (CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_STRUCTURAL) m.punctuator |= bit;
+    if (CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_WHITESPACE) m.whitespace |= bit;
+    if (ch < 0x20) m.control |= bit;
+  }
+#endif
+  *masks = m;
+}
+
+static void index_blocks_scalar(structural_index *si) {
+  uint8_t padded_block[64];
+  block_masks masks;
+  for (const uint8_t *block; (block = structural_index_next_block(si, padded_block)); ) {
+    classify_block_scalar(block, &masks);
+    structural_index_add_block(si, &masks);
+  }
+}
+
+#if defined(PJSON_X86)
+
+// Each of the following returns a mask which has a bit set for every byte of `x` that the corresponding scalar
+// function stops at.
+
+PJSON_TARGET("sse2")
+static inline uint32_t sse2_non_whitespace_mask(__m128i x) {
+  const __m128i ws = _mm_or_si128(
+    _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\x20')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+    _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))));
+  return ~(uint32_t)_mm_movemask_epi8(ws) & 0xFFFF;
+}
+
+PJSON_TARGET("sse2")
+static inline uint32_t sse2_string_special_or_non_ascii_mask(__m128i x) {
+  const __m128i special = _mm_or_si128(
+    _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))),
+    _mm_cmplt_epi8(x, _mm_set1_epi8('\x20'))); // signed comparison, matches both control characters and non-ASCII bytes
+  return (uint32_t)_mm_movemask_epi8(special);
+}
+
+PJSON_TARGET("sse2")
+static inline uint32_t sse2_string_special_mask(__m128i x) {
+  const __m128i special = _mm_or_si128(
+    _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))),
+    _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x)); // unsigned comparison, matches control characters only
+  return (uint32_t)_mm_movemask_epi8(special);
+}
+
+PJSON_TARGET("sse2")
+static inline uint32_t sse2_skipped_value_special_mask(__m128i x) {
+  const __m128i bracket = _mm_or_si128(x, _mm_set1_epi8(0x20)); // maps '[' to '{' and ']' to '}'
+  const __m128i special = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')),
+    _mm_or_si128(_mm_cmpeq_epi8(bracket, _mm_set1_epi8('{')), _mm_cmpeq_epi8(bracket, _mm_set1_epi8('}'))));
+  return (uint32_t)_mm_movemask_epi8(special);
+}
+
+PJSON_TARGET("avx2")
+static inline uint32_t avx2_non_whitespace_mask(__m256i x) {
+  const __m256i ws = _mm256_or_si256(
+    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\x20')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))),
+    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'))));
+  return ~(uint32_t)_mm256_movemask_epi8(ws);
+}
+
+PJSON_TARGET("avx2")
+static inline uint32_t avx2_string_special_or_non_ascii_mask(__m256i x) {
+  const __m256i special = _mm256_or_si256(
+    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))),
+    _mm256_cmpgt_epi8(_mm256_set1_epi8('\x20'), x)); // signed comparison, matches both control characters and non-ASCII bytes
+  return (uint32_t)_mm256_movemask_epi8(special);
+}
+
+PJSON_TARGET("avx2")
+static inline uint32_t avx2_string_special_mask(__m256i x) {
+  const __m256i special = _mm256_or_si256(
+    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))),
+    _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x1F)), x)); // unsigned comparison, matches control characters only
+  return (uint32_t)_mm256_movemask_epi8(special);
+}
+
+PJSON_TARGET("avx2")
+static inline uint32_t avx2_skipped_value_special_mask(__m256i x) {
+  const __m256i bracket = _mm256_or_si256(x, _mm256_set1_epi8(0x20)); // maps '[' to '{' and ']' to '}'
+  const __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+    _mm256_or_si256(_mm256_cmpeq_epi8(bracket, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(bracket, _mm256_set1_epi8('}'))));
+  return (uint32_t)_mm256_movemask_epi8(special);
+}
+
+PJSON_TARGET("sse2")
+static const uint8_t *skip_whitespace_sse2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 16; p += 16) {
+    const uint32_t mask = sse2_non_whitespace_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  while (p < end && is_whitespace(*p)) p++;
+  return p;
+}
+
+PJSON_TARGET("sse2")
+static const uint8_t *scan_string_ascii_run_sse2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 16; p += 16) {
+    const uint32_t mask = sse2_string_special_or_non_ascii_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  for (; p < end; p++) {
+    const uint8_t ch = *p;
+    if ((CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_STRING_SPECIAL) || ch >= 0x80) break;
+  }
+  return p;
+}
+
+PJSON_TARGET("sse2")
+static const uint8_t *scan_string_span_sse2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 16; p += 16) {
+    const uint32_t mask = sse2_string_special_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  for (; p < end; p++) {
+    const uint8_t ch = *p;
+    if (CHAR_CLASS_LOOKUP[ch] & CHAR_CLASS_STRING_SPECIAL) break;
+  }
+  return p;
+}
+
+PJSON_TARGET("sse2")
+static const uint8_t *scan_skipped_value_sse2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 16; p += 16) {
+    const uint32_t mask = sse2_skipped_value_special_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  while (p < end && !is_skipped_value_special(*p)) p++;
+  return p;
+}
+
+PJSON_TARGET("avx2")
+static const uint8_t *skip_whitespace_avx2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 32; p += 32) {
+    const uint32_t mask = avx2_non_whitespace_mask(_mm256_loadu_si256((const __m256i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  return skip_whitespace_sse2(p, end);
+}
+
+PJSON_TARGET("avx2")
+static const uint8_t *scan_string_ascii_run_avx2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 32; p += 32) {
+    const uint32_t mask = avx2_string_special_or_non_ascii_mask(_mm256_loadu_si256((const __m256i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  return scan_string_ascii_run_sse2(p, end);
+}
+
+PJSON_TARGET("avx2")
+static const uint8_t *scan_string_span_avx2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 32; p += 32) {
+    const uint32_t mask = avx2_string_special_mask(_mm256_loadu_si256((const __m256i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  return scan_string_span_sse2(p, end);
+}
+
+PJSON_TARGET("avx2")
+static const uint8_t *scan_skipped_value_avx2(const uint8_t *p, const uint8_t *end) {
+  for (; end - p >= 32; p += 32) {
+    const uint32_t mask = avx2_skipped_value_special_mask(_mm256_loadu_si256((const __m256i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+  }
+
+  return scan_skipped_value_sse2(p, end);
+}
+
+PJSON_TARGET("sse2")
+static inline void classify_block_sse2(const uint8_t *p, block_masks *masks) {
+  block_masks m = { 0 };
+  for (unsigned i = 0; i < 64; i += 16) {
+    const __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+    const __m128i bracket = _mm_or_si128(x, _mm_set1_epi8(0x20)); // maps '[' to '{' and ']' to '}'
+    const __m128i ws = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\x20')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))));
+    const __m128i punctuator = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')), _mm_cmpeq_epi8(x, _mm_set1_epi8(','))),
+      _mm_or_si128(_mm_cmpeq_epi8(bracket, _mm_set1_epi8('{')), _mm_cmpeq_epi8(bracket, _mm_set1_epi8('}'))));
+    const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x);
+    m.quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('"'))) << i;
+    m.backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))) << i;
+    m.punctuator |= (uint64_t)(uint32_t)_mm_movemask_epi8(punctuator) << i;
+    m.whitespace |= (uint64_t)(uint32_t)_mm_movemask_epi8(ws) << i;
+    m.control |= (uint64_t)(uint32_t)_mm_movemask_epi8(control) << i;
+  }
+  *masks = m;
+}
+
+// With PSHUFB, whitespace and punctuators can be matched by looking up the only candidate for the low nibble of
+// each byte in a table and comparing the result with the byte itself. (Bytes with the high bit set are looked up
+// as zero, so they never match.) The low nibbles of whitespace characters are unique, and so are those of
+// punctuators if '[' and ']' are mapped to '{' and '}' by setting bit 5, which leaves the rest of them unchanged.
+// The remaining table entries are chosen so that they can't match any byte having the corresponding low nibble.
+
+#define WHITESPACE_NIBBLE_LOOKUP \
+  '\x20', 0x64, 0x64, 0x64, 0x11, 0x64, 0x71, 0x02, 0x64, '\t', '\n', 0x70, 0x64, '\r', 0x64, 0x64
+#define PUNCTUATOR_NIBBLE_LOOKUP \
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0
+
+PJSON_TARGET("ssse3")
+static inline void classify_block_ssse3(const uint8_t *p, block_masks *masks) {
+  const __m128i whitespace_lookup = _mm_setr_epi8(WHITESPACE_NIBBLE_LOOKUP);
+  const __m128i punctuator_lookup = _mm_setr_epi8(PUNCTUATOR_NIBBLE_LOOKUP);
+
+  block_masks m = { 0 };
+  for (unsigned i = 0; i < 64; i += 16) {
+    const __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+    const __m128i ws = _mm_cmpeq_epi8(x, _mm_shuffle_epi8(whitespace_lookup, x));
+    const __m128i punctuator = _mm_cmpeq_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_shuffle_epi8(punctuator_lookup, x));
+    const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x);
+    m.quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('"'))) << i;
+    m.backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))) << i;
+    m.punctuator |= (uint64_t)(uint32_t)_mm_movemask_epi8(punctuator) << i;
+    m.whitespace |= (uint64_t)(uint32_t)_mm_movemask_epi8(ws) << i;
+    m.control |= (uint64_t)(uint32_t)_mm_movemask_epi8(control) << i;
+  }
+  *masks = m;
+}
 
-  pjson_parser_context *new_context = (pjson_parser_context *)parser->peek_context(parser, false);
-  memset(new_context, 0, sizeof(*new_context));
+PJSON_TARGET("avx2")
+static inline void classify_block_avx2(const uint8_t *p, block_masks *masks) {
+  const __m256i whitespace_lookup = _mm256_setr_epi8(WHITESPACE_NIBBLE_LOOKUP, WHITESPACE_NIBBLE_LOOKUP);
+  const __m256i punctuator_lookup = _mm256_setr_epi8(PUNCTUATOR_NIBBLE_LOOKUP, PUNCTUATOR_NIBBLE_LOOKUP);
+
+  block_masks m = { 0 };
+  for (unsigned i = 0; i < 64; i += 32) {
+    const __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+    const __m256i ws = _mm256_cmpeq_epi8(x, _mm256_shuffle_epi8(whitespace_lookup, x));
+    const __m256i punctuator = _mm256_cmpeq_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_shuffle_epi8(punctuator_lookup, x));
+    const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x1F)), x);
+    m.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'))) << i;
+    m.backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))) << i;
+    m.punctuator |= (uint64_t)(uint32_t)_mm256_movemask_epi8(punctuator) << i;
+    m.whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << i;
+    m.control |= (uint64_t)(uint32_t)_mm256_movemask_epi8(control) << i;
+  }
+  *masks = m;
+}
 
-  context = (pjson_parser_context *)parser->peek_context(parser, true);
-  assert(context);
-  context->next_eat = complex_value_next_eat;
+#undef PUNCTUATOR_NIBBLE_LOOKUP
+#undef WHITESPACE_NIBBLE_LOOKUP
 
-  if (context->on_value
-    && (status = context->on_value(parser, context, token)) != PJSON_STATUS_SUCCESS) {
-    goto Error;
+PJSON_TARGET("sse2")
+static void index_blocks_sse2(structural_index *si) {
+  uint8_t padded_block[64];
+  block_masks masks;
+  for (const uint8_t *block; (block = structural_index_next_block(si, padded_block)); ) {
+    classify_block_sse2(block, &masks);
+    structural_index_add_block(si, &masks);
   }
+}
 
-  parser->base.eat = parser_next_eat;
-  return PJSON_STATUS_DATA_NEEDED;
+PJSON_TARGET("ssse3")
+static void index_blocks_ssse3(structural_index *si) {
+  uint8_t padded_block[64];
+  block_masks masks;
+  for (const uint8_t *block; (block = structural_index_next_block(si, padded_block)); ) {
+    classify_block_ssse3(block, &masks);
+    structural_index_add_block(si, &masks);
+  }
+}
 
-Error:
-  return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status;
+PJSON_TARGET("avx2")
+static void index_blocks_avx2(structural_index *si) {
+  uint8_t padded_block[64];
+  block_masks masks;
+  for (const uint8_t *block; (block = structural_index_next_block(si, padded_block)); ) {
+    classify_block_avx2(block, &masks);
+    structural_index_add_block(si, &masks);
+  }
 }
 
-static inline pjson_parsing_status pjson_end_complex_value(pjson_parser *parser, const pjson_token *token) {
-  pjson_parser_context *context = (pjson_parser_context *)parser->peek_context(parser, true);
-  assert(context);
+#endif
 
-  pjson_parsing_status status;
-  if (context->on_value
-    && (status = context->on_value(parser, context, token)) != PJSON_STATUS_SUCCESS) {
-    return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status;
+// Runs of whitespace and plain string characters are usually short (a single space after a colon, an object key, etc.)
+// The following wrappers look at the first 16 bytes inline and invoke the selected kernel for longer runs only,
+// so short runs don't pay for an indirect call.
+
+static inline const uint8_t *skip_whitespace(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_X86_SSE2_BASELINE)
+  if (end - p >= 16 && kernels->level >= PJSON_KERNEL_SSE2) {
+    const uint32_t mask = sse2_non_whitespace_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+    p += 16;
   }
+#elif defined(PJSON_SWAR)
+  for (const uint8_t *probe_end = p + 16; p < probe_end && end - p >= 8; p += 8) {
+    const uint64_t mask = swar_non_whitespace_bytes(swar_load(p));
+    if (mask) return p + swar_first_byte_index(mask);
+  }
+#endif
+  return kernels->skip_whitespace(p, end);
+}
 
-  pjson_parser_eat next_eat = context->next_eat;
-  context->next_eat = NULL;
+static inline const uint8_t *scan_string_ascii_run(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_X86_SSE2_BASELINE)
+  if (end - p >= 16 && kernels->level >= PJSON_KERNEL_SSE2) {
+    const uint32_t mask = sse2_string_special_or_non_ascii_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+    p += 16;
+  }
+#elif defined(PJSON_SWAR)
+  for (const uint8_t *probe_end = p + 16; p < probe_end && end - p >= 8; p += 8) {
+    const uint64_t mask = swar_string_special_bytes(swar_load(p), true);
+    if (mask) return p + swar_first_byte_index(mask);
+  }
+#endif
+  return kernels->scan_string_ascii_run(p, end);
+}
 
-  parser->pop_context(parser);
+static inline const uint8_t *scan_string_span(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_X86_SSE2_BASELINE)
+  if (end - p >= 16 && kernels->level >= PJSON_KERNEL_SSE2) {
+    const uint32_t mask = sse2_string_special_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+    p += 16;
+  }
+#elif defined(PJSON_SWAR)
+  for (const uint8_t *probe_end = p + 16; p < probe_end && end - p >= 8; p += 8) {
+    const uint64_t mask = swar_string_special_bytes(swar_load(p), false);
+    if (mask) return p + swar_first_byte_index(mask);
+  }
+#endif
+  return kernels->scan_string_span(p, end);
+}
 
-  if (next_eat) {
-    parser->base.eat = next_eat;
-    return PJSON_STATUS_DATA_NEEDED;
+static inline const uint8_t *scan_skipped_value(const pjson_kernels *kernels, const uint8_t *p, const uint8_t *end) {
+#if defined(PJSON_X86_SSE2_BASELINE)
+  if (end - p >= 16 && kernels->level >= PJSON_KERNEL_SSE2) {
+    const uint32_t mask = sse2_skipped_value_special_mask(_mm_loadu_si128((const __m128i *)p));
+    if (mask) return p + bit_scan_forward32(mask);
+    p += 16;
   }
-  else {
-    parser->base.eat = (pjson_parser_eat)&pjson_eat_eos;
-    return PJSON_STATUS_COMPLETED;
+#elif defined(PJSON_SWAR)
+  for (const uint8_t *probe_end = p + 16; p < probe_end && end - p >= 8; p += 8) {
+    const uint64_t mask = swar_skipped_value_special_bytes(swar_load(p));
+    if (mask) return p + swar_first_byte_index(mask);
   }
+#endif
+  return kernels->scan_skipped_value(p, end);
 }
 
-static pjson_parsing_status pjson_eat_toplevel_value_greedy(pjson_parser *parser, const pjson_token *token) {
-  return pjson_eat_value(parser, token,
-    (pjson_parser_eat)&pjson_eat_eos,
-    (pjson_parser_eat)&pjson_eat_eos,
-    PJSON_STATUS_DATA_NEEDED,
-    PJSON_STATUS_NO_TOKENS_FOUND);
+static inline uint8_t hex_digit_value(uint8_t ch) {
+  return (ch <= '9') ? ch - '0'
+    : (ch <= 'F') ? ch - ('A' - 10)
+    : ch - ('a' - 10);
 }
 
-static pjson_parsing_status pjson_eat_toplevel_value_lazy(pjson_parser *parser, const pjson_token *token) {
-  return pjson_eat_value(parser, token,
-    (pjson_parser_eat)&pjson_eat_eos,
-    NULL, // used to indicate lazy parsing to `pjson_end_complex_value`
-    PJSON_STATUS_COMPLETED,
-    PJSON_STATUS_NO_TOKENS_FOUND);
+static inline bool is_in_range(uint16_t cp, uint16_t min, uint16_t max) {
+  assert(min <= max);
+  return (uint32_t)(cp - (uint32_t)min) <= (uint32_t)(max - (uint32_t)min);
 }
 
-static pjson_parsing_status pjson_eat_array_element_or_end(pjson_parser *parser, const pjson_token *token) {
-  return token->type != PJSON_TOKEN_CLOSE_BRACKET
-    ? pjson_eat_array_element(parser, token)
-    : pjson_end_complex_value(parser, token);
+#define UTF8_ERROR (-1)
+
+/**
+ * Get the 6-bit payload of the next continuation byte.
+ * Return UTF8_ERROR if it is not a contination byte.
+ */
+static inline int16_t utf8_cont_payload(uint8_t ch) {
+  return ((ch & 0xC0) == 0x80) ? (ch & 0x3F) : UTF8_ERROR;
 }
 
-static pjson_parsing_status pjson_eat_array_element(pjson_parser *parser, const pjson_token *token) {
-  return pjson_eat_value(parser, token,
-    (pjson_parser_eat)&pjson_eat_array_element_separator_or_end,
-    (pjson_parser_eat)&pjson_eat_array_element_separator_or_end,
-    PJSON_STATUS_DATA_NEEDED,
-    PJSON_STATUS_SYNTAX_ERROR);
+/**
+ * Get the length of the sequence introduced by the lead byte `ch`.
+ * Return 0 if it is not a lead byte.
+ */
+static inline size_t utf8_sequence_length(uint8_t ch) {
+  return (ch & 0xE0) == 0xC0 ? 2
+    : (ch & 0xF0) == 0xE0 ? 3
+    : (ch & 0xF8) == 0xF0 ? 4
+    : 0;
 }
 
-static pjson_parsing_status pjson_eat_array_element_separator_or_end(pjson_parser *parser, const pjson_token *token) {
-  switch (token->type) {
-    case PJSON_TOKEN_COMMA: {
-      parser->base.eat = (pjson_parser_eat)&pjson_eat_array_element;
-      return PJSON_STATUS_DATA_NEEDED;
-    }
+// UTF8 sequence validation is based on: https://www.json.org/JSON_checker/utf8_decode.c
 
-    case PJSON_TOKEN_CLOSE_BRACKET:
-      return pjson_end_complex_value(parser, token);
+/**
+ * Check whether the multi-byte sequence `seq` of `length` bytes (whose lead byte is already known to match `length`)
+ * encodes a valid code point, i.e. it is not an overlong encoding, a surrogate or a code point beyond U+10FFFF.
+ */
+static inline bool utf8_is_valid_sequence(const uint8_t *seq, size_t length) {
+  const uint8_t ch0 = seq[0];
+  const int16_t ch1 = utf8_cont_payload(seq[1]);
+  int16_t ch2, ch3;
+  uint32_t r;
+
+  switch (length) {
+    case 2:
+      if (ch1 < 0) return false;
+      r = ((ch0 & 0x1F) << 6) | (uint8_t)ch1;
+      return r >= 0x80;
+
+    case 3:
+      ch2 = utf8_cont_payload(seq[2]);
+      if ((ch1 | ch2) < 0) return false;
+      r = ((ch0 & 0x0F) << 12) | ((uint8_t)ch1 << 6) | (uint8_t)ch2;
+      return r >= 0x800 && (r < 0xD800 || r > 0xDFFF);
 
     default:
-      return PJSON_STATUS_SYNTAX_ERROR;
+      assert(length == 4);
+      ch2 = utf8_cont_payload(seq[2]);
+      ch3 = utf8_cont_payload(seq[3]);
+      if ((ch1 | ch2 | ch3) < 0) return false;
+      r = ((uint32_t)(ch0 & 0x07) << 18) | ((uint32_t)(uint8_t)ch1 << 12) | ((uint8_t)ch2 << 6) | (uint8_t)ch3;
+      return r >= 0x10000 && r <= 0x10FFFF;
   }
 }
 
-static pjson_parsing_status pjson_eat_object_property_name_or_end(pjson_parser *parser, const pjson_token *token) {
-  return token->type != PJSON_TOKEN_CLOSE_BRACE
-    ? pjson_eat_object_property_name(parser, token)
-    : pjson_end_complex_value(parser, token);
+/**
+ * Return a pointer to the start of the multi-byte sequence at the end of the range `[p, end)` if the sequence is
+ * truncated by `end` (i.e. it may be continued in the next chunk), otherwise return `end`.
+ */
+static inline const uint8_t *utf8_trim_incomplete_sequence(const uint8_t *p, const uint8_t *end) {
+  for (size_t i = 1; i <= 3 && i <= (size_t)(end - p); i++) {
+    const uint8_t ch = *(end - i);
+    if ((ch & 0xC0) != 0x80) {
+      return ch >= 0xC0 && utf8_sequence_length(ch) > i ? end - i : end;
+    }
+  }
+  return end;
 }
 
-static pjson_parsing_status pjson_eat_object_property_name(pjson_parser *parser, const pjson_token *token) {
-  if (token->type == PJSON_TOKEN_STRING) {
-    pjson_parser_context *current_context = (pjson_parser_context *)parser->peek_context(parser, false);
-    assert(current_context);
-
-    pjson_parsing_status status;
-    if (current_context->on_object_property_name
-      && (status = current_context->on_object_property_name(parser, current_context, token)) != PJSON_STATUS_SUCCESS) {
-      return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status;
+static bool utf8_validate_scalar(const uint8_t *p, const uint8_t *end) {
+  while (p < end) {
+    if (*p < 0x80) {
+      p++;
+      continue;
     }
 
-    parser->base.eat = (pjson_parser_eat)&pjson_eat_object_property_name_and_value_separator;
-    return PJSON_STATUS_DATA_NEEDED;
+    const size_t length = utf8_sequence_length(*p);
+    if (!length || (size_t)(end - p) < length || !utf8_is_valid_sequence(p, length)) return false;
+    p += length;
   }
+  return true;
+}
 
-  return PJSON_STATUS_SYNTAX_ERROR;
+#if defined(PJSON_X86)
+
+// Vectorized UTF8 validation is based on: John Keiser, Daniel Lemire: Validating UTF-8 In Less Than One Instruction Per Byte
+// (https://arxiv.org/abs/2010.03090)
+// Each byte pair is classified by looking up the high and low nibbles of the first byte and the high nibble of
+// the second byte in 16-entry tables. A pair is invalid if the three lookups have an error bit in common.
+
+#define UTF8_TOO_SHORT (1 << 0) // 11______ 0_______ or 11______ 11______
+#define UTF8_TOO_LONG (1 << 1) // 0_______ 10______
+#define UTF8_OVERLONG_3 (1 << 2) // 11100000 100_____
+#define UTF8_TOO_LARGE (1 << 3) // 11110100 1001____ or 11110100 101_____ or 11110101+ 10______
+#define UTF8_SURROGATE (1 << 4) // 11101101 101_____
+#define UTF8_OVERLONG_2 (1 << 5) // 1100000_ 10______
+#define UTF8_TOO_LARGE_1000 (1 << 6) // 11110101+ 1000____
+#define UTF8_OVERLONG_4 (1 << 6) // 11110000 1000____
+#define UTF8_TWO_CONTS (1 << 7) // 10______ 10______
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#define UTF8_BYTE_1_HIGH_LOOKUP \
+  UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+  UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+  (char)UTF8_TWO_CONTS, (char)UTF8_TWO_CONTS, (char)UTF8_TWO_CONTS, (char)UTF8_TWO_CONTS, \
+  UTF8_TOO_SHORT | UTF8_OVERLONG_2, \
+  UTF8_TOO_SHORT, \
+  UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE, \
+  UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+
+#define UTF8_BYTE_1_LOW_LOOKUP \
+  (char)(UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4), \
+  (char)(UTF8_CARRY | UTF8_OVERLONG_2), \
+  (char)UTF8_CARRY, \
+  (char)UTF8_CARRY, \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+  (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000)
+
+#define UTF8_BYTE_2_HIGH_LOOKUP \
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+  (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4), \
+  (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE), \
+  (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE), \
+  (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE), \
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+
+PJSON_TARGET("ssse3")
+static inline __m128i utf8_block_errors_128(__m128i input, __m128i prev_input) {
+  const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+  const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 16 - 1);
+  const __m128i byte_1_high = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE_1_HIGH_LOOKUP), _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask));
+  const __m128i byte_1_low = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE_1_LOW_LOOKUP), _mm_and_si128(prev1, nibble_mask));
+  const __m128i byte_2_high = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE_2_HIGH_LOOKUP), _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask));
+  const __m128i special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+  // The 3rd and 4th bytes of 3- and 4-byte sequences are the only places where two continuation bytes are allowed.
+  const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 16 - 2);
+  const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 16 - 3);
+  const __m128i is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));
+  const __m128i is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));
+  const __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8((char)0x80));
+  return _mm_xor_si128(must_be_continuation, special_cases);
 }
 
-static pjson_parsing_status pjson_eat_object_property_name_and_value_separator(pjson_parser *parser, const pjson_token *token) {
-  if (token->type == PJSON_TOKEN_COLON) {
-    parser->base.eat = (pjson_parser_eat)&pjson_eat_object_property_value;
-    return PJSON_STATUS_DATA_NEEDED;
+PJSON_TARGET("ssse3")
+static bool utf8_validate_blocks_128(const uint8_t *p, const uint8_t *end) {
+  // The last 3 bytes of a block must not start a sequence which is longer than the rest of the block.
+  const __m128i incomplete_max = _mm_setr_epi8(
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+  __m128i input, prev_input = _mm_setzero_si128(), prev_incomplete = _mm_setzero_si128(), error = _mm_setzero_si128();
+  uint8_t block[16];
+
+  for (;;) {
+    if (end - p >= 16) {
+      input = _mm_loadu_si128((const __m128i *)p);
+      p += 16;
+    }
+    else if (p < end) {
+      memset(block, 0, sizeof(block));
+      memcpy(block, p, end - p);
+      input = _mm_loadu_si128((const __m128i *)block);
+      p = end;
+    }
+    else break;
+
+    if (_mm_movemask_epi8(input)) {
+      error = _mm_or_si128(error, utf8_block_errors_128(input, prev_input));
+      prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+    }
+    else {
+      error = _mm_or_si128(error, prev_incomplete);
+      prev_incomplete = _mm_setzero_si128();
+    }
+    prev_input = input;
   }
 
-  return PJSON_STATUS_SYNTAX_ERROR;
+  error = _mm_or_si128(error, prev_incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
 }
 
-static pjson_parsing_status pjson_eat_object_property_value(pjson_parser *parser, const pjson_token *token) {
-  return pjson_eat_value(parser, token,
-    (pjson_parser_eat)&pjson_eat_object_property_separator_or_end,
-    (pjson_parser_eat)&pjson_eat_object_property_separator_or_end,
-    PJSON_STATUS_DATA_NEEDED,
-    PJSON_STATUS_SYNTAX_ERROR);
+PJSON_TARGET("avx2")
+static inline __m256i utf8_block_errors_256(__m256i input, __m256i prev_input) {
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+  const __m256i prev_input_shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+  const __m256i prev1 = _mm256_alignr_epi8(input, prev_input_shifted, 16 - 1);
+  const __m256i byte_1_high = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE_1_HIGH_LOOKUP, UTF8_BYTE_1_HIGH_LOOKUP),
+    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble_mask));
+  const __m256i byte_1_low = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE_1_LOW_LOOKUP, UTF8_BYTE_1_LOW_LOOKUP),
+    _mm256_and_si256(prev1, nibble_mask));
+  const __m256i byte_2_high = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE_2_HIGH_LOOKUP, UTF8_BYTE_2_HIGH_LOOKUP),
+    _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble_mask));
+  const __m256i special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+  const __m256i prev2 = _mm256_alignr_epi8(input, prev_input_shifted, 16 - 2);
+  const __m256i prev3 = _mm256_alignr_epi8(input, prev_input_shifted, 16 - 3);
+  const __m256i is_third_byte = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+  const __m256i is_fourth_byte = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+  const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte), _mm256_set1_epi8((char)0x80));
+  return _mm256_xor_si256(must_be_continuation, special_cases);
 }
 
-static pjson_parsing_status pjson_eat_object_property_separator_or_end(pjson_parser *parser, const pjson_token *token) {
-  switch (token->type) {
-    case PJSON_TOKEN_COMMA: {
-      parser->base.eat = (pjson_parser_eat)&pjson_eat_object_property_name;
-      return PJSON_STATUS_DATA_NEEDED;
+PJSON_TARGET("avx2")
+static bool utf8_validate_blocks_256(const uint8_t *p, const uint8_t *end) {
+  const __m256i incomplete_max = _mm256_setr_epi8(
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+  __m256i input, prev_input = _mm256_setzero_si256(), prev_incomplete = _mm256_setzero_si256(), error = _mm256_setzero_si256();
+  uint8_t block[32];
+
+  for (;;) {
+    if (end - p >= 32) {
+      input = _mm256_loadu_si256((const __m256i *)p);
+      p += 32;
     }
+    else if (p < end) {
+      memset(block, 0, sizeof(block));
+      memcpy(block, p, end - p);
+      input = _mm256_loadu_si256((const __m256i *)block);
+      p = end;
+    }
+    else break;
 
-    case PJSON_TOKEN_CLOSE_BRACE:
-      return pjson_end_complex_value(parser, token);
-
-    default:
-      return PJSON_STATUS_SYNTAX_ERROR;
+    if (_mm256_movemask_epi8(input)) {
+      error = _mm256_or_si256(error, utf8_block_errors_256(input, prev_input));
+      prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+    }
+    else {
+      error = _mm256_or_si256(error, prev_incomplete);
+      prev_incomplete = _mm256_setzero_si256();
+    }
+    prev_input = input;
   }
-}
 
-static pjson_parsing_status pjson_eat_eos(pjson_parser *parser, const pjson_token *token) {
-  (void)parser;
-  return token->type == PJSON_TOKEN_EOS ? PJSON_STATUS_COMPLETED : PJSON_STATUS_SYNTAX_ERROR;
+  error = _mm256_or_si256(error, prev_incomplete);
+  return _mm256_testz_si256(error, error);
 }
 
-void pjson_parser_init(pjson_parser *parser, bool is_lazy,
-  pjson_parser_push_context push_context,
-  pjson_parser_peek_context peek_context,
-  pjson_parser_pop_context pop_context
-) {
-  assert(parser);
-  assert(push_context);
-  assert(peek_context);
-  assert(pop_context);
-
-  memset(parser, 0, sizeof(*parser));
+// Short ranges are validated faster by the scalar implementation.
 
-  parser->push_context = push_context;
-  parser->peek_context = peek_context;
-  parser->pop_context = pop_context;
+PJSON_TARGET("ssse3")
+static bool utf8_validate_ssse3(const uint8_t *p, const uint8_t *end) {
+  return end - p >= 16 ? utf8_validate_blocks_128(p, end) : utf8_validate_scalar(p, end);
+}
 
-  pjson_parser_reset(parser, is_lazy);
+PJSON_TARGET("avx2")
+static bool utf8_validate_avx2(const uint8_t *p, const uint8_t *end) {
+  return end - p >= 32 ? utf8_validate_blocks_256(p, end) : utf8_validate_ssse3(p, end);
 }
 
-void pjson_parser_reset(pjson_parser *parser, bool is_lazy) {
-  assert(parser);
+#endif
 
-  parser->push_context(parser);
-  pjson_parser_context *context = parser->peek_context(parser, false);
-  assert(context);
-  memset(context, 0, sizeof(*context));
+/* Kernel dispatch */
+
+static const pjson_kernels KERNEL_LOOKUP[] = {
+  {
+    PJSON_KERNEL_SCALAR,
+    &skip_whitespace_scalar, &scan_string_ascii_run_scalar, &scan_string_span_scalar, &scan_skipped_value_scalar,
+    &utf8_validate_scalar,
+    &index_blocks_scalar
+  },
+#if defined(PJSON_X86)
+  {
+    PJSON_KERNEL_SSE2,
+    &skip_whitespace_sse2, &scan_string_ascii_run_sse2, &scan_string_span_sse2, &scan_skipped_value_sse2,
+    &utf8_validate_scalar,
+    &index_blocks_sse2
+  },
+  {
+    PJSON_KERNEL_SSSE3,
+    &skip_whitespace_sse2, &scan_string_ascii_run_sse2, &scan_string_span_sse2, &scan_skipped_value_sse2,
+    &utf8_validate_ssse3,
+    &index_blocks_ssse3
+  },
+  {
+    PJSON_KERNEL_AVX2,
+    &skip_whitespace_avx2, &scan_string_ascii_run_avx2, &scan_string_span_avx2, &scan_skipped_value_avx2,
+    &utf8_validate_avx2,
+    &index_blocks_avx2
+  },
+#endif
+};
 
-  parser->base.eat = (pjson_parser_eat)(!is_lazy
-    ? &pjson_eat_toplevel_value_greedy
-    : &pjson_eat_toplevel_value_lazy);
+static const char *KERNEL_LEVEL_NAME_LOOKUP[] = { "scalar", "sse2", "ssse3", "avx2" };
+
+// The selected kernels are published atomically, so that tokenizers can be initialized from several threads while the
+// kernels are selected automatically. (Racing threads select the same kernels, whichever store wins.)
+static const pjson_kernels *volatile selected_kernels;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNELS_LOAD() ((const pjson_kernels *)_InterlockedCompareExchangePointer((void *volatile *)&selected_kernels, NULL, NULL))
+#define KERNELS_STORE(kernels) ((void)_InterlockedExchangePointer((void *volatile *)&selected_kernels, (void *)(kernels)))
+#elif defined(__GNUC__) || defined(__clang__)
+#define KERNELS_LOAD() __atomic_load_n(&selected_kernels, __ATOMIC_ACQUIRE)
+#define KERNELS_STORE(kernels) __atomic_store_n(&selected_kernels, (kernels), __ATOMIC_RELEASE)
+#else
+#define KERNELS_LOAD() (selected_kernels) // aligned pointer accesses are assumed to be atomic
+#define KERNELS_STORE(kernels) ((void)(selected_kernels = (kernels)))
+#endif
+
+/**
+ * Return the highest kernel level which is supported by both the build and the CPU.
+ */
+static pjson_kernel_level detect_kernel_level(void) {
+#if defined(PJSON_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const int ecx = info[2], edx = info[3];
+  if (!(edx & (1 << 26))) return PJSON_KERNEL_SCALAR;
+  if (!(ecx & (1 << 9))) return PJSON_KERNEL_SSE2;
+  // AVX2 also requires the OS to save the upper halves of the YMM registers (OSXSAVE and AVX bits, then XCR0).
+  if (max_leaf >= 7 && (ecx & (1 << 27)) && (ecx & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6) {
+    __cpuidex(info, 7, 0);
+    if (info[1] & (1 << 5)) return PJSON_KERNEL_AVX2;
+  }
+  return PJSON_KERNEL_SSSE3;
+#elif defined(PJSON_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return PJSON_KERNEL_AVX2;
+  if (__builtin_cpu_supports("ssse3")) return PJSON_KERNEL_SSSE3;
+  if (__builtin_cpu_supports("sse2")) return PJSON_KERNEL_SSE2;
+  return PJSON_KERNEL_SCALAR;
+#else
+  return PJSON_KERNEL_SCALAR;
+#endif
 }
 
-/* Helpers */
+/**
+ * Return the kernel level requested by the `PJSON_KERNEL` environment variable or `PJSON_KERNEL_AUTO` if it's not set.
+ */
+static pjson_kernel_level requested_kernel_level(void) {
+#if defined(_MSC_VER)
+#pragma warning(suppress: 4996) // getenv is deprecated by MSVC in favor of _dupenv_s
+#endif
+  const char *name = getenv("PJSON_KERNEL");
+  if (name) {
+    for (size_t i = 0; i < pjson_countof(KERNEL_LEVEL_NAME_LOOKUP); i++) {
+      if (!strcmp(name, KERNEL_LEVEL_NAME_LOOKUP[i])) return (pjson_kernel_level)i;
+    }
+  }
+  return PJSON_KERNEL_AUTO;
+}
 
-static inline uint8_t hex_digit_value(uint8_t ch) {
-  return (ch <= '9') ? ch - '0'
-    : (ch <= 'F') ? ch - ('A' - 10)
-    : ch - ('a' - 10);
+/**
+ * Return the level `pjson_set_kernel_level` selects for `level`, without selecting it.
+ */
+static pjson_kernel_level resolve_kernel_level(pjson_kernel_level level) {
+  if (level == PJSON_KERNEL_AUTO) level = requested_kernel_level();
+
+  const pjson_kernel_level supported_level = detect_kernel_level();
+  if (level == PJSON_KERNEL_AUTO || level > supported_level) level = supported_level;
+
+  assert((size_t)level < pjson_countof(KERNEL_LOOKUP));
+  return level;
 }
 
-static inline bool is_in_range(uint16_t cp, uint16_t min, uint16_t max) {
-  assert(min <= max);
-  return (uint32_t)(cp - (uint32_t)min) <= (uint32_t)(max - (uint32_t)min);
+static const pjson_kernels *get_kernels(void) {
+  const pjson_kernels *kernels = KERNELS_LOAD();
+  if (!kernels) {
+    kernels = &KERNEL_LOOKUP[resolve_kernel_level(PJSON_KERNEL_AUTO)];
+    KERNELS_STORE(kernels);
+  }
+  return kernels;
 }
 
-#define UTF8_ERROR (-1)
+pjson_kernel_level pjson_set_kernel_level(pjson_kernel_level level) {
+  assert(level >= PJSON_KERNEL_AUTO && level <= PJSON_KERNEL_AVX2);
 
-/**
- * Get the 6-bit payload of the next continuation byte.
- * Return UTF8_ERROR if it is not a contination byte.
- */
-static inline int16_t utf8_cont_payload(uint8_t ch) {
-  return ((ch & 0xC0) == 0x80) ? (ch & 0x3F) : UTF8_ERROR;
+  level = resolve_kernel_level(level);
+  KERNELS_STORE(&KERNEL_LOOKUP[level]);
+  return level;
+}
+
+pjson_kernel_level pjson_get_kernel_level(void) {
+  return get_kernels()->level;
 }
 
 static inline size_t utf8_byte_size(int32_t cp) {
@@ -1220,12 +5331,76 @@ static int32_t utf16_parse_char(const uint8_t *src) {
   int32_t cp = 0;
   for (size_t i = 0; i < 4; i++) {
     uint8_t ch = src[i];
-    if (!isxdigit(ch)) return -1;
+    if (!is_hex_digit(ch)) return -1;
     cp = cp << 4 | hex_digit_value(ch);
   }
   return cp;
 }
 
+/**
+ * Unescapes the (already validated) string payload `[src, src_end)` into `*dest`, replacing lone surrogates with U+FFFD.
+ * Unless `is_last`, stops before an escape sequence which may be incomplete or followed by a low surrogate escape
+ * sequence in the rest of the payload.
+ * @return Pointer to where unescaping stopped.
+ */
+static const uint8_t *unescape_string_part(uint8_t **dest, const uint8_t *src, const uint8_t *src_end, bool is_last) {
+  uint8_t *d = *dest;
+
+  while (src < src_end) {
+    int32_t cp = *src;
+
+    if (cp == '\\') {
+      if (src_end - src < 2) break; // an incomplete escape sequence can only occur at the end of a part
+
+      switch (src[1]) {
+        case 'b': cp = '\b'; break;
+        case 'f': cp = '\f'; break;
+        case 'n': cp = '\n'; break;
+        case 'r': cp = '\r'; break;
+        case 't': cp = '\t'; break;
+        case 'u': {
+          if (src_end - src < 6) goto Stop;
+
+          cp = utf16_parse_char(src + 2);
+          assert(cp >= 0);
+          const uint8_t *next = src + 6;
+
+          if (utf16_is_high_surrogate((uint16_t)cp)) {
+            if (src_end - next < 6) {
+              if (!is_last) goto Stop;
+            }
+            else if (next[0] == '\\' && next[1] == 'u') {
+              int32_t cp2 = utf16_parse_char(next + 2);
+              assert(cp2 >= 0);
+              if (utf16_is_low_surrogate((uint16_t)cp2)) {
+                cp = utf16_to_code_point((uint16_t)cp, (uint16_t)cp2);
+                next += 6;
+              }
+            }
+          }
+
+          bool success = utf8_encode_code_point(cp, &d, d + 4);
+          assert(success);
+          (void)success;
+          d++, src = next;
+          continue;
+        }
+        default: cp = src[1]; break; // '"', '\\' or '/'
+      }
+
+      *d++ = (uint8_t)cp, src += 2;
+      continue;
+    }
+
+    *d++ = (uint8_t)cp, src++;
+  }
+
+Stop:
+  assert(is_last ? src == src_end : src_end - src < 12);
+  *dest = d;
+  return src;
+}
+
 bool pjson_parse_string(uint8_t *dest, size_t dest_size, const uint8_t *token_start, size_t token_length, bool replace_lone_surrogates) {
   assert(dest);
   assert(token_start);
@@ -1298,7 +5473,7 @@ static bool pjson_parse_uint32_core(uint32_t *num, const uint8_t *token_start, c
   uint32_t value = 0;
   for (; token_start < token_end; token_start++) {
     uint8_t ch = *token_start;
-    if (!isdigit(ch)) return false;
+    if (!is_digit(ch)) return false;
 
     ch = ch - '0';
     if (value <= UINT32_MAX / 10 - 1) {
@@ -1355,7 +5530,7 @@ static bool pjson_parse_uint64_core(uint64_t *num, const uint8_t *token_start, c
   uint64_t value = 0;
   for (; token_start < token_end; token_start++) {
     uint8_t ch = *token_start;
-    if (!isdigit(ch)) return false;
+    if (!is_digit(ch)) return false;
 
     ch = ch - '0';
     if (value <= UINT64_MAX / 10 - 1) {
@@ -1425,6 +5600,10 @@ static void replace_decimal_point(char *str, const char *str_end, char decimal_p
 #endif
 
 bool pjson_parse_float(float *num, const uint8_t *token_start, size_t token_length) {
+  return pjson_parse_float_ex(num, token_start, token_length, NULL);
+}
+
+bool pjson_parse_float_ex(float *num, const uint8_t *token_start, size_t token_length, const pjson_allocator *allocator) {
   assert(num);
   assert(token_start);
   assert((uintptr_t)token_start <= (uintptr_t)(token_start + token_length)); // check for unsigned overflow
@@ -1436,8 +5615,9 @@ bool pjson_parse_float(float *num, const uint8_t *token_start, size_t token_leng
   if (token_length < sizeof(fixed_size_buf)) {
     buf = fixed_size_buf;
   }
-  else if (!(buf = pjson_malloc(token_length + 1))) {
-    return false;
+  else {
+    if (!allocator) allocator = &pjson_default_allocator;
+    if (!(buf = pjson_allocate(allocator, token_length + 1))) return false;
   }
 
   memcpy(buf, token_start, token_length);
@@ -1454,7 +5634,7 @@ bool pjson_parse_float(float *num, const uint8_t *token_start, size_t token_leng
   float tmp = strtof(buf, &endptr);
   bool success = !errno && endptr == buf + token_length;
 
-  if (buf != fixed_size_buf) pjson_free(buf);
+  if (buf != fixed_size_buf) pjson_deallocate(allocator, buf, token_length + 1);
   if (!success) return false;
 
   *num = tmp;
@@ -1462,6 +5642,10 @@ bool pjson_parse_float(float *num, const uint8_t *token_start, size_t token_leng
 }
 
 bool pjson_parse_double(double *num, const uint8_t *token_start, size_t token_length) {
+  return pjson_parse_double_ex(num, token_start, token_length, NULL);
+}
+
+bool pjson_parse_double_ex(double *num, const uint8_t *token_start, size_t token_length, const pjson_allocator *allocator) {
   assert(num);
   assert(token_start);
   assert((uintptr_t)token_start <= (uintptr_t)(token_start + token_length)); // check for unsigned overflow
@@ -1473,8 +5657,9 @@ bool pjson_parse_double(double *num, const uint8_t *token_start, size_t token_le
   if (token_length < sizeof(fixed_size_buf)) {
     buf = fixed_size_buf;
   }
-  else if (!(buf = pjson_malloc(token_length + 1))) {
-    return false;
+  else {
+    if (!allocator) allocator = &pjson_default_allocator;
+    if (!(buf = pjson_allocate(allocator, token_length + 1))) return false;
   }
 
   memcpy(buf, token_start, token_length);
@@ -1491,7 +5676,7 @@ bool pjson_parse_double(double *num, const uint8_t *token_start, size_t token_le
   double tmp = strtod(buf, &endptr);
   bool success = !errno && endptr == buf + token_length;
 
-  if (buf != fixed_size_buf) pjson_free(buf);
+  if (buf != fixed_size_buf) pjson_deallocate(allocator, buf, token_length + 1);
   if (!success) return false;
 
   *num = tmp;
@@ -58,12 +58,13 @@ extern "C" {
   // Note for maintainers: enum values must not be changed as parsing logic relies on them!
   // Errors must be represented using negative values less than -1.
   // Value -1 is reserved for special purposes (see STATE_EOS).
-  // (Values other than PJSON_STATUS_DATA_NEEDED causes pjson_feed to return.)
+  // (Values other than PJSON_STATUS_DATA_NEEDED and PJSON_STATUS_SKIP causes pjson_feed to return.)
 
   typedef enum pjson_parsing_status {
     PJSON_STATUS_USER_ERROR = -0x20,
     PJSON_STATUS_SYNTAX_ERROR = -0x10,
     PJSON_STATUS_UTF8_ERROR = -0xF,
+    PJSON_STATUS_LIMIT_EXCEEDED = -6,
     PJSON_STATUS_OUT_OF_MEMORY = -5,
     PJSON_STATUS_NONCOMPLIANT_PARSER = -4,
     PJSON_STATUS_MAX_DEPTH_EXCEEDED = -3,
@@ -71,6 +72,12 @@ extern "C" {
     PJSON_STATUS_SUCCESS = 0,
     PJSON_STATUS_DATA_NEEDED = PJSON_STATUS_SUCCESS,
     PJSON_STATUS_COMPLETED = 1,
+    /**
+     * Returned by the parser for an opening bracket or brace to make the tokenizer skip the content of the array or
+     * object: the tokenizer only tracks strings and nesting until the matching closing bracket or brace, which is
+     * the next token passed to the parser. (The skipped content is not validated.)
+     */
+    PJSON_STATUS_SKIP = 2,
   } pjson_parsing_status;
 
   // Note for maintainers: enum values must not be changed as parsing logic relies on them!
@@ -93,6 +100,14 @@ extern "C" {
     PJSON_TOKEN_EOS = 12,
   } pjson_token_type;
 
+  /**
+   * A contiguous part of a token which straddles input chunks (see `pjson_tokenizer_options.scatter_strings`).
+   */
+  typedef struct pjson_segment {
+    const uint8_t /* non-owning */ *start;
+    size_t length;
+  } pjson_segment;
+
   typedef struct pjson_token {
     pjson_token_type type;
     size_t start_index;
@@ -102,17 +117,116 @@ extern "C" {
     size_t length;
     /** In the case of string tokens, the length of the unescaped, UTF-8 encoded string value (excluding quotes) in bytes. */
     size_t unescaped_length;
+    /**
+     * In the case of string tokens, pointer to the unescaped, UTF-8 encoded string value (excluding quotes, not
+     * zero-terminated) if the tokenizer was initialized with the `unescape_strings` option, otherwise `NULL`.
+     * Lone surrogates are replaced with U+FFFD. Valid for the current call only, must not be stored outside the stack.
+     */
+    const uint8_t /* non-owning */ *unescaped;
+    /**
+     * In the case of string tokens straddling input chunks, the parts of the token in the order of the chunks if the
+     * tokenizer was initialized with the `scatter_strings` option, otherwise `NULL`. In that case, `start` points to
+     * the first byte of the first segment and `length` is the total length of the segments. Valid for the current call
+     * only, must not be stored outside the stack.
+     */
+    const pjson_segment /* non-owning */ *segments;
+    size_t segment_count;
   } pjson_token;
 
   typedef struct pjson_parser_base pjson_parser_base;
 
+  typedef struct pjson_token_sink pjson_token_sink;
+
+  typedef struct pjson_string_chunk_handler pjson_string_chunk_handler;
+
+  typedef struct pjson_buffer_pool pjson_buffer_pool;
+
+  /* Allocator */
+
+  typedef void *(*pjson_allocator_allocate)(void *user_data, size_t size);
+  typedef void *(*pjson_allocator_reallocate)(void *user_data, void *ptr, size_t old_size, size_t new_size);
+  typedef void (*pjson_allocator_deallocate)(void *user_data, void *ptr, size_t size);
+
+  /**
+   * Memory management callbacks (e.g. of a per-request arena) to use instead of the default ones
+   * (`pjson_malloc`, `pjson_realloc` and `pjson_free`, see pjson_config.h).
+   *
+   * @remarks
+   * The callbacks are passed the size of the block (as requested on allocation) along with the pointer, so that
+   * allocators which don't keep track of it (e.g. bump allocators) can implement them. `reallocate` must accept `NULL`
+   * (with `old_size` being 0) like `realloc` does. `deallocate` is never called with `NULL`.
+   */
+  typedef struct pjson_allocator {
+    pjson_allocator_allocate allocate;
+    pjson_allocator_reallocate reallocate;
+    pjson_allocator_deallocate deallocate;
+    void *user_data;
+  } pjson_allocator;
+
+  /* Kernels */
+
+  // Note for maintainers: enum values must not be changed as kernel selection logic relies on them!
+  // (Levels must be listed in ascending order of required CPU features.)
+
+  typedef enum pjson_kernel_level {
+    PJSON_KERNEL_AUTO = -1,
+    PJSON_KERNEL_SCALAR = 0,
+    PJSON_KERNEL_SSE2 = 1,
+    PJSON_KERNEL_SSSE3 = 2,
+    PJSON_KERNEL_AVX2 = 3,
+  } pjson_kernel_level;
+
+  typedef struct pjson_kernels pjson_kernels;
+
+  /**
+   * Selects the implementation of the scanning kernels (whitespace skipping, string scanning, UTF-8 validation)
+   * used by tokenizers initialized afterwards. Not thread-safe, intended to be called at startup.
+   * (If not called, the kernels are selected automatically when the first tokenizer is initialized, which is safe to
+   * do from several threads at once.)
+   * @param level The level to use. `PJSON_KERNEL_AUTO` selects the level requested by the `PJSON_KERNEL` environment
+   * variable (`scalar`, `sse2`, `ssse3` or `avx2`) if set, otherwise the highest level supported by the CPU.
+   * Levels not supported by the build or the CPU are lowered to the highest supported one.
+   * @return The level actually selected.
+   */
+  pjson_kernel_level PJSON_API(pjson_set_kernel_level)(pjson_kernel_level level);
+
+  pjson_kernel_level PJSON_API(pjson_get_kernel_level)(void);
+
   /* Tokenizer */
 
-  /** Stores mostly internal state. Do not modify members directly. */
+#if !defined(PJSON_COMPACT_TOKENIZER)
+  /** Type of the buffer sizes, limits and counters stored in `pjson_tokenizer`. */
+  typedef size_t pjson_tokenizer_length;
+  typedef int pjson_tokenizer_state;
+  typedef pjson_token_type pjson_tokenizer_token_type;
+#define PJSON_TOKENIZER_LENGTH_MAX SIZE_MAX
+  /** Pointer to the fixed-size part of the internal buffer of a tokenizer (`NULL` if `PJSON_COMPACT_TOKENIZER` is defined). */
+#define pjson_fixed_size_buf(tokenizer) ((tokenizer)->fixed_size_buf)
+#else
+  typedef uint32_t pjson_tokenizer_length;
+  typedef int8_t pjson_tokenizer_state;
+  typedef int8_t pjson_tokenizer_token_type;
+#define PJSON_TOKENIZER_LENGTH_MAX UINT32_MAX
+#define pjson_fixed_size_buf(tokenizer) ((uint8_t *)NULL)
+#endif
+
+  /**
+   * Stores mostly internal state. Do not modify members directly.
+   * (The members accessed for every byte or token come first so that they share a cache line.)
+   */
   typedef struct pjson_tokenizer {
-    pjson_parser_base /* non-owning */ *parser;
+    pjson_tokenizer_state state;
+    pjson_tokenizer_token_type token_type;
+    bool unescape_strings;
+    bool scatter_strings;
+    bool is_streaming_string;
+    bool is_buf_pooled; // buf is a slab borrowed from buffer_pool
+    union {
+      uint8_t utf8_sequence_buf[4];
+      uint16_t utf16_surrogate_pair[2];
+    } string_state;
+    pjson_tokenizer_length unescaped_length;
     size_t index;
-    size_t token_start_index;
     /**
      * Used internally only, except when PJSON_STATUS_COMPLETED is returned by pjson_feed.
      * In that case, it points to where the next token may start in the user-provided buffer.
@@ -120,19 +234,90 @@ extern "C" {
      * This allows user to continue receiving further items when parsing a stream of JSON values.
      */
     const uint8_t /* non-owning */ *token_start;
-    pjson_token_type token_type;
-    int state;
-    union {
-      uint8_t utf8_sequence_buf[4];
-      uint16_t utf16_surrogate_pair[2];
-    } string_state;
-    size_t unescaped_length;
-    uint8_t fixed_size_buf[PJSON_INTERNAL_BUFFER_FIXED_SIZE];
+    size_t token_start_index;
+    pjson_parser_base /* non-owning */ *parser;
+    const pjson_kernels /* non-owning */ *kernels;
+    pjson_token_sink /* non-owning */ *sink; // set only in batch mode (see pjson_init_batch)
     uint8_t /* owning */ *buf; // owned by pjson_tokenizer, mananged by pjson_init & pjson_close.
-    size_t buf_length;
-    size_t buf_capacity;
+    pjson_tokenizer_length buf_length;
+    pjson_tokenizer_length buf_capacity;
+    pjson_tokenizer_length sink_token_count;
+    pjson_tokenizer_length depth;
+    pjson_tokenizer_length skip_depth; // nesting depth within the array or object being skipped (see PJSON_STATUS_SKIP)
+    pjson_tokenizer_length max_token_length;
+    pjson_tokenizer_length max_buffer_size;
+    pjson_tokenizer_length max_depth;
+    pjson_tokenizer_length buffer_high_water;
+    const pjson_allocator /* non-owning */ *allocator;
+    pjson_buffer_pool /* non-owning */ *buffer_pool;
+    uint8_t /* owning */ *unescape_buf; // owned by pjson_tokenizer, managed by pjson_feed & pjson_close.
+    pjson_tokenizer_length unescape_buf_capacity;
+    pjson_tokenizer_length segment_count;
+    pjson_segment /* owning */ *segments; // owned by pjson_tokenizer, managed by pjson_feed & pjson_close.
+    pjson_tokenizer_length segment_capacity;
+    pjson_tokenizer_length string_chunk_pending_length; // length of the incomplete escape sequence kept at the start of unescape_buf
+    pjson_string_chunk_handler /* non-owning */ *string_chunk_handler;
+#if !defined(PJSON_COMPACT_TOKENIZER)
+    uint8_t fixed_size_buf[PJSON_INTERNAL_BUFFER_FIXED_SIZE];
+#endif
   } pjson_tokenizer;
 
+  typedef struct pjson_tokenizer_options {
+    /**
+     * Specifies whether to unescape string tokens while tokenizing (see `pjson_token.unescaped`), sparing consumers
+     * a second pass using `pjson_parse_string`. Strings containing escape sequences are decoded into a scratch buffer
+     * owned by the tokenizer, other strings are referenced in place.
+     */
+    bool unescape_strings;
+    /**
+     * Specifies whether to deliver string tokens straddling input chunks as a list of segments referencing the chunks
+     * (see `pjson_token.segments`) instead of copying them into the internal buffer. The caller guarantees that the
+     * chunks passed to `pjson_feed` stay valid and unchanged until the tokens they contain are completed.
+     * Has no effect on strings if `unescape_strings` is set as the unescaped value must be contiguous.
+     */
+    bool scatter_strings;
+    /**
+     * Optional handler which receives strings longer than its threshold in fragments (see `pjson_string_chunk_handler`).
+     */
+    pjson_string_chunk_handler /* non-owning */ *string_chunk_handler;
+    /**
+     * Maximum length of a token in bytes (0 means no limit). Longer tokens are rejected with
+     * `PJSON_STATUS_LIMIT_EXCEEDED` as soon as the limit is exceeded, even if they are incomplete yet.
+     */
+    size_t max_token_length;
+    /**
+     * Maximum number of bytes the tokenizer may allocate for buffering tokens (0 means no limit), i.e. the total
+     * capacity of its internal buffer (excluding the fixed-size part), its unescaping scratch buffer and the list of
+     * segments of a scattered string (see `scatter_strings`). Input which would need more is rejected with
+     * `PJSON_STATUS_LIMIT_EXCEEDED` before calling the allocator.
+     */
+    size_t max_buffer_size;
+    /**
+     * Maximum nesting depth of arrays and objects (0 means no limit). Deeper input is rejected with
+     * `PJSON_STATUS_MAX_DEPTH_EXCEEDED` at the opening bracket or brace exceeding the limit.
+     */
+    size_t max_depth;
+    /**
+     * Capacity in bytes above which the heap-allocated part of the internal buffer is released when the token it holds
+     * is completed (0 means it is kept until `pjson_close`). The same applies to the unescaping scratch buffer (see
+     * `unescape_strings`) and to the segment list (see `scatter_strings`). Prevents a single oversized token from
+     * inflating the memory footprint of a long-lived tokenizer for good.
+     */
+    size_t buffer_high_water;
+    /**
+     * Optional pool to borrow the internal buffer from when tokens overflow its fixed-size part (see `pjson_buffer_pool`).
+     * The buffer is returned to the pool (or freed if the token didn't fit into a slab) as soon as the token it holds is
+     * completed. The unescaping scratch buffer and the segment list are freed at that point too, so idle tokenizers hold
+     * no heap memory.
+     */
+    pjson_buffer_pool /* non-owning */ *buffer_pool;
+    /**
+     * Optional allocator to use for the memory owned by the tokenizer (or the tape, see `pjson_init_tape_ex`).
+     * Must outlive the tokenizer (and the tape).
+     */
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_tokenizer_options;
+
   /**
    * Initializes a JSON tokenizer with an optional JSON parser.
    * @param tokenizer Pointer to a `pjson_tokenizer` struct. Required, cannot be `NULL`.
@@ -140,10 +325,98 @@ extern "C" {
    */
   void PJSON_API(pjson_init)(pjson_tokenizer *tokenizer, pjson_parser_base *parser);
 
+  /**
+   * Initializes a JSON tokenizer with an optional JSON parser and options.
+   * @param tokenizer Pointer to a `pjson_tokenizer` struct. Required, cannot be `NULL`.
+   * @param parser Pointer to a `pjson_parser_base` struct. Optional, can be `NULL`.
+   * @param options Pointer to a `pjson_tokenizer_options` struct. Optional, can be `NULL` (which is equivalent to
+   * calling `pjson_init`).
+   */
+  void PJSON_API(pjson_init_ex)(pjson_tokenizer *tokenizer, pjson_parser_base *parser, const pjson_tokenizer_options *options);
+
+  /**
+   * Returns the size of `pjson_tokenizer` as compiled into the library, which depends on the configuration
+   * (`PJSON_COMPACT_TOKENIZER` and `PJSON_INTERNAL_BUFFER_FIXED_SIZE`, see pjson_config.h). Useful for checking
+   * that the library and the application agree on the configuration or for budgeting memory per connection.
+   */
+  size_t PJSON_API(pjson_tokenizer_size)(void);
+
   pjson_parsing_status PJSON_API(pjson_feed)(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length);
 
+  /**
+   * Feeds the rest of the input to the tokenizer when it's available in a single buffer (e.g. a memory-mapped file).
+   * Behaves exactly like a `pjson_feed` call with the same arguments (same tokens, return value and tokenizer state),
+   * only faster: it locates the tokens by building an index of structural characters in a vectorized pass first, then
+   * emits them without inspecting the input byte by byte. (Strings containing escape sequences and malformed input
+   * are handed over to `pjson_feed`. So is the whole input in batch mode, see `pjson_init_batch`.)
+   * As with `pjson_feed`, `pjson_close` must be called afterwards to complete tokenization.
+   */
+  pjson_parsing_status PJSON_API(pjson_index)(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length);
+
   pjson_parsing_status PJSON_API(pjson_close)(pjson_tokenizer *tokenizer);
 
+  /**
+   * Resets a tokenizer to its initial state so that it can be reused for tokenizing another input. Unlike `pjson_init`
+   * followed by `pjson_close`, this keeps the options and the buffers grown so far (subject to the `buffer_high_water`
+   * and `buffer_pool` options). Can be called at any time, even after `pjson_close`. The parser is not affected: it must
+   * be reset separately (e.g. using `pjson_parser_reset`).
+   * @param tokenizer Pointer to a `pjson_tokenizer` struct initialized by one of the `pjson_init*` functions.
+   * Required, cannot be `NULL`.
+   */
+  void PJSON_API(pjson_reset)(pjson_tokenizer *tokenizer);
+
+  /**
+   * Tokenizes a complete input available in a single buffer (e.g. a message). Resets the tokenizer, feeds the input
+   * to it and completes tokenization, returning the same status as the `pjson_reset`, `pjson_index`/`pjson_feed_batch`
+   * and `pjson_close` calls would. The buffers are kept for the next call though, so `pjson_close` must be called
+   * when the tokenizer is no longer needed (its return value can be ignored in that case).
+   */
+  pjson_parsing_status PJSON_API(pjson_parse_buffer)(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length);
+
+  /* Batch mode */
+
+  typedef pjson_parsing_status(*pjson_token_sink_eat)(pjson_token_sink *sink, const pjson_token *tokens, size_t count);
+
+  /**
+   * Receives tokens in batches instead of one by one, sparing an indirect call per token.
+   * The tokenizer fills `tokens` and hands them over when the array is full, when a token was assembled in
+   * the internal buffer (i.e. it straddled a chunk boundary), at the end-of-stream token and before
+   * `pjson_feed_batch` returns. So all tokens of a batch, including their `start` pointers, are valid
+   * until `eat` returns.
+   *
+   * @remarks
+   * `eat` returns a status like `pjson_parser_eat` does, but it applies to the batch as a whole: it is handled as if it
+   * was returned for the last token of the batch. (As tokens are delivered late, the tokenizer may have read past a
+   * value completed in the middle of a batch, so batch mode is not suitable for parsing streams of multiple JSON values.)
+   */
+  typedef struct pjson_token_sink {
+    pjson_token_sink_eat eat;
+    /** Caller-provided array which receives the tokens. Required, cannot be `NULL`. */
+    pjson_token *tokens;
+    /** Number of elements in `tokens`. Must be greater than zero. */
+    size_t capacity;
+  } pjson_token_sink;
+
+  /**
+   * Initializes a JSON tokenizer which delivers the tokens to a batch sink instead of a parser.
+   * Such tokenizers must be fed using `pjson_feed_batch` and completed using `pjson_close`.
+   * @param tokenizer Pointer to a `pjson_tokenizer` struct. Required, cannot be `NULL`.
+   * @param sink Pointer to a `pjson_token_sink` struct. Required, cannot be `NULL`.
+   */
+  void PJSON_API(pjson_init_batch)(pjson_tokenizer *tokenizer, pjson_token_sink *sink);
+
+  /**
+   * Initializes a JSON tokenizer which delivers the tokens to a batch sink, with options (see `pjson_init_batch` and
+   * `pjson_init_ex`).
+   */
+  void PJSON_API(pjson_init_batch_ex)(pjson_tokenizer *tokenizer, pjson_token_sink *sink, const pjson_tokenizer_options *options);
+
+  /**
+   * Same as `pjson_feed` for tokenizers initialized using `pjson_init_batch`. Delivers all pending tokens to the sink
+   * before returning.
+   */
+  pjson_parsing_status PJSON_API(pjson_feed_batch)(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length);
+
   /* Parser */
 
   typedef pjson_parsing_status(*pjson_parser_eat)(pjson_parser_base *parser, const pjson_token *token);
@@ -162,11 +435,16 @@ extern "C" {
     /** Stores internal state. Do not modify it directly. */
     pjson_parser_eat next_eat;
 
+    /** Stores internal state (the enclosing context if the built-in context stack is used). Do not modify it directly. */
+    pjson_parser_context *parent;
+
     /**
      * User-provided function that is called when consuming a JSON value (null, boolean, number, string, array or object). Optional, can be `NULL`.
      *
      * @remarks
      * For arrays and objects it is called twice: once when beginning and once when finishing parsing the value. The actual case can be detected by looking at `token->type`.
+     * When beginning an array or object, it may return `PJSON_STATUS_SKIP` to skip its content: no callbacks are
+     * called until it is called again with the closing token (see also `pjson_parser_options.validate_skipped_values`).
      */
     pjson_parser_context_callback on_value;
 
@@ -180,15 +458,66 @@ extern "C" {
   typedef pjson_parser_context *(*pjson_parser_peek_context)(pjson_parser *parser, bool previous);
   typedef void(*pjson_parser_pop_context)(pjson_parser *parser);
 
+  typedef struct pjson_parser_stack_block pjson_parser_stack_block;
+
   /** Stores mostly internal state. Do not modify members directly. */
   typedef struct pjson_parser {
     pjson_parser_base base;
 
-    pjson_parser_push_context push_context;
+    /**
+     * The current context (i.e. the one on the top of the context stack). When an array or object is beginning
+     * (or ending), it's the context of the array or object, while the `on_value` callback receives the enclosing one.
+     */
+    pjson_parser_context /* non-owning */ *context;
+    size_t depth; // number of contexts pushed (including the top-level one)
+
+    pjson_parser_push_context push_context; // NULL if the built-in context stack is used
     pjson_parser_peek_context peek_context;
     pjson_parser_pop_context pop_context;
+
+    // Built-in context stack (see pjson_parser_init_ex)
+    size_t context_size;
+    size_t max_depth;
+    uint8_t /* non-owning */ *initial_contexts;
+    size_t initial_capacity;
+    uint8_t /* non-owning */ *stack_end; // end of the storage holding the current context
+    pjson_parser_stack_block /* non-owning */ *stack_block; // block holding the current context, NULL if it's in initial_contexts
+    pjson_parser_stack_block /* owning */ *stack_blocks; // kept for reuse until pjson_parser_free
+    const pjson_allocator /* non-owning */ *allocator;
+    bool validate_skipped_values;
+    pjson_parser_context inline_contexts[PJSON_PARSER_INLINE_DEPTH]; // used when no initial_contexts are provided
   } pjson_parser;
 
+  typedef struct pjson_parser_options {
+    /**
+     * Size of the context struct in bytes (e.g. `sizeof(my_parser_context)`). The struct must begin with
+     * a `pjson_parser_context` member. 0 means `sizeof(pjson_parser_context)`.
+     */
+    size_t context_size;
+    /**
+     * Caller-provided array of context structs used for storing the first levels of the stack (e.g. a member of
+     * the user-defined parser struct). Optional, can be `NULL`, in which case the first levels are stored inside
+     * the parser (see `PJSON_PARSER_INLINE_DEPTH`). Deeper levels are stored in blocks allocated by the parser,
+     * which are kept for reuse until `pjson_parser_free` is called.
+     */
+    void *initial_contexts;
+    /** Number of elements in `initial_contexts`. */
+    size_t initial_capacity;
+    /**
+     * Maximum nesting depth of arrays and objects (0 means no limit). Deeper input is rejected with
+     * `PJSON_STATUS_MAX_DEPTH_EXCEEDED`.
+     */
+    size_t max_depth;
+    /** Optional allocator to use for the blocks of the context stack. Must outlive the parser. */
+    const pjson_allocator /* non-owning */ *allocator;
+    /**
+     * Specifies whether to parse the content of the arrays and objects skipped by `on_value` (i.e. without calling any
+     * callbacks), so that it's still checked for syntax errors. By default, it is left to the fast skipping mode of
+     * the tokenizer, which only looks for the matching closing bracket or brace.
+     */
+    bool validate_skipped_values;
+  } pjson_parser_options;
+
   /**
    * Initializes a user-defined JSON parser.
    * @param parser Pointer to a `pjson_parser` struct. Required, cannot be `NULL`.
@@ -207,8 +536,701 @@ extern "C" {
     pjson_parser_pop_context pop_context
   );
 
+  /**
+   * Initializes a user-defined JSON parser which stores the contexts in a built-in stack, so that user need not
+   * implement one. Contexts are zero-initialized when pushed and they stay at the same address until they are popped.
+   * The current context is available as `parser->context`, so the parser doesn't need to call back into user code
+   * for accessing contexts. `pjson_parser_free` must be called to release the memory of the stack. As the stack may
+   * point into the parser struct, the parser must not be moved after initialization.
+   * @param parser Pointer to a `pjson_parser` struct. Required, cannot be `NULL`.
+   * @param is_lazy See `pjson_parser_init`.
+   * @param options Pointer to a `pjson_parser_options` struct. Optional, can be `NULL`.
+   */
+  void PJSON_API(pjson_parser_init_ex)(pjson_parser *parser, bool is_lazy, const pjson_parser_options *options);
+
+  /**
+   * Releases the memory allocated for the built-in context stack of a parser (see `pjson_parser_init_ex`).
+   * Does nothing if the parser uses a user-provided stack. The parser must be reset before being used again.
+   */
+  void PJSON_API(pjson_parser_free)(pjson_parser *parser);
+
+  /**
+   * Prepares a parser for parsing another input by pushing a new top-level context. If the parser uses a user-provided
+   * context stack, user has to empty the stack beforehand. (The built-in stack is emptied by the parser.)
+   */
   void PJSON_API(pjson_parser_reset)(pjson_parser *parser, bool is_lazy);
 
+  /**
+   * Prepares a parser for parsing another input (see `pjson_reset`) without involving user in managing the context
+   * stack: the contexts of the arrays and objects left open by the previous input (if any) are popped and the top-level
+   * context is reused, keeping the callbacks set by user. (Unlike `pjson_parser_reset`, which pushes a new
+   * top-level context, so user has to empty the stack beforehand.)
+   * @param parser Pointer to a `pjson_parser` struct. Required, cannot be `NULL`.
+   * @param is_lazy See `pjson_parser_init`.
+   */
+  void PJSON_API(pjson_parser_rewind)(pjson_parser *parser, bool is_lazy);
+
+  /* String chunks */
+
+  typedef pjson_parsing_status(*pjson_string_chunk_handler_on_chunk)(pjson_string_chunk_handler *handler, size_t start_index, const uint8_t *chunk, size_t length);
+  typedef pjson_parsing_status(*pjson_string_chunk_handler_on_end)(pjson_string_chunk_handler *handler, const pjson_token *token);
+
+  /**
+   * Receives oversized strings (values and property names alike) in fragments as they arrive, so that they need not be
+   * assembled in the internal buffer of the tokenizer. A string is streamed if it straddles input chunks and its length
+   * exceeds `threshold` at the end of a chunk. (Strings contained in a single chunk are delivered as a single token
+   * regardless of their length as they are referenced in place anyway.)
+   *
+   * @remarks
+   * `on_chunk` receives the payload of the string (excluding quotes) in one or more fragments, which are unescaped if
+   * the `unescape_strings` option is set, otherwise raw. Fragments are not necessarily split at character boundaries
+   * and are valid until `on_chunk` returns. `start_index` is the index of the string token.
+   * When the string is complete, `on_end` (optional, can be `NULL`) is called, then the string token is delivered as
+   * usual (to the parser or, in batch mode, the sink) so that parsers keep track of the structure. In both calls, the
+   * token has `start` set to `NULL`, its length fields are set as usual. Parsers which need the bytes of strings
+   * document how they treat streamed ones (e.g. the tape flags their entries, see `PJSON_TAPE_STREAMED`).
+   * The callbacks return a status like `pjson_parser_eat` does.
+   */
+  typedef struct pjson_string_chunk_handler {
+    pjson_string_chunk_handler_on_chunk on_chunk;
+    pjson_string_chunk_handler_on_end on_end;
+    /** Length in bytes (including quotes) an incomplete string must exceed to be streamed. */
+    size_t threshold;
+  } pjson_string_chunk_handler;
+
+  /* Buffer pool */
+
+  /**
+   * A cache of equally sized buffers (slabs) which tokenizers borrow to hold tokens overflowing the fixed-size part
+   * of their internal buffer. Tokens longer than a slab are buffered on the heap as usual. (Slabs are allocated using
+   * the default allocator as they are meant to outlive tokenizers.)
+   *
+   * @remarks
+   * The pool is not synchronized: it must only be used by tokenizers driven by the same thread, e.g. by declaring it
+   * `_Thread_local` and initializing it on first use in each thread.
+   */
+  typedef struct pjson_buffer_pool {
+    size_t slab_size;
+    size_t max_free_count;
+    size_t free_count;
+    void /* owning */ *free_list; // cached slabs, linked through their first bytes
+  } pjson_buffer_pool;
+
+  /**
+   * Initializes a buffer pool.
+   * @param pool Pointer to a `pjson_buffer_pool` struct. Required, cannot be `NULL`.
+   * @param slab_size Size of the buffers in bytes. Must be at least `sizeof(void *)`.
+   * @param max_free_count Maximum number of returned buffers to keep for reuse. Buffers returned to a full pool are freed.
+   */
+  void PJSON_API(pjson_buffer_pool_init)(pjson_buffer_pool *pool, size_t slab_size, size_t max_free_count);
+
+  /**
+   * Frees the buffers cached by a pool. Buffers borrowed by tokenizers are not affected: they are freed when returned.
+   */
+  void PJSON_API(pjson_buffer_pool_free)(pjson_buffer_pool *pool);
+
+  /* Tape */
+
+#define PJSON_TAPE_NO_INDEX ((size_t)-1)
+#define PJSON_TAPE_STREAMED ((size_t)-2)
+
+  /** A fixed-size record of a token in a tape. */
+  typedef struct pjson_tape_entry {
+    pjson_token_type type;
+    /** Index of the first byte of the token in the input. */
+    size_t start_index;
+    /** Length of token in bytes. */
+    size_t length;
+    /** In the case of string tokens, the length of the unescaped, UTF-8 encoded string value (excluding quotes) in bytes. */
+    size_t unescaped_length;
+    /**
+     * In the case of brackets and braces, the index of the entry of the matching bracket or brace, so a whole array or
+     * object can be skipped by continuing at `match_index + 1`. `PJSON_TAPE_NO_INDEX` for other tokens.
+     */
+    size_t match_index;
+    /**
+     * Offset of the copy of the token in the string area of the tape if it straddled input chunks,
+     * `PJSON_TAPE_STREAMED` if it's a string passed to a `pjson_string_chunk_handler` (whose bytes are not kept),
+     * otherwise `PJSON_TAPE_NO_INDEX`. (Use `pjson_tape_entry_data` to access the token.)
+     */
+    size_t string_offset;
+  } pjson_tape_entry;
+
+  /**
+   * Records the tokens of a JSON document as a flat array of entries instead of passing them to callbacks.
+   * Only values, brackets and braces are recorded (separators carry no information once the grammar is checked),
+   * so the entries of an object alternate between property names and values.
+   * Stores mostly internal state. Do not modify members directly.
+   */
+  typedef struct pjson_tape {
+    pjson_parser_base base;
+    pjson_tape_entry /* owning if not equal to initial_entries */ *entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    /** Copies of the tokens which straddled input chunks. */
+    uint8_t /* owning */ *strings;
+    size_t strings_length;
+    size_t strings_capacity;
+    pjson_tape_entry /* non-owning */ *initial_entries;
+    const pjson_tokenizer /* non-owning */ *tokenizer;
+    const pjson_allocator /* non-owning */ *allocator;
+    size_t open_index;
+    int state;
+  } pjson_tape;
+
+  /**
+   * Initializes a JSON tokenizer which records the tokens in a tape. Input can be fed using `pjson_feed` (in chunks) or
+   * `pjson_index` as usual. The tape grows as needed, `pjson_tape_free` must be called to release its memory.
+   * @param tokenizer Pointer to a `pjson_tokenizer` struct. Required, cannot be `NULL`. Must not be moved while in use.
+   * @param tape Pointer to a `pjson_tape` struct. Required, cannot be `NULL`.
+   * @param entries Caller-provided array used for storing the first entries. Optional, can be `NULL`.
+   * (It's not freed by the tape. When it gets full, the entries are moved to an array allocated by the tape.)
+   * @param capacity Number of elements in `entries`.
+   */
+  void PJSON_API(pjson_init_tape)(pjson_tokenizer *tokenizer, pjson_tape *tape, pjson_tape_entry *entries, size_t capacity);
+
+  /**
+   * Initializes a JSON tokenizer which records the tokens in a tape, with options (see `pjson_init_tape` and `pjson_init_ex`).
+   * The tape allocates its memory using `options->allocator` as well.
+   */
+  void PJSON_API(pjson_init_tape_ex)(pjson_tokenizer *tokenizer, pjson_tape *tape, pjson_tape_entry *entries, size_t capacity,
+    const pjson_tokenizer_options *options);
+
+  void PJSON_API(pjson_tape_free)(pjson_tape *tape);
+
+  /**
+   * Returns a pointer to the first byte of a token recorded in a tape, or `NULL` if it's a string which was streamed
+   * to a `pjson_string_chunk_handler` (see `pjson_tape_entry.string_offset`).
+   * @param input Pointer to the whole input, as the bytes of tokens not straddling input chunks are not copied.
+   * Optional, can be `NULL` if only the tape-owned copies of tokens are accessed.
+   */
+  const uint8_t *PJSON_API(pjson_tape_entry_data)(const pjson_tape *tape, const pjson_tape_entry *entry, const uint8_t *input);
+
+  /* Path filter */
+
+#define PJSON_PATH_FILTER_MAX_NODES (64)
+
+  typedef struct pjson_path_filter pjson_path_filter;
+
+  /**
+   * User-provided function that is called for the values matching the path with the index `path_index`. For arrays and
+   * objects it is called twice, like `pjson_parser_context.on_value`: with the opening and with the closing token.
+   * It may return `PJSON_STATUS_SKIP` for the opening token to skip the content (including the values matching deeper
+   * paths). Values matching several paths are reported once per path.
+   */
+  typedef pjson_parsing_status(*pjson_path_filter_callback)(pjson_path_filter *filter, size_t path_index, const pjson_token *token);
+
+  /** One step of a compiled path. Used internally only. */
+  typedef struct pjson_path_filter_node {
+    uint8_t kind;
+    uint8_t first_child; // 0 if none (the root is never a child)
+    uint8_t next_sibling; // 0 if none
+    size_t index; // array index
+    size_t name_offset; // offset of the property name in names
+    size_t name_length;
+    size_t first_path; // index of the first path ending at the node, (size_t)-1 if none (see next_paths)
+  } pjson_path_filter_node;
+
+  /**
+   * Parser which only calls back for the values at the given paths, and makes the tokenizer skip the arrays and objects
+   * which no path leads into (see `PJSON_STATUS_SKIP`). Pass `&filter->parser.base` to `pjson_init`.
+   * Stores mostly internal state. Do not modify members directly.
+   *
+   * @remarks
+   * Values streamed to a `pjson_string_chunk_handler` are reported as usual (with `start` set to `NULL`). Property
+   * names are compared with the steps of the paths, so parsing fails with `PJSON_STATUS_USER_ERROR` if a streamed
+   * name is not longer than the longest name in the paths. (The threshold of the handler should exceed that length.)
+   */
+  typedef struct pjson_path_filter {
+    pjson_parser parser; // base struct MUST be the first member!
+    pjson_path_filter_callback on_match;
+    /** User data for `on_match`. Not used by the filter. */
+    void *user_data;
+    // Paths compiled into a trie: node 0 is the root (i.e. the whole document). Sets of nodes are stored as bit masks.
+    pjson_path_filter_node nodes[PJSON_PATH_FILTER_MAX_NODES];
+    size_t node_count;
+    uint64_t inner_nodes; // nodes having children
+    uint64_t final_nodes; // nodes where paths end
+    size_t path_count;
+    size_t /* owning */ *next_paths; // index of the next path ending at the same node, (size_t)-1 if none
+    uint8_t /* owning */ *names; // property names of the steps (unescaped)
+    uint8_t /* owning */ *scratch; // used for comparing property names containing escape sequences
+    size_t max_name_length;
+    size_t buffer_size; // size of the block holding next_paths, names and scratch
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_path_filter;
+
+  typedef struct pjson_path_filter_options {
+    /** See `pjson_parser_options.max_depth`. */
+    size_t max_depth;
+    /** See `pjson_parser_options.validate_skipped_values`. */
+    bool validate_skipped_values;
+    /** Optional allocator to use for the compiled paths and the context stack. Must outlive the filter. */
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_path_filter_options;
+
+  /**
+   * Compiles a set of paths and initializes a parser which calls `on_match` for the values at these paths only.
+   * Paths can be given as JSON Pointers (e.g. `/items/0/price`, where `~0` and `~1` stand for `~` and `/` in names, and
+   * tokens consisting of digits match array indices as well) or in a simple subset of JSONPath: `$` followed by steps like
+   * `.name`, `['name']`, `[0]`, `.*` or `[*]` (e.g. `$.items[*].price`). Recursive descent and filter expressions are
+   * not supported. The empty JSON Pointer and `$` match the whole document. `pjson_path_filter_free` must be called to
+   * release the memory of the filter, unless initialization fails.
+   * @param filter Pointer to a `pjson_path_filter` struct. Required, cannot be `NULL`. Must not be moved after initialization.
+   * @param is_lazy See `pjson_parser_init`.
+   * @param paths Array of zero-terminated paths. The index of a path in the array is passed to `on_match`.
+   * @param path_count Number of elements in `paths`.
+   * @param on_match User-provided function that is called for the matching values. Required, cannot be `NULL`.
+   * @param options Optional, can be `NULL`.
+   * @returns `PJSON_STATUS_SUCCESS`, `PJSON_STATUS_SYNTAX_ERROR` if a path is invalid, `PJSON_STATUS_LIMIT_EXCEEDED` if
+   * the paths consist of more than `PJSON_PATH_FILTER_MAX_NODES` distinct steps (including the root) or
+   * `PJSON_STATUS_OUT_OF_MEMORY`.
+   */
+  pjson_parsing_status PJSON_API(pjson_path_filter_init)(pjson_path_filter *filter, bool is_lazy,
+    const char *const *paths, size_t path_count, pjson_path_filter_callback on_match, const pjson_path_filter_options *options);
+
+  /**
+   * Prepares the filter for parsing another document with the same paths (see `pjson_parser_rewind`).
+   */
+  void PJSON_API(pjson_path_filter_rewind)(pjson_path_filter *filter, bool is_lazy);
+
+  void PJSON_API(pjson_path_filter_free)(pjson_path_filter *filter);
+
+  /* Property name lookup */
+
+#define PJSON_NAME_NOT_FOUND ((size_t)-1)
+#define PJSON_NAME_UNAVAILABLE ((size_t)-2)
+#define PJSON_NAME_TABLE_MAX_NAMES (0xFFFF)
+
+  /**
+   * Maps property names to their indices in a fixed list of names. The names are placed into a perfect hash table when
+   * the table is built, so a lookup takes one hash and one comparison, however many names there are.
+   * Stores internal state only. Do not modify members directly.
+   */
+  typedef struct pjson_name_table {
+    const char *const /* non-owning */ *names;
+    size_t name_count;
+    size_t max_name_length;
+    uint64_t seed;
+    unsigned bucket_bits; // names are hashed to 2^bucket_bits buckets first...
+    unsigned slot_bits; // ...then to 2^slot_bits slots, using the displacement of their bucket
+    size_t /* owning */ *name_lengths;
+    uint16_t /* owning */ *displacements;
+    uint16_t /* owning */ *slots; // 1 + the index of the name placed into the slot, 0 if none
+    size_t buffer_size; // size of the block holding name_lengths, displacements and slots
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_name_table;
+
+  typedef struct pjson_name_table_options {
+    /** Optional allocator to use for the table. Must outlive the table. */
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_name_table_options;
+
+  /**
+   * Builds a lookup table for a list of property names. Typically done once per schema, the table can be shared by any
+   * number of parsers (lookups don't modify it). `pjson_name_table_free` must be called to release its memory, unless
+   * building fails.
+   * @param table Pointer to a `pjson_name_table` struct. Required, cannot be `NULL`.
+   * @param names Array of zero-terminated, unescaped property names. Must outlive the table.
+   * @param name_count Number of elements in `names`, at most `PJSON_NAME_TABLE_MAX_NAMES`.
+   * @param options Optional, can be `NULL`.
+   * @returns `PJSON_STATUS_SUCCESS`, `PJSON_STATUS_SYNTAX_ERROR` if the names are not distinct,
+   * `PJSON_STATUS_LIMIT_EXCEEDED` if there are too many names or `PJSON_STATUS_OUT_OF_MEMORY`.
+   */
+  pjson_parsing_status PJSON_API(pjson_name_table_init)(pjson_name_table *table, const char *const *names, size_t name_count,
+    const pjson_name_table_options *options);
+
+  void PJSON_API(pjson_name_table_free)(pjson_name_table *table);
+
+  /**
+   * Looks up the name given by a string token (typically the one passed to `on_object_property_name`).
+   * Uses `token->unescaped` if the tokenizer unescapes strings, otherwise names without escape sequences are looked up
+   * in place and only the ones having escape sequences get unescaped (on the stack, unless they are very long).
+   * Names streamed to a `pjson_string_chunk_handler` can't be looked up as their bytes are not available. (The threshold
+   * of the handler should exceed the length of the longest name in the table.)
+   * @returns The index of the name in the list the table was built from, `PJSON_NAME_NOT_FOUND` if the token is not one
+   * of the names, or `PJSON_NAME_UNAVAILABLE` if that can't be told: the name was streamed (and is not longer than
+   * the longest name in the table) or allocating the buffer to unescape it failed.
+   */
+  size_t PJSON_API(pjson_name_table_find)(const pjson_name_table *table, const pjson_token *token);
+
+  /**
+   * Looks up an unescaped name.
+   * @returns The index of the name in the list the table was built from, or `PJSON_NAME_NOT_FOUND`.
+   */
+  size_t PJSON_API(pjson_name_table_find_string)(const pjson_name_table *table, const uint8_t *name, size_t length);
+
+  /* Arena */
+
+#define PJSON_ARENA_ALIGNMENT (16) // alignment suitable for any of the types stored by the library
+
+  typedef struct pjson_arena_block pjson_arena_block;
+
+  /**
+   * Bump allocator handing out memory from an optional caller-provided buffer first, then from blocks of growing size
+   * obtained from an allocator. Allocations are not freed one by one: `pjson_arena_reset` makes all of the memory
+   * available again (keeping the blocks for reuse), and `pjson_arena_free` releases the blocks.
+   * Stores internal state only. Do not modify members directly.
+   */
+  typedef struct pjson_arena {
+    uint8_t /* non-owning */ *initial_buffer;
+    size_t initial_size;
+    pjson_arena_block /* non-owning */ *block; // block being used, NULL while using the initial buffer
+    pjson_arena_block /* owning */ *blocks; // allocated blocks in the order of use, kept for reuse until pjson_arena_free
+    uint8_t *cursor; // next free byte
+    uint8_t *end; // end of the buffer or block being used
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_arena;
+
+  /**
+   * @param arena Pointer to a `pjson_arena` struct. Required, cannot be `NULL`.
+   * @param buffer Optional buffer to use before allocating blocks, can be `NULL`. Must outlive the arena.
+   * @param size Size of `buffer` in bytes.
+   * @param allocator Optional allocator for the blocks, can be `NULL` to use the default one. Must outlive the arena.
+   */
+  void PJSON_API(pjson_arena_init)(pjson_arena *arena, void *buffer, size_t size, const pjson_allocator *allocator);
+
+  /**
+   * @param alignment Power of two, at most `PJSON_ARENA_ALIGNMENT`.
+   * @returns Pointer to `size` bytes, or `NULL` if out of memory.
+   */
+  void *PJSON_API(pjson_arena_allocate)(pjson_arena *arena, size_t size, size_t alignment);
+
+  /**
+   * Grows or shrinks the most recent allocation in place if possible, otherwise allocates and copies (the old memory is
+   * not reused until the arena is reset). `ptr` can be `NULL` (with `old_size` being 0).
+   * @returns Pointer to `new_size` bytes, or `NULL` if out of memory (in which case `ptr` stays valid).
+   */
+  void *PJSON_API(pjson_arena_reallocate)(pjson_arena *arena, void *ptr, size_t old_size, size_t new_size, size_t alignment);
+
+  /** Invalidates all allocations made from the arena. The allocated blocks are reused by later allocations. */
+  void PJSON_API(pjson_arena_reset)(pjson_arena *arena);
+
+  /** Invalidates all allocations made from the arena, and releases the allocated blocks. */
+  void PJSON_API(pjson_arena_free)(pjson_arena *arena);
+
+  /* Struct binding */
+
+  /** String stored in an arena. `data` is zero-terminated, but may contain zero bytes as well (see `length`). */
+  typedef struct pjson_string {
+    const char /* non-owning */ *data;
+    size_t length;
+  } pjson_string;
+
+  /** Growable vector stored in an arena. */
+  typedef struct pjson_array {
+    void /* non-owning */ *items;
+    size_t count;
+    size_t capacity;
+  } pjson_array;
+
+  typedef enum pjson_field_type {
+    PJSON_FIELD_BOOL, // bool
+    PJSON_FIELD_INT32, // int32_t
+    PJSON_FIELD_UINT32, // uint32_t
+    PJSON_FIELD_INT64, // int64_t
+    PJSON_FIELD_UINT64, // uint64_t
+    PJSON_FIELD_FLOAT, // float
+    PJSON_FIELD_DOUBLE, // double
+    PJSON_FIELD_STRING, // pjson_string
+    PJSON_FIELD_OBJECT, // struct described by `pjson_field_descriptor.object`
+    PJSON_FIELD_ARRAY, // pjson_array of `pjson_field_descriptor.element_type` items
+  } pjson_field_type;
+
+  typedef struct pjson_struct_descriptor pjson_struct_descriptor;
+
+  typedef struct pjson_field_descriptor {
+    /** Property name (unescaped, zero-terminated). */
+    const char *name;
+    /** `offsetof` the member in the struct. */
+    size_t offset;
+    pjson_field_type type;
+    /** Type of the items of arrays. Cannot be `PJSON_FIELD_ARRAY`. */
+    pjson_field_type element_type;
+    /** Descriptor of objects and of the items of arrays of objects, otherwise `NULL`. */
+    const pjson_struct_descriptor /* non-owning */ *object;
+  } pjson_field_descriptor;
+
+  /** Describes how the properties of a JSON object map to the members of a C struct. */
+  struct pjson_struct_descriptor {
+    size_t size;
+    const pjson_field_descriptor /* non-owning */ *fields;
+    size_t field_count;
+  };
+
+#define PJSON_FIELD(name, struct_type, member, type) \
+  { (name), offsetof(struct_type, member), (type), (type), NULL }
+#define PJSON_OBJECT_FIELD(name, struct_type, member, descriptor) \
+  { (name), offsetof(struct_type, member), PJSON_FIELD_OBJECT, PJSON_FIELD_OBJECT, &(descriptor) }
+#define PJSON_ARRAY_FIELD(name, struct_type, member, element_type) \
+  { (name), offsetof(struct_type, member), PJSON_FIELD_ARRAY, (element_type), NULL }
+#define PJSON_OBJECT_ARRAY_FIELD(name, struct_type, member, descriptor) \
+  { (name), offsetof(struct_type, member), PJSON_FIELD_ARRAY, PJSON_FIELD_OBJECT, &(descriptor) }
+#define PJSON_STRUCT_DESCRIPTOR(struct_type, fields) \
+  { sizeof(struct_type), (fields), pjson_countof(fields) }
+
+#define PJSON_BINDING_MAX_STRUCTS (16)
+
+  /** Struct descriptor prepared for binding. Used internally only. */
+  typedef struct pjson_binding_struct {
+    const pjson_struct_descriptor /* non-owning */ *descriptor;
+    const char /* owning */ **names; // the block also holds field_structs
+    uint8_t *field_structs; // index into `pjson_binding.structs` of the struct of each field having one
+    pjson_name_table table;
+  } pjson_binding_struct;
+
+  /**
+   * Parser which fills C structs described by `pjson_struct_descriptor` tables straight from the tokens: numbers are
+   * converted in place, strings are copied (unescaped) into an arena, arrays become `pjson_array` vectors in the arena,
+   * and the values of unknown properties are skipped. JSON `null` leaves the members zeroed. Values not matching the
+   * type of their member make parsing fail with `PJSON_STATUS_USER_ERROR`. Pass `&binding->parser.base` to `pjson_init`.
+   * Stores internal state only. Do not modify members directly.
+   *
+   * @remarks
+   * Strings streamed to a `pjson_string_chunk_handler` can't be bound as their bytes are not available: parsing fails
+   * with `PJSON_STATUS_USER_ERROR` for such a value of a string member, and for such a property name unless it's
+   * longer than the names of the fields (i.e. it's unknown). Values of unknown properties are skipped as usual.
+   */
+  typedef struct pjson_binding {
+    pjson_parser parser; // base struct MUST be the first member!
+    pjson_binding_struct structs[PJSON_BINDING_MAX_STRUCTS]; // structs[0] describes the top-level value
+    size_t struct_count;
+    bool is_array; // whether the top-level value is an array of structs
+    void /* non-owning */ *target;
+    pjson_arena /* non-owning */ *arena;
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_binding;
+
+  typedef struct pjson_binding_options {
+    /** See `pjson_parser_options.max_depth`. */
+    size_t max_depth;
+    /** Optional allocator to use for the lookup tables and the context stack. Must outlive the binding. */
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_binding_options;
+
+  /**
+   * Prepares the descriptors for binding, and initializes a parser which fills `target` from the next document.
+   * `pjson_binding_free` must be called to release the memory of the binding, unless initialization fails.
+   * @param binding Pointer to a `pjson_binding` struct. Required, cannot be `NULL`. Must not be moved after initialization.
+   * @param descriptor Descriptor of the top-level object, or of the items of the top-level array. Must outlive the binding.
+   * @param is_array Whether the top-level value is an array of objects (bound to a `pjson_array`) or a single object.
+   * @param target The struct or `pjson_array` to fill. It is zeroed when the top-level value starts.
+   * @param arena Arena for the strings and arrays. Required, cannot be `NULL`. The data stays valid until it is reset.
+   * @param options Optional, can be `NULL`.
+   * @returns `PJSON_STATUS_SUCCESS`, `PJSON_STATUS_SYNTAX_ERROR` if a struct has several fields with the same name,
+   * `PJSON_STATUS_LIMIT_EXCEEDED` if more than `PJSON_BINDING_MAX_STRUCTS` descriptors are involved or
+   * `PJSON_STATUS_OUT_OF_MEMORY`.
+   */
+  pjson_parsing_status PJSON_API(pjson_binding_init)(pjson_binding *binding, const pjson_struct_descriptor *descriptor,
+    bool is_array, void *target, pjson_arena *arena, const pjson_binding_options *options);
+
+  /**
+   * Prepares the binding for filling `target` from another document (see `pjson_parser_rewind`).
+   */
+  void PJSON_API(pjson_binding_rewind)(pjson_binding *binding, void *target);
+
+  void PJSON_API(pjson_binding_free)(pjson_binding *binding);
+
+  /* DOM */
+
+  typedef enum pjson_dom_type {
+    PJSON_DOM_NULL,
+    PJSON_DOM_FALSE,
+    PJSON_DOM_TRUE,
+    PJSON_DOM_NUMBER,
+    PJSON_DOM_STRING,
+    PJSON_DOM_ARRAY,
+    PJSON_DOM_OBJECT,
+  } pjson_dom_type;
+
+  typedef struct pjson_dom_member pjson_dom_member;
+
+  /** Node of a document tree. All of the data is stored in the arena of the `pjson_dom` which built it. */
+  typedef struct pjson_dom_value {
+    pjson_dom_type type;
+    /** Length of the text in bytes for numbers and strings, number of items or members for arrays and objects. */
+    size_t count;
+    union {
+      /** Numbers: the token as is. Strings: the unescaped, UTF-8 encoded value. Zero-terminated in both cases. */
+      const char /* non-owning */ *text;
+      /** Arrays: the items, stored contiguously. */
+      const struct pjson_dom_value /* non-owning */ *items;
+      /** Objects: the members in document order, stored contiguously. */
+      const pjson_dom_member /* non-owning */ *members;
+    } data;
+  } pjson_dom_value;
+
+  struct pjson_dom_member {
+    pjson_string name;
+    pjson_dom_value value;
+  };
+
+  /**
+   * Parser which builds a tree of `pjson_dom_value` nodes. Every node, property name and string is allocated from an
+   * arena, and the children of an array or object are stored in a single contiguous allocation made when the array or
+   * object ends (they are collected on a stack until their count is known). The whole tree is released at once by
+   * `pjson_dom_rewind` or `pjson_dom_free`. Pass `&dom->parser.base` to `pjson_init` (or `pjson_init_ex`).
+   * Stores mostly internal state. Do not modify members directly.
+   *
+   * @remarks
+   * Strings (values and property names alike) cannot be streamed: the tree holds copies of them, so parsing fails with
+   * `PJSON_STATUS_USER_ERROR` if the tokenizer passes one to a `pjson_string_chunk_handler`. Leave the
+   * `string_chunk_handler` option unset, or set its threshold above the longest string expected.
+   */
+  typedef struct pjson_dom {
+    pjson_parser parser; // base struct MUST be the first member!
+    /** The top-level value. Valid once parsing has completed, until the next rewind. */
+    pjson_dom_value root;
+    pjson_arena arena;
+    pjson_dom_member /* owning */ *stack; // children of the arrays and objects being parsed, kept until pjson_dom_free
+    size_t stack_count;
+    size_t stack_capacity;
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_dom;
+
+  typedef struct pjson_dom_options {
+    /** See `pjson_parser_options.max_depth`. */
+    size_t max_depth;
+    /** Optional buffer for the arena to use before allocating blocks (see `pjson_arena_init`). Must outlive the DOM. */
+    void /* non-owning */ *buffer;
+    size_t buffer_size;
+    /** Optional allocator to use for the arena, the child stack and the context stack. Must outlive the DOM. */
+    const pjson_allocator /* non-owning */ *allocator;
+  } pjson_dom_options;
+
+  /**
+   * Initializes a parser which builds the tree of the next document. `pjson_dom_free` must be called to release its memory.
+   * Parsing fails with `PJSON_STATUS_OUT_OF_MEMORY` if the tree cannot be allocated.
+   * @param dom Pointer to a `pjson_dom` struct. Required, cannot be `NULL`. Must not be moved after initialization.
+   * @param options Optional, can be `NULL`.
+   */
+  void PJSON_API(pjson_dom_init)(pjson_dom *dom, const pjson_dom_options *options);
+
+  /**
+   * Releases the tree (keeping the memory of the arena for reuse), and prepares the parser for building the tree of
+   * another document (see `pjson_parser_rewind`).
+   */
+  void PJSON_API(pjson_dom_rewind)(pjson_dom *dom);
+
+  void PJSON_API(pjson_dom_free)(pjson_dom *dom);
+
+  /** @returns The item at `index` of an array, or `NULL` if `array` is not an array or `index` is out of range. */
+  const pjson_dom_value *PJSON_API(pjson_dom_array_get)(const pjson_dom_value *array, size_t index);
+
+  /**
+   * Looks up a property by its (unescaped) name with a linear scan.
+   * @returns The value of the first member named `name` of an object, or `NULL` if `object` is not an object or has no such member.
+   */
+  const pjson_dom_value *PJSON_API(pjson_dom_object_get)(const pjson_dom_value *object, const char *name, size_t length);
+
+  /* On-demand cursor */
+
+  typedef struct pjson_doc pjson_doc;
+
+  /**
+   * Handle of a value of a document opened by `pjson_doc_open`. Values are read from the input only when accessed, and
+   * the cursor moves forward only: a value must be accessed before the following ones (its next siblings, and the next
+   * siblings of the arrays and objects containing it). Values which are not accessed are skipped without tokenizing
+   * their content. Handles take no memory besides their own struct.
+   */
+  typedef struct pjson_value {
+    pjson_doc /* non-owning */ *doc;
+    /** Sequence number of the value in the document. Used internally only. */
+    size_t index;
+    /** Nesting depth of the value (0 for the top-level value). Used internally only. */
+    size_t depth;
+    /**
+     * First token of the value (`PJSON_TOKEN_NONE` until it's read), i.e. the bracket or brace opening an array or object.
+     * Strings are not unescaped (see `pjson_value_get_string`).
+     */
+    pjson_token token;
+  } pjson_value;
+
+  /**
+   * Cursor navigating a JSON document in a buffer on demand (pulling one token at a time from a `pjson_tokenizer`).
+   * Stores mostly internal state. Do not modify members directly.
+   */
+  struct pjson_doc {
+    pjson_parser_base base; // receives the tokens pulled from the tokenizer
+    pjson_tokenizer tokenizer;
+    const uint8_t /* non-owning */ *data;
+    size_t length;
+    /**
+     * `PJSON_STATUS_SUCCESS`, or the first error encountered (in which case the cursor stops). The position of the
+     * error is reported by the tokenizer as in the case of `pjson_feed` (see `tokenizer.token_start_index`).
+     * `PJSON_STATUS_USER_ERROR` reports values accessed out of order, and arrays or objects accessed as the other one.
+     */
+    pjson_parsing_status status;
+    pjson_token token; // last token read
+    size_t depth; // number of arrays and objects open
+    size_t value_count; // number of values handed out
+    size_t pending_value; // index of the value beginning with the next token, 0 if none
+    bool is_after_value; // whether a value of the innermost array or object (or the top-level value) has been consumed
+    bool is_skipping; // whether arrays and objects beginning with the next token are to be skipped
+    bool is_skipped; // whether the last token closes an array or object skipped entirely
+    bool is_token_read;
+    bool is_closed; // whether the tokenizer has reached the end of the input
+  };
+
+  /**
+   * Opens a JSON document for navigating it on demand.
+   * `pjson_doc_close` must be called to release the memory of the tokenizer.
+   * @param doc Pointer to a `pjson_doc` struct. Required, cannot be `NULL`. Must not be moved while in use.
+   * @param data The whole document. Must stay valid and unchanged until the document is closed.
+   * @param options Optional, can be `NULL` (see `pjson_init_ex`). Strings are never unescaped, scattered or streamed.
+   * @param root Receives the handle of the top-level value.
+   */
+  void PJSON_API(pjson_doc_open)(pjson_doc *doc, const uint8_t *data, size_t length, const pjson_tokenizer_options *options,
+    pjson_value *root);
+
+  /**
+   * Skips the rest of the document, checking that nothing follows the top-level value, and releases the memory of the tokenizer.
+   * @returns `PJSON_STATUS_COMPLETED`, or the first error encountered.
+   */
+  pjson_parsing_status PJSON_API(pjson_doc_close)(pjson_doc *doc);
+
+  /**
+   * Moves to the next item of an array, skipping what is left of the previous one.
+   * @param item Receives the handle of the item.
+   * @returns `true` if there is a next item, `false` at the end of the array or if an error occurred (see `pjson_doc.status`).
+   */
+  bool PJSON_API(pjson_arr_next)(pjson_value *array, pjson_value *item);
+
+  /**
+   * Moves to the next member of an object, skipping what is left of the previous one.
+   * @param name Receives the property name token (not unescaped). Optional, can be `NULL`.
+   * @param value Receives the handle of the value.
+   * @returns `true` if there is a next member, `false` at the end of the object or if an error occurred (see `pjson_doc.status`).
+   */
+  bool PJSON_API(pjson_obj_next_field)(pjson_value *object, pjson_token *name, pjson_value *value);
+
+  /**
+   * Moves to the next member of an object named `name` (unescaped), skipping the members before it. Members preceding
+   * the current position are not looked at, so the fields of an object are best looked up in document order.
+   * @param value Receives the handle of the value.
+   * @returns `true` if the member is found, `false` if the end of the object is reached or an error occurred (see `pjson_doc.status`).
+   */
+  bool PJSON_API(pjson_obj_find_field)(pjson_value *object, const char *name, size_t length, pjson_value *value);
+
+  /** @returns The type of the first token of the value, or `PJSON_TOKEN_ERROR` if an error occurred (see `pjson_doc.status`). */
+  pjson_token_type PJSON_API(pjson_value_get_type)(pjson_value *value);
+
+  /** @returns `false` if the value is not a boolean, or if an error occurred (see `pjson_doc.status`). */
+  bool PJSON_API(pjson_value_get_bool)(pjson_value *value, bool *result);
+
+  /** @returns `false` if the value is not a number fitting into `int64_t`, or if an error occurred (see `pjson_doc.status`). */
+  bool PJSON_API(pjson_value_get_int64)(pjson_value *value, int64_t *num);
+
+  /** @returns `false` if the value is not a number, or if an error occurred (see `pjson_doc.status`). */
+  bool PJSON_API(pjson_value_get_double)(pjson_value *value, double *num);
+
+  /**
+   * Unescapes a string value to `dest` (not zero-terminated, see `pjson_parse_string`).
+   * @param length Receives the length of the unescaped value in bytes, even if it doesn't fit into `dest`. Optional, can be `NULL`.
+   * @returns `false` if the value is not a string, if it doesn't fit into `dest`, or if an error occurred (see `pjson_doc.status`).
+   */
+  bool PJSON_API(pjson_value_get_string)(pjson_value *value, uint8_t *dest, size_t dest_size, size_t *length);
+
   /* Helpers */
 
   bool PJSON_API(pjson_parse_string)(uint8_t *dest, size_t dest_size, const uint8_t *token_start, size_t token_length, bool replace_lone_surrogates);
@@ -219,6 +1241,18 @@ extern "C" {
   bool PJSON_API(pjson_parse_float)(float *num, const uint8_t *token_start, size_t token_length);
   bool PJSON_API(pjson_parse_double)(double *num, const uint8_t *token_start, size_t token_length);
 
+  /**
+   * Like `pjson_parse_float`, but numbers too long to be parsed on the stack are copied into a buffer allocated
+   * using `allocator` (optional, can be `NULL` to use the default one).
+   */
+  bool PJSON_API(pjson_parse_float_ex)(float *num, const uint8_t *token_start, size_t token_length, const pjson_allocator *allocator);
+
+  /**
+   * Like `pjson_parse_double`, but numbers too long to be parsed on the stack are copied into a buffer allocated
+   * using `allocator` (optional, can be `NULL` to use the default one).
+   */
+  bool PJSON_API(pjson_parse_double_ex)(double *num, const uint8_t *token_start, size_t token_length, const pjson_allocator *allocator);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -45,6 +45,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // Define PJSON_NO_LOCALE if localeconv (locale.h) is not available.
 // #define PJSON_NO_LOCALE
 
+// Define PJSON_NO_SIMD to disable the SIMD-accelerated (SSE2/SSSE3/AVX2) kernels. (Otherwise the kernels to use are
+// selected at run time based on the capabilities of the CPU, see pjson_set_kernel_level.)
+// #define PJSON_NO_SIMD
+
+// Define PJSON_USE_COMPUTED_GOTO to make the tokenizer dispatch on its states through computed gotos (direct threading)
+// instead of a switch statement. Requires the "labels as values" extension of GCC/Clang, ignored by other compilers.
+// #define PJSON_USE_COMPUTED_GOTO
+
+// Define PJSON_COMPACT_TOKENIZER to shrink pjson_tokenizer for applications which keep lots of mostly idle tokenizers
+// (e.g. one per connection) around: buffer sizes, limits and counters are stored as 32-bit integers (limiting tokens and
+// buffers to 4 GiB), the state fields are packed and the fixed-size part of the internal buffer is left out (so
+// PJSON_INTERNAL_BUFFER_FIXED_SIZE is ignored). Tokens straddling input chunks are then buffered in slabs borrowed from
+// a buffer pool (see pjson_tokenizer_options.buffer_pool) or in memory allocated on demand.
+// #define PJSON_COMPACT_TOKENIZER
+
+// PJSON_PARSER_INLINE_DEPTH sets the number of contexts stored inside pjson_parser when its built-in context stack is
+// used without caller-provided storage (see pjson_parser_init_ex). Deeper levels spill to blocks allocated on demand.
+#ifndef PJSON_PARSER_INLINE_DEPTH
+#define PJSON_PARSER_INLINE_DEPTH (8)
+#endif
+
 #ifndef PJSON_INTERNAL_BUFFER_FIXED_SIZE
 #define PJSON_INTERNAL_BUFFER_FIXED_SIZE (256)
 #endif
@@ -0,0 +1,292 @@
+/*
+3-Clause BSD Non-AI License
+
+Copyright (c) 2024 Adam Simon. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+4. The source code, and any modifications made to it may not be used for the
+   purpose of training or improving machine learning algorithms, including but
+   not limited to artificial intelligence, natural language processing, or
+   data mining. This condition applies to any derivatives, modifications, or
+   updates based on the Software code. Any usage of the source code in an
+   AI-training dataset is considered a breach of this License.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __PJSON_PARSER_TEMPLATE_H__
+#define __PJSON_PARSER_TEMPLATE_H__
+
+#include <string.h>
+
+#include "pjson.h"
+
+/*
+ * `PJSON_DEFINE_PARSER` generates a parser specialized for a given context type, maximum depth and pair of callbacks.
+ * It implements the same grammar as `pjson_parser` but everything it needs is known at compile time: the context stack
+ * is a fixed-size array and the callbacks are called directly, so the compiler can inline them into the generated eat
+ * functions. The only indirect call left per token is the one made by the tokenizer.
+ *
+ * Usage:
+ *
+ *   typedef struct { size_t counter; } my_context;
+ *   typedef struct my_parser my_parser; // the macro defines the struct but not the typedef
+ *   static pjson_parsing_status my_on_value(my_parser *parser, my_context *context, const pjson_token *token);
+ *   PJSON_DEFINE_PARSER(my_parser, my_context, 64, my_on_value, PJSON_PARSER_IGNORE)
+ *
+ *   my_parser parser;
+ *   my_parser_init(&parser, false);
+ *   pjson_init(&tokenizer, &parser.base);
+ *
+ * This defines `struct my_parser` and the following static functions:
+ *   - `void my_parser_init(my_parser *parser, bool is_lazy)`: initializes or resets the parser.
+ *     (The `is_lazy` parameter has the same meaning as in `pjson_parser_init`.)
+ *   - `my_context *my_parser_current_context(my_parser *parser)`: returns the current context.
+ *
+ * The callbacks work like `pjson_parser_context.on_value` and `pjson_parser_context.on_object_property_name`:
+ * they receive the context of the enclosing array or object (or the top-level context); when an array or object is
+ * beginning (or ending), its own context is the current one (see `my_parser_current_context`). They can be functions or
+ * function-like macros taking `(parser, context, token)`, e.g. `PJSON_PARSER_IGNORE`. Contexts are zero-initialized
+ * when pushed. At most `max_depth` levels of arrays and objects can be nested, deeper input is rejected with
+ * `PJSON_STATUS_MAX_DEPTH_EXCEEDED`. Any other data needed by the callbacks can be stored in the `user_data` member.
+ * Returning `PJSON_STATUS_SKIP` from `on_value_fn` for an opening token skips the content of the array or object
+ * (there is no validating mode, unlike `pjson_parser_options.validate_skipped_values`).
+ */
+
+/** Callback which ignores the token, for use with `PJSON_DEFINE_PARSER`. */
+#define PJSON_PARSER_IGNORE(parser, context, token) \
+  ((void)(parser), (void)(context), (void)(token), PJSON_STATUS_SUCCESS)
+
+// Note for maintainers: the generated functions mirror the eat functions of pjson_parser (see pjson.c).
+
+#define PJSON_DEFINE_PARSER(name, context_type, max_depth, on_value_fn, on_name_fn) \
+  struct name { \
+    pjson_parser_base base; /* base struct MUST be the first member! */ \
+    void *user_data; \
+    size_t depth; /* number of arrays and objects open */ \
+    pjson_parser_eat next_eats[(max_depth) + 1]; /* eat function to continue with after the array or object ends */ \
+    context_type contexts[(max_depth) + 1]; \
+  }; \
+  \
+  static inline context_type *name##_current_context(name *parser) { \
+    return &parser->contexts[parser->depth]; \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_array_element_or_end(pjson_parser_base *base, const pjson_token *token); \
+  static inline pjson_parsing_status name##_eat_object_property_name_or_end(pjson_parser_base *base, const pjson_token *token); \
+  static inline pjson_parsing_status name##_eat_skipped_array_end(pjson_parser_base *base, const pjson_token *token); \
+  static inline pjson_parsing_status name##_eat_skipped_object_end(pjson_parser_base *base, const pjson_token *token); \
+  \
+  static inline pjson_parsing_status name##_eat_eos(pjson_parser_base *base, const pjson_token *token) { \
+    (void)base; \
+    return token->type == PJSON_TOKEN_EOS ? PJSON_STATUS_COMPLETED : PJSON_STATUS_SYNTAX_ERROR; \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_value(name *parser, const pjson_token *token, \
+    pjson_parser_eat primitive_value_next_eat, \
+    pjson_parser_eat complex_value_next_eat, \
+    pjson_parsing_status primitive_value_status, \
+    pjson_parsing_status eos_status) { \
+    \
+    pjson_parsing_status status; \
+    pjson_parser_eat nested_eat; \
+    \
+    switch (token->type) { \
+      case PJSON_TOKEN_NULL: \
+      case PJSON_TOKEN_FALSE: \
+      case PJSON_TOKEN_TRUE: \
+      case PJSON_TOKEN_NUMBER: \
+      case PJSON_TOKEN_STRING: \
+        status = on_value_fn(parser, &parser->contexts[parser->depth], token); \
+        if (status != PJSON_STATUS_SUCCESS && status != PJSON_STATUS_SKIP) goto Error; \
+        parser->base.eat = primitive_value_next_eat; \
+        return primitive_value_status; \
+      \
+      case PJSON_TOKEN_OPEN_BRACKET: \
+        nested_eat = &name##_eat_array_element_or_end; \
+        break; \
+      \
+      case PJSON_TOKEN_OPEN_BRACE: \
+        nested_eat = &name##_eat_object_property_name_or_end; \
+        break; \
+      \
+      case PJSON_TOKEN_EOS: \
+        return eos_status; \
+      \
+      default: \
+        return PJSON_STATUS_SYNTAX_ERROR; \
+    } \
+    \
+    if (parser->depth >= (size_t)(max_depth)) return PJSON_STATUS_MAX_DEPTH_EXCEEDED; \
+    parser->next_eats[parser->depth] = complex_value_next_eat; \
+    memset(&parser->contexts[++parser->depth], 0, sizeof(context_type)); \
+    \
+    status = on_value_fn(parser, &parser->contexts[parser->depth - 1], token); \
+    if (status != PJSON_STATUS_SUCCESS) { \
+      if (status != PJSON_STATUS_SKIP) goto Error; \
+      nested_eat = token->type == PJSON_TOKEN_OPEN_BRACKET ? &name##_eat_skipped_array_end : &name##_eat_skipped_object_end; \
+    } \
+    \
+    parser->base.eat = nested_eat; \
+    return status; \
+    \
+  Error: \
+    return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status; \
+  } \
+  \
+  static inline pjson_parsing_status name##_end_complex_value(name *parser, const pjson_token *token) { \
+    pjson_parsing_status status = on_value_fn(parser, &parser->contexts[parser->depth - 1], token); \
+    if (status != PJSON_STATUS_SUCCESS && status != PJSON_STATUS_SKIP) { \
+      return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status; \
+    } \
+    \
+    pjson_parser_eat next_eat = parser->next_eats[--parser->depth]; \
+    if (next_eat) { \
+      parser->base.eat = next_eat; \
+      return PJSON_STATUS_DATA_NEEDED; \
+    } \
+    else { \
+      parser->base.eat = &name##_eat_eos; \
+      return PJSON_STATUS_COMPLETED; \
+    } \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_skipped_array_end(pjson_parser_base *base, const pjson_token *token) { \
+    return token->type == PJSON_TOKEN_CLOSE_BRACKET \
+      ? name##_end_complex_value((name *)base, token) \
+      : PJSON_STATUS_SYNTAX_ERROR; \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_skipped_object_end(pjson_parser_base *base, const pjson_token *token) { \
+    return token->type == PJSON_TOKEN_CLOSE_BRACE \
+      ? name##_end_complex_value((name *)base, token) \
+      : PJSON_STATUS_SYNTAX_ERROR; \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_toplevel_value_greedy(pjson_parser_base *base, const pjson_token *token) { \
+    return name##_eat_value((name *)base, token, \
+      &name##_eat_eos, \
+      &name##_eat_eos, \
+      PJSON_STATUS_DATA_NEEDED, \
+      PJSON_STATUS_NO_TOKENS_FOUND); \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_toplevel_value_lazy(pjson_parser_base *base, const pjson_token *token) { \
+    return name##_eat_value((name *)base, token, \
+      &name##_eat_eos, \
+      NULL, /* used to indicate lazy parsing to `end_complex_value` */ \
+      PJSON_STATUS_COMPLETED, \
+      PJSON_STATUS_NO_TOKENS_FOUND); \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_array_element_separator_or_end(pjson_parser_base *base, const pjson_token *token); \
+  \
+  static inline pjson_parsing_status name##_eat_array_element(pjson_parser_base *base, const pjson_token *token) { \
+    return name##_eat_value((name *)base, token, \
+      &name##_eat_array_element_separator_or_end, \
+      &name##_eat_array_element_separator_or_end, \
+      PJSON_STATUS_DATA_NEEDED, \
+      PJSON_STATUS_SYNTAX_ERROR); \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_array_element_or_end(pjson_parser_base *base, const pjson_token *token) { \
+    return token->type != PJSON_TOKEN_CLOSE_BRACKET \
+      ? name##_eat_array_element(base, token) \
+      : name##_end_complex_value((name *)base, token); \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_array_element_separator_or_end(pjson_parser_base *base, const pjson_token *token) { \
+    switch (token->type) { \
+      case PJSON_TOKEN_COMMA: \
+        base->eat = &name##_eat_array_element; \
+        return PJSON_STATUS_DATA_NEEDED; \
+      \
+      case PJSON_TOKEN_CLOSE_BRACKET: \
+        return name##_end_complex_value((name *)base, token); \
+      \
+      default: \
+        return PJSON_STATUS_SYNTAX_ERROR; \
+    } \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_object_property_value(pjson_parser_base *base, const pjson_token *token); \
+  \
+  static inline pjson_parsing_status name##_eat_object_property_name_and_value_separator(pjson_parser_base *base, const pjson_token *token) { \
+    if (token->type == PJSON_TOKEN_COLON) { \
+      base->eat = &name##_eat_object_property_value; \
+      return PJSON_STATUS_DATA_NEEDED; \
+    } \
+    \
+    return PJSON_STATUS_SYNTAX_ERROR; \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_object_property_name(pjson_parser_base *base, const pjson_token *token) { \
+    if (token->type == PJSON_TOKEN_STRING) { \
+      name *parser = (name *)base; \
+      pjson_parsing_status status = on_name_fn(parser, &parser->contexts[parser->depth], token); \
+      if (status != PJSON_STATUS_SUCCESS) return status > 0 ? PJSON_STATUS_NONCOMPLIANT_PARSER : status; \
+      \
+      base->eat = &name##_eat_object_property_name_and_value_separator; \
+      return PJSON_STATUS_DATA_NEEDED; \
+    } \
+    \
+    return PJSON_STATUS_SYNTAX_ERROR; \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_object_property_name_or_end(pjson_parser_base *base, const pjson_token *token) { \
+    return token->type != PJSON_TOKEN_CLOSE_BRACE \
+      ? name##_eat_object_property_name(base, token) \
+      : name##_end_complex_value((name *)base, token); \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_object_property_separator_or_end(pjson_parser_base *base, const pjson_token *token) { \
+    switch (token->type) { \
+      case PJSON_TOKEN_COMMA: \
+        base->eat = &name##_eat_object_property_name; \
+        return PJSON_STATUS_DATA_NEEDED; \
+      \
+      case PJSON_TOKEN_CLOSE_BRACE: \
+        return name##_end_complex_value((name *)base, token); \
+      \
+      default: \
+        return PJSON_STATUS_SYNTAX_ERROR; \
+    } \
+  } \
+  \
+  static inline pjson_parsing_status name##_eat_object_property_value(pjson_parser_base *base, const pjson_token *token) { \
+    return name##_eat_value((name *)base, token, \
+      &name##_eat_object_property_separator_or_end, \
+      &name##_eat_object_property_separator_or_end, \
+      PJSON_STATUS_DATA_NEEDED, \
+      PJSON_STATUS_SYNTAX_ERROR); \
+  } \
+  \
+  static inline void name##_init(name *parser, bool is_lazy) { \
+    parser->base.eat = !is_lazy ? &name##_eat_toplevel_value_greedy : &name##_eat_toplevel_value_lazy; \
+    parser->depth = 0; \
+    memset(&parser->contexts[0], 0, sizeof(context_type)); \
+  }
+
+#endif // __PJSON_PARSER_TEMPLATE_H__
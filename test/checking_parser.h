@@ -0,0 +1,61 @@
+#ifndef __CHECKING_PARSER_H__
+#define __CHECKING_PARSER_H__
+
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+
+/* A parser (or token sink) which passes every token to a check and counts them, until the end of the input. (Inline so
+ * that tests may use either of them.) */
+
+typedef struct checking_parser checking_parser;
+
+typedef void (*checking_parser_check)(checking_parser *parser, const pjson_token *token);
+
+struct checking_parser {
+  pjson_parser_base base; // base struct MUST be the first member!
+  checking_parser_check check;
+  size_t token_count;
+};
+
+static inline void checking_parser_check_token(checking_parser *parser, const pjson_token *token) {
+  parser->token_count++;
+  parser->check(parser, token);
+}
+
+static inline pjson_parsing_status checking_parser_eat(pjson_parser_base *parser, const pjson_token *token) {
+  checking_parser_check_token((checking_parser *)parser, token);
+  return token->type != PJSON_TOKEN_EOS ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_COMPLETED;
+}
+
+/**
+ * Initializes the `checking_parser` which is the first member of a bigger struct, the members of which are zeroed.
+ * @param size Size of the bigger struct.
+ */
+static inline void checking_parser_init(checking_parser *parser, size_t size, checking_parser_check check) {
+  memset(parser, 0, size);
+  parser->base.eat = &checking_parser_eat;
+  parser->check = check;
+}
+
+typedef struct {
+  pjson_token_sink base;
+  checking_parser *parser;
+} checking_sink;
+
+static inline pjson_parsing_status checking_sink_eat(pjson_token_sink *sink, const pjson_token *tokens, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    checking_parser_check_token(((checking_sink *)sink)->parser, &tokens[i]);
+  }
+  return tokens[count - 1].type != PJSON_TOKEN_EOS ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_COMPLETED;
+}
+
+static inline void checking_sink_init(checking_sink *sink, pjson_token *tokens, size_t capacity, checking_parser *parser) {
+  sink->base.eat = &checking_sink_eat;
+  sink->base.tokens = tokens;
+  sink->base.capacity = capacity;
+  sink->parser = parser;
+}
+
+#endif // __CHECKING_PARSER_H__
@@ -0,0 +1,49 @@
+#ifndef __CHUNK_HANDLERS_H__
+#define __CHUNK_HANDLERS_H__
+
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+
+/* A string chunk handler which only counts what it receives, for consumers which must cope with streamed strings. */
+
+typedef struct {
+  pjson_string_chunk_handler base;
+  size_t byte_count;
+  size_t string_count;
+} counting_chunk_handler;
+
+static pjson_parsing_status counting_chunk_handler_on_chunk(pjson_string_chunk_handler *handler, size_t start_index, const uint8_t *chunk, size_t length) {
+  (void)start_index;
+  TEST_ASSERT_NOT_NULL(chunk);
+  ((counting_chunk_handler *)handler)->byte_count += length;
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+static pjson_parsing_status counting_chunk_handler_on_end(pjson_string_chunk_handler *handler, const pjson_token *token) {
+  TEST_ASSERT_NULL(token->start);
+  ((counting_chunk_handler *)handler)->string_count++;
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+static void counting_chunk_handler_init(counting_chunk_handler *handler, size_t threshold) {
+  handler->base.on_chunk = &counting_chunk_handler_on_chunk;
+  handler->base.on_end = &counting_chunk_handler_on_end;
+  handler->base.threshold = threshold;
+  handler->byte_count = handler->string_count = 0;
+}
+
+/**
+ * Feed `input` to `tokenizer` in two chunks split at `split_index` (so that a string straddling it gets streamed), then
+ * close it.
+ */
+static pjson_parsing_status feed_split(pjson_tokenizer *tokenizer, const char *input, size_t split_index) {
+  size_t length = strlen(input);
+  pjson_parsing_status status = pjson_feed(tokenizer, (const uint8_t *)input, split_index);
+  if (status == PJSON_STATUS_DATA_NEEDED) status = pjson_feed(tokenizer, (const uint8_t *)input + split_index, length - split_index);
+  pjson_parsing_status close_status = pjson_close(tokenizer);
+  return status == PJSON_STATUS_DATA_NEEDED ? close_status : status;
+}
+
+#endif // __CHUNK_HANDLERS_H__
@@ -0,0 +1,59 @@
+#ifndef __COUNTING_ALLOCATOR_H__
+#define __COUNTING_ALLOCATOR_H__
+
+#include <stdlib.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+
+/* An allocator which counts the allocations and checks that all memory is released with the right sizes. */
+
+typedef struct {
+  pjson_allocator base;
+  size_t allocation_count; // successful allocations and reallocations
+  size_t live_size; // the sum of the sizes passed in by the code under test, must get back to 0
+  size_t allocation_limit; // allocations and reallocations fail once this many succeeded (unlimited by default)
+  bool can_reallocate; // reallocations fail the test if not set
+} counting_allocator;
+
+static void *counting_allocate(void *user_data, size_t size) {
+  counting_allocator *allocator = (counting_allocator *)user_data;
+  if (allocator->allocation_count == allocator->allocation_limit) return NULL;
+  allocator->allocation_count++;
+  allocator->live_size += size;
+  return malloc(size);
+}
+
+static void *counting_reallocate(void *user_data, void *ptr, size_t old_size, size_t new_size) {
+  counting_allocator *allocator = (counting_allocator *)user_data;
+  if (!allocator->can_reallocate) TEST_FAIL_MESSAGE("The code under test is not expected to reallocate.");
+  TEST_ASSERT_TRUE(ptr || !old_size);
+  TEST_ASSERT_TRUE(old_size <= allocator->live_size);
+  if (allocator->allocation_count == allocator->allocation_limit) return NULL;
+
+  void *new_ptr = realloc(ptr, new_size);
+  if (!new_ptr) return NULL;
+  allocator->allocation_count++;
+  allocator->live_size += new_size - old_size;
+  return new_ptr;
+}
+
+static void counting_deallocate(void *user_data, void *ptr, size_t size) {
+  counting_allocator *allocator = (counting_allocator *)user_data;
+  TEST_ASSERT_NOT_NULL(ptr);
+  TEST_ASSERT_TRUE(size <= allocator->live_size);
+  allocator->live_size -= size;
+  free(ptr);
+}
+
+static void counting_allocator_init(counting_allocator *allocator, bool can_reallocate) {
+  allocator->base.allocate = &counting_allocate;
+  allocator->base.reallocate = &counting_reallocate;
+  allocator->base.deallocate = &counting_deallocate;
+  allocator->base.user_data = allocator;
+  allocator->allocation_count = allocator->live_size = 0;
+  allocator->allocation_limit = (size_t)-1;
+  allocator->can_reallocate = can_reallocate;
+}
+
+#endif // __COUNTING_ALLOCATOR_H__
@@ -80,7 +80,7 @@ static pjson_parsing_status parse_string_property_value(ds_parser *parser, ds_pa
   uint8_t **value_ptr = (uint8_t **)context->data.item.current_member;
   *value_ptr = (uint8_t *)pjson_malloc(token->unescaped_length + 1);
   if (!*value_ptr) return PJSON_STATUS_OUT_OF_MEMORY;
-  pjson_parse_string(*value_ptr, token->unescaped_length, token->start, token->length, false);
+  memcpy(*value_ptr, token->unescaped, token->unescaped_length); // the tokenizer is expected to unescape strings
   (*value_ptr)[token->unescaped_length] = 0;
   return PJSON_STATUS_SUCCESS;
 }
@@ -99,27 +99,9 @@ static pjson_parsing_status parse_double_property_value(ds_parser *parser, ds_pa
   return PJSON_STATUS_SUCCESS;
 }
 
-static const char *get_property_name(const pjson_token *token) {
-  if (token->unescaped_length == token->length - 2) {
-    return (const char *)token->start + 1;
-  }
-
-  uint8_t *property_name = (uint8_t *)pjson_malloc(token->unescaped_length);
-  if (!property_name) return NULL;
-  pjson_parse_string(property_name, token->unescaped_length, token->start, token->length, false);
-  return (const char *)property_name;
-}
-
-static void free_property_name(const char *property_name, const pjson_token *token) {
-  if ((uint8_t *)property_name != token->start + 1) {
-    pjson_free((char *)property_name);
-  }
-}
-
 static pjson_parsing_status parse_item_property_name(ds_parser *parser, ds_parser_context *context, const pjson_token *token) {
   (void)parser;
-  const char *property_name = get_property_name(token);
-  if (!property_name) return PJSON_STATUS_OUT_OF_MEMORY;
+  const char *property_name = (const char *)token->unescaped;
 
   if (strncmp(property_name, PROPERTY_NAME_ID, token->unescaped_length) == 0) {
     context->data.item.current_member = &context->data.item.ptr->id;
@@ -134,11 +116,9 @@ static pjson_parsing_status parse_item_property_name(ds_parser *parser, ds_parse
     context->base.on_value = (pjson_parser_context_callback)&parse_double_property_value;
   }
   else {
-    free_property_name(property_name, token);
     return PJSON_STATUS_USER_ERROR;
   }
 
-  free_property_name(property_name, token);
   return PJSON_STATUS_SUCCESS;
 }
 
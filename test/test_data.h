@@ -0,0 +1,31 @@
+#ifndef __TEST_DATA_H__
+#define __TEST_DATA_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+
+/**
+ * Read the whole file at `file_path` (relative to the working directory of the tests) into memory.
+ * The returned buffer must be released with `free()`.
+ */
+static uint8_t *load_file(const char *file_path, size_t *length) {
+  FILE *file = fopen(file_path, "rb");
+  TEST_ASSERT_NOT_NULL(file);
+
+  fseek(file, 0, SEEK_END);
+  long file_length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  TEST_ASSERT_TRUE(file_length >= 0);
+
+  uint8_t *data = (uint8_t *)malloc(file_length > 0 ? (size_t)file_length : 1u);
+  TEST_ASSERT_NOT_NULL(data);
+  *length = fread(data, 1, (size_t)file_length, file);
+  fclose(file);
+  TEST_ASSERT_EQUAL((size_t)file_length, *length);
+  return data;
+}
+
+#endif // __TEST_DATA_H__
@@ -0,0 +1,106 @@
+#ifndef __TEST_INPUT_H__
+#define __TEST_INPUT_H__
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+
+/* Helpers for building inputs and feeding them in chunks. (Inline so that tests may use any subset of them.) */
+
+/**
+ * Feed `data` in chunks of `chunk_size` bytes using `feed` (`pjson_feed` or `pjson_feed_batch`). Each chunk is copied
+ * into a scratch buffer which is clobbered right afterwards, so that tokens still referring to a previous chunk are
+ * caught. Tokenizers which scatter strings require the chunks to stay valid, so they are fed `data` in place.
+ */
+static inline pjson_parsing_status feed_in_chunks(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length, size_t chunk_size,
+  pjson_parsing_status(*feed)(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length)) {
+  assert(chunk_size > 0);
+  uint8_t *buf = tokenizer->scatter_strings ? NULL : (uint8_t *)malloc(chunk_size);
+  TEST_ASSERT_TRUE(tokenizer->scatter_strings || buf);
+
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  for (size_t offset = 0; offset < length && status == PJSON_STATUS_DATA_NEEDED; offset += chunk_size) {
+    size_t chunk_length = length - offset < chunk_size ? length - offset : chunk_size;
+    if (!buf) {
+      status = feed(tokenizer, data + offset, chunk_length);
+      continue;
+    }
+
+    memcpy(buf, data + offset, chunk_length);
+    status = feed(tokenizer, buf, chunk_length);
+    memset(buf, 0, chunk_length);
+  }
+
+  free(buf);
+  return status;
+}
+
+/** A growable buffer for building inputs. */
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+} input_builder;
+
+static inline void input_builder_init(input_builder *builder) {
+  memset(builder, 0, sizeof(*builder));
+}
+
+static inline uint8_t *input_builder_reserve(input_builder *builder, size_t count) {
+  if (builder->length + count > builder->capacity) {
+    size_t new_capacity = builder->capacity * 2 > builder->length + count ? builder->capacity * 2 : builder->length + count;
+    builder->data = (uint8_t *)realloc(builder->data, new_capacity);
+    TEST_ASSERT_NOT_NULL(builder->data);
+    builder->capacity = new_capacity;
+  }
+
+  uint8_t *p = builder->data + builder->length;
+  builder->length += count;
+  return p;
+}
+
+static inline void input_builder_append(input_builder *builder, const char *text) {
+  size_t count = strlen(text);
+  memcpy(input_builder_reserve(builder, count), text, count);
+}
+
+/**
+ * Append `count` copies of `ch`.
+ */
+static inline void input_builder_fill(input_builder *builder, char ch, size_t count) {
+  memset(input_builder_reserve(builder, count), ch, count);
+}
+
+/**
+ * Return the input built so far. The returned buffer must be released with `free()`.
+ */
+static inline uint8_t *input_builder_finish(input_builder *builder, size_t *length) {
+  *length = builder->length;
+  return builder->data ? builder->data : (uint8_t *)calloc(1, 1);
+}
+
+/**
+ * Build an array of `count` strings, the `i`-th of which is `string_lengths[i]` bytes long (including the quotes) and
+ * consists of `prefix` (e.g. an escape sequence) followed by copies of a letter which varies from string to string.
+ */
+static inline uint8_t *make_string_array(const size_t *string_lengths, size_t count, const char *prefix, size_t *length) {
+  input_builder builder;
+  input_builder_init(&builder);
+
+  input_builder_append(&builder, "[");
+  for (size_t i = 0; i < count; i++) {
+    assert(string_lengths[i] >= strlen(prefix) + 2);
+    input_builder_append(&builder, i ? ",\"" : "\"");
+    input_builder_append(&builder, prefix);
+    input_builder_fill(&builder, (char)('a' + i % 26), string_lengths[i] - strlen(prefix) - 2);
+    input_builder_append(&builder, "\"");
+  }
+  input_builder_append(&builder, "]");
+
+  return input_builder_finish(&builder, length);
+}
+
+#endif // __TEST_INPUT_H__
@@ -41,10 +41,27 @@ int main(void) {
   TEST_PRINTF("Random seed: %u\n\n", rand_seed);
 
   UNITY_BEGIN();
+  RUN_TEST_GROUP(arena);
   RUN_TEST_GROUP(basics);
+  RUN_TEST_GROUP(batch);
+  RUN_TEST_GROUP(binding);
+  RUN_TEST_GROUP(buffers);
+  RUN_TEST_GROUP(context_stack);
+  RUN_TEST_GROUP(doc);
+  RUN_TEST_GROUP(dom);
   RUN_TEST_GROUP(errors);
   RUN_TEST_GROUP(feed_fuzzy);
+  RUN_TEST_GROUP(index);
+  RUN_TEST_GROUP(limits);
+  RUN_TEST_GROUP(name_table);
   RUN_TEST_GROUP(parse_datastruct);
+  RUN_TEST_GROUP(parser_template);
+  RUN_TEST_GROUP(path_filter);
+  RUN_TEST_GROUP(scatter);
+  RUN_TEST_GROUP(skip);
+  RUN_TEST_GROUP(string_chunks);
+  RUN_TEST_GROUP(tape);
+  RUN_TEST_GROUP(unescape);
   RUN_TEST_GROUP(value_helpers);
   return UNITY_END();
 }
@@ -0,0 +1,102 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "counting_allocator.h"
+
+TEST_GROUP(arena);
+
+TEST_SETUP(arena) {}
+
+TEST_TEAR_DOWN(arena) {}
+
+TEST(arena, test_arena_allocate) {
+  static const size_t alignments[] = { 1, 2, 4, 8, 16 };
+  static uint8_t buffer[100];
+
+  counting_allocator allocator;
+  counting_allocator_init(&allocator, false);
+  pjson_arena arena;
+  pjson_arena_init(&arena, buffer, sizeof(buffer), &allocator.base);
+
+  // The first allocations come from the buffer.
+  uint8_t *p = pjson_arena_allocate(&arena, 10, 1);
+  TEST_ASSERT_TRUE(p == buffer);
+  uint8_t *q = pjson_arena_allocate(&arena, 8, 8);
+  TEST_ASSERT_TRUE(q >= buffer + 10 && q < buffer + 18);
+  TEST_ASSERT_EQUAL(0, (uintptr_t)q % 8);
+  TEST_ASSERT_EQUAL(0, allocator.allocation_count);
+
+  // Allocations are aligned, don't overlap and stay valid.
+  uint8_t *prev = NULL;
+  for (size_t i = 0; i < 1000; i++) {
+    size_t alignment = alignments[i % pjson_countof(alignments)];
+    size_t size = i % 7 == 6 ? 5000 : i % 50;
+    p = pjson_arena_allocate(&arena, size, alignment);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)p % alignment);
+    memset(p, (int)(i & 0xFF), size);
+    if (prev) TEST_ASSERT_EQUAL((i - 1) & 0xFF, *prev);
+    prev = size ? p + size - 1 : NULL;
+  }
+  TEST_ASSERT_TRUE(allocator.allocation_count > 0);
+  TEST_ASSERT_TRUE(allocator.allocation_count < 20);
+
+  pjson_arena_free(&arena);
+  TEST_ASSERT_EQUAL(0, allocator.live_size);
+}
+
+TEST(arena, test_arena_reset) {
+  counting_allocator allocator;
+  counting_allocator_init(&allocator, false);
+  pjson_arena arena;
+  pjson_arena_init(&arena, NULL, 0, &allocator.base);
+
+  for (size_t round = 0; round < 3; round++) {
+    for (size_t i = 0; i < 100; i++) {
+      TEST_ASSERT_NOT_NULL(pjson_arena_allocate(&arena, 1000, 8));
+    }
+    // The blocks allocated in the first round are reused afterwards.
+    size_t allocation_count = allocator.allocation_count;
+    pjson_arena_reset(&arena);
+    if (round > 0) TEST_ASSERT_EQUAL(allocation_count, allocator.allocation_count);
+  }
+  TEST_ASSERT_TRUE(allocator.allocation_count > 0);
+
+  pjson_arena_free(&arena);
+  TEST_ASSERT_EQUAL(0, allocator.live_size);
+}
+
+TEST(arena, test_arena_reallocate) {
+  pjson_arena arena;
+  pjson_arena_init(&arena, NULL, 0, NULL);
+
+  // The most recent allocation grows in place while it fits.
+  uint8_t *p = pjson_arena_reallocate(&arena, NULL, 0, 16, 8);
+  TEST_ASSERT_NOT_NULL(p);
+  memset(p, 0xAB, 16);
+  TEST_ASSERT_TRUE(p == pjson_arena_reallocate(&arena, p, 16, 64, 8));
+
+  // Otherwise the data is copied.
+  uint8_t *other = pjson_arena_allocate(&arena, 1, 1);
+  TEST_ASSERT_NOT_NULL(other);
+  uint8_t *q = pjson_arena_reallocate(&arena, p, 64, 128, 8);
+  TEST_ASSERT_TRUE(q != p);
+  for (size_t i = 0; i < 16; i++) TEST_ASSERT_EQUAL(0xAB, q[i]);
+
+  // Growing beyond the block moves the data to a new block.
+  uint8_t *r = pjson_arena_reallocate(&arena, q, 128, 100000, 8);
+  TEST_ASSERT_NOT_NULL(r);
+  for (size_t i = 0; i < 16; i++) TEST_ASSERT_EQUAL(0xAB, r[i]);
+
+  pjson_arena_free(&arena);
+}
+
+TEST_GROUP_RUNNER(arena) {
+  RUN_TEST_CASE(arena, test_arena_allocate);
+  RUN_TEST_CASE(arena, test_arena_reset);
+  RUN_TEST_CASE(arena, test_arena_reallocate);
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "unity_fixture.h"
@@ -550,6 +551,101 @@ TEST(basics, test_parse_multiple_toplevel_values_lazy) {
   TEST_ASSERT_EQUAL(PJSON_TOKEN_NONE, parser.toplevel_datatype);
 }
 
+TEST(basics, test_parse_buffer_reuse) {
+  static const struct { const char *input; pjson_parsing_status status; pjson_token_type toplevel_datatype; } messages[] = {
+    { "{\"a\": \"x\\ny\"}", PJSON_STATUS_COMPLETED, PJSON_TOKEN_CLOSE_BRACE },
+    { "[1, {\"b\": [true", PJSON_STATUS_SYNTAX_ERROR, PJSON_TOKEN_OPEN_BRACKET },
+    { "\"\\u0041\"", PJSON_STATUS_COMPLETED, PJSON_TOKEN_STRING },
+    { "", PJSON_STATUS_NO_TOKENS_FOUND, PJSON_TOKEN_NONE },
+    { "[[{}], 2]", PJSON_STATUS_COMPLETED, PJSON_TOKEN_CLOSE_BRACKET },
+  };
+
+  stats_parser parser;
+  stats_parser_init(&parser, false);
+
+  pjson_tokenizer_options options = { .unescape_strings = true };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+
+  const uint8_t *unescape_buf = NULL;
+  for (size_t i = 0; i < pjson_countof(messages); i++) {
+    parser.toplevel_datatype = PJSON_TOKEN_NONE;
+    pjson_parser_rewind(&parser.base, false);
+    TEST_ASSERT_EQUAL(1, parser.base.depth);
+
+    pjson_parsing_status status = pjson_parse_buffer(&tokenizer, (const uint8_t *)messages[i].input, strlen(messages[i].input));
+    TEST_ASSERT_EQUAL(messages[i].status, status);
+    TEST_ASSERT_EQUAL(messages[i].toplevel_datatype, parser.toplevel_datatype);
+
+    // The scratch buffer allocated for unescaping the first message is reused.
+    if (!unescape_buf) unescape_buf = tokenizer.unescape_buf;
+    TEST_ASSERT_EQUAL_PTR(unescape_buf, tokenizer.unescape_buf);
+  }
+
+  pjson_close(&tokenizer);
+  TEST_ASSERT_NULL(tokenizer.unescape_buf);
+
+  // The tokenizer can be reused after pjson_close as well.
+  pjson_parser_rewind(&parser.base, false);
+  pjson_reset(&tokenizer);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_string(&tokenizer, "[null]"));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_CLOSE_BRACKET, parser.toplevel_datatype);
+}
+
+/* Kernels */
+
+TEST(basics, test_kernel_level_selection) {
+  pjson_kernel_level supported_level = pjson_set_kernel_level(PJSON_KERNEL_AVX2);
+  TEST_ASSERT_TRUE(supported_level >= PJSON_KERNEL_SCALAR && supported_level <= PJSON_KERNEL_AVX2);
+  TEST_ASSERT_EQUAL(supported_level, pjson_get_kernel_level());
+
+  TEST_ASSERT_EQUAL(PJSON_KERNEL_SCALAR, pjson_set_kernel_level(PJSON_KERNEL_SCALAR));
+  TEST_ASSERT_EQUAL(PJSON_KERNEL_SCALAR, pjson_get_kernel_level());
+
+  pjson_set_kernel_level(PJSON_KERNEL_AUTO);
+}
+
+TEST(basics, test_kernel_level_requested_by_environment) {
+  static const char *level_names[] = { "scalar", "sse2", "ssse3", "avx2" };
+
+  pjson_kernel_level supported_level = pjson_set_kernel_level(PJSON_KERNEL_AVX2);
+  pjson_kernel_level expected_level = supported_level;
+
+  const char *name = getenv("PJSON_KERNEL");
+  for (size_t i = 0; name && i < pjson_countof(level_names); i++) {
+    if (!strcmp(name, level_names[i]) && (pjson_kernel_level)i < supported_level) expected_level = (pjson_kernel_level)i;
+  }
+
+  TEST_ASSERT_EQUAL(expected_level, pjson_set_kernel_level(PJSON_KERNEL_AUTO));
+}
+
+TEST(basics, test_parse_with_each_kernel_level) {
+  const char *input =
+    "[\n    \"a plain ASCII string which is long enough for the vectorized kernels\",\n"
+    "    \"\xc3\xa1rv\xc3\xadzt\xc5\xb1r\xc5\x91 t\xc3\xbck\xc3\xb6rf\xc3\xbar\xc3\xb3g\xc3\xa9p \xe4\xbd\xa0\xe5\xa5\xbd\xe4\xb8\x96\xe7\x95\x8c \xf0\x9f\x98\x80\","
+    "                                        \n"
+    "    { \"key\": [1, 2.5e3, true, null, \"esc\\\"aped\"] }\n]";
+
+  pjson_kernel_level supported_level = pjson_set_kernel_level(PJSON_KERNEL_AVX2);
+  for (pjson_kernel_level level = PJSON_KERNEL_SCALAR; level <= supported_level; level++) {
+    TEST_ASSERT_EQUAL(level, pjson_set_kernel_level(level));
+
+    stats_parser parser;
+    stats_parser_init(&parser, false);
+
+    pjson_parsing_status close_status = parse_string(&parser, input, NULL);
+
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, close_status);
+    TEST_ASSERT_EQUAL(PJSON_TOKEN_CLOSE_BRACKET, parser.toplevel_datatype);
+    TEST_ASSERT_EQUAL(3, parser.datatype_counts[PJSON_TOKEN_STRING - PJSON_TOKEN_NULL]);
+    TEST_ASSERT_EQUAL(2, parser.datatype_counts[PJSON_TOKEN_NUMBER - PJSON_TOKEN_NULL]);
+    TEST_ASSERT_EQUAL(1, parser.key_count);
+  }
+
+  pjson_set_kernel_level(PJSON_KERNEL_AUTO);
+}
+
 TEST_GROUP_RUNNER(basics) {
   RUN_TEST_CASE(basics, test_parse_empty_input_greedy);
   RUN_TEST_CASE(basics, test_parse_empty_input_lazy);
@@ -597,4 +693,8 @@ TEST_GROUP_RUNNER(basics) {
 
   RUN_TEST_CASE(basics, test_parse_multiple_toplevel_values_greedy);
   RUN_TEST_CASE(basics, test_parse_multiple_toplevel_values_lazy);
+  RUN_TEST_CASE(basics, test_parse_buffer_reuse);
+  RUN_TEST_CASE(basics, test_kernel_level_selection);
+  RUN_TEST_CASE(basics, test_kernel_level_requested_by_environment);
+  RUN_TEST_CASE(basics, test_parse_with_each_kernel_level);
 }
@@ -0,0 +1,196 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "test_data.h"
+
+TEST_GROUP(batch);
+
+TEST_SETUP(batch) {}
+
+TEST_TEAR_DOWN(batch) {}
+
+typedef struct {
+  pjson_token_type type;
+  size_t start_index;
+  size_t length;
+  size_t unescaped_length;
+  uint32_t hash; // hash of the token bytes, checks that the start pointer is still valid when the token is received
+} recorded_token;
+
+typedef struct {
+  recorded_token *tokens;
+  size_t count;
+  size_t capacity;
+} token_record;
+
+static void record_token(token_record *record, const pjson_token *token) {
+  if (record->count == record->capacity) {
+    record->capacity = record->capacity ? record->capacity * 2 : 1024;
+    record->tokens = (recorded_token *)realloc(record->tokens, record->capacity * sizeof(*record->tokens));
+    TEST_ASSERT_NOT_NULL(record->tokens);
+  }
+
+  recorded_token *recorded = &record->tokens[record->count++];
+  memset(recorded, 0, sizeof(*recorded)); // zero the padding as records are compared using memcmp
+  recorded->type = token->type;
+  recorded->start_index = token->start_index;
+  recorded->length = token->length;
+  recorded->unescaped_length = token->unescaped_length;
+  recorded->hash = 2166136261u;
+  for (size_t i = 0; i < token->length; i++) {
+    recorded->hash = (recorded->hash ^ token->start[i]) * 16777619u;
+  }
+}
+
+typedef struct {
+  pjson_parser_base base;
+  token_record record;
+} recording_parser;
+
+static pjson_parsing_status recording_parser_eat(pjson_parser_base *parser, const pjson_token *token) {
+  record_token(&((recording_parser *)parser)->record, token);
+  return token->type != PJSON_TOKEN_EOS ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_COMPLETED;
+}
+
+typedef struct {
+  pjson_token_sink base;
+  token_record record;
+  size_t batch_count;
+  size_t fail_after; // number of tokens after which PJSON_STATUS_USER_ERROR is returned (0 means never)
+} recording_sink;
+
+static pjson_parsing_status recording_sink_eat(pjson_token_sink *sink, const pjson_token *tokens, size_t count) {
+  recording_sink *recording = (recording_sink *)sink;
+  TEST_ASSERT_TRUE(count > 0 && count <= sink->capacity);
+  TEST_ASSERT_EQUAL_PTR(sink->tokens, tokens);
+
+  recording->batch_count++;
+  for (size_t i = 0; i < count; i++) {
+    record_token(&recording->record, &tokens[i]);
+  }
+
+  if (recording->fail_after && recording->record.count >= recording->fail_after) return PJSON_STATUS_USER_ERROR;
+  return tokens[count - 1].type != PJSON_TOKEN_EOS ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_COMPLETED;
+}
+
+/**
+ * Feed `data` in random size chunks, copying each chunk into a scratch buffer which is clobbered afterwards
+ * so that tokens referencing a previous chunk are detected.
+ */
+static pjson_parsing_status feed_in_random_size_chunks(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length,
+  pjson_parsing_status(*feed)(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length)) {
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  uint8_t buf[128];
+
+  for (size_t offset = 0; offset < length; ) {
+    size_t chunk_length = (rand() % (sizeof(buf) - 4)) + 4; // get a random number between 4 and sizeof(buf) - 1
+    if (chunk_length > length - offset) chunk_length = length - offset;
+
+    memcpy(buf, data + offset, chunk_length);
+    status = feed(tokenizer, buf, chunk_length);
+    memset(buf, 0, sizeof(buf));
+
+    offset += chunk_length;
+    if (status != PJSON_STATUS_DATA_NEEDED) break;
+  }
+
+  return status;
+}
+
+static void assert_batch_matches_feed(const uint8_t *data, size_t length, size_t capacity) {
+  recording_parser parser = { { &recording_parser_eat }, { NULL, 0, 0 } };
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base);
+  feed_in_random_size_chunks(&tokenizer, data, length, &pjson_feed);
+  pjson_parsing_status expected_status = pjson_close(&tokenizer);
+
+  pjson_token *tokens = (pjson_token *)malloc(capacity * sizeof(pjson_token));
+  TEST_ASSERT_NOT_NULL(tokens);
+  recording_sink sink = { { &recording_sink_eat, tokens, capacity }, { NULL, 0, 0 }, 0, 0 };
+  pjson_init_batch(&tokenizer, &sink.base);
+  feed_in_random_size_chunks(&tokenizer, data, length, &pjson_feed_batch);
+  TEST_ASSERT_EQUAL(expected_status, pjson_close(&tokenizer));
+
+  TEST_ASSERT_EQUAL(parser.record.count, sink.record.count);
+  TEST_ASSERT_EQUAL_MEMORY(parser.record.tokens, sink.record.tokens, parser.record.count * sizeof(recorded_token));
+  if (capacity > 1) TEST_ASSERT_TRUE(sink.batch_count < sink.record.count);
+
+  free(tokens);
+  free(parser.record.tokens);
+  free(sink.record.tokens);
+}
+
+TEST(batch, test_batch_formatted_1mb) {
+  size_t length;
+  uint8_t *data = load_file("test/data/formatted_1mb.json", &length);
+  assert_batch_matches_feed(data, length, 256);
+  free(data);
+}
+
+TEST(batch, test_batch_minified_1mb) {
+  size_t length;
+  uint8_t *data = load_file("test/data/minified_1mb.json", &length);
+  assert_batch_matches_feed(data, length, 1);
+  assert_batch_matches_feed(data, length, 3);
+  assert_batch_matches_feed(data, length, 256);
+  free(data);
+}
+
+TEST(batch, test_batch_invalid_missing_colon) {
+  size_t length;
+  uint8_t *data = load_file("test/data/invalid_missing_colon.json", &length);
+  assert_batch_matches_feed(data, length, 64);
+  free(data);
+}
+
+TEST(batch, test_batch_sink_error) {
+  static const char input[] = "[1, 2, 3, 4, 5, 6, 7, 8]";
+
+  pjson_token tokens[4];
+  recording_sink sink = { { &recording_sink_eat, tokens, pjson_countof(tokens) }, { NULL, 0, 0 }, 0, 6 };
+  pjson_tokenizer tokenizer;
+  pjson_init_batch(&tokenizer, &sink.base);
+
+  // The error is reported for the last token of the rejected batch.
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_feed_batch(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL(8, sink.record.count);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_NUMBER, tokenizer.token_type);
+  TEST_ASSERT_EQUAL(10, tokenizer.token_start_index);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_feed_batch(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(8, sink.record.count);
+
+  free(sink.record.tokens);
+}
+
+TEST(batch, test_batch_sink_error_on_last_batch) {
+  static const char input[] = "[1, 2, 3]";
+
+  pjson_token tokens[64];
+  recording_sink sink = { { &recording_sink_eat, tokens, pjson_countof(tokens) }, { NULL, 0, 0 }, 0, 1 };
+  pjson_tokenizer tokenizer;
+  pjson_init_batch(&tokenizer, &sink.base);
+
+  // Pending tokens are delivered before returning, so the error surfaces in the same call.
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_feed_batch(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL(1, sink.batch_count);
+  TEST_ASSERT_EQUAL(7, sink.record.count);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_CLOSE_BRACKET, tokenizer.token_type);
+  TEST_ASSERT_EQUAL(8, tokenizer.token_start_index);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_close(&tokenizer));
+
+  free(sink.record.tokens);
+}
+
+TEST_GROUP_RUNNER(batch) {
+  RUN_TEST_CASE(batch, test_batch_formatted_1mb);
+  RUN_TEST_CASE(batch, test_batch_minified_1mb);
+  RUN_TEST_CASE(batch, test_batch_invalid_missing_colon);
+  RUN_TEST_CASE(batch, test_batch_sink_error);
+  RUN_TEST_CASE(batch, test_batch_sink_error_on_last_batch);
+}
@@ -0,0 +1,287 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "chunk_handlers.h"
+
+TEST_GROUP(binding);
+
+TEST_SETUP(binding) {}
+
+TEST_TEAR_DOWN(binding) {}
+
+/* Data structure definition */
+
+typedef struct {
+  pjson_string name;
+  int32_t age;
+} owner_t;
+
+typedef struct {
+  int32_t id;
+  pjson_string name;
+} friend_t;
+
+typedef struct {
+  int32_t id;
+  pjson_string name;
+  double rating;
+  bool active;
+  uint64_t big;
+  float ratio;
+  int64_t balance;
+  uint32_t count;
+  pjson_array tags; // pjson_string
+  pjson_array scores; // double
+  owner_t owner;
+  pjson_array friends; // friend_t
+} item_t;
+
+static const pjson_field_descriptor owner_fields[] = {
+  PJSON_FIELD("name", owner_t, name, PJSON_FIELD_STRING),
+  PJSON_FIELD("age", owner_t, age, PJSON_FIELD_INT32),
+};
+static const pjson_struct_descriptor owner_descriptor = PJSON_STRUCT_DESCRIPTOR(owner_t, owner_fields);
+
+static const pjson_field_descriptor friend_fields[] = {
+  PJSON_FIELD("id", friend_t, id, PJSON_FIELD_INT32),
+  PJSON_FIELD("name", friend_t, name, PJSON_FIELD_STRING),
+};
+static const pjson_struct_descriptor friend_descriptor = PJSON_STRUCT_DESCRIPTOR(friend_t, friend_fields);
+
+static const pjson_field_descriptor item_fields[] = {
+  PJSON_FIELD("id", item_t, id, PJSON_FIELD_INT32),
+  PJSON_FIELD("name", item_t, name, PJSON_FIELD_STRING),
+  PJSON_FIELD("rating", item_t, rating, PJSON_FIELD_DOUBLE),
+  PJSON_FIELD("active", item_t, active, PJSON_FIELD_BOOL),
+  PJSON_FIELD("big", item_t, big, PJSON_FIELD_UINT64),
+  PJSON_FIELD("ratio", item_t, ratio, PJSON_FIELD_FLOAT),
+  PJSON_FIELD("balance", item_t, balance, PJSON_FIELD_INT64),
+  PJSON_FIELD("count", item_t, count, PJSON_FIELD_UINT32),
+  PJSON_ARRAY_FIELD("tags", item_t, tags, PJSON_FIELD_STRING),
+  PJSON_ARRAY_FIELD("scores", item_t, scores, PJSON_FIELD_DOUBLE),
+  PJSON_OBJECT_FIELD("owner", item_t, owner, owner_descriptor),
+  PJSON_OBJECT_ARRAY_FIELD("friends", item_t, friends, friend_descriptor),
+};
+static const pjson_struct_descriptor item_descriptor = PJSON_STRUCT_DESCRIPTOR(item_t, item_fields);
+
+/* Helpers */
+
+static pjson_parsing_status bind(pjson_binding *binding, const char *input, size_t chunk_size, const pjson_tokenizer_options *options) {
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &binding->parser.base, options);
+
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  size_t length = strlen(input);
+  for (size_t offset = 0; offset < length && status == PJSON_STATUS_DATA_NEEDED; offset += chunk_size) {
+    status = pjson_feed(&tokenizer, (const uint8_t *)input + offset, length - offset < chunk_size ? length - offset : chunk_size);
+  }
+
+  pjson_parsing_status close_status = pjson_close(&tokenizer);
+  return status == PJSON_STATUS_DATA_NEEDED ? close_status : status;
+}
+
+static pjson_parsing_status bind_items(const char *input, pjson_array *items, pjson_arena *arena) {
+  pjson_binding binding;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_binding_init(&binding, &item_descriptor, true, items, arena, NULL));
+  pjson_parsing_status status = bind(&binding, input, 1024, NULL);
+  pjson_binding_free(&binding);
+  return status;
+}
+
+static void assert_string(const char *expected, pjson_string actual) {
+  TEST_ASSERT_NOT_NULL(actual.data);
+  TEST_ASSERT_EQUAL(strlen(expected), actual.length);
+  TEST_ASSERT_EQUAL_STRING(expected, actual.data);
+}
+
+TEST(binding, test_binding_items) {
+  static const char input[] =
+    "[\n"
+    "  {\"id\": 1, \"name\": \"first \\\"item\\\"\", \"rating\": 4.5, \"active\": true, \"big\": 18446744073709551615,"
+    "   \"ratio\": 0.25, \"balance\": -9000000000, \"count\": 7,"
+    "   \"tags\": [\"a\", \"b\\n\", \"\\u00e9t\\u00e9\"], \"scores\": [1, 2.5, null, -3e2],"
+    "   \"owner\": {\"name\": \"o\", \"extra\": [1, {\"x\": [2]}], \"age\": 30},"
+    "   \"friends\": [{\"id\": 2, \"name\": \"f2\"}, {\"id\": 3}], \"unknown\": {\"deep\": [[[]]], \"id\": 99}},\n"
+    "  {\"id\": 2, \"name\": null, \"tags\": [], \"owner\": null, \"\\u0069d\": 22},\n"
+    "  {}\n"
+    "]\n";
+
+  static const size_t chunk_sizes[] = { 1, 7, 4096 };
+  const pjson_tokenizer_options options[] = { { .unescape_strings = false }, { .unescape_strings = true }, { .scatter_strings = true } };
+  uint8_t arena_buffer[64];
+
+  for (size_t i = 0; i < pjson_countof(chunk_sizes); i++) {
+    for (size_t j = 0; j < pjson_countof(options); j++) {
+      // The buffer of the arena is too small for the data, so blocks get allocated too.
+      pjson_arena arena;
+      pjson_arena_init(&arena, arena_buffer, sizeof(arena_buffer), NULL);
+      pjson_array items = { (void *)1, 1, 1 };
+
+      pjson_binding binding;
+      TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_binding_init(&binding, &item_descriptor, true, &items, &arena, NULL));
+      TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, bind(&binding, input, chunk_sizes[i], &options[j]));
+      pjson_binding_free(&binding);
+
+      TEST_ASSERT_EQUAL(3, items.count);
+      const item_t *item = (const item_t *)items.items;
+      TEST_ASSERT_EQUAL(1, item->id);
+      assert_string("first \"item\"", item->name);
+      TEST_ASSERT_EQUAL_DOUBLE(4.5, item->rating);
+      TEST_ASSERT_TRUE(item->active);
+      TEST_ASSERT_TRUE(item->big == UINT64_MAX);
+      TEST_ASSERT_EQUAL_FLOAT(0.25f, item->ratio);
+      TEST_ASSERT_TRUE(item->balance == -9000000000LL);
+      TEST_ASSERT_EQUAL(7, item->count);
+
+      TEST_ASSERT_EQUAL(3, item->tags.count);
+      assert_string("a", ((const pjson_string *)item->tags.items)[0]);
+      assert_string("b\n", ((const pjson_string *)item->tags.items)[1]);
+      assert_string("\xC3\xA9t\xC3\xA9", ((const pjson_string *)item->tags.items)[2]);
+
+      TEST_ASSERT_EQUAL(4, item->scores.count);
+      const double *scores = (const double *)item->scores.items;
+      TEST_ASSERT_EQUAL_DOUBLE(1.0, scores[0]);
+      TEST_ASSERT_EQUAL_DOUBLE(2.5, scores[1]);
+      TEST_ASSERT_EQUAL_DOUBLE(0.0, scores[2]);
+      TEST_ASSERT_EQUAL_DOUBLE(-300.0, scores[3]);
+
+      assert_string("o", item->owner.name);
+      TEST_ASSERT_EQUAL(30, item->owner.age);
+
+      TEST_ASSERT_EQUAL(2, item->friends.count);
+      const friend_t *friends = (const friend_t *)item->friends.items;
+      TEST_ASSERT_EQUAL(2, friends[0].id);
+      assert_string("f2", friends[0].name);
+      TEST_ASSERT_EQUAL(3, friends[1].id);
+      TEST_ASSERT_NULL(friends[1].name.data);
+
+      item++;
+      TEST_ASSERT_EQUAL(22, item->id);
+      TEST_ASSERT_NULL(item->name.data);
+      TEST_ASSERT_EQUAL(0, item->tags.count);
+      TEST_ASSERT_NULL(item->owner.name.data);
+      TEST_ASSERT_EQUAL(0, item->friends.count);
+
+      item++;
+      TEST_ASSERT_EQUAL(0, item->id);
+      TEST_ASSERT_FALSE(item->active);
+
+      pjson_arena_free(&arena);
+    }
+  }
+}
+
+TEST(binding, test_binding_object) {
+  static const char *const inputs[] = { "{\"name\": \"x\", \"age\": 3}", "{\"age\": 4, \"other\": null}" };
+  pjson_arena arena;
+  pjson_arena_init(&arena, NULL, 0, NULL);
+
+  owner_t owner = { { "garbage", 7 }, 0 };
+  pjson_binding binding;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_binding_init(&binding, &owner_descriptor, false, &owner, &arena, NULL));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, bind(&binding, inputs[0], 1024, NULL));
+  assert_string("x", owner.name);
+  TEST_ASSERT_EQUAL(3, owner.age);
+
+  // The binding can be reused for the next document.
+  owner_t other_owner;
+  pjson_binding_rewind(&binding, &other_owner);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, bind(&binding, inputs[1], 1024, NULL));
+  TEST_ASSERT_NULL(other_owner.name.data);
+  TEST_ASSERT_EQUAL(4, other_owner.age);
+
+  pjson_binding_free(&binding);
+  pjson_arena_free(&arena);
+}
+
+TEST(binding, test_binding_type_mismatch) {
+  static const char *const inputs[] = {
+    "[{\"id\": \"1\"}]", "[{\"id\": 1.5}]", "[{\"id\": 4294967296}]", "[{\"count\": -1}]", "[{\"active\": 1}]",
+    "[{\"name\": 1}]", "[{\"tags\": [1]}]", "[{\"tags\": {}}]", "[{\"owner\": []}]", "[{\"owner\": {\"age\": true}}]",
+    "[{\"friends\": [1]}]", "[1]", "{}", "[[]]",
+  };
+
+  pjson_arena arena;
+  pjson_arena_init(&arena, NULL, 0, NULL);
+  for (size_t i = 0; i < pjson_countof(inputs); i++) {
+    pjson_array items;
+    TEST_ASSERT_EQUAL_MESSAGE(PJSON_STATUS_USER_ERROR, bind_items(inputs[i], &items, &arena), inputs[i]);
+  }
+
+  // Syntax errors are reported as such, even in skipped values.
+  pjson_array items;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, bind_items("[{\"id\": 1,}]", &items, &arena));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, bind_items("[{\"x\": [1}]", &items, &arena));
+  pjson_arena_free(&arena);
+}
+
+TEST(binding, test_binding_streamed_strings) {
+  static const struct {
+    const char *input;
+    size_t split_index; // strings straddling this index are streamed
+    pjson_parsing_status status;
+    size_t error_index;
+  } cases[] = {
+    { "{\"name\": \"0123456789abcdefghij\", \"age\": 3}", 12, PJSON_STATUS_USER_ERROR, 9 }, // value of a string member
+    { "{\"name\": \"x\", \"age\": 3}", 4, PJSON_STATUS_USER_ERROR, 1 }, // name of a field
+    { "{\"0123456789abcdefghij\": \"klmnopqrstuvwxyz\", \"age\": 3}", 6, PJSON_STATUS_COMPLETED, 0 }, // unknown name
+    { "{\"0123456789abcdefghij\": \"klmnopqrstuvwxyz\", \"age\": 3}", 30, PJSON_STATUS_COMPLETED, 0 }, // skipped value
+  };
+
+  pjson_arena arena;
+  pjson_arena_init(&arena, NULL, 0, NULL);
+  for (size_t i = 0; i < pjson_countof(cases); i++) {
+    counting_chunk_handler handler;
+    counting_chunk_handler_init(&handler, 2);
+    pjson_tokenizer_options options = { .string_chunk_handler = &handler.base };
+    owner_t owner;
+    pjson_binding binding;
+    TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_binding_init(&binding, &owner_descriptor, false, &owner, &arena, NULL));
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &binding.parser.base, &options);
+
+    TEST_ASSERT_EQUAL_MESSAGE(cases[i].status, feed_split(&tokenizer, cases[i].input, cases[i].split_index), cases[i].input);
+    if (cases[i].status == PJSON_STATUS_COMPLETED) {
+      TEST_ASSERT_EQUAL(1, handler.string_count);
+      TEST_ASSERT_NULL(owner.name.data);
+      TEST_ASSERT_EQUAL(3, owner.age);
+    }
+    else {
+      TEST_ASSERT_EQUAL_MESSAGE(cases[i].error_index, tokenizer.token_start_index, cases[i].input);
+    }
+    pjson_binding_free(&binding);
+  }
+  pjson_arena_free(&arena);
+}
+
+TEST(binding, test_binding_invalid_descriptors) {
+  static const pjson_field_descriptor duplicate_fields[] = {
+    PJSON_FIELD("id", friend_t, id, PJSON_FIELD_INT32),
+    PJSON_FIELD("id", friend_t, name, PJSON_FIELD_STRING),
+  };
+  static const pjson_struct_descriptor duplicate_descriptor = PJSON_STRUCT_DESCRIPTOR(friend_t, duplicate_fields);
+  static const pjson_field_descriptor nesting_fields[] = {
+    PJSON_OBJECT_ARRAY_FIELD("a", item_t, friends, friend_descriptor),
+    PJSON_OBJECT_ARRAY_FIELD("b", item_t, tags, duplicate_descriptor),
+  };
+  static const pjson_struct_descriptor nesting_descriptor = PJSON_STRUCT_DESCRIPTOR(item_t, nesting_fields);
+
+  pjson_arena arena;
+  pjson_arena_init(&arena, NULL, 0, NULL);
+  pjson_array items;
+  pjson_binding binding;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, pjson_binding_init(&binding, &duplicate_descriptor, true, &items, &arena, NULL));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, pjson_binding_init(&binding, &nesting_descriptor, true, &items, &arena, NULL));
+}
+
+TEST_GROUP_RUNNER(binding) {
+  RUN_TEST_CASE(binding, test_binding_items);
+  RUN_TEST_CASE(binding, test_binding_object);
+  RUN_TEST_CASE(binding, test_binding_type_mismatch);
+  RUN_TEST_CASE(binding, test_binding_streamed_strings);
+  RUN_TEST_CASE(binding, test_binding_invalid_descriptors);
+}
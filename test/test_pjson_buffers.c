@@ -0,0 +1,266 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "checking_parser.h"
+#include "counting_allocator.h"
+#include "test_input.h"
+
+TEST_GROUP(buffers);
+
+TEST_SETUP(buffers) {}
+
+TEST_TEAR_DOWN(buffers) {}
+
+typedef struct {
+  checking_parser base; // base struct MUST be the first member!
+  const uint8_t *input; // the whole input, for checking the tokens
+} input_checker;
+
+/**
+ * Check that the token refers to its bytes of the input.
+ */
+static void check_token_data(checking_parser *base, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_EOS) return;
+  TEST_ASSERT_EQUAL_MEMORY(((input_checker *)base)->input + token->start_index, token->start, token->length);
+}
+
+static void input_checker_init(input_checker *parser, const uint8_t *input) {
+  checking_parser_init(&parser->base, sizeof(*parser), &check_token_data);
+  parser->input = input;
+}
+
+TEST(buffers, test_buffers_kept_by_default) {
+  static const size_t string_lengths[] = { 10, 5000, 10 };
+  size_t length;
+  uint8_t *data = make_string_array(string_lengths, pjson_countof(string_lengths), "", &length);
+
+  input_checker parser;
+  input_checker_init(&parser, data);
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data, length, 1000, &pjson_feed));
+  TEST_ASSERT_TRUE(tokenizer.buf != pjson_fixed_size_buf(&tokenizer));
+  TEST_ASSERT_TRUE(tokenizer.buf_capacity >= 5000);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(8, parser.base.token_count);
+
+  free(data);
+}
+
+TEST(buffers, test_buffers_high_water) {
+  static const size_t string_lengths[] = { 10, 5000, 10, 1500, 10 };
+  size_t length;
+  uint8_t *data = make_string_array(string_lengths, pjson_countof(string_lengths), "", &length);
+
+  input_checker parser;
+  input_checker_init(&parser, data);
+  pjson_tokenizer_options options = { .buffer_high_water = 2048 };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+
+  // The buffer which held the oversized string is released, the one below the threshold is kept.
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data, 5050, 1000, &pjson_feed));
+#if !defined(PJSON_COMPACT_TOKENIZER)
+  TEST_ASSERT_EQUAL_PTR(pjson_fixed_size_buf(&tokenizer), tokenizer.buf);
+#else
+  TEST_ASSERT_TRUE(tokenizer.buf_capacity <= 2048); // short tokens are buffered on the heap as there's no fixed-size part
+#endif
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data + 5050, length - 5050, 1000, &pjson_feed));
+  TEST_ASSERT_TRUE(tokenizer.buf != pjson_fixed_size_buf(&tokenizer));
+  TEST_ASSERT_TRUE(tokenizer.buf_capacity <= 2048);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(12, parser.base.token_count);
+
+  free(data);
+}
+
+TEST(buffers, test_buffers_high_water_other_buffers) {
+  // Unescaping scratch buffer
+  static const size_t escaped_lengths[] = { 10, 5000, 10, 1500 };
+  size_t length;
+  uint8_t *data = make_string_array(escaped_lengths, pjson_countof(escaped_lengths), "\\n", &length);
+
+  input_checker parser;
+  input_checker_init(&parser, data);
+  pjson_tokenizer_options unescape_options = { .unescape_strings = true, .buffer_high_water = 2048 };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &unescape_options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data, 5050, 1000, &pjson_feed));
+  TEST_ASSERT_TRUE(tokenizer.unescape_buf_capacity <= 2048);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data + 5050, length - 5050, 1000, &pjson_feed));
+  TEST_ASSERT_NOT_NULL(tokenizer.unescape_buf);
+  TEST_ASSERT_TRUE(tokenizer.unescape_buf_capacity <= 2048);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(10, parser.base.token_count);
+  free(data);
+
+  // Segment list
+  static const size_t scattered_lengths[] = { 5000, 100 };
+  data = make_string_array(scattered_lengths, pjson_countof(scattered_lengths), "", &length);
+
+  input_checker_init(&parser, data);
+  pjson_tokenizer_options scatter_options = { .scatter_strings = true, .buffer_high_water = 2048 };
+  pjson_init_ex(&tokenizer, &parser.base.base, &scatter_options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data, 5002, 4, &pjson_feed));
+  TEST_ASSERT_NULL(tokenizer.segments);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data + 5002, length - 5002, 4, &pjson_feed));
+  TEST_ASSERT_NOT_NULL(tokenizer.segments);
+  TEST_ASSERT_TRUE(tokenizer.segment_capacity * sizeof(pjson_segment) <= 2048);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(6, parser.base.token_count);
+  free(data);
+
+  // With a pool, idle tokenizers hold neither of them.
+  pjson_buffer_pool pool;
+  pjson_buffer_pool_init(&pool, 1024, 1);
+  static const char input[] = "[\"a\\nb\", \"cdefghijklmnopqrstuvwxyz\"]";
+  unescape_options.buffer_pool = scatter_options.buffer_pool = &pool;
+  const pjson_tokenizer_options *pooled_options[] = { &unescape_options, &scatter_options };
+  for (size_t i = 0; i < pjson_countof(pooled_options); i++) {
+    input_checker_init(&parser, (const uint8_t *)input);
+    pjson_init_ex(&tokenizer, &parser.base.base, pooled_options[i]);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, 5, &pjson_feed));
+    TEST_ASSERT_NULL(tokenizer.unescape_buf);
+    TEST_ASSERT_NULL(tokenizer.segments);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+    TEST_ASSERT_EQUAL(6, parser.base.token_count);
+  }
+  pjson_buffer_pool_free(&pool);
+}
+
+TEST(buffers, test_buffers_pool) {
+  static const size_t string_lengths[] = { 10, 500, 1000, 10, 5000, 700, 10 };
+  size_t length;
+  uint8_t *data = make_string_array(string_lengths, pjson_countof(string_lengths), "", &length);
+
+  pjson_buffer_pool pool;
+  pjson_buffer_pool_init(&pool, 1024, 1);
+
+  // Interleave two streams so that both borrow a slab at the same time.
+  input_checker parsers[2];
+  pjson_tokenizer_options options = { .buffer_pool = &pool };
+  pjson_tokenizer tokenizers[2];
+  for (size_t i = 0; i < pjson_countof(tokenizers); i++) {
+    input_checker_init(&parsers[i], data);
+    pjson_init_ex(&tokenizers[i], &parsers[i].base.base, &options);
+  }
+
+  size_t chunk_size = 300;
+  for (size_t offset = 0; offset < length; offset += chunk_size) {
+    size_t chunk_length = length - offset < chunk_size ? length - offset : chunk_size;
+    for (size_t i = 0; i < pjson_countof(tokenizers); i++) {
+      TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_feed(&tokenizers[i], data + offset, chunk_length));
+      TEST_ASSERT_TRUE(tokenizers[i].is_buf_pooled ? tokenizers[i].buf_capacity == pool.slab_size : tokenizers[i].buf_capacity != pool.slab_size);
+    }
+    TEST_ASSERT_TRUE(pool.free_count <= pool.max_free_count);
+  }
+
+  // Idle streams hold no heap memory, the pool keeps at most `max_free_count` slabs.
+  for (size_t i = 0; i < pjson_countof(tokenizers); i++) {
+    TEST_ASSERT_EQUAL_PTR(pjson_fixed_size_buf(&tokenizers[i]), tokenizers[i].buf);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizers[i]));
+    TEST_ASSERT_EQUAL(2 * pjson_countof(string_lengths) + 2, parsers[i].base.token_count);
+  }
+  TEST_ASSERT_EQUAL(1, pool.free_count);
+  TEST_ASSERT_NOT_NULL(pool.free_list);
+
+  pjson_buffer_pool_free(&pool);
+  TEST_ASSERT_EQUAL(0, pool.free_count);
+  TEST_ASSERT_NULL(pool.free_list);
+
+  free(data);
+}
+
+TEST(buffers, test_buffers_tokenizer_size) {
+  TEST_ASSERT_EQUAL(sizeof(pjson_tokenizer), pjson_tokenizer_size());
+
+  // The members accessed for every byte share a cache line.
+  TEST_ASSERT_TRUE(offsetof(pjson_tokenizer, kernels) + sizeof(void *) <= 64);
+
+#if defined(PJSON_COMPACT_TOKENIZER)
+  TEST_ASSERT_TRUE(sizeof(pjson_tokenizer) <= 192);
+
+  // Without the fixed-size part, even short tokens straddling input chunks are buffered on the heap.
+  static const char input[] = "[\"abc\", 12345, true]";
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, NULL);
+  TEST_ASSERT_NULL(tokenizer.buf);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, 3, &pjson_feed));
+  TEST_ASSERT_NOT_NULL(tokenizer.buf);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+#else
+  TEST_ASSERT_TRUE(sizeof(pjson_tokenizer) >= PJSON_INTERNAL_BUFFER_FIXED_SIZE);
+#endif
+}
+
+TEST(buffers, test_buffers_custom_allocator) {
+  static const size_t string_lengths[] = { 10, 5000, 10, 1500, 10 };
+  size_t length;
+  uint8_t *data = make_string_array(string_lengths, pjson_countof(string_lengths), "", &length);
+
+  // Internal buffer
+  counting_allocator allocator;
+  counting_allocator_init(&allocator, true);
+  input_checker parser;
+  input_checker_init(&parser, data);
+  pjson_tokenizer_options options = { .allocator = &allocator.base };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data, length, 1000, &pjson_feed));
+  TEST_ASSERT_TRUE(allocator.allocation_count > 0);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(12, parser.base.token_count);
+  TEST_ASSERT_EQUAL(0, allocator.live_size);
+
+  // Unescaping scratch buffer and segment list
+  static const char input[] = "[\"a\\nb\", \"cdefghijklmnopqrstuvwxyz\"]";
+  pjson_tokenizer_options unescape_options = { .unescape_strings = true, .allocator = &allocator.base };
+  pjson_tokenizer_options scatter_options = { .scatter_strings = true, .allocator = &allocator.base };
+  const pjson_tokenizer_options *other_options[] = { &unescape_options, &scatter_options };
+  for (size_t i = 0; i < pjson_countof(other_options); i++) {
+    counting_allocator_init(&allocator, true);
+    pjson_init_ex(&tokenizer, NULL, other_options[i]);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, 5, &pjson_feed));
+    TEST_ASSERT_TRUE(allocator.allocation_count > 0);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+    TEST_ASSERT_EQUAL(0, allocator.live_size);
+  }
+
+  // Tape
+  counting_allocator_init(&allocator, true);
+  pjson_tape tape;
+  pjson_init_tape_ex(&tokenizer, &tape, NULL, 0, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data, length, 1000, &pjson_feed));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_TRUE(allocator.live_size > 0);
+  TEST_ASSERT_EQUAL(7, tape.entry_count);
+  pjson_tape_free(&tape);
+  TEST_ASSERT_EQUAL(0, allocator.live_size);
+
+  // Long numbers
+  static const char number[] = "3.1415926535897932384626433832795028841971";
+  counting_allocator_init(&allocator, true);
+  double d;
+  float f;
+  TEST_ASSERT_TRUE(pjson_parse_double_ex(&d, (const uint8_t *)number, sizeof(number) - 1, &allocator.base));
+  TEST_ASSERT_TRUE(pjson_parse_float_ex(&f, (const uint8_t *)number, sizeof(number) - 1, &allocator.base));
+  TEST_ASSERT_EQUAL(2, allocator.allocation_count);
+  TEST_ASSERT_EQUAL(0, allocator.live_size);
+  TEST_ASSERT_EQUAL_DOUBLE(3.14159265358979, d);
+  TEST_ASSERT_TRUE(pjson_parse_double_ex(&d, (const uint8_t *)number, sizeof(number) - 1, NULL));
+
+  free(data);
+}
+
+TEST_GROUP_RUNNER(buffers) {
+  RUN_TEST_CASE(buffers, test_buffers_kept_by_default);
+  RUN_TEST_CASE(buffers, test_buffers_high_water);
+  RUN_TEST_CASE(buffers, test_buffers_high_water_other_buffers);
+  RUN_TEST_CASE(buffers, test_buffers_pool);
+  RUN_TEST_CASE(buffers, test_buffers_tokenizer_size);
+  RUN_TEST_CASE(buffers, test_buffers_custom_allocator);
+}
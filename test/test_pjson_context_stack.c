@@ -0,0 +1,228 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "counting_allocator.h"
+#include "test_input.h"
+
+TEST_GROUP(context_stack);
+
+TEST_SETUP(context_stack) {}
+
+TEST_TEAR_DOWN(context_stack) {}
+
+#define MAX_TEST_DEPTH (300)
+
+typedef struct {
+  pjson_parser_context base; // base struct MUST be the first member!
+  size_t level;
+  size_t item_count;
+} depth_parser_context;
+
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  depth_parser_context *contexts[MAX_TEST_DEPTH + 1]; // contexts by level, for checking that they don't move
+  size_t max_level;
+  size_t close_count;
+} depth_parser;
+
+static pjson_parsing_status depth_parser_on_value(depth_parser *parser, depth_parser_context *context, const pjson_token *token) {
+  depth_parser_context *child_context = (depth_parser_context *)parser->base.context;
+
+  switch (token->type) {
+    case PJSON_TOKEN_OPEN_BRACKET:
+    case PJSON_TOKEN_OPEN_BRACE:
+      TEST_ASSERT_TRUE(child_context->base.parent == &context->base);
+      // The parser zeroes the whole user-defined context.
+      TEST_ASSERT_EQUAL(0, child_context->level);
+      TEST_ASSERT_EQUAL(0, child_context->item_count);
+      child_context->level = context->level + 1;
+      child_context->base.on_value = (pjson_parser_context_callback)&depth_parser_on_value;
+      TEST_ASSERT_EQUAL(child_context->level + 1, parser->base.depth);
+      TEST_ASSERT_TRUE(child_context->level <= MAX_TEST_DEPTH);
+      parser->contexts[child_context->level] = child_context;
+      if (parser->max_level < child_context->level) parser->max_level = child_context->level;
+      break;
+
+    case PJSON_TOKEN_CLOSE_BRACKET:
+    case PJSON_TOKEN_CLOSE_BRACE:
+      TEST_ASSERT_TRUE(parser->contexts[child_context->level] == child_context);
+      TEST_ASSERT_EQUAL(context->level + 1, child_context->level);
+      parser->close_count++;
+      return PJSON_STATUS_SUCCESS;
+
+    default:
+      break;
+  }
+
+  context->item_count++;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static void depth_parser_reset(depth_parser *parser) {
+  pjson_parser_reset(&parser->base, false);
+  parser->base.context->on_value = (pjson_parser_context_callback)&depth_parser_on_value;
+  parser->max_level = parser->close_count = 0;
+}
+
+static void depth_parser_init(depth_parser *parser, const pjson_parser_options *options) {
+  pjson_parser_init_ex(&parser->base, false, options);
+  depth_parser_reset(parser);
+}
+
+/**
+ * Build `[{"a": [{"a": ... 1 ... }]}]` with `depth` levels of nesting.
+ */
+static uint8_t *make_nested_input(size_t depth, size_t *length) {
+  input_builder builder;
+  input_builder_init(&builder);
+
+  for (size_t i = 0; i < depth; i++) {
+    input_builder_append(&builder, i & 1 ? "{\"a\":" : "[");
+  }
+  input_builder_append(&builder, "1");
+  for (size_t i = depth; i-- > 0;) {
+    input_builder_append(&builder, i & 1 ? "}" : "]");
+  }
+
+  return input_builder_finish(&builder, length);
+}
+
+static pjson_parsing_status parse(depth_parser *parser, const uint8_t *data, size_t length) {
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser->base.base);
+  pjson_parsing_status status = pjson_feed(&tokenizer, data, length);
+  if (status == PJSON_STATUS_DATA_NEEDED) status = pjson_close(&tokenizer);
+  else pjson_close(&tokenizer);
+  return status;
+}
+
+TEST(context_stack, test_context_stack_inline) {
+  // Contexts fitting into the inline array need no allocation.
+  const size_t inline_capacity = sizeof(((pjson_parser *)NULL)->inline_contexts) / (sizeof(depth_parser_context));
+  TEST_ASSERT_TRUE(inline_capacity >= 2);
+  size_t length;
+  uint8_t *data = make_nested_input(inline_capacity - 1, &length);
+
+  counting_allocator allocator;
+  counting_allocator_init(&allocator, false);
+  pjson_parser_options options = { .context_size = sizeof(depth_parser_context), .allocator = &allocator.base };
+  depth_parser parser;
+  depth_parser_init(&parser, &options);
+  TEST_ASSERT_TRUE(parser.base.context == &parser.base.inline_contexts[0]);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, parse(&parser, data, length));
+  TEST_ASSERT_EQUAL(inline_capacity - 1, parser.max_level);
+  TEST_ASSERT_EQUAL(inline_capacity - 1, parser.close_count);
+  TEST_ASSERT_EQUAL(1, parser.base.depth);
+  TEST_ASSERT_EQUAL(0, allocator.allocation_count);
+
+  pjson_parser_free(&parser.base);
+  free(data);
+}
+
+TEST(context_stack, test_context_stack_growth) {
+  static const size_t depths[] = { 1, 2, 3, 17, 18, 50, 51, MAX_TEST_DEPTH };
+  depth_parser_context initial_contexts[3];
+
+  for (size_t with_initial = 0; with_initial <= 1; with_initial++) {
+    counting_allocator allocator;
+    counting_allocator_init(&allocator, false);
+    pjson_parser_options options = {
+      .context_size = sizeof(depth_parser_context),
+      .initial_contexts = with_initial ? initial_contexts : NULL,
+      .initial_capacity = with_initial ? pjson_countof(initial_contexts) : 0,
+      .allocator = &allocator.base,
+    };
+    depth_parser parser;
+    depth_parser_init(&parser, &options);
+
+    for (size_t i = 0; i < pjson_countof(depths); i++) {
+      size_t length;
+      uint8_t *data = make_nested_input(depths[i], &length);
+
+      depth_parser_reset(&parser);
+      TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, parse(&parser, data, length));
+      TEST_ASSERT_EQUAL(depths[i], parser.max_level);
+      TEST_ASSERT_EQUAL(depths[i], parser.close_count);
+      TEST_ASSERT_EQUAL(1, parser.base.depth);
+      TEST_ASSERT_EQUAL(1, ((depth_parser_context *)parser.base.context)->item_count);
+
+      // Blocks grow geometrically, so only a few allocations are needed for deep input.
+      TEST_ASSERT_TRUE(allocator.allocation_count <= 6);
+
+      // Parsing the same input again reuses the blocks allocated the first time.
+      depth_parser_reset(&parser);
+      size_t prev_allocation_count = allocator.allocation_count;
+      TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, parse(&parser, data, length));
+      TEST_ASSERT_EQUAL(depths[i], parser.max_level);
+      TEST_ASSERT_EQUAL(prev_allocation_count, allocator.allocation_count);
+
+      free(data);
+    }
+
+    TEST_ASSERT_TRUE(allocator.allocation_count > 0);
+    pjson_parser_free(&parser.base);
+    TEST_ASSERT_EQUAL(0, allocator.live_size);
+  }
+}
+
+TEST(context_stack, test_context_stack_rewind) {
+  // Rewinding drops the contexts of the containers left open but keeps their storage.
+  static const char partial_input[] = "[[[[{\"a\": [[[[[1, 2";
+  static const char input[] = "[[[[[[[[[[1]]]]]]]]]]";
+
+  counting_allocator allocator;
+  counting_allocator_init(&allocator, false);
+  pjson_parser_options options = { .context_size = sizeof(depth_parser_context), .allocator = &allocator.base };
+  depth_parser parser;
+  depth_parser_init(&parser, &options);
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_feed(&tokenizer, (const uint8_t *)partial_input, sizeof(partial_input) - 1));
+  TEST_ASSERT_EQUAL(11, parser.base.depth);
+  size_t allocation_count = allocator.allocation_count;
+
+  pjson_parser_rewind(&parser.base, false);
+  TEST_ASSERT_EQUAL(1, parser.base.depth);
+  TEST_ASSERT_TRUE(parser.base.context == &parser.base.inline_contexts[0]);
+  parser.max_level = parser.close_count = 0;
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_parse_buffer(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL(10, parser.max_level);
+  TEST_ASSERT_EQUAL(10, parser.close_count);
+  TEST_ASSERT_EQUAL(allocation_count, allocator.allocation_count);
+  pjson_close(&tokenizer);
+
+  pjson_parser_free(&parser.base);
+  TEST_ASSERT_EQUAL(0, allocator.live_size);
+}
+
+TEST(context_stack, test_context_stack_max_depth) {
+  for (size_t max_depth = 1; max_depth <= 20; max_depth++) {
+    pjson_parser_options options = { .context_size = sizeof(depth_parser_context), .max_depth = max_depth };
+    depth_parser parser;
+    depth_parser_init(&parser, &options);
+
+    for (size_t depth = max_depth - 1; depth <= max_depth + 1; depth++) {
+      size_t length;
+      uint8_t *data = make_nested_input(depth, &length);
+      depth_parser_reset(&parser);
+      TEST_ASSERT_EQUAL(depth <= max_depth ? PJSON_STATUS_COMPLETED : PJSON_STATUS_MAX_DEPTH_EXCEEDED, parse(&parser, data, length));
+      free(data);
+    }
+
+    pjson_parser_free(&parser.base);
+  }
+}
+
+TEST_GROUP_RUNNER(context_stack) {
+  RUN_TEST_CASE(context_stack, test_context_stack_inline);
+  RUN_TEST_CASE(context_stack, test_context_stack_growth);
+  RUN_TEST_CASE(context_stack, test_context_stack_rewind);
+  RUN_TEST_CASE(context_stack, test_context_stack_max_depth);
+}
@@ -0,0 +1,206 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+
+TEST_GROUP(doc);
+
+TEST_SETUP(doc) {}
+
+TEST_TEAR_DOWN(doc) {}
+
+/* Helpers */
+
+static void open_string(pjson_doc *doc, const char *input, pjson_value *root) {
+  pjson_doc_open(doc, (const uint8_t *)input, strlen(input), NULL, root);
+}
+
+static bool find(pjson_value *object, const char *name, pjson_value *value) {
+  return pjson_obj_find_field(object, name, strlen(name), value);
+}
+
+static double get_double(pjson_value *value) {
+  double num = 0.0;
+  TEST_ASSERT_TRUE(pjson_value_get_double(value, &num));
+  return num;
+}
+
+static void assert_string(const char *expected, pjson_value *value) {
+  uint8_t buf[64];
+  size_t length;
+  TEST_ASSERT_TRUE(pjson_value_get_string(value, buf, sizeof(buf), &length));
+  TEST_ASSERT_EQUAL(strlen(expected), length);
+  TEST_ASSERT_TRUE(!memcmp(expected, buf, length));
+}
+
+/* Tests */
+
+TEST(doc, test_doc_navigate) {
+  static const char input[] =
+    "{\n"
+    "  \"id\": 1, \"name\": \"x\\\"y\", \"skipped\": {\"deep\": [1, [2, {\"a\": \"]}\"}]]},\n"
+    "  \"items\": [{\"v\": 1.5}, {\"v\": -2, \"w\": [1, {\"x\": [3]}]}, {\"w\": []}, 3, [4, 5]],\n"
+    "  \"flag\": true, \"none\": null, \"\\u0074ail\": \"end\"\n"
+    "}\n";
+
+  pjson_doc doc;
+  pjson_value root, value, item, inner;
+  open_string(&doc, input, &root);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_OPEN_BRACE, pjson_value_get_type(&root));
+
+  TEST_ASSERT_TRUE(find(&root, "name", &value)); // "id" is skipped
+  assert_string("x\"y", &value);
+  assert_string("x\"y", &value); // values can be accessed again
+
+  // The items are visited partially, what's left of them is skipped.
+  TEST_ASSERT_TRUE(find(&root, "items", &value));
+  static const double expected_v[] = { 1.5, -2.0 };
+  size_t count = 0;
+  while (pjson_arr_next(&value, &item)) {
+    if (count < pjson_countof(expected_v)) {
+      pjson_value v;
+      TEST_ASSERT_TRUE(find(&item, "v", &v));
+      TEST_ASSERT_EQUAL_DOUBLE(expected_v[count], get_double(&v));
+    }
+    if (count == 1) {
+      pjson_value w;
+      TEST_ASSERT_TRUE(find(&item, "w", &w));
+      TEST_ASSERT_TRUE(pjson_arr_next(&w, &inner));
+      TEST_ASSERT_EQUAL_DOUBLE(1.0, get_double(&inner));
+      TEST_ASSERT_TRUE(pjson_arr_next(&w, &inner));
+      TEST_ASSERT_TRUE(find(&inner, "x", &inner)); // left open
+    }
+    if (count == 4) {
+      TEST_ASSERT_TRUE(pjson_arr_next(&item, &inner));
+      TEST_ASSERT_EQUAL_DOUBLE(4.0, get_double(&inner));
+    }
+    count++;
+  }
+  TEST_ASSERT_EQUAL(5, count);
+  TEST_ASSERT_FALSE(pjson_arr_next(&value, &item)); // the end is sticky
+
+  pjson_token name;
+  TEST_ASSERT_TRUE(pjson_obj_next_field(&root, &name, &value));
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, name.type);
+  TEST_ASSERT_EQUAL(6, name.length);
+  bool flag = false;
+  TEST_ASSERT_TRUE(pjson_value_get_bool(&value, &flag));
+  TEST_ASSERT_TRUE(flag);
+
+  TEST_ASSERT_TRUE(find(&root, "tail", &value)); // the name is unescaped for the comparison
+  assert_string("end", &value);
+  TEST_ASSERT_FALSE(find(&root, "id", &value)); // fields are not looked up before the current one
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, doc.status);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_doc_close(&doc));
+}
+
+TEST(doc, test_doc_toplevel_values) {
+  pjson_doc doc;
+  pjson_value root;
+  int64_t num = 0;
+
+  open_string(&doc, "12", &root); // the number ends with the input
+  TEST_ASSERT_TRUE(pjson_value_get_int64(&root, &num));
+  TEST_ASSERT_TRUE(num == 12);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_doc_close(&doc));
+
+  open_string(&doc, " -3.25e2 ", &root);
+  TEST_ASSERT_FALSE(pjson_value_get_int64(&root, &num));
+  TEST_ASSERT_EQUAL_DOUBLE(-325.0, get_double(&root));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_doc_close(&doc));
+
+  open_string(&doc, "\"\\u00e9t\\u00e9\"", &root);
+  uint8_t buf[4];
+  size_t length = 0;
+  TEST_ASSERT_FALSE(pjson_value_get_string(&root, buf, sizeof(buf), &length)); // too small
+  TEST_ASSERT_EQUAL(5, length);
+  TEST_ASSERT_FALSE(pjson_value_get_double(&root, &(double){ 0 }));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_doc_close(&doc));
+
+  open_string(&doc, "null", &root);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_NULL, pjson_value_get_type(&root));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_doc_close(&doc));
+
+  // Values which are not accessed are skipped.
+  open_string(&doc, "[[1, 2], {\"a\": [3]}] ", &root);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_doc_close(&doc));
+
+  open_string(&doc, " ", &root);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_ERROR, pjson_value_get_type(&root));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_NO_TOKENS_FOUND, pjson_doc_close(&doc));
+}
+
+TEST(doc, test_doc_skipped_values_not_tokenized) {
+  // Like with PJSON_STATUS_SKIP, only the nesting of the skipped arrays and objects matters.
+  pjson_doc doc;
+  pjson_value root, value;
+  open_string(&doc, "{\"a\": [1, 2 3, tru], \"b\": 4}", &root);
+  TEST_ASSERT_TRUE(find(&root, "b", &value));
+  TEST_ASSERT_EQUAL_DOUBLE(4.0, get_double(&value));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_doc_close(&doc));
+}
+
+TEST(doc, test_doc_syntax_errors) {
+  static const struct { const char *input; pjson_parsing_status status; size_t error_index; } cases[] = {
+    { "[1,]", PJSON_STATUS_SYNTAX_ERROR, 3 },
+    { "[1 2]", PJSON_STATUS_SYNTAX_ERROR, 3 },
+    { "[,1]", PJSON_STATUS_SYNTAX_ERROR, 1 },
+    { "[1}", PJSON_STATUS_SYNTAX_ERROR, 2 },
+    { "{\"a\" 1}", PJSON_STATUS_SYNTAX_ERROR, 5 },
+    { "{\"a\": 1,}", PJSON_STATUS_SYNTAX_ERROR, 8 },
+    { "{1: 2}", PJSON_STATUS_SYNTAX_ERROR, 1 },
+    { "[[1, 2]", PJSON_STATUS_SYNTAX_ERROR, 7 },
+    { "[1] 2", PJSON_STATUS_SYNTAX_ERROR, 4 },
+    { "[1, tru]", PJSON_STATUS_SYNTAX_ERROR, 4 },
+    { "[\"a\xff\"]", PJSON_STATUS_UTF8_ERROR, 3 },
+  };
+
+  for (size_t i = 0; i < pjson_countof(cases); i++) {
+    // The values are visited one by one (visiting nothing would skip them, and detect fewer errors).
+    pjson_doc doc;
+    pjson_value root, value, item;
+    open_string(&doc, cases[i].input, &root);
+    if (pjson_value_get_type(&root) == PJSON_TOKEN_OPEN_BRACKET) {
+      while (pjson_arr_next(&root, &value)) {
+        while (pjson_value_get_type(&value) == PJSON_TOKEN_OPEN_BRACKET && pjson_arr_next(&value, &item)) {
+          pjson_value_get_type(&item);
+        }
+      }
+    }
+    else {
+      while (pjson_obj_next_field(&root, NULL, &value)) pjson_value_get_type(&value);
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(cases[i].status, pjson_doc_close(&doc), cases[i].input);
+    TEST_ASSERT_EQUAL_MESSAGE(cases[i].error_index, doc.tokenizer.token_start_index, cases[i].input);
+  }
+}
+
+TEST(doc, test_doc_misuse) {
+  pjson_doc doc;
+  pjson_value root, first, second;
+
+  // Values cannot be accessed once the cursor has moved past them.
+  open_string(&doc, "[1, 2]", &root);
+  TEST_ASSERT_TRUE(pjson_arr_next(&root, &first));
+  TEST_ASSERT_TRUE(pjson_arr_next(&root, &second));
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_ERROR, pjson_value_get_type(&first));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_doc_close(&doc));
+
+  // Arrays are not objects.
+  open_string(&doc, "[1, 2]", &root);
+  TEST_ASSERT_FALSE(pjson_obj_next_field(&root, NULL, &first));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, doc.status);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_doc_close(&doc));
+}
+
+TEST_GROUP_RUNNER(doc) {
+  RUN_TEST_CASE(doc, test_doc_navigate);
+  RUN_TEST_CASE(doc, test_doc_toplevel_values);
+  RUN_TEST_CASE(doc, test_doc_skipped_values_not_tokenized);
+  RUN_TEST_CASE(doc, test_doc_syntax_errors);
+  RUN_TEST_CASE(doc, test_doc_misuse);
+}
@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "counting_allocator.h"
+#include "chunk_handlers.h"
+
+TEST_GROUP(dom);
+
+TEST_SETUP(dom) {}
+
+TEST_TEAR_DOWN(dom) {}
+
+/* Helpers */
+
+static pjson_parsing_status build(pjson_dom *dom, const char *input, size_t chunk_size, const pjson_tokenizer_options *options) {
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &dom->parser.base, options);
+
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  size_t length = strlen(input);
+  for (size_t offset = 0; offset < length && status == PJSON_STATUS_DATA_NEEDED; offset += chunk_size) {
+    status = pjson_feed(&tokenizer, (const uint8_t *)input + offset, length - offset < chunk_size ? length - offset : chunk_size);
+  }
+
+  pjson_parsing_status close_status = pjson_close(&tokenizer);
+  return status == PJSON_STATUS_DATA_NEEDED ? close_status : status;
+}
+
+static const pjson_dom_value *get(const pjson_dom_value *object, const char *name) {
+  const pjson_dom_value *value = pjson_dom_object_get(object, name, strlen(name));
+  TEST_ASSERT_NOT_NULL(value);
+  return value;
+}
+
+static void assert_text(pjson_dom_type type, const char *expected, const pjson_dom_value *value) {
+  TEST_ASSERT_NOT_NULL(value);
+  TEST_ASSERT_EQUAL(type, value->type);
+  TEST_ASSERT_EQUAL(strlen(expected), value->count);
+  TEST_ASSERT_EQUAL_STRING(expected, value->data.text);
+}
+
+/* Tests */
+
+TEST(dom, test_dom_build) {
+  static const char input[] =
+    "{\n"
+    "  \"id\": 1, \"name\": \"first \\\"item\\\"\", \"rating\": -4.5e1, \"active\": true, \"gone\": false, \"none\": null,\n"
+    "  \"tags\": [\"a\", \"b\\n\", \"\\u00e9t\\u00e9\"], \"empty\": [], \"nothing\": {},\n"
+    "  \"friends\": [{\"id\": 2, \"name\": \"f2\"}, {\"id\": 3, \"tags\": [[1, [2]], {\"x\\u0079\": 3}]}],\n"
+    "  \"id\": 4, \"\\u0069d\\u0032\": 5, \"\": \"empty name\"\n"
+    "}\n";
+
+  static const size_t chunk_sizes[] = { 1, 7, 4096 };
+  const pjson_tokenizer_options options[] = { { .unescape_strings = false }, { .unescape_strings = true }, { .scatter_strings = true } };
+  uint8_t arena_buffer[64];
+
+  for (size_t i = 0; i < pjson_countof(chunk_sizes); i++) {
+    for (size_t j = 0; j < pjson_countof(options); j++) {
+      // The buffer of the arena is too small for the tree, so blocks get allocated too.
+      pjson_dom_options dom_options = { .buffer = arena_buffer, .buffer_size = sizeof(arena_buffer) };
+      pjson_dom dom;
+      pjson_dom_init(&dom, &dom_options);
+      TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, build(&dom, input, chunk_sizes[i], &options[j]));
+
+      const pjson_dom_value *root = &dom.root;
+      TEST_ASSERT_EQUAL(PJSON_DOM_OBJECT, root->type);
+      TEST_ASSERT_EQUAL(13, root->count);
+      TEST_ASSERT_EQUAL_STRING("rating", root->data.members[2].name.data);
+
+      assert_text(PJSON_DOM_NUMBER, "1", get(root, "id")); // the first of the duplicates
+      assert_text(PJSON_DOM_STRING, "first \"item\"", get(root, "name"));
+      assert_text(PJSON_DOM_NUMBER, "-4.5e1", get(root, "rating"));
+      TEST_ASSERT_EQUAL(PJSON_DOM_TRUE, get(root, "active")->type);
+      TEST_ASSERT_EQUAL(PJSON_DOM_FALSE, get(root, "gone")->type);
+      TEST_ASSERT_EQUAL(PJSON_DOM_NULL, get(root, "none")->type);
+      assert_text(PJSON_DOM_NUMBER, "5", get(root, "id2"));
+      assert_text(PJSON_DOM_STRING, "empty name", get(root, ""));
+      TEST_ASSERT_NULL(pjson_dom_object_get(root, "unknown", 7));
+      TEST_ASSERT_NULL(pjson_dom_object_get(root, "i", 1));
+
+      const pjson_dom_value *tags = get(root, "tags");
+      TEST_ASSERT_EQUAL(PJSON_DOM_ARRAY, tags->type);
+      TEST_ASSERT_EQUAL(3, tags->count);
+      assert_text(PJSON_DOM_STRING, "a", pjson_dom_array_get(tags, 0));
+      assert_text(PJSON_DOM_STRING, "b\n", pjson_dom_array_get(tags, 1));
+      assert_text(PJSON_DOM_STRING, "\xC3\xA9t\xC3\xA9", pjson_dom_array_get(tags, 2));
+      TEST_ASSERT_NULL(pjson_dom_array_get(tags, 3));
+      TEST_ASSERT_NULL(pjson_dom_object_get(tags, "a", 1));
+      TEST_ASSERT_NULL(pjson_dom_array_get(root, 0));
+
+      TEST_ASSERT_EQUAL(PJSON_DOM_ARRAY, get(root, "empty")->type);
+      TEST_ASSERT_EQUAL(0, get(root, "empty")->count);
+      TEST_ASSERT_EQUAL(PJSON_DOM_OBJECT, get(root, "nothing")->type);
+      TEST_ASSERT_EQUAL(0, get(root, "nothing")->count);
+
+      const pjson_dom_value *friends = get(root, "friends");
+      TEST_ASSERT_EQUAL(2, friends->count);
+      assert_text(PJSON_DOM_NUMBER, "2", get(pjson_dom_array_get(friends, 0), "id"));
+      assert_text(PJSON_DOM_STRING, "f2", get(pjson_dom_array_get(friends, 0), "name"));
+      const pjson_dom_value *nested = get(pjson_dom_array_get(friends, 1), "tags");
+      TEST_ASSERT_EQUAL(2, nested->count);
+      const pjson_dom_value *inner = pjson_dom_array_get(nested, 0);
+      TEST_ASSERT_EQUAL(2, inner->count);
+      assert_text(PJSON_DOM_NUMBER, "1", pjson_dom_array_get(inner, 0));
+      assert_text(PJSON_DOM_NUMBER, "2", pjson_dom_array_get(pjson_dom_array_get(inner, 1), 0));
+      assert_text(PJSON_DOM_NUMBER, "3", get(pjson_dom_array_get(nested, 1), "xy"));
+
+      pjson_dom_free(&dom);
+    }
+  }
+}
+
+TEST(dom, test_dom_toplevel_values) {
+  static const struct {
+    const char *input;
+    pjson_dom_type type;
+    size_t count;
+  } cases[] = {
+    { "null", PJSON_DOM_NULL, 0 }, { " true ", PJSON_DOM_TRUE, 0 }, { "-12.5", PJSON_DOM_NUMBER, 5 },
+    { "\"a\\tb\"", PJSON_DOM_STRING, 3 }, { "[]", PJSON_DOM_ARRAY, 0 }, { "[[], {}, 1]", PJSON_DOM_ARRAY, 3 },
+    { "{\"a\": {\"b\": []}}", PJSON_DOM_OBJECT, 1 },
+  };
+
+  // A single DOM builds the tree of one document after the other.
+  pjson_dom dom;
+  pjson_dom_init(&dom, NULL);
+  for (size_t i = 0; i < pjson_countof(cases); i++) {
+    pjson_dom_rewind(&dom);
+    TEST_ASSERT_EQUAL_MESSAGE(PJSON_STATUS_COMPLETED, build(&dom, cases[i].input, 2, NULL), cases[i].input);
+    TEST_ASSERT_EQUAL_MESSAGE(cases[i].type, dom.root.type, cases[i].input);
+    TEST_ASSERT_EQUAL_MESSAGE(cases[i].count, dom.root.count, cases[i].input);
+    TEST_ASSERT_EQUAL(0, dom.stack_count);
+  }
+  pjson_dom_free(&dom);
+}
+
+TEST(dom, test_dom_allocations) {
+  // A large document with many small strings: the tree gets a handful of arena blocks, not an allocation per node.
+  static char input[64 * 1024];
+  char *p = input;
+  p += sprintf(p, "[");
+  for (size_t i = 0; p < input + sizeof(input) - 64; i++) {
+    p += sprintf(p, "%s{\"id\": %u, \"tags\": [\"t%u\", \"u\"]}", i ? "," : "", (unsigned)i, (unsigned)i);
+  }
+  p += sprintf(p, "]");
+
+  counting_allocator allocator;
+  counting_allocator_init(&allocator, true);
+  pjson_dom_options options = { .allocator = &allocator.base };
+  pjson_dom dom;
+  pjson_dom_init(&dom, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, build(&dom, input, 4096, NULL));
+  TEST_ASSERT_TRUE(dom.root.count > 1000);
+  TEST_ASSERT_TRUE(allocator.allocation_count < 30);
+
+  // The memory is reused by the next document of the same size.
+  size_t allocation_count = allocator.allocation_count;
+  pjson_dom_rewind(&dom);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, build(&dom, input, 4096, NULL));
+  TEST_ASSERT_EQUAL(allocation_count, allocator.allocation_count);
+  assert_text(PJSON_DOM_STRING, "t7", pjson_dom_array_get(get(pjson_dom_array_get(&dom.root, 7), "tags"), 0));
+  pjson_dom_free(&dom);
+}
+
+TEST(dom, test_dom_streamed_strings) {
+  static const struct {
+    const char *input;
+    size_t split_index; // strings straddling this index are streamed
+    size_t error_index;
+  } cases[] = {
+    { "{\"a\": \"0123456789abcdefghij\"}", 12, 6 },
+    { "[1, {\"0123456789abcdefghij\": 2}]", 10, 5 },
+  };
+
+  // The tree can't hold strings without their bytes.
+  for (size_t i = 0; i < pjson_countof(cases); i++) {
+    counting_chunk_handler handler;
+    counting_chunk_handler_init(&handler, 4);
+    pjson_tokenizer_options options = { .string_chunk_handler = &handler.base };
+    pjson_dom dom;
+    pjson_dom_init(&dom, NULL);
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &dom.parser.base, &options);
+
+    TEST_ASSERT_EQUAL_MESSAGE(PJSON_STATUS_USER_ERROR, feed_split(&tokenizer, cases[i].input, cases[i].split_index), cases[i].input);
+    TEST_ASSERT_EQUAL_MESSAGE(cases[i].error_index, tokenizer.token_start_index, cases[i].input);
+    TEST_ASSERT_EQUAL(1, handler.string_count);
+    pjson_dom_free(&dom);
+  }
+}
+
+TEST(dom, test_dom_out_of_memory) {
+  static const char input[] = "{\"a\": [1, 2, {\"b\": \"c\"}], \"d\": [[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]}";
+
+  // Allocation failures anywhere make parsing fail cleanly.
+  for (size_t limit = 0;; limit++) {
+    counting_allocator allocator;
+    counting_allocator_init(&allocator, true);
+    allocator.allocation_limit = limit;
+    pjson_dom_options options = { .max_depth = 64, .allocator = &allocator.base };
+    pjson_dom dom;
+    pjson_dom_init(&dom, &options);
+    pjson_parsing_status status = build(&dom, input, 4096, NULL);
+    pjson_dom_free(&dom);
+
+    if (status == PJSON_STATUS_COMPLETED) break;
+    TEST_ASSERT_EQUAL(PJSON_STATUS_OUT_OF_MEMORY, status);
+    TEST_ASSERT_TRUE(limit < 100);
+  }
+}
+
+TEST_GROUP_RUNNER(dom) {
+  RUN_TEST_CASE(dom, test_dom_build);
+  RUN_TEST_CASE(dom, test_dom_toplevel_values);
+  RUN_TEST_CASE(dom, test_dom_allocations);
+  RUN_TEST_CASE(dom, test_dom_streamed_strings);
+  RUN_TEST_CASE(dom, test_dom_out_of_memory);
+}
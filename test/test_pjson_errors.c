@@ -106,6 +106,31 @@ TEST(errors, test_parse_utf8_low_surrogate) {
   TEST_ASSERT_EQUAL(5, error_index);
 }
 
+TEST(errors, test_parse_utf8_surrogate_after_long_run) {
+  pjson_parsing_status feed_status;
+  size_t error_index;
+  pjson_parsing_status close_status = parse_string("[\"\344\275\240\345\245\275\344\270\226\347\225\214\344\275\240\345\245\275\344\270\226\347\225\214"
+    "\344\275\240\345\245\275\344\270\226\347\225\214\355\240\200\344\275\240\345\245\275\"]", &feed_status, &error_index);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_UTF8_ERROR, feed_status);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_UTF8_ERROR, close_status);
+  TEST_ASSERT_EQUAL(38, error_index);
+}
+
+TEST(errors, test_parse_utf8_surrogate_split_between_chunks) {
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, NULL);
+  pjson_parsing_status feed_status1 = feed_string(&tokenizer, "[\"\344\275\240\345\245\275\344\270\226\347\225\214\344\275\240\345\245\275\344\270\226\347\225\214"
+    "\344\275\240\345\245\275\344\270\226\347\225\214\355");
+  pjson_parsing_status feed_status2 = feed_string(&tokenizer, "\240\200\344\275\240\345\245\275\"]");
+  pjson_parsing_status close_status = pjson_close(&tokenizer);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_status1);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_UTF8_ERROR, feed_status2);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_UTF8_ERROR, close_status);
+  TEST_ASSERT_EQUAL(38, tokenizer.token_start_index);
+}
+
 /* Escape sequence errors */
 
 TEST(errors, test_parse_escape_sequence_unterminated_input) {
@@ -220,6 +245,16 @@ TEST(errors, test_parse_surrogate_pair_unterminated_string) {
 
 /* Unexpected characters */
 
+TEST(errors, test_parse_control_character_after_ascii_run) {
+  pjson_parsing_status feed_status;
+  size_t error_index;
+  pjson_parsing_status close_status = parse_string("[\"The quick brown fox jumps over the lazy dog.\n\"]", &feed_status, &error_index);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, feed_status);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, close_status);
+  TEST_ASSERT_EQUAL(1, error_index);
+}
+
 TEST(errors, test_parse_invalid_character_null) {
   pjson_parsing_status feed_status;
   size_t error_index;
@@ -238,6 +273,16 @@ TEST(errors, test_parse_invalid_character_null) {
   TEST_ASSERT_EQUAL(15, error_index);
 }
 
+TEST(errors, test_parse_invalid_character_after_whitespace_run) {
+  pjson_parsing_status feed_status;
+  size_t error_index;
+  pjson_parsing_status close_status = parse_string("[\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t0,\r\n                                        ;]", &feed_status, &error_index);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, feed_status);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, close_status);
+  TEST_ASSERT_EQUAL(64, error_index);
+}
+
 TEST(errors, test_parse_invalid_character_in_keyword) {
   pjson_parsing_status feed_status;
   size_t error_index;
@@ -357,6 +402,8 @@ TEST_GROUP_RUNNER(errors) {
   RUN_TEST_CASE(errors, test_parse_utf8_4_byte_sequence_unterminated_string);
   RUN_TEST_CASE(errors, test_parse_utf8_high_surrogate);
   RUN_TEST_CASE(errors, test_parse_utf8_low_surrogate);
+  RUN_TEST_CASE(errors, test_parse_utf8_surrogate_after_long_run);
+  RUN_TEST_CASE(errors, test_parse_utf8_surrogate_split_between_chunks);
 
   RUN_TEST_CASE(errors, test_parse_escape_sequence_unterminated_input);
   RUN_TEST_CASE(errors, test_parse_escape_sequence_unterminated_string);
@@ -370,7 +417,9 @@ TEST_GROUP_RUNNER(errors) {
   RUN_TEST_CASE(errors, test_parse_surrogate_pair_unterminated_input);
   RUN_TEST_CASE(errors, test_parse_surrogate_pair_unterminated_string);
 
+  RUN_TEST_CASE(errors, test_parse_control_character_after_ascii_run);
   RUN_TEST_CASE(errors, test_parse_invalid_character_null);
+  RUN_TEST_CASE(errors, test_parse_invalid_character_after_whitespace_run);
   RUN_TEST_CASE(errors, test_parse_invalid_character_in_keyword);
   RUN_TEST_CASE(errors, test_parse_invalid_punctuator_directly_after_keyword);
   RUN_TEST_CASE(errors, test_parse_invalid_punctuator_after_keyword);
@@ -0,0 +1,200 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "test_data.h"
+#include "stats_parser.h"
+
+TEST_GROUP(index);
+
+TEST_SETUP(index) {}
+
+TEST_TEAR_DOWN(index) {}
+
+typedef struct {
+  pjson_parsing_status index_status;
+  pjson_parsing_status close_status;
+  pjson_token_type type;
+  size_t pos;
+} index_result;
+
+static void index_data(stats_parser *parser, const uint8_t *data, size_t length, index_result *result) {
+  stats_parser_init(parser, false);
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser->base.base);
+
+  result->index_status = pjson_index(&tokenizer, data, length);
+  result->close_status = pjson_close(&tokenizer);
+  result->type = tokenizer.token_type;
+  result->pos = tokenizer.token_start_index;
+}
+
+static void feed_data(stats_parser *parser, const uint8_t *data, size_t length, index_result *result) {
+  stats_parser_init(parser, false);
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser->base.base);
+
+  result->index_status = pjson_feed(&tokenizer, data, length);
+  result->close_status = pjson_close(&tokenizer);
+  result->type = tokenizer.token_type;
+  result->pos = tokenizer.token_start_index;
+}
+
+static pjson_parsing_status index_file(stats_parser *parser, const char *file_path, index_result *result) {
+  size_t length;
+  uint8_t *data = load_file(file_path, &length);
+  index_data(parser, data, length, result);
+  free(data);
+  return result->close_status;
+}
+
+/**
+ * Index `input` and check that the outcome is indistinguishable from feeding it in one go.
+ */
+static void assert_index_matches_feed(const char *input) {
+  stats_parser feed_parser, index_parser;
+  index_result feed_result, index_result;
+  size_t length = strlen(input);
+
+  feed_data(&feed_parser, (const uint8_t *)input, length, &feed_result);
+  index_data(&index_parser, (const uint8_t *)input, length, &index_result);
+
+  TEST_ASSERT_EQUAL(feed_result.index_status, index_result.index_status);
+  TEST_ASSERT_EQUAL(feed_result.close_status, index_result.close_status);
+  TEST_ASSERT_EQUAL(feed_result.type, index_result.type);
+  TEST_ASSERT_EQUAL(feed_result.pos, index_result.pos);
+  TEST_ASSERT_EQUAL(feed_parser.key_count, index_parser.key_count);
+  TEST_ASSERT_EQUAL(feed_parser.max_depth, index_parser.max_depth);
+  TEST_ASSERT_EQUAL_MEMORY(feed_parser.datatype_counts, index_parser.datatype_counts, sizeof(feed_parser.datatype_counts));
+}
+
+TEST(index, test_index_formatted_1mb) {
+  stats_parser parser;
+  index_result result;
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, index_file(&parser, "test/data/formatted_1mb.json", &result));
+
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_CLOSE_BRACKET, parser.toplevel_datatype);
+  TEST_ASSERT_EQUAL(4, parser.max_depth);
+  TEST_ASSERT_EQUAL(1550, parser.max_array_item_count);
+  TEST_ASSERT_EQUAL(24, parser.max_object_property_count);
+  TEST_ASSERT_EQUAL(21700, parser.key_count);
+
+  TEST_ASSERT_EQUAL(0, parser.datatype_counts[PJSON_TOKEN_NULL - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(381, parser.datatype_counts[PJSON_TOKEN_FALSE - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(394, parser.datatype_counts[PJSON_TOKEN_TRUE - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(5425, parser.datatype_counts[PJSON_TOKEN_NUMBER - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(19375, parser.datatype_counts[PJSON_TOKEN_STRING - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(1551, parser.datatype_counts[PJSON_TOKEN_CLOSE_BRACKET - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(3100, parser.datatype_counts[PJSON_TOKEN_CLOSE_BRACE - PJSON_TOKEN_NULL]);
+}
+
+TEST(index, test_index_minified_1mb) {
+  stats_parser parser;
+  index_result result;
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, index_file(&parser, "test/data/minified_1mb.json", &result));
+
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_CLOSE_BRACKET, parser.toplevel_datatype);
+  TEST_ASSERT_EQUAL(4, parser.max_depth);
+  TEST_ASSERT_EQUAL(2000, parser.max_array_item_count);
+  TEST_ASSERT_EQUAL(24, parser.max_object_property_count);
+  TEST_ASSERT_EQUAL(28000, parser.key_count);
+
+  TEST_ASSERT_EQUAL(0, parser.datatype_counts[PJSON_TOKEN_NULL - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(492, parser.datatype_counts[PJSON_TOKEN_FALSE - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(508, parser.datatype_counts[PJSON_TOKEN_TRUE - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(7000, parser.datatype_counts[PJSON_TOKEN_NUMBER - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(25000, parser.datatype_counts[PJSON_TOKEN_STRING - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(2001, parser.datatype_counts[PJSON_TOKEN_CLOSE_BRACKET - PJSON_TOKEN_NULL]);
+  TEST_ASSERT_EQUAL(4000, parser.datatype_counts[PJSON_TOKEN_CLOSE_BRACE - PJSON_TOKEN_NULL]);
+}
+
+TEST(index, test_index_invalid_binary_data) {
+  stats_parser parser;
+  index_result result;
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, index_file(&parser, "test/data/invalid_binary_data.json", &result));
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_ERROR, result.type);
+  TEST_ASSERT_EQUAL(47, result.pos);
+}
+
+TEST(index, test_index_invalid_missing_colon) {
+  stats_parser parser;
+  index_result result;
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, index_file(&parser, "test/data/invalid_missing_colon.json", &result));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, result.index_status);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, result.type);
+  TEST_ASSERT_EQUAL(22275, result.pos);
+}
+
+TEST(index, test_index_invalid_unterminated_string) {
+  stats_parser parser;
+  index_result result;
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, index_file(&parser, "test/data/invalid_unterminated_string.json", &result));
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_ERROR, result.type);
+  TEST_ASSERT_EQUAL(30029, result.pos);
+}
+
+TEST(index, test_index_escapes_across_block_boundaries) {
+  // Backslash runs of varying parity ending right at, and straddling, 64-byte block boundaries.
+  assert_index_matches_feed("[\"0123456789012345678901234567890123456789012345678901234567890\\\\\", \"\\\"\"]");
+  assert_index_matches_feed("[\"01234567890123456789012345678901234567890123456789012345678901\\\\\\\"\", 1]");
+  assert_index_matches_feed("[\"012345678901234567890123456789012345678901234567890123456789012\\\"\\\\\", {\"a\\u00e9\": null}]");
+  assert_index_matches_feed("{\"k\": \"0123456789012345678901234567890123456789012345678901234"
+    "\\\\\\\\\\\\\\\\" "\\\\\\\\\\\\\\\\" "\\\\\\\\\\\\\\\\" "\\\\\\\\\\\\\\\\" "\\\\\\\\\\\\\\\\" "\"}");
+}
+
+TEST(index, test_index_scalars_across_block_boundaries) {
+  assert_index_matches_feed("[1234567890,1234567890,1234567890,1234567890,1234567890,12345678.9e-10,true,false,null ,-0.5E+3]");
+  assert_index_matches_feed("[                                                            12345678,                      true]");
+  assert_index_matches_feed("                                                               0");
+  assert_index_matches_feed("                                                               nul");
+}
+
+TEST(index, test_index_errors_match_feed) {
+  assert_index_matches_feed("[\"0123456789012345678901234567890123456789012345678901234567890\t\"]");
+  assert_index_matches_feed("[\"0123456789012345678901234567890123456789012345678901234567890\\x\"]");
+  assert_index_matches_feed("[\"0123456789012345678901234567890123456789012345678901234567890\xc3\"]");
+  assert_index_matches_feed("[1234567890,1234567890,1234567890,1234567890,1234567890,123456789 x]");
+  assert_index_matches_feed("[truefalse]");
+  assert_index_matches_feed("[01]");
+  assert_index_matches_feed("{\"a\" 1}");
+  assert_index_matches_feed("[1,2,3");
+  assert_index_matches_feed("\"unterminated");
+  assert_index_matches_feed("");
+  assert_index_matches_feed("[] []");
+}
+
+TEST(index, test_index_separators_match_feed) {
+  // Separators and property names which follow other tokens right away are emitted without a pass through
+  // the main dispatch of pjson_index.
+  assert_index_matches_feed("{\"a\":{\"b\":[1,\"c\",[],{}],\"d\":\"e\"},\"f\":[{\"g\":null},{\"h\":true}]}");
+  assert_index_matches_feed("{\"a\"::1}");
+  assert_index_matches_feed("{\"a\":1,,\"b\":2}");
+  assert_index_matches_feed("[\"a\":1]");
+  assert_index_matches_feed("[[],:]");
+  assert_index_matches_feed("{\"a\":{},\"b\\n\":1}");
+  assert_index_matches_feed("{\"a\":1}:");
+  assert_index_matches_feed("[\"a\"],");
+  assert_index_matches_feed("{}\"a\"");
+}
+
+TEST_GROUP_RUNNER(index) {
+  RUN_TEST_CASE(index, test_index_formatted_1mb);
+  RUN_TEST_CASE(index, test_index_minified_1mb);
+  RUN_TEST_CASE(index, test_index_invalid_binary_data);
+  RUN_TEST_CASE(index, test_index_invalid_missing_colon);
+  RUN_TEST_CASE(index, test_index_invalid_unterminated_string);
+  RUN_TEST_CASE(index, test_index_escapes_across_block_boundaries);
+  RUN_TEST_CASE(index, test_index_scalars_across_block_boundaries);
+  RUN_TEST_CASE(index, test_index_errors_match_feed);
+  RUN_TEST_CASE(index, test_index_separators_match_feed);
+}
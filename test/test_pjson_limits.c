@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "test_input.h"
+
+TEST_GROUP(limits);
+
+TEST_SETUP(limits) {}
+
+TEST_TEAR_DOWN(limits) {}
+
+typedef struct {
+  pjson_parser_base base;
+  size_t token_count;
+} counting_parser;
+
+static pjson_parsing_status counting_parser_eat(pjson_parser_base *parser, const pjson_token *token) {
+  ((counting_parser *)parser)->token_count++;
+  return token->type != PJSON_TOKEN_EOS ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_COMPLETED;
+}
+
+TEST(limits, test_limits_token_length) {
+  static const char input[] = "[\"abcdefgh\", 123456789]";
+
+  // Complete tokens (referenced in place), incomplete tokens (buffered) and whole-buffer indexing are all checked.
+  for (size_t chunk_size = 1; chunk_size <= sizeof(input); chunk_size++) {
+    counting_parser parser = { { &counting_parser_eat }, 0 };
+    pjson_tokenizer_options options = { .max_token_length = 9 };
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base, &options);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_LIMIT_EXCEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, chunk_size, &pjson_feed));
+    TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, tokenizer.token_type);
+    TEST_ASSERT_EQUAL(1, tokenizer.token_start_index);
+    TEST_ASSERT_EQUAL(1, parser.token_count);
+    pjson_close(&tokenizer);
+  }
+
+  counting_parser parser = { { &counting_parser_eat }, 0 };
+  pjson_tokenizer_options options = { .max_token_length = 10 };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_index(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+  options.max_token_length = 8;
+  pjson_init_ex(&tokenizer, &parser.base, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_LIMIT_EXCEEDED, pjson_index(&tokenizer, (const uint8_t *)input + 12, sizeof(input) - 13));
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_NUMBER, tokenizer.token_type);
+  TEST_ASSERT_EQUAL(1, tokenizer.token_start_index);
+  pjson_close(&tokenizer);
+}
+
+TEST(limits, test_limits_buffer_size) {
+  size_t string_lengths[16], length;
+  for (size_t i = 0; i < pjson_countof(string_lengths); i++) string_lengths[i] = 1002;
+  uint8_t *data = make_string_array(string_lengths, pjson_countof(string_lengths), "\\n", &length);
+
+  // Strings straddling the chunks must be buffered, and each needs unescaping.
+  static const struct { size_t max_buffer_size; pjson_parsing_status status; } cases[] = {
+    { 0, PJSON_STATUS_COMPLETED }, { 4096, PJSON_STATUS_COMPLETED }, { 1500, PJSON_STATUS_LIMIT_EXCEEDED }, { 1000, PJSON_STATUS_LIMIT_EXCEEDED },
+  };
+  for (size_t i = 0; i < pjson_countof(cases); i++) {
+    counting_parser parser = { { &counting_parser_eat }, 0 };
+    pjson_tokenizer_options options = { .unescape_strings = true, .max_buffer_size = cases[i].max_buffer_size };
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base, &options);
+    pjson_parsing_status status = feed_in_chunks(&tokenizer, data, length, 700, &pjson_feed);
+    if (status == PJSON_STATUS_DATA_NEEDED) status = pjson_close(&tokenizer);
+    else pjson_close(&tokenizer);
+    TEST_ASSERT_EQUAL(cases[i].status, status);
+
+    if (cases[i].max_buffer_size) {
+      size_t buffer_size = (tokenizer.buf != pjson_fixed_size_buf(&tokenizer) ? tokenizer.buf_capacity : 0) + tokenizer.unescape_buf_capacity;
+      TEST_ASSERT_TRUE(buffer_size <= cases[i].max_buffer_size);
+    }
+  }
+
+  free(data);
+}
+
+TEST(limits, test_limits_segment_list) {
+  static const size_t string_lengths[] = { 402, 402 };
+  size_t length;
+  uint8_t *data = make_string_array(string_lengths, pjson_countof(string_lengths), "", &length);
+
+  // Scattered strings aren't buffered, but the list recording their segments grows with the number of chunks.
+  static const struct { size_t max_buffer_size; pjson_parsing_status status; } cases[] = {
+    { 0, PJSON_STATUS_COMPLETED }, { 200 * sizeof(pjson_segment), PJSON_STATUS_COMPLETED }, { 512, PJSON_STATUS_LIMIT_EXCEEDED },
+  };
+  for (size_t i = 0; i < pjson_countof(cases); i++) {
+    counting_parser parser = { { &counting_parser_eat }, 0 };
+    pjson_tokenizer_options options = { .scatter_strings = true, .max_buffer_size = cases[i].max_buffer_size };
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base, &options);
+    pjson_parsing_status status = feed_in_chunks(&tokenizer, data, length, 4, &pjson_feed);
+    if (cases[i].max_buffer_size) {
+      TEST_ASSERT_TRUE(tokenizer.segment_capacity * sizeof(pjson_segment) <= cases[i].max_buffer_size);
+    }
+
+    if (status == PJSON_STATUS_DATA_NEEDED) status = pjson_close(&tokenizer);
+    else {
+      TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, tokenizer.token_type);
+      pjson_close(&tokenizer);
+    }
+    TEST_ASSERT_EQUAL(cases[i].status, status);
+  }
+
+  free(data);
+}
+
+TEST(limits, test_limits_depth) {
+  static const char input[] = "[{\"a\": [[1]], \"b\": {}}, [[2]]]";
+
+  for (size_t max_depth = 1; max_depth <= 5; max_depth++) {
+    counting_parser parser = { { &counting_parser_eat }, 0 };
+    pjson_tokenizer_options options = { .max_depth = max_depth };
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base, &options);
+    pjson_parsing_status status = pjson_feed(&tokenizer, (const uint8_t *)input, sizeof(input) - 1);
+    TEST_ASSERT_EQUAL(max_depth >= 4 ? PJSON_STATUS_DATA_NEEDED : PJSON_STATUS_MAX_DEPTH_EXCEEDED, status);
+    pjson_close(&tokenizer);
+
+    counting_parser index_parser = { { &counting_parser_eat }, 0 };
+    pjson_init_ex(&tokenizer, &index_parser.base, &options);
+    TEST_ASSERT_EQUAL(status, pjson_index(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+    pjson_close(&tokenizer);
+    TEST_ASSERT_EQUAL(parser.token_count, index_parser.token_count);
+  }
+}
+
+TEST_GROUP_RUNNER(limits) {
+  RUN_TEST_CASE(limits, test_limits_token_length);
+  RUN_TEST_CASE(limits, test_limits_buffer_size);
+  RUN_TEST_CASE(limits, test_limits_segment_list);
+  RUN_TEST_CASE(limits, test_limits_depth);
+}
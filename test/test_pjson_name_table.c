@@ -0,0 +1,204 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "counting_allocator.h"
+
+TEST_GROUP(name_table);
+
+TEST_SETUP(name_table) {}
+
+TEST_TEAR_DOWN(name_table) {}
+
+static const char *const schema_names[] = {
+  "_id", "index", "guid", "isActive", "balance", "picture", "age", "eyeColor", "name", "gender", "company", "email",
+  "phone", "address", "about", "registered", "latitude", "longitude", "tags", "friends", "greeting", "favoriteFruit",
+  "id", "", "a/b", "\"quoted\"", "line\nbreak", "\xC3\xA9t\xC3\xA9", "a_rather_long_property_name_crossing_8_byte_words",
+};
+
+// The parser looks up every property name of the top-level object and records the indices.
+
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  const pjson_name_table *table;
+  size_t indices[64];
+  size_t count;
+} lookup_parser;
+
+static pjson_parsing_status lookup_parser_on_name(lookup_parser *parser, pjson_parser_context *context, const pjson_token *token) {
+  (void)context;
+  TEST_ASSERT_TRUE(parser->count < pjson_countof(parser->indices));
+  parser->indices[parser->count++] = pjson_name_table_find(parser->table, token);
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status lookup_parser_on_value(lookup_parser *parser, pjson_parser_context *context, const pjson_token *token) {
+  (void)context;
+  if (token->type == PJSON_TOKEN_OPEN_BRACE) {
+    parser->base.context->on_object_property_name = (pjson_parser_context_callback)&lookup_parser_on_name;
+  }
+  return PJSON_STATUS_SUCCESS;
+}
+
+static void check_lookups(const pjson_name_table *table, const char *input, const size_t *expected, size_t expected_count) {
+  static const size_t chunk_sizes[] = { 1, 5, 4096 };
+  const pjson_tokenizer_options options[] = { { .unescape_strings = false }, { .unescape_strings = true }, { .scatter_strings = true } };
+
+  for (size_t i = 0; i < pjson_countof(chunk_sizes); i++) {
+    for (size_t j = 0; j < pjson_countof(options); j++) {
+      lookup_parser parser;
+      pjson_parser_init_ex(&parser.base, false, NULL);
+      parser.base.context->on_value = (pjson_parser_context_callback)&lookup_parser_on_value;
+      parser.table = table;
+      parser.count = 0;
+
+      pjson_tokenizer tokenizer;
+      pjson_init_ex(&tokenizer, &parser.base.base, &options[j]);
+      pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+      size_t length = strlen(input);
+      for (size_t offset = 0; offset < length && status == PJSON_STATUS_DATA_NEEDED; offset += chunk_sizes[i]) {
+        size_t chunk_length = length - offset < chunk_sizes[i] ? length - offset : chunk_sizes[i];
+        status = pjson_feed(&tokenizer, (const uint8_t *)input + offset, chunk_length);
+      }
+      TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, status);
+      TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+      pjson_parser_free(&parser.base);
+
+      TEST_ASSERT_EQUAL(expected_count, parser.count);
+      for (size_t k = 0; k < expected_count; k++) {
+        TEST_ASSERT_EQUAL_MESSAGE(expected[k], parser.indices[k], input);
+      }
+    }
+  }
+}
+
+TEST(name_table, test_name_table_find_string) {
+  pjson_name_table table;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_name_table_init(&table, schema_names, pjson_countof(schema_names), NULL));
+
+  for (size_t i = 0; i < pjson_countof(schema_names); i++) {
+    TEST_ASSERT_EQUAL(i, pjson_name_table_find_string(&table, (const uint8_t *)schema_names[i], strlen(schema_names[i])));
+  }
+
+  static const char *const unknown_names[] = { "i", "ids", "Id", "nam", "names", "tag", "a_rather_long_property_name_crossing_8_byte_word" };
+  for (size_t i = 0; i < pjson_countof(unknown_names); i++) {
+    TEST_ASSERT_EQUAL(PJSON_NAME_NOT_FOUND, pjson_name_table_find_string(&table, (const uint8_t *)unknown_names[i], strlen(unknown_names[i])));
+  }
+  TEST_ASSERT_EQUAL(PJSON_NAME_NOT_FOUND, pjson_name_table_find_string(&table, (const uint8_t *)"id\0", 3));
+
+  pjson_name_table_free(&table);
+}
+
+TEST(name_table, test_name_table_find_token) {
+  pjson_name_table table;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_name_table_init(&table, schema_names, pjson_countof(schema_names), NULL));
+
+  static const size_t plain_expected[] = { 22, 8, 28, PJSON_NAME_NOT_FOUND, 23, 6 };
+  check_lookups(&table,
+    "{\"id\": 1, \"name\": [], \"a_rather_long_property_name_crossing_8_byte_words\": {\"x\": 2}, \"unknown\": 3, \"\": 4, \"age\": 5}",
+    plain_expected, pjson_countof(plain_expected));
+
+  // Names with escape sequences are unescaped before the lookup.
+  static const size_t escaped_expected[] = { 22, 24, 24, 25, 26, 27, 27, PJSON_NAME_NOT_FOUND, 9 };
+  check_lookups(&table,
+    "{\"\\u0069d\": 1, \"a\\/b\": 2, \"a/b\": 3, \"\\\"quoted\\\"\": 4, \"line\\nbreak\": 5, \"\\u00e9t\\u00E9\": 6, \"\xC3\xA9t\xC3\xA9\": 7,"
+    " \"\\u0069ds\": 8, \"\\u0067\\u0065\\u006e\\u0064\\u0065\\u0072\": 9}",
+    escaped_expected, pjson_countof(escaped_expected));
+
+  pjson_name_table_free(&table);
+}
+
+TEST(name_table, test_name_table_streamed_name) {
+  pjson_name_table table;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_name_table_init(&table, schema_names, pjson_countof(schema_names), NULL));
+
+  // A name streamed to a string chunk handler comes without its bytes, whether it has escape sequences or not.
+  pjson_token token = { PJSON_TOKEN_STRING, 1, NULL, 6, 4, NULL, NULL, 0 };
+  TEST_ASSERT_EQUAL(PJSON_NAME_UNAVAILABLE, pjson_name_table_find(&table, &token));
+  token.length = 11;
+  TEST_ASSERT_EQUAL(PJSON_NAME_UNAVAILABLE, pjson_name_table_find(&table, &token));
+
+  // Names longer than any in the table are not found all the same.
+  token.length = token.unescaped_length = 1000;
+  TEST_ASSERT_EQUAL(PJSON_NAME_NOT_FOUND, pjson_name_table_find(&table, &token));
+
+  pjson_name_table_free(&table);
+}
+
+TEST(name_table, test_name_table_long_escaped_name) {
+  // Names too long to be unescaped on the stack are unescaped in an allocated buffer.
+  static char name[301];
+  memset(name, 'x', sizeof(name) - 1);
+  const char *const names[] = { "x", name };
+  pjson_name_table table;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_name_table_init(&table, names, pjson_countof(names), NULL));
+
+  static char input[sizeof(name) * 6 + 32];
+  char *p = input;
+  p += sprintf(p, "{\"");
+  for (size_t i = 0; i < sizeof(name) - 1; i++) p += sprintf(p, i % 2 ? "x" : "\\u0078");
+  p += sprintf(p, "\": 1, \"\\u0078\": 2}");
+
+  static const size_t expected[] = { 1, 0 };
+  check_lookups(&table, input, expected, pjson_countof(expected));
+
+  pjson_name_table_free(&table);
+
+  // The name can't be told apart from the other ones if allocating the buffer fails.
+  counting_allocator allocator;
+  counting_allocator_init(&allocator, false);
+  pjson_name_table_options options = { .allocator = &allocator.base };
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_name_table_init(&table, names, pjson_countof(names), &options));
+  allocator.allocation_limit = allocator.allocation_count;
+
+  static char escaped_name[sizeof(name) + 7];
+  sprintf(escaped_name, "\"\\u0078%s\"", name + 1);
+  pjson_token token = { PJSON_TOKEN_STRING, 0, (const uint8_t *)escaped_name, strlen(escaped_name), sizeof(name) - 1, NULL, NULL, 0 };
+  TEST_ASSERT_EQUAL(PJSON_NAME_UNAVAILABLE, pjson_name_table_find(&table, &token));
+  allocator.allocation_limit = (size_t)-1;
+  TEST_ASSERT_EQUAL(1, pjson_name_table_find(&table, &token));
+
+  pjson_name_table_free(&table);
+  TEST_ASSERT_EQUAL(0, allocator.live_size);
+}
+
+TEST(name_table, test_name_table_many_names) {
+  static char storage[PJSON_NAME_TABLE_MAX_NAMES][8];
+  static const char *names[PJSON_NAME_TABLE_MAX_NAMES];
+  for (size_t i = 0; i < pjson_countof(names); i++) {
+    snprintf(storage[i], sizeof(storage[i]), "f%u", (unsigned)i);
+    names[i] = storage[i];
+  }
+
+  static const size_t counts[] = { 0, 1, 2, 7, 40, 1000, PJSON_NAME_TABLE_MAX_NAMES };
+  for (size_t j = 0; j < pjson_countof(counts); j++) {
+    const size_t count = counts[j];
+    pjson_name_table table;
+    TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_name_table_init(&table, names, count, NULL));
+    for (size_t i = 0; i < count; i++) {
+      TEST_ASSERT_EQUAL(i, pjson_name_table_find_string(&table, (const uint8_t *)names[i], strlen(names[i])));
+    }
+    TEST_ASSERT_EQUAL(PJSON_NAME_NOT_FOUND, pjson_name_table_find_string(&table, (const uint8_t *)"f65535", 6));
+    pjson_name_table_free(&table);
+  }
+}
+
+TEST(name_table, test_name_table_invalid) {
+  static const char *const duplicate_names[] = { "a", "b", "c", "b" };
+  pjson_name_table table;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, pjson_name_table_init(&table, duplicate_names, pjson_countof(duplicate_names), NULL));
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_LIMIT_EXCEEDED, pjson_name_table_init(&table, duplicate_names, PJSON_NAME_TABLE_MAX_NAMES + 1, NULL));
+}
+
+TEST_GROUP_RUNNER(name_table) {
+  RUN_TEST_CASE(name_table, test_name_table_find_string);
+  RUN_TEST_CASE(name_table, test_name_table_find_token);
+  RUN_TEST_CASE(name_table, test_name_table_streamed_name);
+  RUN_TEST_CASE(name_table, test_name_table_long_escaped_name);
+  RUN_TEST_CASE(name_table, test_name_table_many_names);
+  RUN_TEST_CASE(name_table, test_name_table_invalid);
+}
@@ -13,7 +13,8 @@ TEST_TEAR_DOWN(parse_datastruct) {}
 
 static pjson_parsing_status parse_string(ds_parser *parser, const char *input, pjson_parsing_status *feed_status) {
   pjson_tokenizer tokenizer;
-  pjson_init(&tokenizer, &parser->base.base);
+  pjson_tokenizer_options options = { .unescape_strings = true };
+  pjson_init_ex(&tokenizer, &parser->base.base, &options);
   pjson_parsing_status status = -1; // unnecessary assignment, just for keeping the compiler happy
 
   char buf[16];
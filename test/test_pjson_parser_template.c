@@ -0,0 +1,186 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "pjson_parser_template.h"
+
+TEST_GROUP(parser_template);
+
+TEST_SETUP(parser_template) {}
+
+TEST_TEAR_DOWN(parser_template) {}
+
+#define TEST_MAX_DEPTH (4)
+
+// Both parsers record the callbacks in the same format, so the specialized parser can be checked against pjson_parser.
+
+typedef struct {
+  char text[1024];
+  size_t length;
+  const char *fail_at; // the callbacks fail with PJSON_STATUS_USER_ERROR when seeing this token (if not NULL)
+} event_log;
+
+static pjson_parsing_status event_log_append(event_log *log, char kind, size_t level, const pjson_token *token) {
+  int n = snprintf(log->text + log->length, sizeof(log->text) - log->length, "%c%d@%u:%.*s ",
+    kind, (int)token->type, (unsigned)level, (int)token->length, token->start ? (const char *)token->start : "");
+  TEST_ASSERT_TRUE(n > 0 && (size_t)n < sizeof(log->text) - log->length);
+  log->length += (size_t)n;
+
+  return log->fail_at && token->length == strlen(log->fail_at) && !memcmp(token->start, log->fail_at, token->length)
+    ? PJSON_STATUS_USER_ERROR
+    : PJSON_STATUS_SUCCESS;
+}
+
+/* Specialized parser */
+
+typedef struct {
+  size_t level;
+} test_context;
+
+typedef struct test_parser test_parser;
+
+static pjson_parsing_status test_parser_on_value(test_parser *parser, test_context *context, const pjson_token *token);
+static pjson_parsing_status test_parser_on_name(test_parser *parser, test_context *context, const pjson_token *token);
+
+PJSON_DEFINE_PARSER(test_parser, test_context, TEST_MAX_DEPTH, test_parser_on_value, test_parser_on_name)
+
+static pjson_parsing_status test_parser_on_value(test_parser *parser, test_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_OPEN_BRACKET || token->type == PJSON_TOKEN_OPEN_BRACE) {
+    test_context *child_context = test_parser_current_context(parser);
+    TEST_ASSERT_EQUAL(0, child_context->level); // contexts are zeroed when pushed
+    child_context->level = context->level + 1;
+  }
+  return event_log_append((event_log *)parser->user_data, 'v', context->level, token);
+}
+
+static pjson_parsing_status test_parser_on_name(test_parser *parser, test_context *context, const pjson_token *token) {
+  return event_log_append((event_log *)parser->user_data, 'n', context->level, token);
+}
+
+/* Generic parser */
+
+typedef struct {
+  pjson_parser_context base; // base struct MUST be the first member!
+  size_t level;
+} generic_context;
+
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  event_log *log;
+} generic_parser;
+
+static pjson_parsing_status generic_parser_on_name(generic_parser *parser, generic_context *context, const pjson_token *token) {
+  return event_log_append(parser->log, 'n', context->level, token);
+}
+
+static pjson_parsing_status generic_parser_on_value(generic_parser *parser, generic_context *context, const pjson_token *token) {
+  if (token->type == PJSON_TOKEN_OPEN_BRACKET || token->type == PJSON_TOKEN_OPEN_BRACE) {
+    generic_context *child_context = (generic_context *)parser->base.context;
+    child_context->level = context->level + 1;
+    child_context->base.on_value = (pjson_parser_context_callback)&generic_parser_on_value;
+    child_context->base.on_object_property_name = (pjson_parser_context_callback)&generic_parser_on_name;
+  }
+  return event_log_append(parser->log, 'v', context->level, token);
+}
+
+/* Helpers */
+
+static pjson_parsing_status parse(pjson_parser_base *parser, const char *input, size_t chunk_size) {
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, parser);
+
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  size_t length = strlen(input);
+  for (size_t offset = 0; offset < length && status == PJSON_STATUS_DATA_NEEDED; offset += chunk_size) {
+    status = pjson_feed(&tokenizer, (const uint8_t *)input + offset, length - offset < chunk_size ? length - offset : chunk_size);
+  }
+
+  pjson_parsing_status close_status = pjson_close(&tokenizer);
+  return status == PJSON_STATUS_DATA_NEEDED ? close_status : status;
+}
+
+static void check_same_as_generic(const char *input, bool is_lazy, const char *fail_at, size_t chunk_size) {
+  event_log generic_log = { "", 0, fail_at };
+  generic_context initial_contexts[TEST_MAX_DEPTH + 1];
+  pjson_parser_options options = {
+    .context_size = sizeof(generic_context),
+    .initial_contexts = initial_contexts,
+    .initial_capacity = pjson_countof(initial_contexts),
+    .max_depth = TEST_MAX_DEPTH,
+  };
+  generic_parser generic;
+  pjson_parser_init_ex(&generic.base, is_lazy, &options);
+  generic.log = &generic_log;
+  generic.base.context->on_value = (pjson_parser_context_callback)&generic_parser_on_value;
+  generic.base.context->on_object_property_name = (pjson_parser_context_callback)&generic_parser_on_name;
+  pjson_parsing_status generic_status = parse(&generic.base.base, input, chunk_size);
+  pjson_parser_free(&generic.base);
+
+  event_log log = { "", 0, fail_at };
+  test_parser parser;
+  test_parser_init(&parser, is_lazy);
+  parser.user_data = &log;
+  pjson_parsing_status status = parse(&parser.base, input, chunk_size);
+
+  TEST_ASSERT_EQUAL_MESSAGE(generic_status, status, input);
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(generic_log.text, log.text, input);
+}
+
+TEST(parser_template, test_parser_template_same_as_generic) {
+  static const char *inputs[] = {
+    "", " ", "null", "true", " 13 ", "\"abc\"", "1 2", "[]", "{}", "[1, [2, {}], {\"a\": 3}]",
+    "{\"a\": [true, false, null], \"b\": {\"c\": {\"d\": \"e\"}}, \"f\": 1.5e3}",
+    "[[[[1]]]]", "[[[[[1]]]]]", "{\"a\": {\"b\": [{\"c\": [2]}]}}", "[1, 2] 3", "{} []",
+    "[", "]", "[1,]", "[1 2]", "{\"a\"}", "{\"a\": }", "{\"a\": 1,}", "{1: 2}", "{\"a\": 1 \"b\": 2}", "[}", "{]",
+    ",", ":", "[1, 2", "{\"a\": 1", "{\"a\"", "[[[]]",
+  };
+  static const char *fail_at[] = { NULL, "13", "\"a\"", "[", "}", "3" };
+
+  for (size_t i = 0; i < pjson_countof(inputs); i++) {
+    for (size_t j = 0; j < pjson_countof(fail_at); j++) {
+      check_same_as_generic(inputs[i], false, fail_at[j], 1);
+      check_same_as_generic(inputs[i], false, fail_at[j], 1024);
+      check_same_as_generic(inputs[i], true, fail_at[j], 1);
+      check_same_as_generic(inputs[i], true, fail_at[j], 1024);
+    }
+  }
+}
+
+TEST(parser_template, test_parser_template_reuse) {
+  static const char *inputs[] = { "[1, {\"a\": [2]}]", "{\"b\": 3}" };
+
+  test_parser parser;
+  for (size_t i = 0; i < pjson_countof(inputs); i++) {
+    event_log log = { "", 0, NULL };
+    test_parser_init(&parser, false);
+    parser.user_data = &log;
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, parse(&parser.base, inputs[i], 1024));
+    TEST_ASSERT_EQUAL(0, parser.depth);
+    TEST_ASSERT_TRUE(log.length > 0);
+  }
+}
+
+// Parser which only validates the syntax
+typedef struct validating_parser validating_parser;
+PJSON_DEFINE_PARSER(validating_parser, test_context, 1, PJSON_PARSER_IGNORE, PJSON_PARSER_IGNORE)
+
+TEST(parser_template, test_parser_template_ignore) {
+  validating_parser parser;
+  validating_parser_init(&parser, false);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, parse(&parser.base, "[1, \"a\", null]", 1024));
+
+  validating_parser_init(&parser, false);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_MAX_DEPTH_EXCEEDED, parse(&parser.base, "[1, {}]", 1024));
+
+  validating_parser_init(&parser, false);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, parse(&parser.base, "[1, }", 1024));
+}
+
+TEST_GROUP_RUNNER(parser_template) {
+  RUN_TEST_CASE(parser_template, test_parser_template_same_as_generic);
+  RUN_TEST_CASE(parser_template, test_parser_template_reuse);
+  RUN_TEST_CASE(parser_template, test_parser_template_ignore);
+}
@@ -0,0 +1,278 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "chunk_handlers.h"
+
+TEST_GROUP(path_filter);
+
+TEST_SETUP(path_filter) {}
+
+TEST_TEAR_DOWN(path_filter) {}
+
+// The filters record the matches as `<path index>:<token>` and fail or skip when seeing the given tokens.
+
+typedef struct {
+  char text[1024];
+  size_t length;
+  const char *fail_at; // on_match fails with PJSON_STATUS_USER_ERROR when seeing this token (if not NULL)
+  const char *skip_at; // on_match returns PJSON_STATUS_SKIP when seeing this token (if not NULL)
+} event_log;
+
+static bool token_equals(const pjson_token *token, const char *text) {
+  return text && token->start && token->length == strlen(text) && !memcmp(token->start, text, token->length);
+}
+
+static pjson_parsing_status log_match(pjson_path_filter *filter, size_t path_index, const pjson_token *token) {
+  event_log *log = (event_log *)filter->user_data;
+
+  char data[256] = "";
+  size_t length = 0;
+  if (token->segments) {
+    for (size_t i = 0; i < token->segment_count; i++) {
+      TEST_ASSERT_TRUE(length + token->segments[i].length < sizeof(data));
+      memcpy(data + length, token->segments[i].start, token->segments[i].length);
+      length += token->segments[i].length;
+    }
+  }
+  else if (token->start) {
+    TEST_ASSERT_TRUE(token->length < sizeof(data));
+    memcpy(data, token->start, token->length);
+    length = token->length;
+  }
+
+  int n = snprintf(log->text + log->length, sizeof(log->text) - log->length, "%u:%.*s ",
+    (unsigned)path_index, (int)length, data);
+  TEST_ASSERT_TRUE(n > 0 && (size_t)n < sizeof(log->text) - log->length);
+  log->length += (size_t)n;
+
+  if (token_equals(token, log->fail_at)) return PJSON_STATUS_USER_ERROR;
+  if (token_equals(token, log->skip_at)) return PJSON_STATUS_SKIP;
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status parse(pjson_path_filter *filter, const char *input, size_t chunk_size,
+  const pjson_tokenizer_options *options) {
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &filter->parser.base, options);
+
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  size_t length = strlen(input);
+  for (size_t offset = 0; offset < length && status == PJSON_STATUS_DATA_NEEDED; offset += chunk_size) {
+    status = pjson_feed(&tokenizer, (const uint8_t *)input + offset, length - offset < chunk_size ? length - offset : chunk_size);
+  }
+
+  pjson_parsing_status close_status = pjson_close(&tokenizer);
+  return status == PJSON_STATUS_DATA_NEEDED ? close_status : status;
+}
+
+static void check_matches(const char *input, const char *const *paths, size_t path_count, const char *fail_at,
+  const char *skip_at, const char *expected_log, pjson_parsing_status expected_status) {
+  static const size_t chunk_sizes[] = { 1, 3, 1024 };
+  const pjson_tokenizer_options scatter_options = { .scatter_strings = true };
+
+  for (size_t i = 0; i < pjson_countof(chunk_sizes) * 2; i++) {
+    event_log log = { "", 0, fail_at, skip_at };
+    pjson_path_filter filter;
+    TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, paths, path_count, &log_match, NULL));
+    filter.user_data = &log;
+
+    pjson_parsing_status status = parse(&filter, input, chunk_sizes[i / 2], i & 1 ? &scatter_options : NULL);
+    TEST_ASSERT_EQUAL_MESSAGE(expected_status, status, input);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected_log, log.text, input);
+    pjson_path_filter_free(&filter);
+  }
+}
+
+static const char document[] =
+  "{\"meta\": {\"id\": 7, \"tags\": [\"a\", \"b\"]},"
+  " \"items\": [{\"name\": \"x\", \"price\": 1.5}, {\"name\": \"y\", \"price\": 2, \"extra\": {\"price\": 3}}],"
+  " \"price\": 4}";
+
+TEST(path_filter, test_path_filter_pointer) {
+  static const char *const paths[] = { "/meta/id", "/items/1/price", "/meta/tags/0", "/missing", "/items/1/extra" };
+  check_matches(document, paths, pjson_countof(paths),
+    NULL, NULL, "0:7 2:\"a\" 1:2 4:{ 4:} ", PJSON_STATUS_COMPLETED);
+
+  // The empty pointer matches the whole document.
+  static const char *const root_paths[] = { "" };
+  check_matches("[1, {\"a\": 2}]", root_paths, 1, NULL, NULL, "0:[ 0:] ", PJSON_STATUS_COMPLETED);
+  check_matches("5", root_paths, 1, NULL, NULL, "0:5 ", PJSON_STATUS_COMPLETED);
+}
+
+TEST(path_filter, test_path_filter_jsonpath) {
+  static const char *const paths[] = { "$.items[*].price", "$['meta'][\"tags\"][1]", "$.*.id", "$.price" };
+  check_matches(document, paths, pjson_countof(paths),
+    NULL, NULL, "2:7 1:\"b\" 0:1.5 0:2 3:4 ", PJSON_STATUS_COMPLETED);
+
+  static const char *const wildcard_paths[] = { "$[*]", "$.*" };
+  check_matches("[1, [2], {\"a\": 3}]", wildcard_paths, pjson_countof(wildcard_paths),
+    NULL, NULL, "0:1 1:1 0:[ 1:[ 0:] 1:] 0:{ 1:{ 0:} 1:} ", PJSON_STATUS_COMPLETED);
+}
+
+TEST(path_filter, test_path_filter_shared_steps) {
+  // Identical paths and prefixes share nodes, and each path is reported.
+  static const char *const paths[] = { "/a/b", "$.a.b", "$.a", "/a/0", "$.a[0]" };
+  check_matches("{\"a\": {\"b\": 1, \"0\": 2}}", paths, pjson_countof(paths),
+    NULL, NULL, "2:{ 0:1 1:1 3:2 2:} ", PJSON_STATUS_COMPLETED);
+  check_matches("{\"a\": [3, 4], \"b\": 5}", paths, pjson_countof(paths),
+    NULL, NULL, "2:[ 3:3 4:3 2:] ", PJSON_STATUS_COMPLETED);
+}
+
+TEST(path_filter, test_path_filter_escaped_names) {
+  static const char *const paths[] = { "/a~1b", "/c~0d", "$['e\\'f']", "$.A", "$[\"\\\\\"]" };
+  check_matches("{\"a/b\": 1, \"c~d\": 2, \"e'f\": 3, \"\\u0041\": 4, \"\\\\\": 5, \"a\\/b\": 6, \"\\u0042\": 7}",
+    paths, pjson_countof(paths), NULL, NULL, "0:1 1:2 2:3 3:4 4:5 0:6 ", PJSON_STATUS_COMPLETED);
+
+  // Names are compared with the unescaped strings if the tokenizer provides them.
+  event_log log = { "", 0, NULL, NULL };
+  const pjson_tokenizer_options options = { .unescape_strings = true };
+  pjson_path_filter filter;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, paths, pjson_countof(paths), &log_match, NULL));
+  filter.user_data = &log;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, parse(&filter, "{\"\\u0041\": 1, \"\\u0042\": 2, \"c~d\": 3}", 1024, &options));
+  TEST_ASSERT_EQUAL_STRING("3:1 1:3 ", log.text);
+  pjson_path_filter_free(&filter);
+}
+
+TEST(path_filter, test_path_filter_streamed_strings) {
+  static const char input[] = "{\"0123456789abcdefghij\": 1, \"a\": \"klmnopqrstuvwxyz\", \"b\": 2}";
+  static const char *const paths[] = { "/0123456789abcdefghij", "/a", "/b" };
+  static const char *const short_paths[] = { "/a", "/b" };
+
+  // Streamed values are reported without their bytes.
+  counting_chunk_handler handler;
+  counting_chunk_handler_init(&handler, 4);
+  const pjson_tokenizer_options options = { .string_chunk_handler = &handler.base };
+  event_log log = { "", 0, NULL, NULL };
+  pjson_path_filter filter;
+  pjson_tokenizer tokenizer;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, short_paths, pjson_countof(short_paths), &log_match, NULL));
+  filter.user_data = &log;
+  pjson_init_ex(&tokenizer, &filter.parser.base, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, feed_split(&tokenizer, input, 42));
+  TEST_ASSERT_EQUAL(1, handler.string_count);
+  TEST_ASSERT_EQUAL_STRING("0: 1:2 ", log.text);
+  pjson_path_filter_free(&filter);
+
+  // A streamed name longer than the names in the paths matches none of them.
+  counting_chunk_handler_init(&handler, 4);
+  log = (event_log){ "", 0, NULL, NULL };
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, short_paths, pjson_countof(short_paths), &log_match, NULL));
+  filter.user_data = &log;
+  pjson_init_ex(&tokenizer, &filter.parser.base, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, feed_split(&tokenizer, input, 6));
+  TEST_ASSERT_EQUAL(1, handler.string_count);
+  TEST_ASSERT_EQUAL_STRING("0:\"klmnopqrstuvwxyz\" 1:2 ", log.text);
+  pjson_path_filter_free(&filter);
+
+  // Otherwise it can't be compared.
+  counting_chunk_handler_init(&handler, 4);
+  log = (event_log){ "", 0, NULL, NULL };
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, paths, pjson_countof(paths), &log_match, NULL));
+  filter.user_data = &log;
+  pjson_init_ex(&tokenizer, &filter.parser.base, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, feed_split(&tokenizer, input, 6));
+  TEST_ASSERT_EQUAL(1, tokenizer.token_start_index);
+  TEST_ASSERT_EQUAL_STRING("", log.text);
+  pjson_path_filter_free(&filter);
+}
+
+TEST(path_filter, test_path_filter_callback_status) {
+  static const char *const paths[] = { "$.a", "$.a.b", "$.c" };
+  static const char input[] = "{\"a\": {\"b\": 1}, \"c\": 2}";
+
+  check_matches(input, paths, pjson_countof(paths), NULL, NULL, "0:{ 1:1 0:} 2:2 ", PJSON_STATUS_COMPLETED);
+
+  // Skipping a matching container skips the deeper matches too.
+  check_matches(input, paths, pjson_countof(paths), NULL, "{", "0:{ 0:} 2:2 ", PJSON_STATUS_COMPLETED);
+
+  check_matches(input, paths, pjson_countof(paths), "1", NULL, "0:{ 1:1 ", PJSON_STATUS_USER_ERROR);
+}
+
+TEST(path_filter, test_path_filter_skipping) {
+  // Arrays and objects which no path leads into are skipped without validating their content (by default).
+  static const char *const paths[] = { "/a" };
+  static const char input[] = "{\"x\": [1 2 {]], \"a\": true}";
+  check_matches(input, paths, 1, NULL, NULL, "0:true ", PJSON_STATUS_COMPLETED);
+
+  event_log log = { "", 0, NULL, NULL };
+  pjson_path_filter_options options = { .validate_skipped_values = true };
+  pjson_path_filter filter;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, paths, 1, &log_match, &options));
+  filter.user_data = &log;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, parse(&filter, input, 1024, NULL));
+  TEST_ASSERT_EQUAL_STRING("", log.text);
+  pjson_path_filter_free(&filter);
+
+  // Errors outside of the skipped values are always reported.
+  check_matches("{\"x\": [1], \"a\": 2", paths, 1, NULL, NULL, "0:2 ", PJSON_STATUS_SYNTAX_ERROR);
+  check_matches("{\"x\": [1]]", paths, 1, NULL, NULL, "", PJSON_STATUS_SYNTAX_ERROR);
+}
+
+TEST(path_filter, test_path_filter_lazy) {
+  static const char *const paths[] = { "/id" };
+  static const char *const inputs[] = { "{\"id\": 1, \"x\": [2]}", "{\"y\": {}, \"id\": 3}" };
+
+  event_log log = { "", 0, NULL, NULL };
+  pjson_path_filter filter;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, true, paths, 1, &log_match, NULL));
+  filter.user_data = &log;
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &filter.parser.base);
+  for (size_t i = 0; i < pjson_countof(inputs); i++) {
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_parse_buffer(&tokenizer, (const uint8_t *)inputs[i], strlen(inputs[i])));
+    pjson_path_filter_rewind(&filter, true);
+  }
+  pjson_close(&tokenizer);
+  TEST_ASSERT_EQUAL_STRING("0:1 0:3 ", log.text);
+
+  pjson_path_filter_free(&filter);
+}
+
+TEST(path_filter, test_path_filter_invalid_paths) {
+  static const char *const invalid_paths[] = {
+    "a", "$a", "$.", "$..a", "$.a.", "$[", "$[1", "$[a]", "$['a", "$['a'", "$['a\\", "$[-1]", "$[*", "/~", "/a~2",
+    "$[99999999999999999999999]",
+  };
+
+  for (size_t i = 0; i < pjson_countof(invalid_paths); i++) {
+    pjson_path_filter filter;
+    TEST_ASSERT_EQUAL_MESSAGE(PJSON_STATUS_SYNTAX_ERROR,
+      pjson_path_filter_init(&filter, false, &invalid_paths[i], 1, &log_match, NULL), invalid_paths[i]);
+  }
+
+  // The root and 63 distinct steps fit, and shared steps don't count.
+  char path[PJSON_PATH_FILTER_MAX_NODES * 2 + 1];
+  for (size_t i = 0; i < PJSON_PATH_FILTER_MAX_NODES; i++) memcpy(path + i * 2, "/a", 2);
+  path[(PJSON_PATH_FILTER_MAX_NODES - 1) * 2] = 0;
+  const char *paths[] = { path, "/a/a", "$.a" };
+
+  pjson_path_filter filter;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, paths, pjson_countof(paths), &log_match, NULL));
+  pjson_path_filter_free(&filter);
+
+  path[(PJSON_PATH_FILTER_MAX_NODES - 1) * 2] = '/';
+  path[PJSON_PATH_FILTER_MAX_NODES * 2] = 0;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_LIMIT_EXCEEDED, pjson_path_filter_init(&filter, false, paths, pjson_countof(paths), &log_match, NULL));
+
+  paths[0] = "/b";
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SUCCESS, pjson_path_filter_init(&filter, false, paths, pjson_countof(paths), &log_match, NULL));
+  pjson_path_filter_free(&filter);
+}
+
+TEST_GROUP_RUNNER(path_filter) {
+  RUN_TEST_CASE(path_filter, test_path_filter_pointer);
+  RUN_TEST_CASE(path_filter, test_path_filter_jsonpath);
+  RUN_TEST_CASE(path_filter, test_path_filter_shared_steps);
+  RUN_TEST_CASE(path_filter, test_path_filter_escaped_names);
+  RUN_TEST_CASE(path_filter, test_path_filter_streamed_strings);
+  RUN_TEST_CASE(path_filter, test_path_filter_callback_status);
+  RUN_TEST_CASE(path_filter, test_path_filter_skipping);
+  RUN_TEST_CASE(path_filter, test_path_filter_lazy);
+  RUN_TEST_CASE(path_filter, test_path_filter_invalid_paths);
+}
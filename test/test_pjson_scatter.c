@@ -0,0 +1,161 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "test_data.h"
+#include "checking_parser.h"
+
+TEST_GROUP(scatter);
+
+TEST_SETUP(scatter) {}
+
+TEST_TEAR_DOWN(scatter) {}
+
+typedef struct {
+  checking_parser base; // base struct MUST be the first member!
+  const uint8_t *input; // the whole input, for checking the tokens
+  size_t segmented_token_count;
+  size_t max_segment_count;
+} segment_checker;
+
+/**
+ * Check that the (possibly segmented) token data equals the corresponding part of the input.
+ */
+static void check_segmented_token(checking_parser *base, const pjson_token *token) {
+  segment_checker *parser = (segment_checker *)base;
+  if (token->type == PJSON_TOKEN_EOS) return;
+
+  if (!token->segments) {
+    TEST_ASSERT_EQUAL(0, token->segment_count);
+    TEST_ASSERT_EQUAL_MEMORY(parser->input + token->start_index, token->start, token->length);
+    return;
+  }
+
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, token->type);
+  TEST_ASSERT_TRUE(token->segment_count > 1);
+  TEST_ASSERT_EQUAL_PTR(token->segments[0].start, token->start);
+  parser->segmented_token_count++;
+  if (token->segment_count > parser->max_segment_count) parser->max_segment_count = token->segment_count;
+
+  size_t offset = token->start_index;
+  for (size_t i = 0; i < token->segment_count; i++) {
+    TEST_ASSERT_EQUAL_MEMORY(parser->input + offset, token->segments[i].start, token->segments[i].length);
+    offset += token->segments[i].length;
+  }
+  TEST_ASSERT_EQUAL(token->length, offset - token->start_index);
+}
+
+static void segment_checker_init(segment_checker *parser, const uint8_t *input) {
+  checking_parser_init(&parser->base, sizeof(*parser), &check_segmented_token);
+  parser->input = input;
+}
+
+/**
+ * Feed a copy of `data` in chunks of `chunk_size` bytes. Each chunk is a separate allocation, which stays valid
+ * until the tokenizer is closed, as required by the `scatter_strings` option.
+ */
+static pjson_parsing_status feed_in_pinned_chunks(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length, size_t chunk_size,
+  pjson_parsing_status(*feed)(pjson_tokenizer *tokenizer, const uint8_t *data, size_t length), uint8_t ***chunks) {
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  size_t chunk_count = (length + chunk_size - 1) / chunk_size;
+  *chunks = (uint8_t **)calloc(chunk_count + 1, sizeof(uint8_t *));
+  TEST_ASSERT_NOT_NULL(*chunks);
+
+  for (size_t i = 0, offset = 0; offset < length; i++, offset += chunk_size) {
+    size_t chunk_length = length - offset < chunk_size ? length - offset : chunk_size;
+    uint8_t *chunk = (*chunks)[i] = (uint8_t *)malloc(chunk_length);
+    TEST_ASSERT_NOT_NULL(chunk);
+    memcpy(chunk, data + offset, chunk_length);
+
+    status = feed(tokenizer, chunk, chunk_length);
+    if (status != PJSON_STATUS_DATA_NEEDED) break;
+  }
+
+  return status;
+}
+
+static void free_chunks(uint8_t **chunks) {
+  for (uint8_t **chunk = chunks; *chunk; chunk++) {
+    free(*chunk);
+  }
+  free(chunks);
+}
+
+static const pjson_tokenizer_options scatter_options = { .scatter_strings = true };
+
+TEST(scatter, test_scatter_formatted_1mb) {
+  size_t length;
+  uint8_t *data = load_file("test/data/formatted_1mb.json", &length);
+
+  static const size_t chunk_sizes[] = { 1, 7, 4096 };
+  for (size_t i = 0; i < pjson_countof(chunk_sizes); i++) {
+    segment_checker parser;
+    segment_checker_init(&parser, data);
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base.base, &scatter_options);
+
+    uint8_t **chunks;
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_pinned_chunks(&tokenizer, data, length, chunk_sizes[i], &pjson_feed, &chunks));
+    // Only keywords and numbers may be copied into the internal buffer, which are short enough to fit into its fixed size part.
+#if !defined(PJSON_COMPACT_TOKENIZER)
+    TEST_ASSERT_EQUAL_PTR(pjson_fixed_size_buf(&tokenizer), tokenizer.buf);
+#else
+    TEST_ASSERT_TRUE(tokenizer.buf_capacity <= 64);
+#endif
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+    free_chunks(chunks);
+
+    TEST_ASSERT_TRUE(parser.segmented_token_count > 0);
+    if (chunk_sizes[i] == 1) TEST_ASSERT_EQUAL(19375 + 21700, parser.segmented_token_count);
+  }
+
+  free(data);
+}
+
+TEST(scatter, test_scatter_batch) {
+  static const char input[] = "[\"abcdefgh\", 1, \"ij\", \"klmnopqrstuvwxyz\", true]";
+
+  pjson_token tokens[8];
+  segment_checker parser;
+  segment_checker_init(&parser, (const uint8_t *)input);
+  checking_sink sink;
+  checking_sink_init(&sink, tokens, pjson_countof(tokens), &parser.base);
+  pjson_tokenizer tokenizer;
+  pjson_init_batch_ex(&tokenizer, &sink.base, &scatter_options);
+
+  uint8_t **chunks;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_pinned_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, 5, &pjson_feed_batch, &chunks));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  free_chunks(chunks);
+
+  TEST_ASSERT_EQUAL(12, parser.base.token_count);
+  TEST_ASSERT_EQUAL(2, parser.segmented_token_count);
+  TEST_ASSERT_EQUAL(4, parser.max_segment_count);
+}
+
+TEST(scatter, test_scatter_ignored_when_unescaping) {
+  static const char input[] = "[\"abc\\u00e9defgh\"]";
+
+  segment_checker parser;
+  segment_checker_init(&parser, (const uint8_t *)input);
+  pjson_tokenizer_options options = { .unescape_strings = true, .scatter_strings = true };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+
+  uint8_t **chunks;
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_pinned_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, 3, &pjson_feed, &chunks));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  free_chunks(chunks);
+
+  TEST_ASSERT_EQUAL(4, parser.base.token_count);
+  TEST_ASSERT_EQUAL(0, parser.segmented_token_count);
+}
+
+TEST_GROUP_RUNNER(scatter) {
+  RUN_TEST_CASE(scatter, test_scatter_formatted_1mb);
+  RUN_TEST_CASE(scatter, test_scatter_batch);
+  RUN_TEST_CASE(scatter, test_scatter_ignored_when_unescaping);
+}
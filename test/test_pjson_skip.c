@@ -0,0 +1,258 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "pjson_parser_template.h"
+
+TEST_GROUP(skip);
+
+TEST_SETUP(skip) {}
+
+TEST_TEAR_DOWN(skip) {}
+
+// The test parsers skip the arrays and objects which are the values of properties whose name starts with "skip",
+// and record the callbacks they see.
+
+typedef struct {
+  char text[1024];
+  size_t length;
+} event_log;
+
+static void event_log_append(event_log *log, char kind, const pjson_token *token) {
+  int n = snprintf(log->text + log->length, sizeof(log->text) - log->length, "%c:%.*s ",
+    kind, (int)token->length, token->start ? (const char *)token->start : "");
+  TEST_ASSERT_TRUE(n > 0 && (size_t)n < sizeof(log->text) - log->length);
+  log->length += (size_t)n;
+}
+
+static bool is_skipped_name(const pjson_token *token) {
+  return token->length >= 5 && !memcmp(token->start, "\"skip", 5);
+}
+
+/* Generic parser */
+
+typedef struct {
+  pjson_parser_context base; // base struct MUST be the first member!
+  bool skip_value;
+} skipping_context;
+
+typedef struct {
+  pjson_parser base; // base struct MUST be the first member!
+  event_log log;
+} skipping_parser;
+
+static pjson_parsing_status skipping_parser_on_name(skipping_parser *parser, skipping_context *context, const pjson_token *token) {
+  event_log_append(&parser->log, 'n', token);
+  context->skip_value = is_skipped_name(token);
+  return PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status skipping_parser_on_value(skipping_parser *parser, skipping_context *context, const pjson_token *token) {
+  event_log_append(&parser->log, 'v', token);
+  if (context->skip_value) return PJSON_STATUS_SKIP; // a no-op for primitive values and closing tokens
+
+  if (token->type == PJSON_TOKEN_OPEN_BRACKET || token->type == PJSON_TOKEN_OPEN_BRACE) {
+    skipping_context *child_context = (skipping_context *)parser->base.context;
+    child_context->base.on_value = (pjson_parser_context_callback)&skipping_parser_on_value;
+    child_context->base.on_object_property_name = (pjson_parser_context_callback)&skipping_parser_on_name;
+  }
+  return PJSON_STATUS_SUCCESS;
+}
+
+static void skipping_parser_init(skipping_parser *parser, bool is_lazy, bool validate_skipped_values) {
+  pjson_parser_options options = {
+    .context_size = sizeof(skipping_context),
+    .validate_skipped_values = validate_skipped_values,
+  };
+  pjson_parser_init_ex(&parser->base, is_lazy, &options);
+  parser->base.context->on_value = (pjson_parser_context_callback)&skipping_parser_on_value;
+  parser->base.context->on_object_property_name = (pjson_parser_context_callback)&skipping_parser_on_name;
+  parser->log.length = 0;
+  parser->log.text[0] = '\0';
+}
+
+/* Specialized parser */
+
+typedef struct {
+  bool skip_value;
+} specialized_context;
+
+typedef struct specialized_skipping_parser specialized_skipping_parser;
+
+static pjson_parsing_status specialized_on_value(specialized_skipping_parser *parser, specialized_context *context, const pjson_token *token);
+static pjson_parsing_status specialized_on_name(specialized_skipping_parser *parser, specialized_context *context, const pjson_token *token);
+
+PJSON_DEFINE_PARSER(specialized_skipping_parser, specialized_context, 8, specialized_on_value, specialized_on_name)
+
+static pjson_parsing_status specialized_on_value(specialized_skipping_parser *parser, specialized_context *context, const pjson_token *token) {
+  event_log_append((event_log *)parser->user_data, 'v', token);
+  return context->skip_value ? PJSON_STATUS_SKIP : PJSON_STATUS_SUCCESS;
+}
+
+static pjson_parsing_status specialized_on_name(specialized_skipping_parser *parser, specialized_context *context, const pjson_token *token) {
+  event_log_append((event_log *)parser->user_data, 'n', token);
+  context->skip_value = is_skipped_name(token);
+  return PJSON_STATUS_SUCCESS;
+}
+
+/* Helpers */
+
+/**
+ * Feed `input` in chunks of `chunk_size` bytes (or at once using pjson_parse_buffer if `chunk_size` is 0).
+ */
+static pjson_parsing_status parse(pjson_parser_base *parser, const char *input, size_t chunk_size) {
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, parser);
+
+  pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+  size_t length = strlen(input);
+  if (!chunk_size) {
+    status = pjson_parse_buffer(&tokenizer, (const uint8_t *)input, length);
+    pjson_close(&tokenizer);
+    return status;
+  }
+
+  for (size_t offset = 0; offset < length && status == PJSON_STATUS_DATA_NEEDED; offset += chunk_size) {
+    status = pjson_feed(&tokenizer, (const uint8_t *)input + offset, length - offset < chunk_size ? length - offset : chunk_size);
+  }
+
+  pjson_parsing_status close_status = pjson_close(&tokenizer);
+  return status == PJSON_STATUS_DATA_NEEDED ? close_status : status;
+}
+
+static const size_t CHUNK_SIZES[] = { 0, 1, 2, 3, 7, 16, 1024 };
+
+static void check_skip(const char *input, pjson_parsing_status expected_status, const char *expected_log, bool validate_skipped_values) {
+  for (size_t i = 0; i < pjson_countof(CHUNK_SIZES); i++) {
+    skipping_parser parser;
+    skipping_parser_init(&parser, false, validate_skipped_values);
+    pjson_parsing_status status = parse(&parser.base.base, input, CHUNK_SIZES[i]);
+    pjson_parser_free(&parser.base);
+
+    TEST_ASSERT_EQUAL_MESSAGE(expected_status, status, input);
+    if (expected_log) TEST_ASSERT_EQUAL_STRING_MESSAGE(expected_log, parser.log.text, input);
+  }
+}
+
+TEST(skip, test_skip_callbacks) {
+  static const struct {
+    const char *input;
+    const char *log;
+  } cases[] = {
+    { "{\"skip\": [1, 2, {\"a\": 3}], \"b\": 4}", "v:{ n:\"skip\" v:[ v:] n:\"b\" v:4 v:} " },
+    { "{\"skip\": {\"a\": [3]}, \"b\": [5]}", "v:{ n:\"skip\" v:{ v:} n:\"b\" v:[ v:5 v:] v:} " },
+    { "{\"skip\": [], \"skip2\": {}}", "v:{ n:\"skip\" v:[ v:] n:\"skip2\" v:{ v:} v:} " },
+    { "{\"skip\": 1, \"b\": [{\"skip\": [[[]]], \"c\": true}]}",
+      "v:{ n:\"skip\" v:1 n:\"b\" v:[ v:{ n:\"skip\" v:[ v:] n:\"c\" v:true v:} v:] v:} " },
+    // Brackets, braces and escaped quotation marks in skipped strings
+    { "{\"skip\": [\"]\", \"}\\\"]\", {\"[\": \"\\\\\"}, \"\\\\\\\"{\"], \"b\": \"]\"}",
+      "v:{ n:\"skip\" v:[ v:] n:\"b\" v:\"]\" v:} " },
+    // Long content taking the vectorized paths
+    { "{\"skip\": [\"a string which is long enough for the vectorized kernels\", [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12],"
+      " {\"a somewhat long name\": \"and a somewhat long \\\"value\\\" with [brackets] and {braces}\"}], \"b\": 0}",
+      "v:{ n:\"skip\" v:[ v:] n:\"b\" v:0 v:} " },
+  };
+
+  for (size_t i = 0; i < pjson_countof(cases); i++) {
+    check_skip(cases[i].input, PJSON_STATUS_COMPLETED, cases[i].log, false);
+    check_skip(cases[i].input, PJSON_STATUS_COMPLETED, cases[i].log, true);
+  }
+}
+
+TEST(skip, test_skip_validation) {
+  // The fast mode only looks for the matching closing bracket or brace.
+  static const char *invalid_content[] = {
+    "{\"skip\": [1 2, tru, \"\\x\", {:}], \"b\": 4}",
+    "{\"skip\": [{\"a\" \"b\"}], \"b\": 4}",
+    "{\"skip\": [\"\x01\"], \"b\": 4}",
+  };
+  for (size_t i = 0; i < pjson_countof(invalid_content); i++) {
+    check_skip(invalid_content[i], PJSON_STATUS_COMPLETED, "v:{ n:\"skip\" v:[ v:] n:\"b\" v:4 v:} ", false);
+    check_skip(invalid_content[i], PJSON_STATUS_SYNTAX_ERROR, NULL, true);
+  }
+
+  // The closing token must match the opening one anyway.
+  check_skip("{\"skip\": [1, 2}, \"b\": 4}", PJSON_STATUS_SYNTAX_ERROR, NULL, false);
+  check_skip("{\"skip\": {\"a\": 1], \"b\": 4}", PJSON_STATUS_SYNTAX_ERROR, NULL, false);
+
+  // Unterminated arrays, objects and strings
+  static const char *unterminated[] = {
+    "{\"skip\": [", "{\"skip\": [1, [2]", "{\"skip\": [\"]", "{\"skip\": [\"\\", "{\"skip\": [\"\\\"]\"",
+  };
+  for (size_t i = 0; i < pjson_countof(unterminated); i++) {
+    check_skip(unterminated[i], PJSON_STATUS_SYNTAX_ERROR, NULL, false);
+    check_skip(unterminated[i], PJSON_STATUS_SYNTAX_ERROR, NULL, true);
+  }
+}
+
+TEST(skip, test_skip_lazy) {
+  // Skipping a top-level value completes parsing at its end.
+  static const char input[] = "[1, [\"]\"], {}] {\"a\": 1}";
+  const size_t first_value_length = strstr(input, "] {") - input + 1;
+
+  for (size_t i = 0; i < pjson_countof(CHUNK_SIZES); i++) {
+    skipping_parser parser;
+    skipping_parser_init(&parser, true, false);
+    ((skipping_context *)parser.base.context)->skip_value = true;
+
+    pjson_tokenizer tokenizer;
+    pjson_init(&tokenizer, &parser.base.base);
+    pjson_parsing_status status = PJSON_STATUS_DATA_NEEDED;
+    size_t offset = 0, length = CHUNK_SIZES[i] ? CHUNK_SIZES[i] : sizeof(input) - 1;
+    for (; offset < sizeof(input) - 1 && status == PJSON_STATUS_DATA_NEEDED; offset += length) {
+      if (offset + length > sizeof(input) - 1) length = sizeof(input) - 1 - offset;
+      status = !CHUNK_SIZES[i]
+        ? pjson_index(&tokenizer, (const uint8_t *)input + offset, length)
+        : pjson_feed(&tokenizer, (const uint8_t *)input + offset, length);
+    }
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, status);
+    TEST_ASSERT_EQUAL(first_value_length, tokenizer.token_start_index);
+    TEST_ASSERT_EQUAL_STRING("v:[ v:] ", parser.log.text);
+    pjson_close(&tokenizer);
+    pjson_parser_free(&parser.base);
+  }
+}
+
+TEST(skip, test_skip_specialized_parser) {
+  static const char input[] = "{\"a\": [1], \"skip\": [1, {\"b\": \"]}\"}], \"c\": {\"skip\": {}, \"d\": null}}";
+  static const char expected_log[] =
+    "v:{ n:\"a\" v:[ v:1 v:] n:\"skip\" v:[ v:] n:\"c\" v:{ n:\"skip\" v:{ v:} n:\"d\" v:null v:} v:} ";
+
+  for (size_t i = 0; i < pjson_countof(CHUNK_SIZES); i++) {
+    event_log log = { "", 0 };
+    specialized_skipping_parser parser;
+    specialized_skipping_parser_init(&parser, false);
+    parser.user_data = &log;
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, parse(&parser.base, input, CHUNK_SIZES[i]));
+    TEST_ASSERT_EQUAL_STRING(expected_log, log.text);
+    TEST_ASSERT_EQUAL(0, parser.depth);
+  }
+}
+
+TEST(skip, test_skip_depth_limit) {
+  // The content of skipped arrays and objects doesn't count towards the depth limit of the tokenizer.
+  static const char input[] = "{\"skip\": [[[[[[[[1]]]]]]]], \"b\": [[2]]}";
+  pjson_tokenizer_options tokenizer_options = { .max_depth = 3 };
+
+  for (size_t validate = 0; validate <= 1; validate++) {
+    skipping_parser parser;
+    skipping_parser_init(&parser, false, validate);
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base.base, &tokenizer_options);
+    pjson_parsing_status status = pjson_parse_buffer(&tokenizer, (const uint8_t *)input, sizeof(input) - 1);
+    TEST_ASSERT_EQUAL(validate ? PJSON_STATUS_MAX_DEPTH_EXCEEDED : PJSON_STATUS_COMPLETED, status);
+    pjson_close(&tokenizer);
+    pjson_parser_free(&parser.base);
+  }
+}
+
+TEST_GROUP_RUNNER(skip) {
+  RUN_TEST_CASE(skip, test_skip_callbacks);
+  RUN_TEST_CASE(skip, test_skip_validation);
+  RUN_TEST_CASE(skip, test_skip_lazy);
+  RUN_TEST_CASE(skip, test_skip_specialized_parser);
+  RUN_TEST_CASE(skip, test_skip_depth_limit);
+}
@@ -0,0 +1,221 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "checking_parser.h"
+#include "test_input.h"
+
+TEST_GROUP(string_chunks);
+
+TEST_SETUP(string_chunks) {}
+
+TEST_TEAR_DOWN(string_chunks) {}
+
+typedef struct {
+  pjson_string_chunk_handler base;
+  uint8_t *payload; // payload of the string being streamed, assembled from the fragments
+  size_t payload_length;
+  size_t payload_capacity;
+  size_t start_index;
+  size_t fragment_count;
+  size_t streamed_count;
+  size_t token_count_at_first_fragment; // number of tokens received by the sink when the first fragment arrived
+  size_t fail_after; // number of fragments after which PJSON_STATUS_USER_ERROR is returned (0 means never)
+  size_t *token_count; // token counter of the consumer, for checking the order of delivery
+} collecting_handler;
+
+static pjson_parsing_status collecting_handler_on_chunk(pjson_string_chunk_handler *handler, size_t start_index, const uint8_t *chunk, size_t length) {
+  collecting_handler *collector = (collecting_handler *)handler;
+  TEST_ASSERT_TRUE(length > 0);
+
+  if (collector->payload_length == 0) {
+    collector->start_index = start_index;
+    if (collector->streamed_count == 0 && collector->fragment_count == 0) collector->token_count_at_first_fragment = *collector->token_count;
+  }
+  else {
+    TEST_ASSERT_EQUAL(collector->start_index, start_index);
+  }
+
+  if (collector->payload_length + length > collector->payload_capacity) {
+    collector->payload_capacity = (collector->payload_length + length) * 2;
+    collector->payload = (uint8_t *)realloc(collector->payload, collector->payload_capacity);
+    TEST_ASSERT_NOT_NULL(collector->payload);
+  }
+  memcpy(collector->payload + collector->payload_length, chunk, length);
+  collector->payload_length += length;
+
+  if (++collector->fragment_count == collector->fail_after) return PJSON_STATUS_USER_ERROR;
+  return PJSON_STATUS_DATA_NEEDED;
+}
+
+typedef struct {
+  checking_parser base; // base struct MUST be the first member!
+  const uint8_t *input; // the whole input, for checking the tokens
+  bool unescape_strings;
+  collecting_handler *handler;
+} stream_checker;
+
+/**
+ * Check that a streamed string was assembled correctly by the handler or that a regular token equals the input.
+ */
+static void check_streamed_token(checking_parser *base, const pjson_token *token) {
+  stream_checker *parser = (stream_checker *)base;
+  if (token->type == PJSON_TOKEN_EOS) return;
+
+  if (token->start) {
+    TEST_ASSERT_EQUAL_MEMORY(parser->input + token->start_index, token->start, token->length);
+    return;
+  }
+
+  collecting_handler *handler = parser->handler;
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, token->type);
+  TEST_ASSERT_EQUAL(handler->start_index, token->start_index);
+  handler->streamed_count++;
+
+  if (parser->unescape_strings) {
+    uint8_t *expected = (uint8_t *)malloc(token->unescaped_length + 1);
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_TRUE(pjson_parse_string(expected, token->unescaped_length, parser->input + token->start_index, token->length, true));
+    TEST_ASSERT_EQUAL(token->unescaped_length, handler->payload_length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, handler->payload, handler->payload_length);
+    free(expected);
+  }
+  else {
+    TEST_ASSERT_EQUAL(token->length - 2, handler->payload_length);
+    TEST_ASSERT_EQUAL_MEMORY(parser->input + token->start_index + 1, handler->payload, handler->payload_length);
+  }
+  handler->payload_length = 0;
+}
+
+static void collecting_handler_init(collecting_handler *handler, size_t threshold, size_t *token_count) {
+  memset(handler, 0, sizeof(*handler));
+  handler->base.on_chunk = &collecting_handler_on_chunk;
+  handler->base.threshold = threshold;
+  handler->token_count = token_count;
+}
+
+static void stream_checker_init(stream_checker *parser, const char *input, bool unescape_strings, collecting_handler *handler) {
+  checking_parser_init(&parser->base, sizeof(*parser), &check_streamed_token);
+  parser->input = (const uint8_t *)input;
+  parser->unescape_strings = unescape_strings;
+  parser->handler = handler;
+}
+
+static const char escaped_input[] = "{\"short\": \"abc\", \"a property name which is longer than the threshold\": "
+  "[\"\\\"quoted\\\" \\\\ \\/ \\b\\f\\n\\r\\t \\u00e9\\u20AC \\uD83D\\uDE00 \\uD800x\\uDC00 \\uDBFF\\uD800 \xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\", "
+  "\"\\uD83D\\uDE00\\uD83D\\uDE00\\uD83D\\uDE00\\uD83D\\uDE00\\uD83D\\uDE00\\uD800\", 1]}";
+
+TEST(string_chunks, test_string_chunks_raw) {
+  for (size_t chunk_size = 1; chunk_size <= 16; chunk_size++) {
+    collecting_handler handler;
+    stream_checker parser;
+    collecting_handler_init(&handler, 16, &parser.base.token_count);
+    stream_checker_init(&parser, escaped_input, false, &handler);
+    pjson_tokenizer_options options = { .string_chunk_handler = &handler.base };
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base.base, &options);
+
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)escaped_input, sizeof(escaped_input) - 1, chunk_size, &pjson_feed));
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+    TEST_ASSERT_EQUAL(16, parser.base.token_count);
+    TEST_ASSERT_EQUAL(3, handler.streamed_count);
+    free(handler.payload);
+  }
+}
+
+TEST(string_chunks, test_string_chunks_unescaped) {
+  // Escape sequences (including surrogate pairs) are split at every possible position.
+  for (size_t chunk_size = 1; chunk_size <= 16; chunk_size++) {
+    collecting_handler handler;
+    stream_checker parser;
+    collecting_handler_init(&handler, 0, &parser.base.token_count);
+    stream_checker_init(&parser, escaped_input, true, &handler);
+    pjson_tokenizer_options options = { .unescape_strings = true, .string_chunk_handler = &handler.base };
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base.base, &options);
+
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)escaped_input, sizeof(escaped_input) - 1, chunk_size, &pjson_feed));
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+    TEST_ASSERT_EQUAL(16, parser.base.token_count);
+    TEST_ASSERT_TRUE(handler.streamed_count >= 3);
+    free(handler.payload);
+  }
+}
+
+TEST(string_chunks, test_string_chunks_memory_is_bounded) {
+  const size_t string_length = 1024 * 1024 - 1; // the last character must not be a backslash
+  char *input = (char *)malloc(string_length + 8);
+  TEST_ASSERT_NOT_NULL(input);
+  input[0] = '[', input[1] = '"';
+  for (size_t i = 0; i < string_length; i++) {
+    input[2 + i] = i % 64 == 63 ? '\\' : i % 64 == 0 && i ? 'n' : (char)('a' + i % 26);
+  }
+  memcpy(input + 2 + string_length, "\"]", 3);
+
+  collecting_handler handler;
+  stream_checker parser;
+  collecting_handler_init(&handler, 0, &parser.base.token_count);
+  stream_checker_init(&parser, input, true, &handler);
+  pjson_tokenizer_options options = { .unescape_strings = true, .string_chunk_handler = &handler.base };
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)input, strlen(input), 64, &pjson_feed));
+  TEST_ASSERT_EQUAL_PTR(pjson_fixed_size_buf(&tokenizer), tokenizer.buf);
+  TEST_ASSERT_TRUE(tokenizer.unescape_buf_capacity <= 128);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+  TEST_ASSERT_EQUAL(1, handler.streamed_count);
+  TEST_ASSERT_TRUE(handler.fragment_count > string_length / 64);
+  free(handler.payload);
+  free(input);
+}
+
+TEST(string_chunks, test_string_chunks_batch_and_errors) {
+  static const char input[] = "[1, 2, \"a string which is longer than the threshold\", 3]";
+
+  // Tokens preceding a streamed string are delivered before its first fragment.
+  pjson_token tokens[16];
+  collecting_handler handler;
+  stream_checker sink_parser;
+  collecting_handler_init(&handler, 8, &sink_parser.base.token_count);
+  stream_checker_init(&sink_parser, input, false, &handler);
+  checking_sink sink;
+  checking_sink_init(&sink, tokens, pjson_countof(tokens), &sink_parser.base);
+  pjson_tokenizer_options options = { .string_chunk_handler = &handler.base };
+  pjson_tokenizer tokenizer;
+  pjson_init_batch_ex(&tokenizer, &sink.base, &options);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, 20, &pjson_feed_batch));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(5, handler.token_count_at_first_fragment);
+  TEST_ASSERT_EQUAL(1, handler.streamed_count);
+  TEST_ASSERT_EQUAL(10, sink_parser.base.token_count);
+  free(handler.payload);
+
+  // Errors returned by the handler are reported for the string token.
+  stream_checker parser;
+  collecting_handler_init(&handler, 8, &parser.base.token_count);
+  handler.fail_after = 2;
+  stream_checker_init(&parser, input, false, &handler);
+  pjson_init_ex(&tokenizer, &parser.base.base, &options);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, feed_in_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, 10, &pjson_feed));
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, tokenizer.token_type);
+  TEST_ASSERT_EQUAL(7, tokenizer.token_start_index);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_USER_ERROR, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(0, handler.streamed_count);
+  free(handler.payload);
+}
+
+TEST_GROUP_RUNNER(string_chunks) {
+  RUN_TEST_CASE(string_chunks, test_string_chunks_raw);
+  RUN_TEST_CASE(string_chunks, test_string_chunks_unescaped);
+  RUN_TEST_CASE(string_chunks, test_string_chunks_memory_is_bounded);
+  RUN_TEST_CASE(string_chunks, test_string_chunks_batch_and_errors);
+}
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "test_data.h"
+#include "chunk_handlers.h"
+
+TEST_GROUP(tape);
+
+TEST_SETUP(tape) {}
+
+TEST_TEAR_DOWN(tape) {}
+
+static pjson_parsing_status tape_string(pjson_tape *tape, const char *input, size_t *error_index) {
+  pjson_tokenizer tokenizer;
+  pjson_init_tape(&tokenizer, tape, NULL, 0);
+  pjson_feed(&tokenizer, (const uint8_t *)input, strlen(input));
+  pjson_parsing_status status = pjson_close(&tokenizer);
+  if (error_index) *error_index = tokenizer.token_start_index;
+  return status;
+}
+
+static void assert_entry(const pjson_tape *tape, const char *input, size_t index, pjson_token_type type, const char *text, size_t match_index) {
+  TEST_ASSERT_TRUE(index < tape->entry_count);
+  const pjson_tape_entry *entry = &tape->entries[index];
+  TEST_ASSERT_EQUAL(type, entry->type);
+  TEST_ASSERT_EQUAL(strlen(text), entry->length);
+  TEST_ASSERT_EQUAL_MEMORY(text, pjson_tape_entry_data(tape, entry, (const uint8_t *)input), entry->length);
+  TEST_ASSERT_EQUAL(match_index, entry->match_index);
+}
+
+TEST(tape, test_tape_small_document) {
+  static const char input[] = "{\"a\": [1, {}, []], \"b\\n\": \"x\", \"c\": [true, [null]]}";
+
+  // Feed the input byte by byte so that every token except punctuators is copied into the string area.
+  pjson_tape_entry entries[4];
+  pjson_tape tape;
+  pjson_tokenizer tokenizer;
+  pjson_init_tape(&tokenizer, &tape, entries, pjson_countof(entries));
+  for (size_t i = 0; i < sizeof(input) - 1; i++) {
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_feed(&tokenizer, (const uint8_t *)input + i, 1));
+  }
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+  TEST_ASSERT_EQUAL(19, tape.entry_count);
+  TEST_ASSERT_TRUE(tape.entries != entries);
+  assert_entry(&tape, input, 0, PJSON_TOKEN_OPEN_BRACE, "{", 18);
+  assert_entry(&tape, input, 1, PJSON_TOKEN_STRING, "\"a\"", PJSON_TAPE_NO_INDEX);
+  assert_entry(&tape, input, 2, PJSON_TOKEN_OPEN_BRACKET, "[", 8);
+  assert_entry(&tape, input, 3, PJSON_TOKEN_NUMBER, "1", PJSON_TAPE_NO_INDEX);
+  assert_entry(&tape, input, 4, PJSON_TOKEN_OPEN_BRACE, "{", 5);
+  assert_entry(&tape, input, 5, PJSON_TOKEN_CLOSE_BRACE, "}", 4);
+  assert_entry(&tape, input, 6, PJSON_TOKEN_OPEN_BRACKET, "[", 7);
+  assert_entry(&tape, input, 8, PJSON_TOKEN_CLOSE_BRACKET, "]", 2);
+  assert_entry(&tape, input, 9, PJSON_TOKEN_STRING, "\"b\\n\"", PJSON_TAPE_NO_INDEX);
+  TEST_ASSERT_EQUAL(2, tape.entries[9].unescaped_length);
+  TEST_ASSERT_NOT_EQUAL(PJSON_TAPE_NO_INDEX, tape.entries[9].string_offset);
+  assert_entry(&tape, input, 10, PJSON_TOKEN_STRING, "\"x\"", PJSON_TAPE_NO_INDEX);
+  assert_entry(&tape, input, 12, PJSON_TOKEN_OPEN_BRACKET, "[", 17);
+  assert_entry(&tape, input, 13, PJSON_TOKEN_TRUE, "true", PJSON_TAPE_NO_INDEX);
+  assert_entry(&tape, input, 14, PJSON_TOKEN_OPEN_BRACKET, "[", 16);
+  assert_entry(&tape, input, 15, PJSON_TOKEN_NULL, "null", PJSON_TAPE_NO_INDEX);
+  assert_entry(&tape, input, 18, PJSON_TOKEN_CLOSE_BRACE, "}", 0);
+
+  // Skipping the value of "a" lands on the next property name.
+  TEST_ASSERT_EQUAL(9, tape.entries[2].match_index + 1);
+
+  pjson_tape_free(&tape);
+}
+
+TEST(tape, test_tape_minified_1mb) {
+  size_t length;
+  uint8_t *data = load_file("test/data/minified_1mb.json", &length);
+
+  pjson_tape whole_tape;
+  pjson_tokenizer tokenizer;
+  pjson_init_tape(&tokenizer, &whole_tape, NULL, 0);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_index(&tokenizer, data, length));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(0, whole_tape.strings_length);
+
+  size_t counts[PJSON_TOKEN_EOS] = { 0 };
+  for (size_t i = 0; i < whole_tape.entry_count; i++) {
+    const pjson_tape_entry *entry = &whole_tape.entries[i];
+    counts[entry->type]++;
+    if (entry->type == PJSON_TOKEN_OPEN_BRACKET || entry->type == PJSON_TOKEN_OPEN_BRACE) {
+      TEST_ASSERT_TRUE(entry->match_index > i);
+      TEST_ASSERT_EQUAL(i, whole_tape.entries[entry->match_index].match_index);
+      TEST_ASSERT_EQUAL(entry->type + 2, whole_tape.entries[entry->match_index].type);
+    }
+  }
+  TEST_ASSERT_EQUAL(whole_tape.entry_count - 1, whole_tape.entries[0].match_index);
+  TEST_ASSERT_EQUAL(25000 + 28000, counts[PJSON_TOKEN_STRING]);
+  TEST_ASSERT_EQUAL(7000, counts[PJSON_TOKEN_NUMBER]);
+  TEST_ASSERT_EQUAL(2001, counts[PJSON_TOKEN_CLOSE_BRACKET]);
+  TEST_ASSERT_EQUAL(4000, counts[PJSON_TOKEN_CLOSE_BRACE]);
+  TEST_ASSERT_EQUAL(0, counts[PJSON_TOKEN_COMMA] + counts[PJSON_TOKEN_COLON]);
+
+  // Feeding the input in chunks (which are overwritten afterwards) results in the same tape.
+  pjson_tape tape;
+  pjson_init_tape(&tokenizer, &tape, NULL, 0);
+  uint8_t buf[64];
+  for (size_t offset = 0; offset < length; offset += sizeof(buf)) {
+    size_t chunk_length = length - offset < sizeof(buf) ? length - offset : sizeof(buf);
+    memcpy(buf, data + offset, chunk_length);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_feed(&tokenizer, buf, chunk_length));
+    memset(buf, 0, sizeof(buf));
+  }
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+  TEST_ASSERT_EQUAL(whole_tape.entry_count, tape.entry_count);
+  TEST_ASSERT_TRUE(tape.strings_length > 0);
+  for (size_t i = 0; i < tape.entry_count; i++) {
+    const pjson_tape_entry *expected = &whole_tape.entries[i], *actual = &tape.entries[i];
+    TEST_ASSERT_EQUAL(expected->type, actual->type);
+    TEST_ASSERT_EQUAL(expected->start_index, actual->start_index);
+    TEST_ASSERT_EQUAL(expected->length, actual->length);
+    TEST_ASSERT_EQUAL(expected->unescaped_length, actual->unescaped_length);
+    TEST_ASSERT_EQUAL(expected->match_index, actual->match_index);
+    TEST_ASSERT_EQUAL_MEMORY(pjson_tape_entry_data(&whole_tape, expected, data), pjson_tape_entry_data(&tape, actual, data), actual->length);
+  }
+
+  pjson_tape_free(&tape);
+  pjson_tape_free(&whole_tape);
+  free(data);
+}
+
+TEST(tape, test_tape_streamed_strings) {
+  static const char input[] = "{\"name\": \"0123456789abcdefghij\", \"b\": [\"0123456789\"]}";
+
+  // The value of "name" straddles the chunks and is streamed: its entry is flagged as it has no bytes to point to.
+  counting_chunk_handler handler;
+  counting_chunk_handler_init(&handler, 4);
+  pjson_tokenizer_options options = { .string_chunk_handler = &handler.base };
+  pjson_tape tape;
+  pjson_tokenizer tokenizer;
+  pjson_init_tape_ex(&tokenizer, &tape, NULL, 0, &options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, feed_split(&tokenizer, input, 14));
+  TEST_ASSERT_EQUAL(1, handler.string_count);
+  TEST_ASSERT_EQUAL(20, handler.byte_count);
+
+  TEST_ASSERT_EQUAL(8, tape.entry_count);
+  assert_entry(&tape, input, 1, PJSON_TOKEN_STRING, "\"name\"", PJSON_TAPE_NO_INDEX);
+  const pjson_tape_entry *entry = &tape.entries[2];
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, entry->type);
+  TEST_ASSERT_EQUAL(9, entry->start_index);
+  TEST_ASSERT_EQUAL(22, entry->length);
+  TEST_ASSERT_EQUAL(20, entry->unescaped_length);
+  TEST_ASSERT_EQUAL(PJSON_TAPE_STREAMED, entry->string_offset);
+  TEST_ASSERT_NULL(pjson_tape_entry_data(&tape, entry, (const uint8_t *)input));
+  assert_entry(&tape, input, 5, PJSON_TOKEN_STRING, "\"0123456789\"", PJSON_TAPE_NO_INDEX);
+  assert_entry(&tape, input, 7, PJSON_TOKEN_CLOSE_BRACE, "}", 0);
+
+  pjson_tape_free(&tape);
+}
+
+TEST(tape, test_tape_syntax_errors) {
+  pjson_tape tape;
+  size_t error_index;
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "[1 2]", &error_index));
+  TEST_ASSERT_EQUAL(3, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "[1, 2}", &error_index));
+  TEST_ASSERT_EQUAL(5, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "[1,]", &error_index));
+  TEST_ASSERT_EQUAL(3, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "{1: 2}", &error_index));
+  TEST_ASSERT_EQUAL(1, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "{\"a\" 1}", &error_index));
+  TEST_ASSERT_EQUAL(5, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "{\"a\": 1,}", &error_index));
+  TEST_ASSERT_EQUAL(8, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "[[]", &error_index));
+  TEST_ASSERT_EQUAL(3, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_SYNTAX_ERROR, tape_string(&tape, "1 2", &error_index));
+  TEST_ASSERT_EQUAL(2, error_index);
+  pjson_tape_free(&tape);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_NO_TOKENS_FOUND, tape_string(&tape, " ", NULL));
+  pjson_tape_free(&tape);
+}
+
+TEST_GROUP_RUNNER(tape) {
+  RUN_TEST_CASE(tape, test_tape_small_document);
+  RUN_TEST_CASE(tape, test_tape_minified_1mb);
+  RUN_TEST_CASE(tape, test_tape_streamed_strings);
+  RUN_TEST_CASE(tape, test_tape_syntax_errors);
+}
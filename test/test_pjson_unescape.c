@@ -0,0 +1,136 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity_fixture.h"
+#include "pjson.h"
+#include "test_data.h"
+#include "checking_parser.h"
+#include "test_input.h"
+
+TEST_GROUP(unescape);
+
+TEST_SETUP(unescape) {}
+
+TEST_TEAR_DOWN(unescape) {}
+
+typedef struct {
+  checking_parser base; // base struct MUST be the first member!
+  bool unescape_strings;
+  size_t string_count;
+  size_t escaped_string_count;
+  uint8_t last_string[64]; // zero-terminated copy of the last unescaped string (truncated if longer)
+} unescape_checker;
+
+/**
+ * Check that the unescaped string provided by the tokenizer equals the output of `pjson_parse_string`.
+ */
+static void check_unescaped_token(checking_parser *base, const pjson_token *token) {
+  unescape_checker *parser = (unescape_checker *)base;
+  if (!parser->unescape_strings || token->type != PJSON_TOKEN_STRING) {
+    TEST_ASSERT_NULL(token->unescaped);
+    return;
+  }
+
+  TEST_ASSERT_NOT_NULL(token->unescaped);
+  parser->string_count++;
+  if (token->unescaped != token->start + 1) parser->escaped_string_count++;
+
+  uint8_t *expected = (uint8_t *)malloc(token->unescaped_length + 1);
+  TEST_ASSERT_NOT_NULL(expected);
+  TEST_ASSERT_TRUE(pjson_parse_string(expected, token->unescaped_length, token->start, token->length, true));
+  TEST_ASSERT_EQUAL_MEMORY(expected, token->unescaped, token->unescaped_length);
+  free(expected);
+
+  size_t length = token->unescaped_length < sizeof(parser->last_string) - 1 ? token->unescaped_length : sizeof(parser->last_string) - 1;
+  memcpy(parser->last_string, token->unescaped, length);
+  parser->last_string[length] = 0;
+}
+
+static void unescape_checker_init(unescape_checker *parser, bool unescape_strings) {
+  checking_parser_init(&parser->base, sizeof(*parser), &check_unescaped_token);
+  parser->unescape_strings = unescape_strings;
+}
+
+static const pjson_tokenizer_options unescape_options = { .unescape_strings = true };
+
+TEST(unescape, test_unescape_disabled_by_default) {
+  static const char input[] = "[\"a\\nb\", \"c\", 1]";
+
+  unescape_checker parser;
+  unescape_checker_init(&parser, false);
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, NULL);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_feed(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(0, parser.string_count);
+}
+
+TEST(unescape, test_unescape_escape_sequences_split_between_chunks) {
+  static const char input[] = "{\"k\\u00e9y\": \"\\\"quoted\\\" \\\\ \\/ \\b\\f\\n\\r\\t\", \"plain\": \"\xc3\xa9t\xc3\xa9\", "
+    "\"pair\": \"\\uD83D\\uDE00\", \"lone\": \"\\uD800x\\uDC00\"}";
+
+  for (size_t chunk_size = 1; chunk_size <= 8; chunk_size++) {
+    unescape_checker parser;
+    unescape_checker_init(&parser, true);
+    pjson_tokenizer tokenizer;
+    pjson_init_ex(&tokenizer, &parser.base.base, &unescape_options);
+    TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, (const uint8_t *)input, sizeof(input) - 1, chunk_size, &pjson_feed));
+    TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+    TEST_ASSERT_EQUAL(8, parser.string_count);
+    TEST_ASSERT_EQUAL(4, parser.escaped_string_count);
+    TEST_ASSERT_EQUAL_STRING("\xef\xbf\xbdx\xef\xbf\xbd", (const char *)parser.last_string);
+  }
+}
+
+TEST(unescape, test_unescape_formatted_1mb) {
+  size_t length;
+  uint8_t *data = load_file("test/data/formatted_1mb.json", &length);
+
+  unescape_checker parser;
+  unescape_checker_init(&parser, true);
+  pjson_tokenizer tokenizer;
+  pjson_init_ex(&tokenizer, &parser.base.base, &unescape_options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_in_chunks(&tokenizer, data, length, 100, &pjson_feed));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(19375 + 21700, parser.string_count);
+
+  // Whole-buffer indexing references escape-free strings in place and falls back to the byte-wise scanner otherwise.
+  unescape_checker index_parser;
+  unescape_checker_init(&index_parser, true);
+  pjson_init_ex(&tokenizer, &index_parser.base.base, &unescape_options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_index(&tokenizer, data, length));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+  TEST_ASSERT_EQUAL(parser.string_count, index_parser.string_count);
+  TEST_ASSERT_EQUAL(parser.escaped_string_count, index_parser.escaped_string_count);
+
+  free(data);
+}
+
+TEST(unescape, test_unescape_batch) {
+  static const char input[] = "[\"a\\nb\", \"c\", \"d\\te\", \"f\\u0041\"]";
+
+  // Unescaped strings are backed by a scratch buffer reused by the next string, so each is delivered in its own batch.
+  pjson_token tokens[16];
+  unescape_checker parser;
+  unescape_checker_init(&parser, true);
+  checking_sink sink;
+  checking_sink_init(&sink, tokens, pjson_countof(tokens), &parser.base);
+  pjson_tokenizer tokenizer;
+  pjson_init_batch_ex(&tokenizer, &sink.base, &unescape_options);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, pjson_feed_batch(&tokenizer, (const uint8_t *)input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, pjson_close(&tokenizer));
+
+  TEST_ASSERT_EQUAL(4, parser.string_count);
+  TEST_ASSERT_EQUAL(3, parser.escaped_string_count);
+  TEST_ASSERT_EQUAL_STRING("fA", (const char *)parser.last_string);
+}
+
+TEST_GROUP_RUNNER(unescape) {
+  RUN_TEST_CASE(unescape, test_unescape_disabled_by_default);
+  RUN_TEST_CASE(unescape, test_unescape_escape_sequences_split_between_chunks);
+  RUN_TEST_CASE(unescape, test_unescape_formatted_1mb);
+  RUN_TEST_CASE(unescape, test_unescape_batch);
+}
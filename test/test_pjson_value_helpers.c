@@ -23,6 +23,40 @@ static pjson_parsing_status parse_string(tlv_parser *parser, const char *input,
   return pjson_close(&tokenizer);
 }
 
+/* Tokens terminated by the end of input */
+
+TEST(value_helpers, test_keyword_at_end_of_input) {
+  tlv_parser parser;
+  tlv_parser_init(&parser);
+
+  pjson_parsing_status feed_status;
+  pjson_parsing_status close_status = parse_string(&parser, "false", &feed_status);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_status);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, close_status);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_FALSE, parser.token.type);
+  TEST_ASSERT_EQUAL(5, parser.token.length);
+  TEST_ASSERT_EQUAL(5, parser.token.unescaped_length);
+
+  pjson_free((uint8_t *)parser.token.start);
+}
+
+TEST(value_helpers, test_number_at_end_of_input) {
+  tlv_parser parser;
+  tlv_parser_init(&parser);
+
+  pjson_parsing_status feed_status;
+  pjson_parsing_status close_status = parse_string(&parser, "-12.5e3", &feed_status);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_status);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, close_status);
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_NUMBER, parser.token.type);
+  TEST_ASSERT_EQUAL(7, parser.token.length);
+  TEST_ASSERT_EQUAL(7, parser.token.unescaped_length);
+
+  pjson_free((uint8_t *)parser.token.start);
+}
+
 /* int32 */
 
 static bool parse_int32_value(int32_t *value, const char *input) {
@@ -363,6 +397,46 @@ TEST(value_helpers, test_parse_string_unicode_escape_sequences) {
   pjson_free(value);
 }
 
+TEST(value_helpers, test_parse_string_long_ascii_runs) {
+  char *value;
+  TEST_ASSERT_TRUE(parse_string_value(&value, "\"The quick brown fox jumps over the lazy dog.\\tThe quick brown fox jumps over the lazy dog.\\u00e9The quick brown fox jumps over the lazy dog.\"", false));
+  TEST_ASSERT_EQUAL_STRING("The quick brown fox jumps over the lazy dog.\tThe quick brown fox jumps over the lazy dog.\303\251The quick brown fox jumps over the lazy dog.", value);
+  pjson_free(value);
+}
+
+TEST(value_helpers, test_parse_string_long_utf8_runs) {
+  char *value;
+  TEST_ASSERT_TRUE(parse_string_value(&value, "\"\344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200 \344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200\\n"
+    "\344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200 \344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200\\u00e9\"", false));
+  TEST_ASSERT_EQUAL_STRING("\344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200 \344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200\n"
+    "\344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200 \344\275\240\345\245\275\344\270\226\347\225\214 \360\237\230\200\303\251", value);
+  pjson_free(value);
+}
+
+TEST(value_helpers, test_parse_string_utf8_split_between_chunks_followed_by_unicode_escape_sequence) {
+  tlv_parser parser;
+  tlv_parser_init(&parser);
+
+  pjson_tokenizer tokenizer;
+  pjson_init(&tokenizer, &parser.base.base);
+  pjson_parsing_status feed_status1 = pjson_feed(&tokenizer, (uint8_t *)"\"\360\237\230", 4);
+  pjson_parsing_status feed_status2 = pjson_feed(&tokenizer, (uint8_t *)"\200\\u00e9\"", 8);
+  pjson_parsing_status close_status = pjson_close(&tokenizer);
+
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_status1);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_DATA_NEEDED, feed_status2);
+  TEST_ASSERT_EQUAL(PJSON_STATUS_COMPLETED, close_status);
+
+  TEST_ASSERT_EQUAL(PJSON_TOKEN_STRING, parser.token.type);
+  TEST_ASSERT_EQUAL(6, parser.token.unescaped_length);
+  char value[7];
+  TEST_ASSERT_TRUE(pjson_parse_string((uint8_t *)value, 6, parser.token.start, parser.token.length, false));
+  value[6] = 0;
+  TEST_ASSERT_EQUAL_STRING("\360\237\230\200\303\251", value);
+
+  pjson_free((uint8_t *)parser.token.start);
+}
+
 TEST(value_helpers, test_parse_string_lone_high_surrogate_followed_by_nothing_no_replace) {
   char *value;
   TEST_ASSERT_FALSE(parse_string_value(&value, "\"\\uD800\"", false));
@@ -443,6 +517,9 @@ TEST(value_helpers, test_parse_string_lone_low_surrogate_followed_by_nonescaped_
 }
 
 TEST_GROUP_RUNNER(value_helpers) {
+  RUN_TEST_CASE(value_helpers, test_keyword_at_end_of_input);
+  RUN_TEST_CASE(value_helpers, test_number_at_end_of_input);
+
   RUN_TEST_CASE(value_helpers, test_parse_int32_less_than_min);
   RUN_TEST_CASE(value_helpers, test_parse_int32_min);
   RUN_TEST_CASE(value_helpers, test_parse_int32_minus_zero);
@@ -483,6 +560,9 @@ TEST_GROUP_RUNNER(value_helpers) {
   RUN_TEST_CASE(value_helpers, test_parse_string_utf8);
   RUN_TEST_CASE(value_helpers, test_parse_string_basic_escape_sequences);
   RUN_TEST_CASE(value_helpers, test_parse_string_unicode_escape_sequences);
+  RUN_TEST_CASE(value_helpers, test_parse_string_long_ascii_runs);
+  RUN_TEST_CASE(value_helpers, test_parse_string_long_utf8_runs);
+  RUN_TEST_CASE(value_helpers, test_parse_string_utf8_split_between_chunks_followed_by_unicode_escape_sequence);
   RUN_TEST_CASE(value_helpers, test_parse_string_lone_high_surrogate_followed_by_nothing_no_replace);
   RUN_TEST_CASE(value_helpers, test_parse_string_lone_high_surrogate_followed_by_nothing_replace);
   RUN_TEST_CASE(value_helpers, test_parse_string_lone_high_surrogate_followed_by_nonescaped_no_replace);